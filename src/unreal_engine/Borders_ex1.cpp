@@ -8,14 +8,21 @@
 #include "Containers/Queue.h"
 #include "Components/Border.h"
 #include "Serialization/JsonReader.h"
+#include "GameStateStoryGen.h"
+#include "GameFramework/PlayerState.h"
+#include "Stats/Stats.h"
 
-float TimeSinceLastRead = 0.0f;
+DECLARE_STATS_GROUP(TEXT("StoryHUD"), STATGROUP_StoryHUD, STATCAT_Advanced);
+DECLARE_CYCLE_STAT(TEXT("Update history"), STAT_StoryHUD_UpdateHistory, STATGROUP_StoryHUD);
+DECLARE_CYCLE_STAT(TEXT("History text layout"), STAT_StoryHUD_HistoryLayout, STATGROUP_StoryHUD);
 
 void UHUD_ContentRetreiver::NativeConstruct()
 {
     Super::NativeConstruct();
 
     GameStateTexts = { GameStateText_0, GameStateText_1, GameStateText_2 };
+    GameStateBorders = { GameStateBorder_0, GameStateBorder_1, GameStateBorder_2 };
+    RingHead = 0;
 
     if (GameStateTexts.Contains(nullptr))
     {
@@ -27,6 +34,42 @@ void UHUD_ContentRetreiver::NativeConstruct()
     if (GameStateBorder_2) GameStateBorder_2->SetVisibility(ESlateVisibility::Collapsed);
 
     BordersChanged.Init(false, 3);
+
+    // New responses are pushed by the owning player's story stream instead of polling LLM_response.txt.
+    // On a client the PlayerState may not have replicated yet, NativeTick() retries then.
+    if (!SubscribeToStream())
+    {
+        UE_LOG(LogTemp, Log, TEXT("No story stream for the owning player yet, HUD subscribes once its PlayerState has replicated."));
+    }
+}
+
+bool UHUD_ContentRetreiver::SubscribeToStream()
+{
+    AGameStateStoryGen* GameState = GetWorld() ? GetWorld()->GetGameState<AGameStateStoryGen>() : nullptr;
+    const int32 Index = GameState ? GameState->FindOrAddPlayer(GetOwningPlayerState()) : INDEX_NONE;
+    FStoryPlayerStream* Stream = GameState ? GameState->GetPlayerStream(Index) : nullptr;
+    if (!Stream)
+    {
+        return false;
+    }
+
+    PlayerIndex = Index;
+    NarrationHandle = Stream->OnNarration.AddUObject(this, &UHUD_ContentRetreiver::OnNarration);
+    return true;
+}
+
+void UHUD_ContentRetreiver::NativeDestruct()
+{
+    AGameStateStoryGen* GameState = GetWorld() ? GetWorld()->GetGameState<AGameStateStoryGen>() : nullptr;
+    FStoryPlayerStream* Stream = GameState ? GameState->GetPlayerStream(PlayerIndex) : nullptr;
+    if (Stream)
+    {
+        Stream->OnNarration.Remove(NarrationHandle);
+    }
+    PlayerIndex = INDEX_NONE;
+    NarrationHandle.Reset();
+
+    Super::NativeDestruct();
 }
 
 
@@ -34,34 +77,11 @@ void UHUD_ContentRetreiver::NativeTick(const FGeometry& MyGeometry, float InDelt
 {
 
     Super::NativeTick(MyGeometry, InDeltaTime);
-    TimeSinceLastRead += InDeltaTime;
     TimeSinceLastBorderUpdate += InDeltaTime;
 
-    if (TimeSinceLastRead >= 4.0f)
+    if (PlayerIndex == INDEX_NONE)
     {
-        FString FilePath = FPaths::ProjectDir() + TEXT("LLM_Response/LLM_response.txt");
-        FString NewResponse;
-
-        if (FFileHelper::LoadFileToString(NewResponse, *FilePath))
-        {
-            if (NewResponse != prevResponse)
-            {
-                {
-                    ProcessNewResponse(NewResponse);
-                    prevResponse = NewResponse;
-
-                    TimeSinceLastBorderUpdate = 0.0f;
-                    BordersChanged.Init(true, BordersChanged.Num());
-                    UpdateBorderVisibility(); 
-
-                }
-            }
-            else if (!NewResponse.IsEmpty() && NewResponse == prevResponse)
-            {
-                UE_LOG(LogTemp, Log, TEXT("No new response. Skipping update."));
-            }
-        }
-        TimeSinceLastRead = 0.0f;
+        SubscribeToStream();
     }
 
     //Border trigger
@@ -87,6 +107,17 @@ void UHUD_ContentRetreiver::NativeTick(const FGeometry& MyGeometry, float InDelt
     */
 }
 
+void UHUD_ContentRetreiver::OnNarration(const FString& NewResponse, uint32 StreamId)
+{
+    // Called by OnNarration of the player's story stream on the game thread, once per complete response.
+    // The history panel does not subscribe to OnNarrationChunk, streamed responses are shown when complete.
+    ProcessNewResponse(NewResponse);
+    prevResponse = NewResponse;
+
+    TimeSinceLastBorderUpdate = 0.0f;
+    BordersChanged.Init(true, BordersChanged.Num());
+}
+
 void UHUD_ContentRetreiver::ProcessNewResponse(const FString& NewResponse)
 {
     ResponseQueue.Enqueue(NewResponse);
@@ -94,12 +125,18 @@ void UHUD_ContentRetreiver::ProcessNewResponse(const FString& NewResponse)
     AsyncTask(ENamedThreads::GameThread, [this]()
         {
             UpdateTextBlocks();
+            UpdateBorderVisibility();
+            if (bUseLayoutCache && !GameStateBorders.Contains(nullptr))
+            {
+                ApplyHistoryOrder();
+            }
         });
 }
 
 
 void UHUD_ContentRetreiver::UpdateTextBlocks()
 {
+    SCOPE_CYCLE_COUNTER(STAT_StoryHUD_UpdateHistory);
 
     if (ResponseQueue.IsEmpty())
     {
@@ -112,22 +149,108 @@ void UHUD_ContentRetreiver::UpdateTextBlocks()
     {
 
         UE_LOG(LogTemp, Log, TEXT("Dequeued response: %s"), *RetrievedResponse);
-        for (int i = GameStateTexts.Num() - 1; i > 0; --i)
+        if (bUseLayoutCache && !GameStateTexts.Contains(nullptr) && !GameStateBorders.Contains(nullptr))
+        {
+            RotateHistory(RetrievedResponse);
+        }
+        else
         {
-            if (GameStateTexts[i] && GameStateTexts[i - 1])
+            for (int i = GameStateTexts.Num() - 1; i > 0; --i)
+            {
+                if (GameStateTexts[i] && GameStateTexts[i - 1])
+                {
+                    GameStateTexts[i]->SetText(GameStateTexts[i - 1]->GetText());
+                }
+            }
+
+            if (GameStateTexts[0])
             {
-                GameStateTexts[i]->SetText(GameStateTexts[i - 1]->GetText());
+                GameStateTexts[0]->SetText(FText::FromString(RetrievedResponse));
+            }
+
+            // Every block was given new text and is laid out again
+            SCOPE_CYCLE_COUNTER(STAT_StoryHUD_HistoryLayout);
+            for (UBorder* Border : GameStateBorders)
+            {
+                if (Border) Border->ForceLayoutPrepass();
             }
         }
 
-        if (GameStateTexts[0])
+        UE_LOG(LogTemp, Log, TEXT("GameStateText widgets updated successfully."));
+    }
+}
+
+void UHUD_ContentRetreiver::RotateHistory(const FString& NewResponse)
+{
+    /**
+     * # RotateHistory
+     *
+     * ## Brief
+     * Shows a new response at the top of the history by reusing the entry of the oldest response.
+     *
+     * ## Details
+     * The three border/text entries form a ring. `RingHead` is the entry with the newest response.
+     * A new response moves the head back one entry and overwrites the oldest text, the only text that is
+     * shaped and laid out again. The other entries keep their cached text layout and are only moved
+     * to their new place with `ApplyHistoryOrder()`.
+     *
+     * ## Note
+     * Compare `stat StoryHUD` and `stat Slate` with `bUseLayoutCache` on and off to see the difference.
+     */
+    const int32 Num = GameStateTexts.Num();
+    RingHead = (RingHead + Num - 1) % Num;
+    GameStateTexts[RingHead]->SetText(FText::FromString(NewResponse));
+
+    {
+        SCOPE_CYCLE_COUNTER(STAT_StoryHUD_HistoryLayout);
+        GameStateBorders[RingHead]->ForceLayoutPrepass();
+    }
+    ApplyHistoryOrder();
+}
+
+void UHUD_ContentRetreiver::ApplyHistoryOrder()
+{
+    /**
+     * # ApplyHistoryOrder
+     *
+     * ## Brief
+     * Moves the history entries into ring order (newest on top) with render translations.
+     *
+     * ## Details
+     * The entries stay in their slots of the panel, in the order Border_0, Border_1, Border_2.
+     * Each entry is translated by the difference between the position its slot has and the position
+     * it should have in ring order. Render translations only affect painting, so no text is laid out again.
+     */
+    const int32 Num = GameStateBorders.Num();
+
+    TArray<float> Heights;
+    Heights.SetNumZeroed(Num);
+    for (int32 i = 0; i < Num; i++)
+    {
+        if (GameStateBorders[i]->GetVisibility() != ESlateVisibility::Collapsed)
         {
-            GameStateTexts[0]->SetText(FText::FromString(RetrievedResponse));
+            Heights[i] = GameStateBorders[i]->GetDesiredSize().Y;
         }
+    }
 
-        UE_LOG(LogTemp, Log, TEXT("GameStateText widgets updated successfully."));
+    float SlotY = 0.0f;
+    TArray<float> SlotPositions;
+    SlotPositions.SetNumZeroed(Num);
+    for (int32 i = 0; i < Num; i++)
+    {
+        SlotPositions[i] = SlotY;
+        SlotY += Heights[i];
+    }
+
+    float TargetY = 0.0f;
+    for (int32 Position = 0; Position < Num; Position++)
+    {
+        int32 Entry = (RingHead + Position) % Num;
+        GameStateBorders[Entry]->SetRenderTranslation(FVector2D(0.0f, TargetY - SlotPositions[Entry]));
+        TargetY += Heights[Entry];
     }
 }
+
 void UHUD_ContentRetreiver::UpdateBorderVisibility()
 {
     TArray<UTextBlock*> TextBlocks = { GameStateText_0, GameStateText_1, GameStateText_2 };
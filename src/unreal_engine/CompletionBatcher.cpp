@@ -0,0 +1,195 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "CompletionBatcher.h"
+#include "Dom/JsonValue.h"
+
+/**
+ * # File: CompletionBatcher.cpp
+ *
+ * ## Brief
+ * Implements the micro-batching of the actor movement prompts.
+ *
+ * ## Details
+ * When several actors move in the same tracking pass, every actor sent its own request, and a local server on the
+ * CPU ran them one after the other. The game mode now collects them:
+ * - The first payload opens a window of `WindowSeconds`. Payloads that arrive before it closes join the batch,
+ *   a full batch (`MaxBatchSize`) is sent right away.
+ * - The batch is one `/v1/completions` request with an array of prompts. The server computes the prompts together,
+ *   which uses the CPU better than one prompt at a time.
+ * - Each choice carries the `index` of its prompt, `Demultiplex()` gives every prompt its text back in order.
+ *   Some llama.cpp versions answer with a JSON array of one result per prompt instead, which is read as well.
+ * - A batch that fails, or whose response has neither shape, is sent again one prompt per request by the HTTP handler.
+ *   So is a prompt without a choice in a batch that succeeded.
+ * - Batches are not pinned to a server slot, so the server spreads their prompts over its parallel slots.
+ *   The handler reports the throughput in generated tokens per second next to the average batch size.
+ */
+
+bool FCompletionBatcher::Add(FBatchedPayload&& Payload)
+{
+	Pending.Add(MoveTemp(Payload));
+	return Pending.Num() == 1;
+}
+
+TArray<FBatchedPayload> FCompletionBatcher::TakeBatch()
+{
+	TArray<FBatchedPayload> Batch = MoveTemp(Pending);
+	Pending.Reset();
+	if (Batch.Num() > 0)
+	{
+		Stats.Batches++;
+		Stats.Payloads += Batch.Num();
+	}
+	return Batch;
+}
+
+static const TSharedPtr<FJsonObject>* GetObjectAt(const TArray<TSharedPtr<FJsonValue>>& Values, int32 Index)
+{
+	const TSharedPtr<FJsonObject>* Object;
+	return Values[Index].IsValid() && Values[Index]->TryGetObject(Object) ? Object : nullptr;
+}
+
+bool FCompletionBatcher::Demultiplex(const TSharedPtr<FJsonValue>& JsonResponse, int32 NumPrompts, TArray<FString>& OutTexts)
+{
+	/**
+	 * # Function: Demultiplex()
+	 *
+	 * ## Brief
+	 * Sorts the texts of a batched response back to their prompts. Returns false if the response has another shape.
+	 *
+	 * ## Details
+	 * Two shapes are read:
+	 * - **Object**: one `choices` array with a choice per prompt, sorted by the `index` of each choice.
+	 * - **Array**: llama.cpp answers a multi-prompt request with one result per prompt, either a completion with
+	 *   its own `choices` or a `content` string. Sorted by the `index` of each result.
+	 *
+	 * Choices and results without an index are taken in order. Indices outside the batch are ignored.
+	 */
+	OutTexts.Reset();
+	OutTexts.SetNum(NumPrompts);
+	if (!JsonResponse.IsValid())
+	{
+		return false;
+	}
+
+	const TSharedPtr<FJsonObject>* Object;
+	const TArray<TSharedPtr<FJsonValue>>* Choices;
+	if (JsonResponse->TryGetObject(Object))
+	{
+		if (!(*Object)->TryGetArrayField(TEXT("choices"), Choices))
+		{
+			return false;
+		}
+
+		for (int32 i = 0; i < Choices->Num(); i++)
+		{
+			const TSharedPtr<FJsonObject>* Choice = GetObjectAt(*Choices, i);
+			if (!Choice)
+			{
+				continue;
+			}
+
+			int32 Index = i;
+			(*Choice)->TryGetNumberField(TEXT("index"), Index);
+			if (OutTexts.IsValidIndex(Index))
+			{
+				(*Choice)->TryGetStringField(TEXT("text"), OutTexts[Index]);
+			}
+		}
+		return true;
+	}
+
+	const TArray<TSharedPtr<FJsonValue>>* Results;
+	if (!JsonResponse->TryGetArray(Results))
+	{
+		return false;
+	}
+
+	for (int32 i = 0; i < Results->Num(); i++)
+	{
+		const TSharedPtr<FJsonObject>* Result = GetObjectAt(*Results, i);
+		if (!Result)
+		{
+			continue;
+		}
+
+		int32 Index = i;
+		(*Result)->TryGetNumberField(TEXT("index"), Index);
+		if (!OutTexts.IsValidIndex(Index))
+		{
+			continue;
+		}
+
+		// The choice index of a per-prompt completion is 0, the result index is the prompt
+		const TSharedPtr<FJsonObject>* Choice = (*Result)->TryGetArrayField(TEXT("choices"), Choices) && Choices->Num() > 0 ? GetObjectAt(*Choices, 0) : nullptr;
+		if (Choice)
+		{
+			(*Choice)->TryGetStringField(TEXT("text"), OutTexts[Index]);
+		}
+		else
+		{
+			(*Result)->TryGetStringField(TEXT("content"), OutTexts[Index]);
+		}
+	}
+	return true;
+}
+
+static int64 GetUsageTokens(const TSharedPtr<FJsonObject>& Object)
+{
+	// OpenAI usage, or the counter of a llama.cpp result
+	const TSharedPtr<FJsonObject>* Usage;
+	int64 Tokens = 0;
+	if (Object->TryGetObjectField(TEXT("usage"), Usage) && (*Usage)->TryGetNumberField(TEXT("completion_tokens"), Tokens))
+	{
+		return Tokens;
+	}
+	return Object->TryGetNumberField(TEXT("tokens_predicted"), Tokens) ? Tokens : INDEX_NONE;
+}
+
+int64 FCompletionBatcher::CountCompletionTokens(const TSharedPtr<FJsonValue>& JsonResponse, TConstArrayView<FString> Texts)
+{
+	/**
+	 * # Function: CountCompletionTokens()
+	 *
+	 * ## Brief
+	 * Returns the generated tokens of a response: the `usage` of a completion, or the sum over the results
+	 * of a llama.cpp array. Without counters the tokens are estimated, about four characters per token.
+	 */
+	int64 Tokens = INDEX_NONE;
+	const TSharedPtr<FJsonObject>* Object;
+	const TArray<TSharedPtr<FJsonValue>>* Results;
+	if (JsonResponse.IsValid() && JsonResponse->TryGetObject(Object))
+	{
+		Tokens = GetUsageTokens(*Object);
+	}
+	else if (JsonResponse.IsValid() && JsonResponse->TryGetArray(Results))
+	{
+		for (int32 i = 0; i < Results->Num(); i++)
+		{
+			const TSharedPtr<FJsonObject>* Result = GetObjectAt(*Results, i);
+			const int64 ResultTokens = Result ? GetUsageTokens(*Result) : INDEX_NONE;
+			if (ResultTokens == INDEX_NONE)
+			{
+				Tokens = INDEX_NONE;
+				break;
+			}
+			Tokens = FMath::Max<int64>(Tokens, 0) + ResultTokens;
+		}
+	}
+
+	if (Tokens == INDEX_NONE)
+	{
+		Tokens = 0;
+		for (const FString& Text : Texts)
+		{
+			Tokens += (Text.Len() + 3) / 4;
+		}
+	}
+	return Tokens;
+}
+
+void FCompletionBatcher::LogStats() const
+{
+	UE_LOG(LogTemp, Log, TEXT("Completion batching: %lld payloads in %lld requests, %.2f prompts per request."),
+		Stats.Payloads, Stats.Batches, Stats.GetAverageBatchSize());
+}
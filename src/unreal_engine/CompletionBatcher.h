@@ -0,0 +1,64 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Dom/JsonObject.h"
+#include "Dom/JsonValue.h"
+
+/**
+ * One payload waiting for the next batched completion.
+ */
+struct FBatchedPayload
+{
+	FString Payload;
+	FString Question;
+	FString Context;
+};
+
+/**
+ * Batch counters of the completion batcher, and the throughput of the requests the HTTP handler sent.
+ */
+struct FCompletionBatchStats
+{
+	int64 Batches = 0;
+	int64 Payloads = 0;
+
+	// Generated tokens and seconds with requests in flight, see FCompletionBatcher::CountCompletionTokens()
+	int64 CompletionTokens = 0;
+	double ResponseSeconds = 0.0;
+
+	double GetAverageBatchSize() const { return Batches > 0 ? double(Payloads) / double(Batches) : 0.0; }
+	double GetTokensPerSecond() const { return ResponseSeconds > 0.0 ? double(CompletionTokens) / ResponseSeconds : 0.0; }
+};
+
+/**
+ * Collects the payloads that arrive within a short window, so a local server gets them as one batched completion.
+ * See CompletionBatcher.cpp.
+ */
+class PROJECT_API FCompletionBatcher
+{
+public:
+	// Returns true when the payload opens a new window, the caller then starts the window timer
+	bool Add(FBatchedPayload&& Payload);
+	bool HasPending() const { return Pending.Num() > 0; }
+	bool IsFull() const { return Pending.Num() >= MaxBatchSize; }
+	TArray<FBatchedPayload> TakeBatch();
+
+	// Text of each prompt from a response with one choice or result per prompt, empty for prompts without one.
+	// Returns false when the response is neither a completion with choices nor an array of results.
+	static bool Demultiplex(const TSharedPtr<FJsonValue>& JsonResponse, int32 NumPrompts, TArray<FString>& OutTexts);
+
+	// Generated tokens of a response as reported by the server, estimated from Texts if it reports none
+	static int64 CountCompletionTokens(const TSharedPtr<FJsonValue>& JsonResponse, TConstArrayView<FString> Texts);
+
+	const FCompletionBatchStats& GetStats() const { return Stats; }
+	void LogStats() const;
+
+	float WindowSeconds = 0.2f;
+	int32 MaxBatchSize = 8;
+
+private:
+	TArray<FBatchedPayload> Pending;
+	FCompletionBatchStats Stats;
+};
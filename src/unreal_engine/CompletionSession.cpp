@@ -0,0 +1,115 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "CompletionSession.h"
+
+/**
+ * # File: CompletionSession.cpp
+ *
+ * ## Brief
+ * Implements the prompt sessions of the `/v1/completions` backends (LM Studio and the in-process model).
+ *
+ * ## Details
+ * A completion request is stateless, and `question + Payload` as a new prompt makes the server compute the whole
+ * context again. A local server keeps the KV cache of the last prompt in its slot, and reuses it for the part
+ * of the next prompt that is byte-identical. A session therefore only appends:
+ * 1. **Prefix**: the question, fixed for the session.
+ * 2. **Events**: one line per request, the new event last.
+ *
+ * Prompt n + 1 starts with all of prompt n, so only the new line is computed. Each session can be pinned to one of the
+ * slots the server was started with (`id_slot`), so sessions of different questions do not evict each other. When the
+ * prompt would grow past `MaxPromptChars`, the session starts over with at most the last `KeepEvents` events, as many
+ * as fit next to the new one. That request computes the whole prompt once. An event that does not fit a prompt on its
+ * own is cut, so no prompt is longer than `MaxPromptChars`.
+ *
+ * The prompts of a batch (`BuildPrompts()`) all extend the transcript before the batch with their own event. They are
+ * not pinned to the slot of the session, the server computes them in parallel slots.
+ */
+
+static const TCHAR* SessionInstruction = TEXT("Each line below is one event, earlier events first. Use the last line.\n");
+
+void FCompletionSession::Start(const FString& Question, int32 InSlot)
+{
+	Prefix = Question + SessionInstruction;
+	Transcript = Prefix;
+	Events.Reset();
+	Slot = InSlot;
+}
+
+FString FCompletionSession::BuildPrompt(const FString& Event)
+{
+	TArray<FString> Prompts;
+	BuildPrompts(MakeArrayView(&Event, 1), Prompts);
+	return Prompts[0];
+}
+
+void FCompletionSession::BuildPrompts(TConstArrayView<FString> NewEvents, TArray<FString>& OutPrompts)
+{
+	/**
+	 * # Function: BuildPrompts()
+	 *
+	 * ## Brief
+	 * Returns one prompt per event, then appends the events in order. Counts how much of each prompt the server has not seen.
+	 *
+	 * ## Details
+	 * Every prompt is the transcript before the call and its own event, so the prompts of a batch do not repeat
+	 * each other's events. The prompt of the next call starts with all of them.
+	 */
+	OutPrompts.Reset(NewEvents.Num());
+	TArray<FString> Lines;
+	int32 LongestLine = 0;
+	for (const FString& Event : NewEvents)
+	{
+		FString& Line = Lines.Add_GetRef(Event.Replace(TEXT("\n"), TEXT(" ")));
+		const int32 MaxLineChars = FMath::Max(0, MaxPromptChars - Prefix.Len() - 1);
+		if (Line.Len() > MaxLineChars)
+		{
+			Line.LeftInline(MaxLineChars);
+			Stats.CutEvents++;
+		}
+		Line.AppendChar(TEXT('\n'));
+		LongestLine = FMath::Max(LongestLine, Line.Len());
+	}
+
+	// The first prompt of the session is computed in full
+	int32 Reusable = Events.Num() > 0 ? Transcript.Len() : 0;
+	if (Transcript.Len() + LongestLine > MaxPromptChars && Events.Num() > 0)
+	{
+		// The last events, up to KeepEvents, as long as they fit next to the longest new one
+		int32 Budget = MaxPromptChars - Prefix.Len() - LongestLine;
+		int32 FirstKept = Events.Num();
+		while (FirstKept > 0 && Events.Num() - FirstKept < KeepEvents && Events[FirstKept - 1].Len() <= Budget)
+		{
+			FirstKept--;
+			Budget -= Events[FirstKept].Len();
+		}
+		Events.RemoveAt(0, FirstKept);
+		Transcript = Prefix;
+		for (const FString& Kept : Events)
+		{
+			Transcript += Kept;
+		}
+		Reusable = Prefix.Len();
+		Stats.Rollovers++;
+		LogStats();
+	}
+
+	for (const FString& Line : Lines)
+	{
+		const FString& Prompt = OutPrompts.Add_GetRef(Transcript + Line);
+		Stats.Requests++;
+		Stats.PromptChars += Prompt.Len();
+		Stats.NewChars += Prompt.Len() - Reusable;
+	}
+	for (FString& Line : Lines)
+	{
+		Transcript += Line;
+		Events.Add(MoveTemp(Line));
+	}
+}
+
+void FCompletionSession::LogStats() const
+{
+	UE_LOG(LogTemp, Log, TEXT("Completion session (slot %d): %lld requests, %lld rollovers, %lld events cut, %.1f%% of the prompt characters new to the server."),
+		Slot, Stats.Requests, Stats.Rollovers, Stats.CutEvents, Stats.GetNewRatio() * 100.0);
+}
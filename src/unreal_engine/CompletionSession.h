@@ -0,0 +1,55 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+/**
+ * Prompt reuse counters of a completion session.
+ */
+struct FCompletionSessionStats
+{
+	int64 Requests = 0;
+	int64 Rollovers = 0;
+	int64 CutEvents = 0;
+	int64 PromptChars = 0;
+	int64 NewChars = 0;
+
+	// Part of the prompts the server has to compute, the rest is in its KV cache
+	double GetNewRatio() const { return PromptChars > 0 ? double(NewChars) / double(PromptChars) : 0.0; }
+};
+
+/**
+ * Builds append-only completion prompts for one question, so a local server only computes the new events.
+ * See CompletionSession.cpp.
+ */
+class PROJECT_API FCompletionSession
+{
+public:
+	void Start(const FString& Question, int32 InSlot);
+	bool IsStarted() const { return !Prefix.IsEmpty(); }
+
+	// Prompt for the next request: the prefix, the earlier events and Event last
+	FString BuildPrompt(const FString& Event);
+
+	// Prompts of a batch, one per event: the prefix, the earlier events and the event last. All events are appended.
+	void BuildPrompts(TConstArrayView<FString> NewEvents, TArray<FString>& OutPrompts);
+
+	// Server slot of the session, INDEX_NONE leaves the choice to the server
+	int32 GetSlot() const { return Slot; }
+	int32 NumEvents() const { return Events.Num(); }
+	const FCompletionSessionStats& GetStats() const { return Stats; }
+	void LogStats() const;
+
+	// The session starts over with the last KeepEvents events that fit when the prompt would grow past MaxPromptChars.
+	// About 1500 tokens, within the 2048 tokens of the local model's context with room for the answer.
+	int32 MaxPromptChars = 6000;
+	int32 KeepEvents = 4;
+
+private:
+	FString Prefix;
+	TArray<FString> Events;
+	FString Transcript;
+	int32 Slot = INDEX_NONE;
+	FCompletionSessionStats Stats;
+};
@@ -7,8 +7,83 @@
 #include "Interfaces/IHttpRequest.h"
 #include "Interfaces/IHttpResponse.h"
 #include "GameFramework/GameStateBase.h"
+#include "StorySummarizer.h"
+#include "StoryPromptBuilder.h"
+#include "StoryEvent.h"
+#include "NarrationResponseCache.h"
+#include "StorySpeculator.h"
+#include "NarrationScheduler.h"
+#include "NarrationStreamParser.h"
+#include "StoryFrameScheduler.h"
+#include "WorldSnapshot.h"
+#include "WorldBounds.h"
+#include "TrackingSweep.h"
+#include "TrackingLOD.h"
+#include "NarrationReplication.h"
+#include "StoryLatencyTrace.h"
 #include "GameStateStoryGen.generated.h"
 
+// Result of AGameStateStoryGen::ClassifyActor()
+enum class EActorTracking : uint8
+{
+	Tracked,	// Can move, checked for movement
+	Static,		// Static or stationary root, or no root component
+	EditorOnly,	// Editor helper, not part of the game
+	Excluded,	// Trackable: false tag
+	Count
+};
+
+// Broadcast on the game thread when a new narration is published, see AGameStateStoryGen::HandleNarration()
+// StreamId is the stream the narration was revealed through with FOnStoryNarrationChunk, or 0
+DECLARE_MULTICAST_DELEGATE_TwoParams(FOnStoryNarration, const FString& /* Narration */, uint32 /* StreamId */);
+
+// Broadcast on the game thread for each piece of a streamed narration
+DECLARE_MULTICAST_DELEGATE_TwoParams(FOnStoryNarrationChunk, uint32 /* StreamId */, const FString& /* Chunk */);
+
+class APlayerState;
+class UStoryNarrationChannel;
+
+/**
+ * Story stream of one local or remote player: its event history, prompt context and HUD channel.
+ * See AGameStateStoryGen::SyncPlayers().
+ */
+struct FStoryPlayerStream
+{
+	TWeakObjectPtr<APlayerState> PlayerState;
+	int32 Slot = INDEX_NONE;	// Tracked object of the player's pawn
+
+	// Prompt context: the events around this player and its own responses
+	TArray<FStoryEvent> Events;
+	int32 EventCount = 0;
+	FStorySummarizer Summarizer;
+
+	// Events since the last batch, the ones the next request narrates. The older events are only context.
+	TConstArrayView<FStoryEvent> GetPendingEvents() const
+	{
+		const int32 Start = FMath::Max(0, Events.Num() - EventCount);
+		return TConstArrayView<FStoryEvent>(Events).Slice(Start, Events.Num() - Start);
+	}
+
+	// HUD channel, the widgets of this player subscribe here
+	FOnStoryNarration OnNarration;
+	FOnStoryNarrationChunk OnNarrationChunk;
+	FString LatestNarration;
+	uint32 ActiveStreamJob = 0;
+
+	// Server: channel to the owning client of a remote player, see UStoryNarrationChannel
+	TWeakObjectPtr<UStoryNarrationChannel> Channel;
+
+	// Narration replicated piece by piece: sent so far (server) or received so far (client)
+	uint32 ReplicatedStream = 0;
+	FString ReplicatedText;
+	int32 ReplicatedMessages = 0;
+	int32 ReplicatedBytes = 0;
+
+	// Server: streamed text not sent yet, the pieces are coalesced for NarrationDeltaInterval
+	FString PendingDelta;
+	double LastDeltaTime = -1.0;
+};
+
 UCLASS()
 class PROJECT_API AGameStateStoryGen : public AGameStateBase
 {
@@ -21,23 +96,59 @@ public:
 
 	// Json String Whole environment
 	TSharedPtr<FJsonObject> GenerateStartEnvironment();
+	static TSharedPtr<FJsonObject> BuildEnvironment(const FWorldSnapshot& Snapshot, const FString& InGameTitle, const FString& InTheme, const FString& InDescription, EStoryNumberPrecision Precision = EStoryNumberPrecision::Full);
 
 	// Actor Tracking
 	void GetActors();
+	static EActorTracking ClassifyActor(const AActor* Actor);
+	static bool IsTrackingCandidate(const AActor* Actor);
+	void RegisterActor(AActor* Actor);
+	void UnregisterActor(AActor* Actor);
+	int32 FindTrackedSlot(const AActor* Actor) const { const int32* Slot = TrackedSlots.Find(Actor); return Slot ? *Slot : INDEX_NONE; }
 	void PerformTracking();
+	bool TrackSlice();
+	bool TrackDueObjects();
+
+	// Players and their story streams
+	void SyncPlayers();
+	int32 FindOrAddPlayer(APlayerState* PlayerState);
+	FStoryPlayerStream* GetPlayerStream(int32 PlayerIndex) { return Players.IsValidIndex(PlayerIndex) ? &Players[PlayerIndex] : nullptr; }
+	int32 NumPlayers() const { return Players.Num(); }
+	int32 FindPlayerById(int32 PlayerId) const;
+
+	// True where tracking and LLM requests run: the server, or every machine without bServerAuthoritativeStory
+	bool RunsStoryPipeline() const { return !bServerAuthoritativeStory || HasAuthority(); }
+
+	// Client: narration of a player, received on its UStoryNarrationChannel.
+	// Narration is empty if it was received piece by piece with ReceiveNarrationChunk() already.
+	void ReceiveNarration(int32 PlayerId, uint32 StreamId, const FString& Narration);
+	void ReceiveNarrationChunk(int32 PlayerId, uint32 StreamId, const FString& Chunk);
 
 	// For determining relativity
-	void GetPlayerRelativity(const AActor* TargetActor);
+	void GetPlayerRelativity(const AActor* TargetActor, bool bInteractable = false);
+	FTrackingPlayerView GetPlayerView(int32 PlayerIndex) const;
+	void GetPlayerViews(TArray<FTrackingPlayerView>& OutViews) const;
+	TOptional<FVector> ReadTrackedPosition(int32 Index) const;
+	bool SampleTrackedObject(int32 Index, const TOptional<FVector>& CurrentPosition, TConstArrayView<FTrackingPlayerView> PlayerViews, double Now, FTrackedMovement& OutMovement);
+	void PublishMovements(const TArray<FTrackedMovement>& Moved, double Now);
+	void PublishEvent(int32 PlayerIndex, const FString& ActorName, double Distance, EStoryDirection Direction, bool bInteractable);
 	FString GetRelativePosition(const double& ForwardDot, const double& RightDot, const double& VerticalDot);
 
 	//FString question_prompt(const FString& indicator);
-	void SendPayload(const TSharedPtr<FJsonObject>& Event);
-	void httpSendReq();
+	void SendPayload(int32 PlayerIndex, const FStoryEvent& Event);
+	FHttpRequestPtr httpSendReq(int32 PlayerIndex = 0, uint64 SceneKey = 0, bool bCacheRefresh = false, uint32 JobId = 0);
+	void HandleNarration(int32 PlayerIndex, const FString& Content, uint32 StreamId = 0);
+
+	// Speculative narration of likely next interactions
+	void UpdateSpeculation();
+	FHttpRequestPtr httpSendSpeculativeReq(const FSpeculationCandidate& Candidate, uint32 JobId = 0);
 
-	TSharedPtr<FJsonObject> SerializeVector(const FVector& Vector);
+	static TSharedPtr<FJsonObject> SerializeVector(const FVector& Vector, EStoryNumberPrecision Precision = EStoryNumberPrecision::Full);
 
 	// Other
 	virtual void BeginPlay() override;
+	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
+	virtual void Tick(float DeltaSeconds) override;
 
 	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "LLM-Service")
 	FString RetrievedApiKey;
@@ -51,29 +162,231 @@ public:
 	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "World Details")
 	FString Description;
 
+	// Old_AI_Responses are compacted into a synopsis once there are more than this many
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "LLM-Service|Summary")
+	int32 SummaryThreshold = 8;
+
+	// Number of latest responses that are always sent verbatim
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "LLM-Service|Summary")
+	int32 VerbatimResponseCount = 3;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "LLM-Service|Summary")
+	int32 MaxSynopsisLength = 1200;
+
+	// Narrate repeated scenes from the cache instead of calling the LLM
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "LLM-Service|Response Cache")
+	bool bUseResponseCache = true;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "LLM-Service|Response Cache")
+	int32 ResponseCacheSize = 64;
+
+	// Size of the distance buckets used in the scene key (Unreal units)
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "LLM-Service|Response Cache")
+	float DistanceBucketSize = 100.0f;
+
+	// Narrations a scene needs before it is served from the cache
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "LLM-Service|Response Cache")
+	int32 MinCachedVariants = 1;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "LLM-Service|Response Cache")
+	int32 MaxCachedVariants = 3;
+
+	// Ask the LLM again on a cache hit and store the answer as a new variant
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "LLM-Service|Response Cache")
+	bool bRefreshCachedResponses = false;
+
+	// Pre-generate narrations for interactable objects the player is about to use
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "LLM-Service|Speculation")
+	bool bSpeculativeNarration = true;
+
+	// Objects closer than this (Unreal units) and in front of the player are predicted interactions
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "LLM-Service|Speculation")
+	float SpeculationReach = 250.0f;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "LLM-Service|Speculation")
+	int32 MaxSpeculativeCandidates = 2;
+
+	// Seconds a pre-generated narration stays valid
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "LLM-Service|Speculation")
+	float SpeculationLifetime = 30.0f;
+
+	// Story requests running at the same time, more are queued or preempt lower priorities
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "LLM-Service|Scheduling")
+	int32 MaxConcurrentStoryRequests = 2;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "LLM-Service|Scheduling")
+	int32 MaxQueuedStoryRequests = 4;
+
+	// Interactable objects closer than this (Unreal units) are considered held: Critical priority
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "LLM-Service|Scheduling")
+	float HeldDistance = 150.0f;
+
+	// Interactable objects closer than this (Unreal units) are within reach: High priority
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "LLM-Service|Scheduling")
+	float InteractionReach = 400.0f;
+
+	// Latency SLOs (seconds) per priority class
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "LLM-Service|Scheduling")
+	float CriticalLatencySLO = 2.0f;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "LLM-Service|Scheduling")
+	float HighLatencySLO = 4.0f;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "LLM-Service|Scheduling")
+	float NormalLatencySLO = 8.0f;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "LLM-Service|Scheduling")
+	float LowLatencySLO = 20.0f;
+
+	// Game-thread time (ms) the story pipeline may use per frame, a VR frame at 90 Hz is 11 ms
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "LLM-Service|Scheduling")
+	float FrameBudgetMs = 1.5f;
+
+	// Tracked objects checked per slice of the tracking sweep
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "LLM-Service|Scheduling")
+	int32 TrackingSliceSize = 256;
+
+	// Detect movements of a tracking slice on worker threads
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "LLM-Service|Scheduling")
+	bool bParallelTracking = true;
+
+	// Minimum tracked objects per worker chunk, keep it well below TrackingSliceSize.
+	// Slices smaller than two batches are swept on the game thread only
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "LLM-Service|Scheduling")
+	int32 ParallelTrackingBatchSize = 64;
+
+	// Check tracked objects at a rate depending on their distance to the player, instead of all of them every 3 s
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "LLM-Service|Tracking LOD")
+	bool bTrackingLOD = true;
+
+	// Objects closer than this are checked every frame
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "LLM-Service|Tracking LOD")
+	float NearTrackingDistance = 800.0f;
+
+	// Moving objects closer than this are checked every MidTrackingInterval seconds
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "LLM-Service|Tracking LOD")
+	float MidTrackingDistance = 3000.0f;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "LLM-Service|Tracking LOD")
+	float MidTrackingInterval = 0.5f;
+
+	// Far and idle objects are checked every FarTrackingInterval seconds
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "LLM-Service|Tracking LOD")
+	float FarTrackingInterval = 3.0f;
+
+	// Seconds without movement after which an object counts as idle
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "LLM-Service|Tracking LOD")
+	float TrackingIdleTime = 10.0f;
+
+	// Upper bound of tracked objects checked per frame
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "LLM-Service|Tracking LOD")
+	int32 TrackingChecksPerFrame = 512;
+
+	// Minimum seconds between two events of the same tracked object, a carried object moves every frame
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "LLM-Service|Tracking LOD")
+	float EventPublishInterval = 1.0f;
+
+	// Precision of positions, sizes and distances in the prompts
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "LLM-Service")
+	EStoryNumberPrecision NumberPrecision = EStoryNumberPrecision::Centimetre;
+
+	// Stream story responses so the HUD can show them while they are generated
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "LLM-Service")
+	bool bStreamNarration = true;
+
+	// Write the scene data of the chat requests in the compact encoding instead of JSON, fewer prompt tokens for local models.
+	// The completion backends of UHttpHandler_Get have their own setting.
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "LLM-Service")
+	bool bCompactSceneEncoding = false;
+
+	// Trace each event from the movement to the published narration, to Unreal Insights and a JSON file in Saved/Traces (see FStoryLatencyTrace)
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "LLM-Service")
+	bool bLatencyTracing = false;
+
+	// Only the server tracks actors and calls the LLM, clients receive the finished narrations of their players
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "LLM-Service|Replication")
+	bool bServerAuthoritativeStory = true;
+
+	// Seconds between two pieces of a streamed narration sent to a client, the tokens in between are sent together
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "LLM-Service|Replication")
+	float NarrationDeltaInterval = 0.1f;
+
 private:
 	// Timer
 	FTimerHandle TimerHandle;
 
 	// Tracked objects struct
 	struct FTrackedObject {
-		AActor* Actor;
+		TWeakObjectPtr<AActor> Actor;	// Null once the actor is gone, such slots are skipped by the sweeps
 		FString ActorName;
-		FVector PreviousPosition;
-		bool IsPlayer;
+		FVector PreviousPosition = FVector::ZeroVector;
+		bool IsPlayer = false;
+		bool IsInteractable = false;
+		bool IsStoryObject = false;
+		bool BoundsChanged = false;	// Moved, the box in WorldBounds is updated on the game thread
+		double LastMovedTime = -1.0;
+		double LastPublishedTime = -1.0;	// Time of the last event, see EventPublishInterval
 	};
 
-	// Tracked objects array using the struct above
+	// Tracked objects array using the struct above, cleared slots are reused (see AddTrackedObject())
 	TArray<FTrackedObject> TrackedObjects;
+	TMap<TWeakObjectPtr<const AActor>, int32> TrackedSlots;
+	TArray<int32> FreeSlots;
+
+	// Story streams of all players, indexed by player index. Speculation runs for the first local player.
+	TArray<FStoryPlayerStream> Players;
+	int32 SpeculationPlayer = INDEX_NONE;
+
+	// Actors with a Type: tag, the objects of the story environment, and the box around them.
+	// Weak, an actor removed without OnActorDestroyed() (e.g. with its streamed level) is skipped until it is unregistered.
+	TSet<TWeakObjectPtr<AActor>> EnvironmentActors;
+	FWorldBounds WorldBounds;
 
 	// Other variables
-	FString LLM_response;
 	bool generate_stories = true;
-	TArray<TSharedPtr<FJsonObject>> EventHistoryArray;
-	TArray<FString> LLMResponseArray;
+	FStoryPromptBuilder PromptBuilder;
+	FNarrationResponseCache ResponseCache;
+	FStorySpeculator Speculator;
+	FNarrationScheduler Scheduler;
+	TMap<uint32, FNarrationStreamParser> StreamParsers;
+	FStoryFrameScheduler FrameScheduler;
+	int32 TrackingCursor = 0;
+	TArray<FTrackingPlayerView> SweepPlayerViews;
+	FTrackingLOD TrackingLOD;
+	FDelegateHandle ActorSpawnedHandle;
+	FDelegateHandle ActorDestroyedHandle;
+	double PendingTrackingTime = 0.0;
+	FString PromptCacheKey;
 	TSharedPtr<FJsonObject> StartEnviroment;
-	TSharedPtr<FJsonObject> CurrentEnviroment;
-	int Event_Count = 0;
+	// Candidate phrases of the level, each narration channel starts with a copy. Also counts the replicated bytes.
+	FNarrationReplicationCodec NarrationCodec;
+	FStoryLatencyTrace LatencyTrace;
+
+	// Latest narration written to LLM_response.txt, shared with the background writes (see HandleNarration())
+	struct FNarrationFileState
+	{
+		FCriticalSection Lock;
+		uint64 WrittenSequence = 0;
+	};
+	TSharedRef<FNarrationFileState, ESPMode::ThreadSafe> NarrationFile = MakeShared<FNarrationFileState, ESPMode::ThreadSafe>();
+	uint64 NarrationFileSequence = 0;
 
-	void OnResponseReceived(FHttpRequestPtr Request, FHttpResponsePtr Response, bool bWasSuccessful);
+	int32 AddTrackedObject(const FTrackedObject& Object);
+	void ClearTrackedSlot(int32 Slot);
+	void AddEnvironmentActor(AActor* Actor);
+	void UpdateMovedBounds(int32 Index);
+	void OnActorSpawned(AActor* Actor);
+	void OnActorDestroyed(AActor* Actor);
+	TSharedRef<IHttpRequest, ESPMode::ThreadSafe> CreateChatRequest();
+	void SendChatRequest(TSharedRef<IHttpRequest, ESPMode::ThreadSafe> Request, int32 PlayerIndex, TUniqueFunction<TSharedPtr<FJsonObject>()> BuildVolatileContent, int32 MaxTokens, bool bStream, TUniqueFunction<void()> OnFailed, uint32 TraceRequest = 0);
+	static FString BuildChatPayload(const FStoryPromptBuilder& Builder, const TSharedPtr<FJsonObject>& VolatileContent, int32 MaxTokens, bool bStream, const FString& CacheKey);
+	bool ParseChatResponse(FHttpResponsePtr Response, bool bWasSuccessful, FString& OutContent);
+	bool ParseStreamResponse(FHttpResponsePtr Response, bool bWasSuccessful, int32 PlayerIndex, uint32 JobId, FString& OutContent);
+	void OnResponseProgress(FHttpRequestPtr Request, uint64 BytesSent, uint64 BytesReceived, int32 PlayerIndex, uint32 JobId);
+	void OnResponseReceived(FHttpRequestPtr Request, FHttpResponsePtr Response, bool bWasSuccessful, int32 PlayerIndex, uint64 SceneKey, bool bCacheRefresh, uint32 JobId);
+	bool ReplicatesNarration() const;
+	void ReplicateNarrationChunk(FStoryPlayerStream& Player, uint32 StreamId, const FString& Chunk);
+	void FlushNarrationDelta(FStoryPlayerStream& Player, bool bForce);
+	void ReplicateNarration(FStoryPlayerStream& Player, const FString& Narration, uint32 StreamId);
+	void OnSpeculativeResponseReceived(FHttpRequestPtr Request, FHttpResponsePtr Response, bool bWasSuccessful, FString ActorName, uint32 JobId);
 };
@@ -21,6 +21,15 @@
 #include "HAL/PlatformFilemanager.h"
 #include "Engine/Engine.h"
 #include "Misc/DateTime.h"
+#include "Async/Async.h"
+#include "Components/PrimitiveComponent.h"
+#include "GameFramework/PlayerState.h"
+#include "GameFramework/PlayerController.h"
+#include "TrackingSweep.h"
+#include "StoryNarrationChannel.h"
+
+// Movements further away from the player than this (unreal units) are not sent as events
+static constexpr double EventDistance = 800.0;
 
 /**
  * # File: GameStateStoreGen.cpp
@@ -36,6 +45,9 @@
 AGameStateStoryGen::AGameStateStoryGen()
 {
 	//RetrievedApiKey = "DefaultApiKey";
+
+	// Runs the frame-budgeted part of the story pipeline, see Tick()
+	PrimaryActorTick.bCanEverTick = true;
 }
 
 void AGameStateStoryGen::BeginPlay()
@@ -50,10 +62,17 @@ void AGameStateStoryGen::BeginPlay()
 	 *
 	 * ## Tasks Performed
 	 * - Clears the content of the `LLM_response.txt` file in the `LLM_Response` directory to reset logs.
-	 * - Gathers all actors and players from the game world by calling `GetActors()`.
+	 * - Configures the story summarizers of the players, which bound their `Old_AI_Responses` history.
+	 * - Configures the response cache for repeated scenes, the speculative narration and the request `Scheduler`.
+	 * - Sets the per-frame budget of the `FrameScheduler` and the tiers of the `TrackingLOD`.
+	 * - Gathers all actors and players from the game world by calling `GetActors()`, and follows spawned and destroyed actors.
 	 * - Creates the initial game environment representation by calling `GenerateStartEnvironment()`.
+	 * - Sets up the static prompt prefix (instructions and start environment) in the `PromptBuilder`.
 	 * - Starts `TickObjectMovement()`, which triggers `PerformTracking` periodically.
 	 *
+	 * With `bServerAuthoritativeStory` only the server does this. Clients turn off the tick and wait for
+	 * the narrations of their players, see `UStoryNarrationChannel`.
+	 *
 	 * ## Details
 	 * The GameState is typically responsible for managing the overall state of the game world.
 	 * In this implementation, additional support is provided for generating story narratives.
@@ -64,7 +83,12 @@ void AGameStateStoryGen::BeginPlay()
 
 	UE_LOG(LogTemp, Log, TEXT("GAMESTATE TRIGGERED"));
 
-	PrimaryActorTick.bCanEverTick = true;
+	if (!RunsStoryPipeline())
+	{
+		SetActorTickEnabled(false);
+		UE_LOG(LogTemp, Log, TEXT("Story generation runs on the server, this client only receives narrations."));
+		return;
+	}
 
 	FString FilePath = FPaths::ProjectDir() + TEXT("LLM_Response/LLM_response.txt");
 	if (FFileHelper::SaveStringToFile(TEXT(""), *FilePath))
@@ -76,11 +100,118 @@ void AGameStateStoryGen::BeginPlay()
 		UE_LOG(LogTemp, Error, TEXT("Failed to clear file content: %s"), *FilePath);
 	}
 
+	// HUD widgets may have opened a player's stream already
+	for (FStoryPlayerStream& Player : Players)
+	{
+		Player.Summarizer.Configure(SummaryThreshold, VerbatimResponseCount, MaxSynopsisLength);
+	}
+
+	FNarrationCachePolicy CachePolicy;
+	CachePolicy.MaxEntries = ResponseCacheSize;
+	CachePolicy.DistanceBucketSize = DistanceBucketSize;
+	CachePolicy.MinVariants = MinCachedVariants;
+	CachePolicy.MaxVariants = MaxCachedVariants;
+	CachePolicy.bRefreshInBackground = bRefreshCachedResponses;
+	ResponseCache.Configure(CachePolicy);
+	Speculator.Configure(SpeculationReach, MaxSpeculativeCandidates, SpeculationLifetime);
+	Scheduler.Configure(MaxConcurrentStoryRequests, MaxQueuedStoryRequests, { CriticalLatencySLO, HighLatencySLO, NormalLatencySLO, LowLatencySLO });
+	FrameScheduler.SetBudget(FrameBudgetMs);
+
+	FTrackingLODSettings LODSettings;
+	LODSettings.NearDistance = NearTrackingDistance;
+	LODSettings.MidDistance = MidTrackingDistance;
+	LODSettings.MidInterval = MidTrackingInterval;
+	LODSettings.FarInterval = FarTrackingInterval;
+	LODSettings.MaxSamplesPerFrame = TrackingChecksPerFrame;
+	TrackingLOD.Configure(LODSettings);
+
 	GetActors();
+	if (UWorld* World = GetWorld())
+	{
+		ActorSpawnedHandle = World->AddOnActorSpawnedHandler(FOnActorSpawned::FDelegate::CreateUObject(this, &AGameStateStoryGen::OnActorSpawned));
+		ActorDestroyedHandle = World->AddOnActorDestroyedHandler(FOnActorDestroyed::FDelegate::CreateUObject(this, &AGameStateStoryGen::OnActorDestroyed));
+	}
 	StartEnviroment = GenerateStartEnvironment();
+
+	// Static prompt prefix, identical for every request of this session
+	PromptCacheKey = FString::Printf(TEXT("%s-%s"), *GameTitle, *FGuid::NewGuid().ToString(EGuidFormats::Short));
+	PromptBuilder.SetInstructions(TEXT("Use the json data to generate stories for the game it's retreived from the wanderers point of view in third person. Focus on the last events in Event_History to understand the changes made from Start_environment. Try to not use other concepts or imagination outside the given parameters. If you recieve a Story_Synopsis or a history of Old_AI_Responses, continue on that story. Get straight to the story."));
+	PromptBuilder.SetSceneEncoding(bCompactSceneEncoding ? EStorySceneEncoding::Compact : EStorySceneEncoding::Json);
+	PromptBuilder.SetStartEnvironment(StartEnviroment);
+
 	TickObjectMovement();
 }
 
+void AGameStateStoryGen::EndPlay(const EEndPlayReason::Type EndPlayReason)
+{
+	/**
+	 * # Function: EndPlay()
+	 *
+	 * ## Brief
+	 * Cancels the narration requests that are still running, drops the pending frame work
+	 * and logs the latency of each priority class and the frame time of the story pipeline.
+	 * A server also logs the bytes it replicated per narration, see `FNarrationReplicationCodec`.
+	 * With `bLatencyTracing` the latency of each stage is logged and the trace file written, see `FStoryLatencyTrace`.
+	 */
+	if (UWorld* World = GetWorld())
+	{
+		World->RemoveOnActorSpawnedHandler(ActorSpawnedHandle);
+		World->RemoveOnActorDestroyedHandler(ActorDestroyedHandle);
+	}
+
+	Scheduler.CancelAll();
+	Scheduler.LogStats();
+	FrameScheduler.LogStats();
+	FrameScheduler.Reset();
+	TrackingLOD.LogStats();
+	if (ReplicatesNarration())
+	{
+		NarrationCodec.LogStats();
+	}
+	if (bLatencyTracing)
+	{
+		LatencyTrace.LogStats();
+		LatencyTrace.WriteTraceFile(LatencyTrace.GetDefaultTraceFilePath());
+	}
+
+	Super::EndPlay(EndPlayReason);
+}
+
+void AGameStateStoryGen::Tick(float DeltaSeconds)
+{
+	/**
+	 * # Function: Tick()
+	 *
+	 * ## Brief
+	 * Runs the story pipeline work due this frame within `FrameBudgetMs`.
+	 *
+	 * ## Details
+	 * Slices of the tracking sweep (or the checks of `TrackDueObjects()` with `bTrackingLOD`) and the
+	 * game-thread part of payloads built on worker threads run here, see `FStoryFrameScheduler`. Use `stat unit` with `FrameBudgetMs` to tune the budget.
+	 * Streamed narration text held back for `NarrationDeltaInterval` is sent to the clients, see `FlushNarrationDelta()`.
+	 */
+	Super::Tick(DeltaSeconds);
+
+	if (ReplicatesNarration())
+	{
+		for (FStoryPlayerStream& Player : Players)
+		{
+			FlushNarrationDelta(Player, false);
+		}
+	}
+
+	if (bTrackingLOD)
+	{
+		PendingTrackingTime += DeltaSeconds;
+		if (!FrameScheduler.HasTask(TEXT("TrackingLOD")))
+		{
+			FrameScheduler.AddTask(TEXT("TrackingLOD"), [this]() { return TrackDueObjects(); });
+		}
+	}
+
+	FrameScheduler.Tick();
+}
+
 void AGameStateStoryGen::TickObjectMovement()
 {
 	/**
@@ -134,6 +265,26 @@ TSharedPtr<FJsonObject> AGameStateStoryGen::GenerateStartEnvironment()
 	 * ## Brief
 	 * Generates and returns a JSON object representing the current environment state.
 	 *
+	 * ## Details
+	 * Captures a `FWorldSnapshot` of the story objects in `EnvironmentActors` and builds the JSON from it
+	 * with `BuildEnvironment()`. The story objects are collected by `GetActors()`, the box around them is kept in `WorldBounds`.
+	 * Requests capture the snapshot only and build the JSON on a worker thread, see `httpSendReq()`.
+	 */
+	UE_LOG(LogTemp, Log, TEXT("GAME TITLE: %s"), *GameTitle);
+
+	FWorldSnapshot Snapshot;
+	Snapshot.CaptureStoryObjects(GetWorld(), EnvironmentActors, WorldBounds.GetBounds());
+	return BuildEnvironment(Snapshot, GameTitle, Theme, Description, NumberPrecision);
+}
+
+TSharedPtr<FJsonObject> AGameStateStoryGen::BuildEnvironment(const FWorldSnapshot& Snapshot, const FString& InGameTitle, const FString& InTheme, const FString& InDescription, EStoryNumberPrecision Precision)
+{
+	/**
+	 * # Function: BuildEnvironment
+	 *
+	 * ## Brief
+	 * Builds the JSON object representing the environment from a snapshot. Safe to call on any thread.
+	 *
 	 * ## Included Data
 	 * ### General Data about the environment:
 	 * - **Game Title**: The title of the environment.
@@ -151,137 +302,72 @@ TSharedPtr<FJsonObject> AGameStateStoryGen::GenerateStartEnvironment()
 	 */
 
 	TSharedPtr<FJsonObject> RootObject = MakeShareable(new FJsonObject());
-	RootObject->SetStringField(TEXT("game_title"), GameTitle);
+	RootObject->SetStringField(TEXT("game_title"), InGameTitle);
 
-	RootObject->SetStringField(TEXT("theme"), Theme);
+	RootObject->SetStringField(TEXT("theme"), InTheme);
 
-	RootObject->SetStringField(TEXT("description"), Description);
-	UE_LOG(LogTemp, Log, TEXT("GAME TITLE: %s"), *GameTitle);
+	RootObject->SetStringField(TEXT("description"), InDescription);
 
 
-	if (GetWorld())
+	if (Snapshot.bHasWorld)
 	{
-		// Calculate bounds of the environment
-		FVector MinExtent(FLT_MAX);
-		FVector MaxExtent(-FLT_MAX);
+		// Bounds of the environment, kept up to date by FWorldBounds (zero without story objects)
+		const FBox Extent = Snapshot.Bounds.IsValid ? Snapshot.Bounds : FBox(FVector::ZeroVector, FVector::ZeroVector);
 
 		TSharedPtr<FJsonObject> Space = MakeShareable(new FJsonObject());
 		TSharedPtr<FJsonObject> dimensions = MakeShareable(new FJsonObject());
 		TSharedPtr<FJsonObject> bounds = MakeShareable(new FJsonObject());
-		
 
-		FVector EnvironmentSize = MaxExtent - MinExtent;
-		dimensions->SetNumberField(TEXT("width"), EnvironmentSize.X);
-		dimensions->SetNumberField(TEXT("depth"), EnvironmentSize.Y);
-		dimensions->SetNumberField(TEXT("height"), EnvironmentSize.Z);
+		FVector EnvironmentSize = Extent.GetSize();
+		FStoryNumberFormat::SetNumberField(*dimensions, TEXT("width"), EnvironmentSize.X, Precision);
+		FStoryNumberFormat::SetNumberField(*dimensions, TEXT("depth"), EnvironmentSize.Y, Precision);
+		FStoryNumberFormat::SetNumberField(*dimensions, TEXT("height"), EnvironmentSize.Z, Precision);
 
-		bounds->SetNumberField(TEXT("x_min"), (-1540));
-		bounds->SetNumberField(TEXT("x_max"), (4150));
-		bounds->SetNumberField(TEXT("y_min"), (-730));
-		bounds->SetNumberField(TEXT("y_max"), (-3830));
+		FStoryNumberFormat::SetNumberField(*bounds, TEXT("x_min"), Extent.Min.X, Precision);
+		FStoryNumberFormat::SetNumberField(*bounds, TEXT("x_max"), Extent.Max.X, Precision);
+		FStoryNumberFormat::SetNumberField(*bounds, TEXT("y_min"), Extent.Min.Y, Precision);
+		FStoryNumberFormat::SetNumberField(*bounds, TEXT("y_max"), Extent.Max.Y, Precision);
 
 		Space->SetStringField(TEXT("id"), "World outline");
 		Space->SetObjectField(TEXT("dimensions"), dimensions);
 		Space->SetObjectField(TEXT("bounds"), bounds);
 
-		FString SpaceSer;
-		TSharedRef<TJsonWriter<>> Writer_ = TJsonWriterFactory<>::Create(&SpaceSer);
-		FJsonSerializer::Serialize(RootObject.ToSharedRef(), Writer_);
-
 		RootObject->SetObjectField(TEXT("space"), Space);
 
-		// Get and store all relevant Actors in ObjectsArray
-		TArray<AActor*> AllActors;
-		UGameplayStatics::GetAllActorsOfClass(GetWorld(), AActor::StaticClass(), AllActors);
-		
+		// The snapshot only holds actors with a Type: tag
 		TArray<TSharedPtr<FJsonValue>> ObjectsArray;
 
-		for (AActor* Actor : AllActors)
+		for (const FActorSnapshot& Actor : Snapshot.Actors)
 		{
-			if (Actor)
+			const FVector& BoxExtent = Actor.BoxExtent;
+
+			// Filter out actors with unrealistic bounds
+			if (!FWorldBounds::IsRelevantExtent(BoxExtent))
 			{
-				for (const FName& TypeTag : Actor->Tags)
-				{
-					FString TypeTagString = TypeTag.ToString();
-
-					if (TypeTagString.StartsWith(TEXT("Type:")))
-					{
-						FVector Origin, BoxExtent;
-						Actor->GetActorBounds(true, Origin, BoxExtent);
-
-						// Filter out actors with unrealistic bounds
-						if (BoxExtent.IsNearlyZero() || BoxExtent.X > 10000.0f || BoxExtent.Y > 10000.0f || BoxExtent.Z > 10000.0f)
-						{
-							continue;
-						}
-
-						// Update environment bounds
-						MinExtent = FVector::Min(MinExtent, Origin - BoxExtent);
-						MaxExtent = FVector::Max(MaxExtent, Origin + BoxExtent);
-
-						// Get the actor's label
-						FString Label = Actor->GetActorLabel();
-						if (Label.IsEmpty())
-						{
-							Label = Actor->GetName();
-						}
-
-						// default values
-						FString Description_Tag = TEXT("No description available");
-						FString Type_Tag = TEXT("generic");
-						FString Interactable_Tag = TEXT("false");
-
-						for (const FName& Tag : Actor->Tags)
-						{
-							FString TagString = Tag.ToString();
-							if (TagString.StartsWith(TEXT("Description:")))
-							{
-								Description_Tag = TagString.Mid(12).TrimStartAndEnd();
-							}
-							else if (TagString.StartsWith(TEXT("Type:")))
-							{
-								Type_Tag = TagString.Mid(5).TrimStartAndEnd();
-							}
-							else if (TagString.StartsWith(TEXT("Interactable:")))
-							{
-								Interactable_Tag = TagString.Mid(13).TrimStartAndEnd();
-							}
-						}
-
-						// Filter out unnecessary actors
-						FString LowerCaseLabel = Label.ToLower();
-						if (LowerCaseLabel.Contains(TEXT("floor")) || LowerCaseLabel.Contains(TEXT("wall")) ||
-							LowerCaseLabel.Contains(TEXT("light")) || LowerCaseLabel.Contains(TEXT("debug")) ||
-							LowerCaseLabel.Contains(TEXT("volume")) || BoxExtent.IsNearlyZero())
-						{
-							continue;
-						}
-
-						TSharedPtr<FJsonObject> ObjectJson = MakeShareable(new FJsonObject());
-						ObjectJson->SetStringField(TEXT("name"), Label);
-						ObjectJson->SetStringField(TEXT("description"), Description_Tag);
-						ObjectJson->SetStringField(TEXT("type"), Type_Tag);
-						ObjectJson->SetStringField(TEXT("Interactable"), Interactable_Tag);
-						ObjectJson->SetObjectField(TEXT("position"), SerializeVector(Actor->GetActorLocation()));
-						ObjectJson->SetObjectField(TEXT("dimensions"), SerializeVector(BoxExtent * 2)); // Full size (width, depth, height)
-						ObjectsArray.Add(MakeShareable(new FJsonValueObject(ObjectJson)));
-					}
-				}
-				RootObject->SetArrayField(TEXT("objects"), ObjectsArray);
+				continue;
+			}
+
+			// Filter out unnecessary actors
+			FString LowerCaseLabel = Actor.Label.ToLower();
+			if (LowerCaseLabel.Contains(TEXT("floor")) || LowerCaseLabel.Contains(TEXT("wall")) ||
+				LowerCaseLabel.Contains(TEXT("light")) || LowerCaseLabel.Contains(TEXT("debug")) ||
+				LowerCaseLabel.Contains(TEXT("volume")))
+			{
+				continue;
 			}
+
+			TSharedPtr<FJsonObject> ObjectJson = MakeShareable(new FJsonObject());
+			ObjectJson->SetStringField(TEXT("name"), Actor.Label);
+			ObjectJson->SetStringField(TEXT("description"), Actor.FindTag(TEXT("Description:"), TEXT("No description available")));
+			ObjectJson->SetStringField(TEXT("type"), Actor.FindTag(TEXT("Type:"), TEXT("generic")));
+			ObjectJson->SetStringField(TEXT("Interactable"), Actor.FindTag(TEXT("Interactable:"), TEXT("false")));
+			ObjectJson->SetObjectField(TEXT("position"), SerializeVector(Actor.Position, Precision));
+			ObjectJson->SetObjectField(TEXT("dimensions"), SerializeVector(BoxExtent * 2, Precision)); // Full size (width, depth, height)
+			ObjectsArray.Add(MakeShareable(new FJsonValueObject(ObjectJson)));
 		}
+		RootObject->SetArrayField(TEXT("objects"), ObjectsArray);
 	}
 
-	FString SerializedJson;
-	TSharedRef<TJsonWriter<>> Writer = TJsonWriterFactory<>::Create(&SerializedJson);
-	if (FJsonSerializer::Serialize(RootObject.ToSharedRef(), Writer))
-	{
-		UE_LOG(LogTemp, Log, TEXT("Envrionment: "), *SerializedJson);
-	}
-	else
-	{
-		UE_LOG(LogTemp, Error, TEXT("Failed to serialize JSON object."));
-	}
 	return RootObject;
 }
 
@@ -295,325 +381,1013 @@ void AGameStateStoryGen::GetActors()
 	 *
 	 * ## Details
 	 * This function identifies the player pawn's, mon-player, non-camera actors and adds it to the tracked objects list. 
-	 * Player's pawn are marked wit the "IsPlayer" boolean.
+	 * Actors that cannot move are left out, see `ClassifyActor()`. The number of skipped actors is logged.
+	 * The pawns of all local and remote players are tracked by `SyncPlayers()` and marked wit the "IsPlayer" boolean.
+	 * Actors tagged with "Interactable: true" are marked with the "IsInteractable" boolean, used for speculative narration.
+	 * Actors with a "Type:" tag are kept in `EnvironmentActors`, the objects of the story environment,
+	 * and their boxes in `WorldBounds`.
 	 *
-	 * Actors are saved as a FTrackedObject struct in TrackedObjects Array. See headerfile for decleration.
+	 * Actors are saved as a FTrackedObject struct in TrackedObjects Array, see `RegisterActor()`. See headerfile for decleration.
+	 * Actors spawned or destroyed later are added and removed by `OnActorSpawned()` and `OnActorDestroyed()`.
+	 * All tracked objects start in the Near tier of the `TrackingLOD` and are classified on their first check.
 	 * 
 	 * See the header file for the declarations.
 	 */
-	APawn* PlayerPawn = UGameplayStatics::GetPlayerPawn(GetWorld(), 0);
-	if (PlayerPawn)
-	{
-		FTrackedObject PlayerObject;
-		PlayerObject.Actor = PlayerPawn;
-		PlayerObject.PreviousPosition = PlayerPawn->GetActorLocation();
-		PlayerObject.ActorName = TEXT("Player");
-		PlayerObject.IsPlayer = true;
-
-		TrackedObjects.Add(PlayerObject);
-	}
+	SyncPlayers();
 
 	TArray<AActor*> AllActors;
 	UGameplayStatics::GetAllActorsOfClass(GetWorld(), AActor::StaticClass(), AllActors);
 
+	int32 Classified[(int32)EActorTracking::Count] = {};
 	for (AActor* Actor : AllActors)
 	{
 		if (Actor)
 		{
-			if (!Cast<APawn>(Actor) && !Actor->FindComponentByClass<UCameraComponent>() && !Actor->IsA(ACharacter::StaticClass()) && !Actor->IsA(APlayerCameraManager::StaticClass()))
+			if (FWorldSnapshot::IsStoryObject(Actor))
 			{
-				FTrackedObject NewTrackedObject;
-				NewTrackedObject.Actor = Actor;
-				NewTrackedObject.ActorName = Actor->GetActorLabel();
-				NewTrackedObject.PreviousPosition = Actor->GetActorLocation();
+				AddEnvironmentActor(Actor);
+			}
 
-				TrackedObjects.Add(NewTrackedObject);
+			if (IsTrackingCandidate(Actor))
+			{
+				// Actors that can never move are not worth a check in every sweep
+				const EActorTracking Tracking = ClassifyActor(Actor);
+				Classified[(int32)Tracking]++;
+				if (Tracking == EActorTracking::Tracked)
+				{
+					RegisterActor(Actor);
+				}
 			}
 		}
 	}
+
+	UE_LOG(LogTemp, Log, TEXT("Tracking %d actors, skipped %d static, %d editor-only and %d excluded by tag."),
+		Classified[(int32)EActorTracking::Tracked], Classified[(int32)EActorTracking::Static],
+		Classified[(int32)EActorTracking::EditorOnly], Classified[(int32)EActorTracking::Excluded]);
+
+	TrackingLOD.Reset(TrackedObjects.Num());
+	for (int32 Slot : FreeSlots)
+	{
+		TrackingLOD.Remove(Slot);
+	}
 }
 
-void AGameStateStoryGen::PerformTracking()
+bool AGameStateStoryGen::IsTrackingCandidate(const AActor* Actor)
+{
+	// Pawns and cameras are the player, not objects of the story
+	return !Cast<APawn>(Actor) && !Actor->FindComponentByClass<UCameraComponent>() && !Actor->IsA(ACharacter::StaticClass()) && !Actor->IsA(APlayerCameraManager::StaticClass());
+}
+
+void AGameStateStoryGen::RegisterActor(AActor* Actor)
 {
 	/**
-	* # Function: PerformTracking()
-	* 
-	* ## Brief
-	* Tracks and logs movements of the player and relevant actors in the game world.
-	* 
-	* ## Details
-	* This function performs the following tasks:
-	* - Identifies the local player's position by checking tracked objects with the 'IsPlayer' boolean.
-	* - Compares the curent and previous positions of tracked actors to detect movements.
-	* - Logs the movement data for actors that have changed positions.
-	* - Calls `GetPkayerRelaitivity()` for actors with movement, to determine their position relative to the player.
-	* 
-	* ## Notes
-	* - Player position is identified using the local player's controler and tracked objects marked with 'IsPlayer'.
-	* - Only actors that are considered valid are processed. (non-player, non-camera manager actors)
-	* - Movement data is updated in the 'TrackedObjects' array.
-	*/
-	FVector PlayerPosition = FVector::ZeroVector;
+	 * # RegisterActor
+	 *
+	 * ## Brief
+	 * Adds an actor to the tracked objects, unless it is tracked already.
+	 *
+	 * ## Details
+	 * Actors tagged with "Interactable: true" are marked with the "IsInteractable" boolean.
+	 */
+	if (TrackedSlots.Contains(Actor))
+	{
+		return;
+	}
 
-	// Find player position
-	for (const FTrackedObject& Object : TrackedObjects)
+	FTrackedObject NewTrackedObject;
+	NewTrackedObject.Actor = Actor;
+	NewTrackedObject.ActorName = Actor->GetActorLabel();
+	NewTrackedObject.PreviousPosition = Actor->GetActorLocation();
+	NewTrackedObject.IsStoryObject = FWorldSnapshot::IsStoryObject(Actor);
+
+	for (const FName& Tag : Actor->Tags)
 	{
-		if (Object.IsPlayer && Object.Actor)
+		FString TagString = Tag.ToString();
+		if (TagString.StartsWith(TEXT("Interactable:")))
 		{
-			PlayerPosition = Object.Actor->GetActorLocation();
-			UE_LOG(LogTemp, Log, TEXT("PLAYER LOCATION: %s"), *PlayerPosition.ToString());
-			break;
+			NewTrackedObject.IsInteractable = TagString.Mid(13).TrimStartAndEnd().ToBool();
 		}
 	}
 
-	// Check and log movements for all tracked objects
-	for (FTrackedObject& TrackedObject : TrackedObjects)
+	AddTrackedObject(NewTrackedObject);
+}
+
+int32 AGameStateStoryGen::AddTrackedObject(const FTrackedObject& Object)
+{
+	/**
+	 * # AddTrackedObject
+	 *
+	 * ## Brief
+	 * Stores a tracked object in a free slot of `TrackedObjects`, or appends it. O(1).
+	 *
+	 * ## Details
+	 * Slots are reused, so the indices of the other tracked objects (used by `TrackingLOD` and
+	 * a running sweep) never change. `TrackedSlots` maps each actor to its slot.
+	 * The actor name becomes a phrase of the `NarrationCodec` and the open narration channels,
+	 * narrations that mention it are replicated with a short code.
+	 */
+	int32 Slot;
+	if (FreeSlots.Num() > 0)
 	{
-		if (TrackedObject.Actor && IsValid(TrackedObject.Actor) &&
-			!TrackedObject.Actor->IsA(ACharacter::StaticClass()) &&
-			!TrackedObject.Actor->IsA(APlayerCameraManager::StaticClass()))
-		{
-			FVector CurrentPosition = TrackedObject.Actor->GetActorLocation();
+		Slot = FreeSlots.Pop(EAllowShrinking::No);
+		TrackedObjects[Slot] = Object;
+	}
+	else
+	{
+		Slot = TrackedObjects.Add(Object);
+	}
 
-			// If the object has moved, log the interaction 
-			if (!CurrentPosition.Equals(TrackedObject.PreviousPosition, KINDA_SMALL_NUMBER))
-			{
-				GetPlayerRelativity(TrackedObject.Actor);
-				TrackedObject.PreviousPosition = CurrentPosition; // Update the previous position
-			}
+	TrackedSlots.Add(Object.Actor, Slot);
+	TrackingLOD.Add(Slot);
+	NarrationCodec.AddCandidatePhrase(Object.ActorName);
+	for (const FStoryPlayerStream& Player : Players)
+	{
+		if (UStoryNarrationChannel* Channel = Player.Channel.Get())
+		{
+			Channel->AddCandidatePhrase(Object.ActorName);
 		}
 	}
+	return Slot;
 }
 
-TSharedPtr<FJsonObject> AGameStateStoryGen::SerializeVector(const FVector& Vector)
+void AGameStateStoryGen::AddEnvironmentActor(AActor* Actor)
 {
 	/**
-	* # Function: SerializeVector()
-	* 
-	* ## Brief
-	* Convers an FVector into a JSON object.
-	*/
-	TSharedPtr<FJsonObject> JsonObject = MakeShareable(new FJsonObject);
-	JsonObject->SetNumberField(TEXT("x"), Vector.X);
-	JsonObject->SetNumberField(TEXT("y"), Vector.Y);
-	JsonObject->SetNumberField(TEXT("z"), Vector.Z);
-	return JsonObject;
+	 * # AddEnvironmentActor
+	 *
+	 * ## Brief
+	 * Adds a story object to `EnvironmentActors` and its box to `WorldBounds`.
+	 */
+	EnvironmentActors.Add(Actor);
+
+	FVector Origin;
+	FVector BoxExtent;
+	Actor->GetActorBounds(true, Origin, BoxExtent);
+	WorldBounds.Update(Actor, Origin, BoxExtent);
 }
 
-void AGameStateStoryGen::GetPlayerRelativity(const AActor* TargetActor)
+void AGameStateStoryGen::UpdateMovedBounds(int32 Index)
 {
 	/**
-	* # Function: GetPlayerRelativity()
-	*
-	* ## Brief
-	* Calcuates and logs the positoin of a target actor relative to the player's location and orientation.
-	* 
-	* ## Details
-	* This function performs the following tasks:
-	* - Retrive the local player's position, forward vector, and right vector.
-	* - Calculates the relative position of the TargetActor using dotproduct with the player's orientation vectors.
-	* - Logs the relative position, distance from the player and other details.
-	* - Creates a JSON object containing the actor's relative position, distance and a timestamp.
-	* - Sends the JSOn object by calling `SendPayload()` function if the movement was within a specified distance: 800 units in Unreal Engine.
-	* 
-	* ## Note
-	* The specified distance can be changed in the condition at line 458.
-	* 
-	* ## See also
-	* - GetRelativePosition()
-	* - SendPayload()
-	*/
-	TSharedPtr<FJsonObject> EventObject = MakeShareable(new FJsonObject());
+	 * # UpdateMovedBounds
+	 *
+	 * ## Brief
+	 * Updates the box of a story object that moved in the last check, on the game thread after the sweep.
+	 *
+	 * ## Details
+	 * The check may run on a worker thread, so it only sets `BoundsChanged`. Reading the bounds of one actor is
+	 * cheap, the environment `space` never needs a pass over all actors.
+	 */
+	FTrackedObject& TrackedObject = TrackedObjects[Index];
+	if (!TrackedObject.BoundsChanged)
+	{
+		return;
+	}
+	TrackedObject.BoundsChanged = false;
 
-	if (!TargetActor || !TrackedObjects.Num())
-		UE_LOG(LogTemp, Warning, TEXT("Invalid actor or no tracked objects."));
+	AActor* Actor = TrackedObject.Actor.Get();
+	if (IsValid(Actor) && EnvironmentActors.Contains(TrackedObject.Actor))
+	{
+		FVector Origin;
+		FVector BoxExtent;
+		Actor->GetActorBounds(true, Origin, BoxExtent);
+		WorldBounds.Update(Actor, Origin, BoxExtent);
+	}
+}
+
+void AGameStateStoryGen::UnregisterActor(AActor* Actor)
+{
+	/**
+	 * # UnregisterActor
+	 *
+	 * ## Brief
+	 * Removes an actor from the tracked objects and the environment. O(1).
+	 *
+	 * ## Details
+	 * The slot of the actor is cleared and put on the free list, see `AddTrackedObject()`.
+	 * A cleared slot has no actor and is skipped by the sweeps.
+	 */
+	EnvironmentActors.Remove(Actor);
+	WorldBounds.Remove(Actor);
 
-	FVector PlayerPosition = FVector::ZeroVector;
-	FVector PlayerForward = FVector::ZeroVector;
-	FVector PlayerRight = FVector::ZeroVector;
-	FVector PlayerUp = FVector::UpVector;
+	int32 Slot;
+	if (TrackedSlots.RemoveAndCopyValue(Actor, Slot))
+	{
+		ClearTrackedSlot(Slot);
+	}
+}
 
-	for (const FTrackedObject& Object : TrackedObjects)
+void AGameStateStoryGen::ClearTrackedSlot(int32 Slot)
+{
+	/**
+	 * # ClearTrackedSlot
+	 *
+	 * ## Brief
+	 * Clears a slot of `TrackedObjects` and puts it on the free list, also when its actor is already gone.
+	 */
+	TrackedSlots.Remove(TrackedObjects[Slot].Actor);
+	EnvironmentActors.Remove(TrackedObjects[Slot].Actor);
+	TrackedObjects[Slot] = FTrackedObject();
+	TrackingLOD.Remove(Slot);
+	for (FStoryPlayerStream& Player : Players)
 	{
-		if (Object.IsPlayer && Object.Actor)
+		if (Player.Slot == Slot)
 		{
-			PlayerPosition = Object.Actor->GetActorLocation();
-			PlayerForward = Object.Actor->GetActorForwardVector();
-			PlayerRight = Object.Actor->GetActorRightVector();
-			break;
+			Player.Slot = INDEX_NONE;
 		}
 	}
-	FVector ActorLocation = TargetActor->GetActorLocation();
-	FVector RelativeVector = TargetActor->GetActorLocation() - PlayerPosition;
-	FString name = TargetActor->GetActorLabel();
-	double Distance = RelativeVector.Size();
-
-	FVector NormalizedRelativeVector = RelativeVector.GetSafeNormal();
-
-	double ForwardDot = FVector::DotProduct(PlayerForward, NormalizedRelativeVector);
-	double RightDot = FVector::DotProduct(PlayerRight, NormalizedRelativeVector);
-	double VerticalDot = FVector::DotProduct(PlayerUp, NormalizedRelativeVector);
+	FreeSlots.Add(Slot);
+}
 
-	if (Distance < 800)
+void AGameStateStoryGen::SyncPlayers()
+{
+	/**
+	 * # SyncPlayers
+	 *
+	 * ## Brief
+	 * Keeps a story stream and a tracked pawn for every local and remote player in `PlayerArray`.
+	 *
+	 * ## Details
+	 * Players are identified by their PlayerState, so a respawned pawn continues the same story.
+	 * A server with `bServerAuthoritativeStory` opens a `UStoryNarrationChannel` to every remote player.
+	 * A new pawn replaces the old one in the tracked objects. Streams of players that left are kept
+	 * (without a pawn) until the end of the session. Cheap enough to call before each sweep, there are only a few players.
+	 * The first local player gets the speculative narration, see `UpdateSpeculation()`.
+	 */
+	SpeculationPlayer = INDEX_NONE;
+	for (APlayerState* PlayerState : PlayerArray)
 	{
-		FString RelativePosition = GetRelativePosition(ForwardDot, RightDot, VerticalDot);
+		const int32 PlayerIndex = FindOrAddPlayer(PlayerState);
+		if (PlayerIndex == INDEX_NONE)
+		{
+			continue;
+		}
 
-		EventObject->SetStringField(TEXT("Object"), *TargetActor->GetActorLabel());
-		EventObject->SetNumberField(TEXT("Distance from player"), Distance);
-		EventObject->SetStringField(TEXT("Relative Position to player"), RelativePosition);
+		FStoryPlayerStream& Player = Players[PlayerIndex];
+		if (TrackedObjects.IsValidIndex(Player.Slot) && !TrackedObjects[Player.Slot].Actor.IsValid())
+		{
+			// The pawn is gone without OnActorDestroyed()
+			ClearTrackedSlot(Player.Slot);
+		}
 
-		FDateTime CurrentTime = FDateTime::Now();
-		FString Timestamp = CurrentTime.ToString(TEXT("%Y-%m-%d %H:%M:%S"));
-		EventObject->SetStringField(TEXT("TimeStamp"), Timestamp);
+		APawn* Pawn = PlayerState->GetPawn();
+		AActor* TrackedPawn = TrackedObjects.IsValidIndex(Player.Slot) ? TrackedObjects[Player.Slot].Actor.Get() : nullptr;
+		if (Pawn != TrackedPawn)
+		{
+			if (TrackedPawn)
+			{
+				UnregisterActor(TrackedPawn);
+			}
+			if (Pawn)
+			{
+				FTrackedObject PlayerObject;
+				PlayerObject.Actor = Pawn;
+				PlayerObject.PreviousPosition = Pawn->GetActorLocation();
+				PlayerObject.ActorName = PlayerIndex == 0 ? TEXT("Player") : FString::Printf(TEXT("Player %d"), PlayerIndex + 1);
+				PlayerObject.IsPlayer = true;
+				const int32* Slot = TrackedSlots.Find(Pawn);
+				Player.Slot = Slot ? *Slot : AddTrackedObject(PlayerObject);
+			}
+		}
 
-		FString SerializedJson;
-		TSharedRef<TJsonWriter<>> Writer = TJsonWriterFactory<>::Create(&SerializedJson);
-		SendPayload(EventObject);
+		APlayerController* Controller = Cast<APlayerController>(PlayerState->GetOwner());
+		if (SpeculationPlayer == INDEX_NONE && Controller && Controller->IsLocalController())
+		{
+			SpeculationPlayer = PlayerIndex;
+		}
+		if (ReplicatesNarration() && Controller && !Controller->IsLocalController() && !Player.Channel.IsValid())
+		{
+			Player.Channel = UStoryNarrationChannel::FindOrAdd(Controller, NarrationCodec);
+		}
 	}
 }
 
-FString AGameStateStoryGen::GetRelativePosition(const double& ForwardDot, const double& RightDot, const double& VerticalDot)
+int32 AGameStateStoryGen::FindOrAddPlayer(APlayerState* PlayerState)
 {
 	/**
-	* # Function: GetRelativePosition()
-	*
-	* ## Brief
-	* This function determines the direction relative position as a string description.
-	* Returns a FString.
-	*
-	*/
-	FString Position;
-	const double VerticalThreshold = 0.8f;
-	const double HorizontalThreshold = 0.8f;
-
-	// Cases for when object is directly to any direction:
-	if (VerticalDot > VerticalThreshold)
+	 * # FindOrAddPlayer
+	 *
+	 * ## Brief
+	 * Returns the index of the story stream of a player, and opens the stream if the player has none yet.
+	 *
+	 * ## Details
+	 * The index is the player's HUD channel and the owner of its requests in the `Scheduler`.
+	 * HUD widgets call this on construction, possibly before `BeginPlay()`. A linear search, there are only a few players.
+	 */
+	if (!PlayerState)
 	{
-		Position = TEXT("directly above the player");
+		return INDEX_NONE;
 	}
-	else if (VerticalDot < -VerticalThreshold)
+
+	const int32 Found = Players.IndexOfByPredicate([PlayerState](const FStoryPlayerStream& Player) { return Player.PlayerState == PlayerState; });
+	if (Found != INDEX_NONE)
 	{
-		Position = TEXT("directly below the player");
+		return Found;
 	}
 
-	else if (RightDot > HorizontalThreshold)
+	FStoryPlayerStream& Player = Players.AddDefaulted_GetRef();
+	Player.PlayerState = PlayerState;
+	Player.Summarizer.Configure(SummaryThreshold, VerbatimResponseCount, MaxSynopsisLength);
+	UE_LOG(LogTemp, Log, TEXT("Story stream %d opened for player %d."), Players.Num() - 1, PlayerState->GetPlayerId());
+	return Players.Num() - 1;
+}
+
+int32 AGameStateStoryGen::FindPlayerById(int32 PlayerId) const
+{
+	/**
+	 * # FindPlayerById
+	 *
+	 * ## Brief
+	 * Returns the index of the story stream of the player with this `APlayerState::GetPlayerId()`, or `INDEX_NONE`.
+	 *
+	 * ## Details
+	 * Stream indices differ between the server and the clients, the player id is the same on all of them.
+	 */
+	return Players.IndexOfByPredicate([PlayerId](const FStoryPlayerStream& Player)
+	{
+		return Player.PlayerState.IsValid() && Player.PlayerState->GetPlayerId() == PlayerId;
+	});
+}
+
+void AGameStateStoryGen::OnActorSpawned(AActor* Actor)
+{
+	/**
+	 * # OnActorSpawned
+	 *
+	 * ## Brief
+	 * Tracks actors spawned after `BeginPlay()`, with the same classification as `GetActors()`.
+	 */
+	if (!Actor)
 	{
-		Position = TEXT("directly to the right of the player");
+		return;
 	}
-	else if (RightDot < -HorizontalThreshold)
+
+	if (FWorldSnapshot::IsStoryObject(Actor))
 	{
-		Position = TEXT("directly to the left of the player");
+		AddEnvironmentActor(Actor);
 	}
 
-	else if (ForwardDot > HorizontalThreshold)
+	if (IsTrackingCandidate(Actor) && ClassifyActor(Actor) == EActorTracking::Tracked)
 	{
-		Position = TEXT("directly in front of the player");
+		RegisterActor(Actor);
 	}
-	else if (ForwardDot < -HorizontalThreshold)
+}
+
+void AGameStateStoryGen::OnActorDestroyed(AActor* Actor)
+{
+	// Also removes its box from WorldBounds while the actor can still be resolved
+	UnregisterActor(Actor);
+}
+
+EActorTracking AGameStateStoryGen::ClassifyActor(const AActor* Actor)
+{
+	/**
+	 * # ClassifyActor
+	 *
+	 * ## Brief
+	 * Decides whether an actor can move and has to be tracked.
+	 *
+	 * ## Details
+	 * In order:
+	 * - A `Trackable: true` or `Trackable: false` tag overrides the classification.
+	 * - Editor-only actors (helpers, debug actors) do not exist in a game and are not tracked.
+	 * - Actors without a root component have no transform to follow.
+	 * - Actors whose root simulates physics are tracked.
+	 * - Actors with a Static or Stationary root (static meshes, landscape) cannot move and are not tracked.
+	 *
+	 * Give actors that are made movable at runtime with `SetMobility()` the `Trackable: true` tag.
+	 */
+	if (!IsValid(Actor))
 	{
-		Position = TEXT("directly behind the player");
+		return EActorTracking::Excluded;
 	}
-	else
+
+	for (const FName& Tag : Actor->Tags)
 	{
-		// cases for when its not in a direct direction
-		if (ForwardDot > 0)
+		FString TagString = Tag.ToString();
+		if (TagString.StartsWith(TEXT("Trackable:")))
 		{
-			if (RightDot > 0)
-			{
-				if (VerticalDot > 0)
-				{
-					Position = TEXT("in front-right-above the player");
-				}
-				else
-				{
-					Position = TEXT("in front-right-below the player");
-				}
-			}
-			else
-			{
-				if (VerticalDot > 0)
-				{
-					Position = TEXT("in front-left-above the player");
-				}
-				else
-				{
-					Position = TEXT("in front-left-below the player");
-				}
-			}
+			return TagString.Mid(10).TrimStartAndEnd().ToBool() ? EActorTracking::Tracked : EActorTracking::Excluded;
 		}
-		else
+	}
+
+	if (Actor->IsEditorOnly())
+	{
+		return EActorTracking::EditorOnly;
+	}
+
+	const USceneComponent* Root = Actor->GetRootComponent();
+	if (!Root)
+	{
+		return EActorTracking::Static;
+	}
+
+	const UPrimitiveComponent* Primitive = Cast<UPrimitiveComponent>(Root);
+	if (Primitive && Primitive->IsSimulatingPhysics())
+	{
+		return EActorTracking::Tracked;
+	}
+
+	if (Actor->IsRootComponentStatic() || Actor->IsRootComponentStationary())
+	{
+		return EActorTracking::Static;
+	}
+	return EActorTracking::Tracked;
+}
+
+void AGameStateStoryGen::PerformTracking()
+{
+	/**
+	* # Function: PerformTracking()
+	* 
+	* ## Brief
+	* Starts a sweep over the tracked objects to detect movements of the relevant actors in the game world.
+	* 
+	* ## Details
+	* The sweep is not run in the timer callback. It is added as a sliced task to the `FrameScheduler`,
+	* which runs `TrackSlice()` within the frame budget until all tracked objects are checked.
+	* A new sweep is only started once the previous one is finished.
+	* 
+	* With `bTrackingLOD` the tracked objects are checked every frame by `TrackDueObjects()` instead,
+	* and the timer only updates the speculative narration.
+	* 
+	* ## Notes
+	* - Player positions are identified using tracked objects marked with 'IsPlayer', one per player, see `SyncPlayers()`.
+	* - The player views are cached in `SweepPlayerViews` when the sweep starts, see `GetPlayerViews()`.
+	*/
+	if (bTrackingLOD)
+	{
+		if (bSpeculativeNarration)
 		{
-			if (RightDot > 0)
-			{
-				if (VerticalDot > 0)
-				{
-					Position = TEXT("behind-right-above the player");
-				}
-				else
-				{
-					Position = TEXT("behind-right-below the player");
-				}
-			}
-			else
+			UpdateSpeculation();
+		}
+		return;
+	}
+
+	if (FrameScheduler.HasTask(TEXT("Tracking")))
+	{
+		UE_LOG(LogTemp, Verbose, TEXT("Previous tracking sweep is still running."));
+		return;
+	}
+
+	// The player views are read once, every slice of the sweep uses them
+	SyncPlayers();
+	GetPlayerViews(SweepPlayerViews);
+	for (const FTrackingPlayerView& PlayerView : SweepPlayerViews)
+	{
+		if (PlayerView.bValid)
+		{
+			UE_LOG(LogTemp, Log, TEXT("PLAYER LOCATION: %s"), *PlayerView.Position.ToString());
+		}
+	}
+
+	TrackingCursor = 0;
+	FrameScheduler.AddTask(TEXT("Tracking"), [this]() { return TrackSlice(); });
+}
+
+bool AGameStateStoryGen::TrackSlice()
+{
+	/**
+	* # Function: TrackSlice()
+	* 
+	* ## Brief
+	* Checks the next `TrackingSliceSize` tracked objects for movement. Returns true when the sweep is finished.
+	* 
+	* ## Details
+	* This function performs the following tasks:
+	* - Compares the curent and previous positions of tracked actors to detect movements.
+	* - Determines the position of moved actors relative to every player in bulk, see `FTrackingSweep::GetRelativities()`.
+	*   All slices of a sweep use the player views cached in `SweepPlayerViews`.
+	* - Sends an event to the story stream of each player a movement is near with `PublishMovements()`, in the order of `TrackedObjects`.
+	* - Updates the speculative narration once the whole sweep is done.
+	* 
+	* With `bParallelTracking` the detection is spread over worker threads with `FTrackingSweep::Run()`,
+	* in chunks of at least `ParallelTrackingBatchSize` objects. The actor positions of the slice are copied on the
+	* game thread first (`ReadTrackedPosition()`), the workers only read the copies. Events are published on the game thread afterwards.
+	* 
+	* ## Notes
+	* - Only actors that are considered valid are processed. (non-player, non-camera manager actors)
+	* - Movement data is updated in the 'TrackedObjects' array.
+	* - `TrackingCursor` is checked against `TrackedObjects` on every slice, the array may change between frames.
+	* - Raise `TrackingSliceSize` for levels with many tracked objects, slices smaller than two batches run on one thread.
+	*/
+	const int32 SliceEnd = FMath::Min(TrackingCursor + FMath::Max(1, TrackingSliceSize), TrackedObjects.Num());
+	const TConstArrayView<FTrackingPlayerView> PlayerViews = SweepPlayerViews;
+	const int32 NumChunks = bParallelTracking ? FTrackingSweep::GetNumChunks(SliceEnd - TrackingCursor, ParallelTrackingBatchSize) : 1;
+
+	const double Now = GetWorld() ? GetWorld()->GetTimeSeconds() : 0.0;
+
+	// Actors are only read here, on the game thread. The workers compare the copied positions.
+	TArray<TOptional<FVector>> Positions;
+	Positions.Reserve(SliceEnd - TrackingCursor);
+	for (int32 Index = TrackingCursor; Index < SliceEnd; Index++)
+	{
+		Positions.Add(ReadTrackedPosition(Index));
+	}
+
+	TArray<FTrackedMovement> Moved;
+	const int32 SliceBegin = TrackingCursor;
+	FTrackingSweep::Run(TrackingCursor, SliceEnd, NumChunks, PlayerViews, EventDistance, [this, &Positions, SliceBegin, PlayerViews, Now](int32 Index, FTrackedMovement& OutMovement)
+	{
+		return SampleTrackedObject(Index, Positions[Index - SliceBegin], PlayerViews, Now, OutMovement);
+	}, Moved);
+	for (int32 Index = TrackingCursor; Index < SliceEnd; Index++)
+	{
+		UpdateMovedBounds(Index);
+	}
+	TrackingCursor = SliceEnd;
+
+	PublishMovements(Moved, Now);
+
+	if (TrackingCursor < TrackedObjects.Num())
+	{
+		return false;
+	}
+
+	if (bSpeculativeNarration)
+	{
+		UpdateSpeculation();
+	}
+	return true;
+}
+
+bool AGameStateStoryGen::TrackDueObjects()
+{
+	/**
+	* # Function: TrackDueObjects()
+	* 
+	* ## Brief
+	* Checks the tracked objects that are due this frame for movement, see `FTrackingLOD`.
+	* 
+	* ## Details
+	* Objects near the player are checked every frame, objects further away or not moving less often.
+	* At most `TrackingChecksPerFrame` objects are checked per frame, spread over worker threads like `TrackSlice()`.
+	* After the check each object is moved to the tier of its distance to the nearest player. An object counts as moving
+	* if it moved in the last `TrackingIdleTime` seconds. Events are published on the game thread in the order of `TrackedObjects`,
+	* at most one per object every `EventPublishInterval` seconds, see `PublishMovements()`.
+	* 
+	* Runs as a task of the `FrameScheduler`. `PendingTrackingTime` is the time since the last check.
+	*/
+	const double DeltaTime = PendingTrackingTime;
+	PendingTrackingTime = 0.0;
+
+	TArray<int32> Due;
+	TrackingLOD.CollectDue(DeltaTime, Due);
+	if (Due.Num() == 0)
+	{
+		return true;
+	}
+
+	SyncPlayers();
+	TArray<FTrackingPlayerView> PlayerViews;
+	GetPlayerViews(PlayerViews);
+	const double Now = GetWorld() ? GetWorld()->GetTimeSeconds() : 0.0;
+	const int32 NumChunks = bParallelTracking ? FTrackingSweep::GetNumChunks(Due.Num(), ParallelTrackingBatchSize) : 1;
+
+	// Written by the worker checking the object, one entry each
+	TArray<double> Distances;
+	Distances.SetNumUninitialized(Due.Num());
+
+	// Actors are only read here, on the game thread. The workers compare the copied positions.
+	TArray<TOptional<FVector>> Positions;
+	Positions.Reserve(Due.Num());
+	for (int32 Index : Due)
+	{
+		Positions.Add(ReadTrackedPosition(Index));
+	}
+
+	TArray<FTrackedMovement> Moved;
+	FTrackingSweep::Run(0, Due.Num(), NumChunks, PlayerViews, EventDistance, [this, &Due, &Positions, &Distances, &PlayerViews, Now](int32 DueIndex, FTrackedMovement& OutMovement)
+	{
+		const bool bMoved = SampleTrackedObject(Due[DueIndex], Positions[DueIndex], PlayerViews, Now, OutMovement);
+		Distances[DueIndex] = OutMovement.Distance;
+		return bMoved;
+	}, Moved);
+
+	for (int32 DueIndex = 0; DueIndex < Due.Num(); DueIndex++)
+	{
+		const FTrackedObject& TrackedObject = TrackedObjects[Due[DueIndex]];
+		const bool bMoving = TrackedObject.LastMovedTime >= 0.0 && Now - TrackedObject.LastMovedTime <= TrackingIdleTime;
+		TrackingLOD.Assign(Due[DueIndex], Distances[DueIndex], bMoving);
+		UpdateMovedBounds(Due[DueIndex]);
+	}
+
+	// Due objects are collected tier by tier, sort the movements back into the order of TrackedObjects
+	for (FTrackedMovement& Movement : Moved)
+	{
+		Movement.Index = Due[Movement.Index];
+	}
+	Moved.Sort([](const FTrackedMovement& A, const FTrackedMovement& B) { return A.Index < B.Index || (A.Index == B.Index && A.Player < B.Player); });
+
+	PublishMovements(Moved, Now);
+	return true;
+}
+
+void AGameStateStoryGen::PublishMovements(const TArray<FTrackedMovement>& Moved, double Now)
+{
+	/**
+	* # Function: PublishMovements()
+	*
+	* ## Brief
+	* Publishes the movements of a sweep with `PublishEvent()`, at most one event per object every `EventPublishInterval` seconds.
+	*
+	* ## Details
+	* Near objects are checked every frame, an object carried by the player would otherwise publish an event,
+	* and a Critical request, each frame. The first movement is published right away, the movements within the
+	* interval after it are dropped. The tracking itself (positions, bounds, tiers) is not throttled.
+	* The movements of an object to different players are adjacent in `Moved`, they are published in the same frame.
+	*/
+	int32 CurrentIndex = INDEX_NONE;
+	bool bDue = false;
+	for (const FTrackedMovement& Movement : Moved)
+	{
+		FTrackedObject& TrackedObject = TrackedObjects[Movement.Index];
+		if (Movement.Index != CurrentIndex)
+		{
+			CurrentIndex = Movement.Index;
+			bDue = FTrackingSweep::IsPublishDue(TrackedObject.LastPublishedTime, Now, EventPublishInterval);
+			if (bDue)
 			{
-				if (VerticalDot > 0)
-				{
-					Position = TEXT("behind-left-above the player");
-				}
-				else
-				{
-					Position = TEXT("behind-left-below the player");
-				}
+				TrackedObject.LastPublishedTime = Now;
 			}
 		}
+		const AActor* Actor = TrackedObject.Actor.Get();
+		if (bDue && Actor)
+		{
+			PublishEvent(Movement.Player, Actor->GetActorLabel(), Movement.Distance, Movement.Direction, TrackedObject.IsInteractable);
+		}
+	}
+}
+
+TOptional<FVector> AGameStateStoryGen::ReadTrackedPosition(int32 Index) const
+{
+	/**
+	* # Function: ReadTrackedPosition()
+	*
+	* ## Brief
+	* Returns the location of the actor of a tracked object, or nothing if the object is not checked for movement.
+	*
+	* ## Details
+	* Called on the game thread before a sweep hands the objects to the workers, see `SampleTrackedObject()`.
+	* Destroyed actors, characters and camera managers are not checked.
+	*/
+	const AActor* Actor = TrackedObjects[Index].Actor.Get();
+	if (IsValid(Actor) &&
+		!Actor->IsA(ACharacter::StaticClass()) &&
+		!Actor->IsA(APlayerCameraManager::StaticClass()))
+	{
+		return Actor->GetActorLocation();
 	}
-	return FString::Printf(TEXT("Actor is %s."), *Position);
+	return {};
 }
 
-void AGameStateStoryGen::SendPayload(const TSharedPtr<FJsonObject>& Event)
+bool AGameStateStoryGen::SampleTrackedObject(int32 Index, const TOptional<FVector>& CurrentPosition, TConstArrayView<FTrackingPlayerView> PlayerViews, double Now, FTrackedMovement& OutMovement)
+{
+	/**
+	* # Function: SampleTrackedObject()
+	* 
+	* ## Brief
+	* Checks one tracked object for movement. Returns true if it moved.
+	* 
+	* ## Details
+	* `CurrentPosition` is the location read by `ReadTrackedPosition()` on the game thread, unset for objects that are not checked.
+	* `OutMovement` holds the distance to the nearest player of every valid object, and the location of a moved object.
+	* The relativity to each player is computed afterwards for all moved objects at once, see `FTrackingSweep::GetRelativities()`.
+	* Invalid objects get the largest distance. Does not touch the actor and only writes the tracked object at `Index`,
+	* so it may run on worker threads for different indices at the same time.
+	*/
+	FTrackedObject& TrackedObject = TrackedObjects[Index];
+	OutMovement.Distance = TNumericLimits<double>::Max();
+	if (!CurrentPosition.IsSet())
+	{
+		return false;
+	}
+
+	OutMovement.Distance = FTrackingSweep::GetNearestDistance(PlayerViews, *CurrentPosition);
+
+	// If the object has moved, log the interaction 
+	if (!CurrentPosition->Equals(TrackedObject.PreviousPosition, KINDA_SMALL_NUMBER))
+	{
+		TrackedObject.PreviousPosition = *CurrentPosition; // Update the previous position
+		TrackedObject.LastMovedTime = Now;
+		TrackedObject.BoundsChanged = TrackedObject.IsStoryObject;
+		OutMovement.Location = *CurrentPosition;
+		return true;
+	}
+	return false;
+}
+
+void AGameStateStoryGen::UpdateSpeculation()
+{
+	/**
+	* # Function: UpdateSpeculation()
+	*
+	* ## Brief
+	* Predicts the player's next interactions and pre-generates narrations for them.
+	*
+	* ## Details
+	* This function performs the following tasks:
+	* - Collects the interactable tracked objects and lets `FStorySpeculator` rank them by reach and facing.
+	* - Drops pre-generated narrations for objects that are no longer predicted.
+	* - Sends one speculative request for the best candidate without a narration.
+	*
+	* ## Notes
+	* Speculative requests are submitted to the `Scheduler` at Low priority: they are skipped while the pipeline
+	* is saturated, preempted by any story request, and only one runs at a time.
+	* Speculation runs for the first local player only (`SpeculationPlayer`), the one whose HUD shows the narration.
+	*
+	* ## See also
+	* - FStorySpeculator
+	* - httpSendSpeculativeReq()
+	*/
+	const FTrackingPlayerView PlayerView = GetPlayerView(SpeculationPlayer);
+	if (!PlayerView.bValid)
+	{
+		return;
+	}
+
+	TArray<FSpeculationCandidate> Nearby;
+	for (const FTrackedObject& TrackedObject : TrackedObjects)
+	{
+		const AActor* Actor = TrackedObject.Actor.Get();
+		if (TrackedObject.IsInteractable && IsValid(Actor))
+		{
+			FSpeculationCandidate Candidate;
+			Candidate.ActorName = Actor->GetActorLabel();
+			Candidate.Location = Actor->GetActorLocation();
+			Nearby.Add(Candidate);
+		}
+	}
+
+	TArray<FSpeculationCandidate> Candidates;
+	Speculator.PredictInteractions(PlayerView.Position, PlayerView.Forward, PlayerView.Right, Nearby, Candidates);
+	Speculator.Prune(Candidates, GetWorld()->GetTimeSeconds());
+
+	if (Scheduler.IsSaturated() || Speculator.NumInFlight() > 0)
+	{
+		return;
+	}
+
+	for (const FSpeculationCandidate& Candidate : Candidates)
+	{
+		if (Speculator.NeedsNarration(Candidate.ActorName))
+		{
+			Scheduler.Submit(ENarrationPriority::Low, [this, Candidate](uint32 JobId) { return httpSendSpeculativeReq(Candidate, JobId); }, SpeculationPlayer);
+			break;
+		}
+	}
+}
+
+TSharedPtr<FJsonObject> AGameStateStoryGen::SerializeVector(const FVector& Vector, EStoryNumberPrecision Precision)
+{
+	/**
+	* # Function: SerializeVector()
+	* 
+	* ## Brief
+	* Convers an FVector into a JSON object, rounded to the precision (see `FStoryNumberFormat`).
+	*/
+	TSharedPtr<FJsonObject> JsonObject = MakeShareable(new FJsonObject);
+	FStoryNumberFormat::SetNumberField(*JsonObject, TEXT("x"), Vector.X, Precision);
+	FStoryNumberFormat::SetNumberField(*JsonObject, TEXT("y"), Vector.Y, Precision);
+	FStoryNumberFormat::SetNumberField(*JsonObject, TEXT("z"), Vector.Z, Precision);
+	return JsonObject;
+}
+
+void AGameStateStoryGen::GetPlayerRelativity(const AActor* TargetActor, bool bInteractable)
+{
+	/**
+	* # Function: GetPlayerRelativity()
+	*
+	* ## Brief
+	* Calcuates and logs the positoin of a target actor relative to the player's location and orientation.
+	* 
+	* ## Details
+	* This function performs the following tasks:
+	* - Retrive the position, forward vector, and right vector of every local and remote player, see `GetPlayerViews()`.
+	* - Calculates the relative position of the TargetActor to all players in one pass, using dotproducts with each player's orientation vectors.
+	* - Sends an event to each player's stream by calling `PublishEvent()` if the movement was within a specified distance: 800 units in Unreal Engine.
+	*   The event holds the actor's relative direction, distance, a timestamp and whether the actor is
+	*   interactable (`bInteractable`), used for the request priority.
+	* 
+	* ## Note
+	* The specified distance can be changed with `EventDistance` at the top of this file.
+	* The tracking sweep uses the same calculation on worker threads, see `TrackSlice()`.
+	* 
+	* ## See also
+	* - FTrackingSweep::GetRelativities()
+	* - PublishEvent()
+	*/
+	if (!TargetActor || !TrackedObjects.Num())
+	{
+		UE_LOG(LogTemp, Warning, TEXT("Invalid actor or no tracked objects."));
+		if (!TargetActor)
+		{
+			return;
+		}
+	}
+
+	TArray<FTrackingPlayerView> PlayerViews;
+	GetPlayerViews(PlayerViews);
+
+	TArray<FTrackedMovement> Moved;
+	FTrackedMovement& Movement = Moved.AddDefaulted_GetRef();
+	Movement.Location = TargetActor->GetActorLocation();
+	Movement.Distance = FTrackingSweep::GetNearestDistance(PlayerViews, Movement.Location);
+	FTrackingSweep::GetRelativities(PlayerViews, EventDistance, Moved);
+
+	for (const FTrackedMovement& Relative : Moved)
+	{
+		PublishEvent(Relative.Player, TargetActor->GetActorLabel(), Relative.Distance, Relative.Direction, bInteractable);
+	}
+}
+
+FTrackingPlayerView AGameStateStoryGen::GetPlayerView(int32 PlayerIndex) const
+{
+	/**
+	* # Function: GetPlayerView()
+	*
+	* ## Brief
+	* Reads the position, forward vector and right vector of a player from the tracked objects.
+	*
+	* ## Details
+	* The slot of the player's pawn in `TrackedObjects` is kept in its story stream, so no search is needed.
+	* The view is not valid if the player has no pawn.
+	*/
+	FTrackingPlayerView PlayerView;
+	const int32 Slot = Players.IsValidIndex(PlayerIndex) ? Players[PlayerIndex].Slot : INDEX_NONE;
+	const AActor* Player = TrackedObjects.IsValidIndex(Slot) ? TrackedObjects[Slot].Actor.Get() : nullptr;
+	if (IsValid(Player))
+	{
+		PlayerView.Position = Player->GetActorLocation();
+		PlayerView.Forward = Player->GetActorForwardVector();
+		PlayerView.Right = Player->GetActorRightVector();
+		PlayerView.bValid = true;
+	}
+	return PlayerView;
+}
+
+void AGameStateStoryGen::GetPlayerViews(TArray<FTrackingPlayerView>& OutViews) const
+{
+	/**
+	* # Function: GetPlayerViews()
+	*
+	* ## Brief
+	* Reads the views of all players, indexed by player index. Sweeps call this once and share the result.
+	*/
+	OutViews.Reset(Players.Num());
+	for (int32 PlayerIndex = 0; PlayerIndex < Players.Num(); PlayerIndex++)
+	{
+		OutViews.Add(GetPlayerView(PlayerIndex));
+	}
+}
+
+void AGameStateStoryGen::PublishEvent(int32 PlayerIndex, const FString& ActorName, double Distance, EStoryDirection Direction, bool bInteractable)
+{
+	/**
+	* # Function: PublishEvent()
+	*
+	* ## Brief
+	* Creates the `FStoryEvent` of a movement near a player and sends it to the player's stream with `SendPayload()`.
+	*
+	* ## Details
+	* Shows the pre-generated narration first if the event is a predicted interaction, see `UpdateSpeculation()`.
+	* With `bLatencyTracing` the event is traced from here to the HUD, see `FStoryLatencyTrace`.
+	* Must be called on the game thread.
+	*/
+	FStoryEvent Event;
+	Event.ActorName = ActorName;
+	Event.Distance = Distance;
+	Event.Direction = Direction;
+	Event.IsInteractable = bInteractable;
+
+	FDateTime CurrentTime = FDateTime::Now();
+	Event.TimeStamp = CurrentTime.ToString(TEXT("%Y-%m-%d %H:%M:%S"));
+	if (bLatencyTracing)
+	{
+		Event.TraceId = LatencyTrace.BeginEvent(PlayerIndex);
+	}
+
+	// A predicted interaction is narrated right away with the pre-generated text
+	FString SpeculativeNarration;
+	if (bSpeculativeNarration && PlayerIndex == SpeculationPlayer && Speculator.TakeNarration(Event, SpeculativeNarration))
+	{
+		UE_LOG(LogTemp, Log, TEXT("Predicted interaction with %s, showing pre-generated narration."), *Event.ActorName);
+		HandleNarration(PlayerIndex, SpeculativeNarration);
+		Event.IsNarrated = true;
+		// Narrated without a request, the trace of the event ends here
+		LatencyTrace.MarkEvents({ Event.TraceId }, EStoryLatencyStage::Published);
+		LatencyTrace.FinishEvents({ Event.TraceId });
+	}
+
+	// Kept in the history as context for the next narration
+	SendPayload(PlayerIndex, Event);
+}
+
+FString AGameStateStoryGen::GetRelativePosition(const double& ForwardDot, const double& RightDot, const double& VerticalDot)
+{
+	/**
+	* # Function: GetRelativePosition()
+	*
+	* ## Brief
+	* This function determines the direction relative position as a string description.
+	* Returns a FString.
+	*
+	* ## See also
+	* - FStoryEvent::GetDirection()
+	*/
+	EStoryDirection Direction = FStoryEvent::GetDirection(ForwardDot, RightDot, VerticalDot);
+	return FString::Printf(TEXT("Actor is %s."), FStoryEvent::DirectionToString(Direction));
+}
+
+void AGameStateStoryGen::SendPayload(int32 PlayerIndex, const FStoryEvent& Event)
 {
 	/**
 	* # Function: SendPayload()
 	*
 	* ## Brief
-	* Adds a new event ot the event history and triggers a payload request if the history size reached.
+	* Adds a new event ot the event history of a player and triggers a payload request if the history size reached.
 	* 
 	* ## Details
-	* This function manages the 'EventHistoryArray' and calls the `httpSendReq()` method if the size of the array is reached.
+	* This function manages the event history of the player's `FStoryPlayerStream` and calls the `httpSendReq()` method
+	* if the size of the array is reached. Every player has its own history, so the players get separate stories.
 	* 
 	* It performs the following tasks:
-	* - Adds the provided event to the EventHistoryArray.
-	* - If the number of events exceeds the History_Size limit (10):
-	*	- Restes the Event_Count.
-	*	- Regenerates the current environment using GenerateStartEnvironment().
-	*	- Calls httpSendReq()
+	* - Adds the provided event to the player's event history.
+	* - If the number of events exceeds the History_Size limit (10), or the event is Critical (an interactable object held by the player)
+	*   and was not narrated already from a speculative narration:
+	*	- Looks up the quantized events since the last batch in the `ResponseCache`. A cached narration is shown directly.
+	*	- Otherwise (or when background refresh is enabled) submits the request to the `Scheduler` with the priority
+	*	  of the batch, owned by the player. The current environment is captured when the request starts, see `httpSendReq()`.
+	*	- Resets the event count.
 	* - Ensure the event history does not exceed `History_Size` by removing the oldest entry.
 	* 
+	* ## Note
+	* Cache refreshes are submitted at Low priority, the narration was already shown.
+	* The traced events of the batch (the last `EventCount` events) are linked to the request once it starts.
+	*
 	* ## See also
-	* - GenerateStartEnvironment()
 	* - httpSendReq()
+	* - FNarrationResponseCache
+	* - FNarrationScheduler
 	*
 	*/
-	int32 History_Size = 10;
-	Event_Count++;
-	if (Event_Count < History_Size)
+	FStoryPlayerStream* Player = GetPlayerStream(PlayerIndex);
+	if (!Player)
 	{
-		EventHistoryArray.Add(Event);
+		return;
 	}
-	else
+
+	int32 History_Size = 10;
+	Player->EventCount++;
+	Player->Events.Add(Event);
+
+	ENarrationPriority EventPriority = FNarrationScheduler::ClassifyEvent(Event, HeldDistance, InteractionReach);
+	if (Player->EventCount >= History_Size || (EventPriority == ENarrationPriority::Critical && !Event.IsNarrated))
 	{
-		Event_Count = 0;
-		CurrentEnviroment = GenerateStartEnvironment();
-		httpSendReq();
+		// The events since the last batch are at the end of the history
+		TArray<uint32> TraceIds;
+		for (const FStoryEvent& Pending : Player->GetPendingEvents())
+		{
+			if (Pending.TraceId != 0)
+			{
+				TraceIds.Add(Pending.TraceId);
+			}
+		}
+		LatencyTrace.MarkEvents(TraceIds, EStoryLatencyStage::Batched);
+
+		// Repeated scenes are narrated from the cache without an LLM round trip. The key covers the narrated
+		// events only, the older events of the history would make every scene unique.
+		const uint64 SceneKey = ResponseCache.MakeSceneKey(Player->GetPendingEvents());
+		Player->EventCount = 0;
+		FString CachedNarration;
+		bool bServedFromCache = bUseResponseCache && ResponseCache.Find(SceneKey, CachedNarration);
+		if (bServedFromCache)
+		{
+			UE_LOG(LogTemp, Log, TEXT("Scene served from response cache (%d hits, %d misses)."), ResponseCache.GetHits(), ResponseCache.GetMisses());
+			HandleNarration(PlayerIndex, CachedNarration);
+			LatencyTrace.MarkEvents(TraceIds, EStoryLatencyStage::Published);
+			LatencyTrace.FinishEvents(TraceIds);
+			TraceIds.Reset();
+		}
+
+		if (!bServedFromCache || ResponseCache.GetPolicy().bRefreshInBackground)
+		{
+			ENarrationPriority Priority = bServedFromCache ? ENarrationPriority::Low : FNarrationScheduler::ClassifyBatch(Player->Events, HeldDistance, InteractionReach);
+			Scheduler.Submit(Priority, [this, PlayerIndex, SceneKey, bServedFromCache, TraceIds](uint32 JobId)
+				{
+					LatencyTrace.LinkRequest(JobId, TraceIds);
+					return httpSendReq(PlayerIndex, SceneKey, bServedFromCache, JobId);
+				}, PlayerIndex);
+		}
 	}
 
-	if (EventHistoryArray.Num() >= History_Size)
+	if (Player->Events.Num() >= History_Size)
 	{
-		EventHistoryArray.RemoveAt(0);
+		Player->Events.RemoveAt(0);
 	}
 }
 
-void AGameStateStoryGen::httpSendReq()
+FHttpRequestPtr AGameStateStoryGen::httpSendReq(int32 PlayerIndex, uint64 SceneKey, bool bCacheRefresh, uint32 JobId)
 {
 	/**
 	* # Function: httpSendReq()
@@ -625,18 +1399,27 @@ void AGameStateStoryGen::httpSendReq()
 	* This function constructs a JSON payload with the following compontents:
 	* - **Start Environment**: The initial game environment state.
 	* - **Current Environment**: The current game environment state.
-	* - **Event History**: A list of recent events in the game.
-	* - **Old AI Responses**: Previous responses from the AI for context.
+	* - **Event History**: A list of recent events around the player.
+	* - **Story Synopsis**: A summary of the player's older AI responses, see `FStorySummarizer`.
+	* - **Old AI Responses**: The player's latest responses from the AI, sent verbatim for context.
 	* 
-	* The JSOn payload is serialized and sent as a POST request to the specified API endpoint.
-	* - Sets up the HTTP headers and content for the requests.
+	* The event history and responses come from the story stream of the player at `PlayerIndex`.
+	* 
+	* Only a `FWorldSnapshot` of the current environment and copies of the events and responses are taken here.
+	* The JSOn payload is built and serialized on a worker thread and sent as a POST request to the specified API endpoint.
+	* - Sets up the HTTP headers for the requests, see `CreateChatRequest()`, and sends it with `SendChatRequest()`.
 	* - Binds the response to the `OnResponseReceieved` handler for processing the respons.
+	* - With `bStreamNarration` the response is streamed and revealed on the HUD as it arrives, see `OnResponseProgress()`.
 	* - Logs any failures.
 	* 
+	* `SceneKey` is the response cache key of the event batch. With `bCacheRefresh` the narration was already
+	* shown from the cache and the response is only stored as a new cached variant.
+	* `JobId` is the `Scheduler` job of the request. Returns the request, which is sent once its payload is built.
+	* 
 	* ## Note
 	* - The function uses OpenAI's api key for generating the narrative content based on the game state.
 	* - Ensure the `apiKey` is correct.
-	* - The SystemMessage content holds the question asked. Can me modified if needed. 
+	* - The story instructions are set on the `PromptBuilder` in `BeginPlay()`. Can me modified if needed. 
 	* 
 	* ## See also
 	* - OnResponseReceieved()
@@ -645,76 +1428,227 @@ void AGameStateStoryGen::httpSendReq()
 	UE_LOG(LogTemp, Log, TEXT("httpsendreq triggered"));
 	UE_LOG(LogTemp, Log, TEXT("APIKEY: %s"), *RetrievedApiKey);
 
-	FHttpModule* Http = &FHttpModule::Get();
-	TSharedRef<IHttpRequest, ESPMode::ThreadSafe> Request = Http->CreateRequest();
+	FStoryPlayerStream* Player = GetPlayerStream(PlayerIndex);
+	if (!Player)
+	{
+		UE_LOG(LogTemp, Warning, TEXT("No story stream for player %d."), PlayerIndex);
+		return nullptr;
+	}
 
-	TSharedPtr<FJsonObject> JsonPayload = MakeShareable(new FJsonObject);
-	JsonPayload->SetStringField(TEXT("model"), TEXT("gpt-4o"));
+	// The LLM Responses that are not summarized yet
+	TArray<FString> RecentResponses;
+	Player->Summarizer.GetRecentResponses(RecentResponses);
 
-	TArray<TSharedPtr<FJsonValue>> MessagesArray;
-	TSharedPtr<FJsonObject> SystemMessage = MakeShareable(new FJsonObject);
+	FWorldSnapshot Scene;
+	Scene.CaptureStoryObjects(GetWorld(), EnvironmentActors, WorldBounds.GetBounds());
 
-	SystemMessage->SetStringField(TEXT("role"), TEXT("system"));
-	SystemMessage->SetStringField(TEXT("content"), TEXT("Use the json string to generate stories for the game it's retreived from the wanderers point of view in third person. Focus on the last events in Event_History to understand the changes made from Start Environment. Try to not use other concepts or imagination outside the given parameters. If you recieve a history of LLM_responeses, continue on that story. Get straight to the story."));
-	MessagesArray.Add(MakeShareable(new FJsonValueObject(SystemMessage)));
+	// Volatile part of the prompt, always sent last. Built on a worker thread from the copies.
+	auto BuildUserContent = [Scene = MoveTemp(Scene), Events = Player->Events, RecentResponses = MoveTemp(RecentResponses), Title = GameTitle, WorldTheme = Theme, WorldDescription = Description, Precision = NumberPrecision]()
+	{
+		TArray<TSharedPtr<FJsonValue>> LLMResponseJsonArray;
+		for (const FString& Response : RecentResponses)
+		{
+			LLMResponseJsonArray.Add(MakeShareable(new FJsonValueString(Response)));
+		}
+
+		TArray<TSharedPtr<FJsonValue>> EventJson;
+		for (const FStoryEvent& Event : Events)
+		{
+			EventJson.Add(MakeShareable(new FJsonValueObject(Event.ToJson(Precision))));
+		}
 
-	// Create json array of LLM Responses
-	TArray<TSharedPtr<FJsonValue>> LLMResponseJsonArray;
-	for (const FString& Response : LLMResponseArray)
+		TSharedPtr<FJsonObject> User_Content = MakeShareable(new FJsonObject);
+		User_Content->SetObjectField(TEXT("Current_environment"), BuildEnvironment(Scene, Title, WorldTheme, WorldDescription, Precision));
+		User_Content->SetArrayField(TEXT("Event_History"), EventJson);
+		User_Content->SetArrayField(TEXT("Old_AI_Responses"), LLMResponseJsonArray);
+		return User_Content;
+	};
+
+	// Cache refreshes are not shown, so there is nothing to stream
+	bool bStream = bStreamNarration && !bCacheRefresh;
+	TSharedRef<IHttpRequest, ESPMode::ThreadSafe> Request = CreateChatRequest();
+	Request->OnProcessRequestComplete().BindUObject(this, &AGameStateStoryGen::OnResponseReceived, PlayerIndex, SceneKey, bCacheRefresh, JobId);
+	if (bStream)
 	{
-		LLMResponseJsonArray.Add(MakeShareable(new FJsonValueString(Response)));
+		// The body goes to the parser as it arrives, the response content stays empty
+		Request->SetResponseBodyReceiveStreamDelegate(StreamParsers.Add(JobId).CreateReceiveDelegate());
 	}
+	// Also bound when tracing, for the first byte of the response
+	if (bStream || bLatencyTracing)
+	{
+		Request->OnRequestProgress64().BindUObject(this, &AGameStateStoryGen::OnResponseProgress, PlayerIndex, JobId);
+	}
+	SendChatRequest(Request, PlayerIndex, MoveTemp(BuildUserContent), 150, bStream, [this, JobId]()
+		{
+			StreamParsers.Remove(JobId);
+			Scheduler.Complete(JobId, false);
+			LatencyTrace.FinishRequest(JobId);
+		}, JobId);
+	return Request;
+}
 
-	TSharedPtr<FJsonObject> UserMessage = MakeShareable(new FJsonObject);
-	UserMessage->SetStringField(TEXT("role"), TEXT("user"));
-
-	// Create json array of Events
-	TArray<TSharedPtr<FJsonValue>> EventJson;
-	for (const TSharedPtr<FJsonObject>& Event : EventHistoryArray)
+FHttpRequestPtr AGameStateStoryGen::httpSendSpeculativeReq(const FSpeculationCandidate& Candidate, uint32 JobId)
+{
+	/**
+	* # Function: httpSendSpeculativeReq()
+	*
+	* ## Brief
+	* Requests a narration for a predicted interaction before it happens.
+	*
+	* ## Details
+	* The request uses the same cacheable prefix as `httpSendReq()`. The volatile part holds the recent
+	* events of the `SpeculationPlayer` and a `Predicted_Event` describing the player picking up or moving the candidate object.
+	* The answer is stored in the `Speculator` and only shown if the prediction comes true.
+	*
+	* ## See also
+	* - UpdateSpeculation()
+	* - OnSpeculativeResponseReceived()
+	*/
+	FStoryEvent Predicted;
+	Predicted.ActorName = Candidate.ActorName;
+	Predicted.Direction = Candidate.Direction;
+	Predicted.Distance = Candidate.Distance;
+	Predicted.TimeStamp = TEXT("next");
+	Predicted.Type = EStoryEventType::Predicted;
+
+	FStoryPlayerStream* Player = GetPlayerStream(SpeculationPlayer);
+	if (!Player)
 	{
-		EventJson.Add(MakeShareable(new FJsonValueObject(Event)));
+		return nullptr;
 	}
 
-	// Define user json string - message
-	TSharedPtr<FJsonObject> User_Content = MakeShareable(new FJsonObject);
-	User_Content->SetObjectField(TEXT("Start_environment"), StartEnviroment);
-	User_Content->SetObjectField(TEXT("Current_environment"), CurrentEnviroment);
-	User_Content->SetArrayField(TEXT("Event_History"), EventJson);
-	User_Content->SetArrayField(TEXT("Old_AI_Responses"), LLMResponseJsonArray);
-	
-	FString SerializedContent;
-	TSharedRef<TJsonWriter<>> Writer_ = TJsonWriterFactory<>::Create(&SerializedContent);
-	FJsonSerializer::Serialize(User_Content.ToSharedRef(), Writer_);
+	auto BuildUserContent = [Events = Player->Events, Predicted, Precision = NumberPrecision]()
+	{
+		TArray<TSharedPtr<FJsonValue>> EventJson;
+		for (const FStoryEvent& Event : Events)
+		{
+			EventJson.Add(MakeShareable(new FJsonValueObject(Event.ToJson(Precision))));
+		}
 
-	FString WrappedContent = TEXT("\"") + SerializedContent + TEXT("\"");
-	UserMessage->SetStringField(TEXT("content"), WrappedContent);
-	MessagesArray.Add(MakeShareable(new FJsonValueObject(UserMessage)));
-	JsonPayload->SetArrayField(TEXT("messages"), MessagesArray);
-	JsonPayload->SetNumberField(TEXT("temperature"), 0.7);
-	JsonPayload->SetNumberField(TEXT("max_tokens"), 150);
+		TSharedPtr<FJsonObject> User_Content = MakeShareable(new FJsonObject);
+		User_Content->SetArrayField(TEXT("Event_History"), EventJson);
+		User_Content->SetObjectField(TEXT("Predicted_Event"), Predicted.ToJson(Precision));
+		User_Content->SetStringField(TEXT("Instruction"), TEXT("The wanderer is about to pick up or move the object in Predicted_Event. Narrate that moment in 50 tokens or less."));
+		return User_Content;
+	};
+
+	TSharedRef<IHttpRequest, ESPMode::ThreadSafe> Request = CreateChatRequest();
+	Request->OnProcessRequestComplete().BindUObject(this, &AGameStateStoryGen::OnSpeculativeResponseReceived, Candidate.ActorName, JobId);
+	Speculator.MarkInFlight(Candidate.ActorName);
+	SendChatRequest(Request, SpeculationPlayer, MoveTemp(BuildUserContent), 60, false, [this, JobId, ActorName = Candidate.ActorName]()
+		{
+			Speculator.CancelInFlight(ActorName);
+			Scheduler.Complete(JobId, false);
+		});
+	UE_LOG(LogTemp, Log, TEXT("Speculative narration requested for %s"), *Candidate.ActorName);
+	return Request;
+}
 
-	FString SerializedPayload;
-	TSharedRef<TJsonWriter<>> Writer = TJsonWriterFactory<>::Create(&SerializedPayload);
-	FJsonSerializer::Serialize(JsonPayload.ToSharedRef(), Writer);
+TSharedRef<IHttpRequest, ESPMode::ThreadSafe> AGameStateStoryGen::CreateChatRequest()
+{
+	/**
+	* # Function: CreateChatRequest()
+	*
+	* ## Brief
+	* Creates the chat completion request shared by the story and speculative requests.
+	*
+	* ## Details
+	* Only the URL and headers are set. The caller binds the completion delegate and sends
+	* the request with `SendChatRequest()`, which sets the content.
+	*/
+	FHttpModule* Http = &FHttpModule::Get();
+	TSharedRef<IHttpRequest, ESPMode::ThreadSafe> Request = Http->CreateRequest();
 
 	Request->SetURL(TEXT("https://api.openai.com/v1/chat/completions"));
 	Request->SetVerb(TEXT("POST"));
 	Request->SetHeader(TEXT("Content-Type"), TEXT("application/json; charset=utf-8"));
 	Request->SetHeader(TEXT("Authorization"), FString::Printf(TEXT("Bearer %s"), *RetrievedApiKey));
-	Request->SetContentAsString(SerializedPayload);
+	return Request;
+}
 
-	Request->OnProcessRequestComplete().BindUObject(this, &AGameStateStoryGen::OnResponseReceived);
-	if (Request->ProcessRequest())
-	{
-		UE_LOG(LogTemp, Log, TEXT("Payload sent to LLM-service (OpenAI)"));
-	}
-	else
+void AGameStateStoryGen::SendChatRequest(TSharedRef<IHttpRequest, ESPMode::ThreadSafe> Request, int32 PlayerIndex, TUniqueFunction<TSharedPtr<FJsonObject>()> BuildVolatileContent, int32 MaxTokens, bool bStream, TUniqueFunction<void()> OnFailed, uint32 TraceRequest)
+{
+	/**
+	* # Function: SendChatRequest()
+	*
+	* ## Brief
+	* Builds the payload of a chat request on a worker thread and sends the request from the game thread.
+	*
+	* ## Details
+	* The synopsis of the player's story is set on the game thread and the `PromptBuilder` is copied, so the worker only reads
+	* its own copy of the prefix. `BuildVolatileContent` runs on the worker as well and may only use data it owns
+	* (snapshots and copies). The payload is built and serialized by `BuildChatPayload()`. In a later frame the `FrameScheduler`
+	* sets it as content and calls `ProcessRequest()`, unless the request was cancelled in the meantime
+	* (preempted by the `Scheduler`). `OnFailed` runs if the request could not be sent.
+	* `TraceRequest` is the request id in the `LatencyTrace`, which gets the time the payload was serialized and sent.
+	*/
+	FStoryPlayerStream* Player = GetPlayerStream(PlayerIndex);
+	PromptBuilder.SetSynopsis(Player ? Player->Summarizer.GetSynopsis() : FString());
+
+	// Written by the worker, read in the continuation after it
+	TSharedRef<double, ESPMode::ThreadSafe> SerializedTime = MakeShared<double, ESPMode::ThreadSafe>(0.0);
+	FrameScheduler.Offload<FString>(
+		[Builder = PromptBuilder, BuildVolatileContent = MoveTemp(BuildVolatileContent), MaxTokens, bStream, CacheKey = PromptCacheKey, SerializedTime]()
+		{
+			FString Payload = BuildChatPayload(Builder, BuildVolatileContent(), MaxTokens, bStream, CacheKey);
+			*SerializedTime = FPlatformTime::Seconds();
+			return Payload;
+		},
+		[this, Request, OnFailed = MoveTemp(OnFailed), TraceRequest, SerializedTime](FString& Payload) mutable
+		{
+			if (Request->GetStatus() != EHttpRequestStatus::NotStarted)
+			{
+				return;
+			}
+			LatencyTrace.MarkRequest(TraceRequest, EStoryLatencyStage::Serialized, *SerializedTime);
+			Request->SetContentAsString(Payload);
+			if (!Request->ProcessRequest())
+			{
+				UE_LOG(LogTemp, Error, TEXT("Failed to send payload to LLM-service (OpenAI)"));
+				OnFailed();
+				return;
+			}
+			LatencyTrace.MarkRequest(TraceRequest, EStoryLatencyStage::HttpSent);
+			UE_LOG(LogTemp, Log, TEXT("Payload sent to LLM-service (OpenAI)"));
+		});
+}
+
+FString AGameStateStoryGen::BuildChatPayload(const FStoryPromptBuilder& Builder, const TSharedPtr<FJsonObject>& VolatileContent, int32 MaxTokens, bool bStream, const FString& CacheKey)
+{
+	/**
+	* # Function: BuildChatPayload()
+	*
+	* ## Brief
+	* Builds and serializes the JSON payload of a chat request. Runs on a worker thread.
+	*
+	* ## Details
+	* The messages are built by `FStoryPromptBuilder`. The instructions, Start Environment and Story Synopsis
+	* form a byte-stable prefix so providers with prompt caching can reuse it. `VolatileContent` comes last.
+	* With `bStream` the response is sent as server-sent events, see `FNarrationStreamParser`.
+	*/
+	TSharedPtr<FJsonObject> JsonPayload = MakeShareable(new FJsonObject);
+	JsonPayload->SetStringField(TEXT("model"), TEXT("gpt-4o"));
+
+	// Instructions, Start_environment and the synopsis form the cacheable prefix
+	JsonPayload->SetArrayField(TEXT("messages"), Builder.BuildMessages(VolatileContent));
+	JsonPayload->SetStringField(TEXT("prompt_cache_key"), CacheKey);
+	JsonPayload->SetNumberField(TEXT("temperature"), 0.7);
+	JsonPayload->SetNumberField(TEXT("max_tokens"), MaxTokens);
+	if (bStream)
 	{
-		UE_LOG(LogTemp, Error, TEXT("Failed to send payload to LLM-service (OpenAI)"));
+		TSharedPtr<FJsonObject> StreamOptions = MakeShareable(new FJsonObject);
+		StreamOptions->SetBoolField(TEXT("include_usage"), true);
+		JsonPayload->SetBoolField(TEXT("stream"), true);
+		JsonPayload->SetObjectField(TEXT("stream_options"), StreamOptions);
 	}
+
+	FString SerializedPayload;
+	TSharedRef<TJsonWriter<>> Writer = TJsonWriterFactory<>::Create(&SerializedPayload);
+	FJsonSerializer::Serialize(JsonPayload.ToSharedRef(), Writer);
+	return SerializedPayload;
 }
 
-void AGameStateStoryGen::OnResponseReceived(FHttpRequestPtr Request, FHttpResponsePtr Response, bool bWasSuccessful)
+void AGameStateStoryGen::OnResponseReceived(FHttpRequestPtr Request, FHttpResponsePtr Response, bool bWasSuccessful, int32 PlayerIndex, uint64 SceneKey, bool bCacheRefresh, uint32 JobId)
 {
 	/**
 	 * # OnResponseReceived
@@ -725,10 +1659,13 @@ void AGameStateStoryGen::OnResponseReceived(FHttpRequestPtr Request, FHttpRespon
 	 * ## Details
 	 * This function performs the following tasks:
 	 * 1. Checks if the response was successful and valid.
-	 * 2. Parses the JSON string.
-	 * 3. Extracts the respons from the `choices` array from the JSON object.
-	 * 4. Logs the content and writes it to a file (`LLM_Response/LLM_response.txt`).
-	 * 5. Adds the content to the `LLMResponseArray`.
+	 *    The job is completed in the `Scheduler`, which records its latency and starts the next queued request.
+	 * 2. Parses the JSON string and extracts the respons from the `choices` array, see `ParseChatResponse()`.
+	 *    Streamed responses are assembled by `ParseStreamResponse()`.
+	 * 3. Stores the content in the `ResponseCache` under `SceneKey`.
+	 * 4. Passes the content to `HandleNarration()` for the player at `PlayerIndex`, unless the request was only a cache refresh.
+	 * 5. Marks the traced events of the request as parsed and published, and closes them in the `LatencyTrace`.
+	 *    For a remote player the trace ends when the narration is handed to replication, not on the client's HUD.
 	 *
 	 * If the response is invalid or the JSON parsing fails, an error is logged, and no further processing is performed.
 	 *
@@ -740,45 +1677,400 @@ void AGameStateStoryGen::OnResponseReceived(FHttpRequestPtr Request, FHttpRespon
 	 * ## See Also
 	 * - httpSendReq()
 	 */
-	if (bWasSuccessful && Response.IsValid())
+	FString Content;
+	uint32 StreamId = 0;
+	bool bParsed = false;
+	if (StreamParsers.Contains(JobId))
 	{
-		UE_LOG(LogTemp, Log, TEXT("LLM Respons is valid: "));
-		FString ResponseString = Response->GetContentAsString();
-		// parse the json string
-		TSharedPtr<FJsonObject> JsonResponse;
-		TSharedRef<TJsonReader<>> Reader = TJsonReaderFactory<>::Create(ResponseString);
-		if (!FJsonSerializer::Deserialize(Reader, JsonResponse) || !JsonResponse.IsValid())
+		bParsed = ParseStreamResponse(Response, bWasSuccessful, PlayerIndex, JobId, Content);
+		FStoryPlayerStream* Player = GetPlayerStream(PlayerIndex);
+		if (Player && Player->ActiveStreamJob == JobId)
 		{
-			UE_LOG(LogTemp, Error, TEXT("Failed to parse JSON response."));
-			return;
+			StreamId = JobId;
+			Player->ActiveStreamJob = 0;
+		}
+		StreamParsers.Remove(JobId);
+	}
+	else
+	{
+		bParsed = ParseChatResponse(Response, bWasSuccessful, Content);
+	}
+
+	Scheduler.Complete(JobId, bParsed);
+	if (bParsed)
+	{
+		LatencyTrace.MarkRequest(JobId, EStoryLatencyStage::Parsed);
+		if (bUseResponseCache)
+		{
+			ResponseCache.Add(SceneKey, Content);
+		}
+		if (!bCacheRefresh)
+		{
+			// The HUD widgets show the text in their OnNarration handlers, within the broadcast
+			HandleNarration(PlayerIndex, Content, StreamId);
+			LatencyTrace.MarkRequest(JobId, EStoryLatencyStage::Published);
+		}
+	}
+	LatencyTrace.FinishRequest(JobId);
+}
+
+void AGameStateStoryGen::OnResponseProgress(FHttpRequestPtr Request, uint64 BytesSent, uint64 BytesReceived, int32 PlayerIndex, uint32 JobId)
+{
+	/**
+	 * # OnResponseProgress
+	 *
+	 * ## Brief
+	 * Parses the newly received part of a streamed response and broadcasts it with the player's `OnNarrationChunk`.
+	 * The parser gets the bytes from the receive stream of the request, the response content is not read here.
+	 *
+	 * ## Details
+	 * Only one response per player is streamed to the HUD at a time: the first one that produces text.
+	 * Other streamed responses are published as a whole when they complete.
+	 * Also marks the first byte of traced requests, which are bound here when not streamed as well.
+	 */
+	if (BytesReceived > 0)
+	{
+		LatencyTrace.MarkRequest(JobId, EStoryLatencyStage::FirstByte);
+	}
+
+	FNarrationStreamParser* Parser = StreamParsers.Find(JobId);
+	FStoryPlayerStream* Player = GetPlayerStream(PlayerIndex);
+	if (!Parser || !Player)
+	{
+		return;
+	}
+
+	FString Chunk;
+	if (Parser->Feed(Chunk))
+	{
+		if (Player->ActiveStreamJob == 0)
+		{
+			Player->ActiveStreamJob = JobId;
+		}
+		if (Player->ActiveStreamJob == JobId)
+		{
+			Player->OnNarrationChunk.Broadcast(JobId, Chunk);
+			ReplicateNarrationChunk(*Player, JobId, Chunk);
+			LatencyTrace.MarkRequest(JobId, EStoryLatencyStage::Published);
 		}
+	}
+}
+
+void AGameStateStoryGen::OnSpeculativeResponseReceived(FHttpRequestPtr Request, FHttpResponsePtr Response, bool bWasSuccessful, FString ActorName, uint32 JobId)
+{
+	/**
+	 * # OnSpeculativeResponseReceived
+	 *
+	 * ## Brief
+	 * Stores the answer of a speculative request in the `Speculator`. Nothing is shown until the prediction comes true.
+	 */
+	FString Content;
+	bool bParsed = ParseChatResponse(Response, bWasSuccessful, Content);
+	Scheduler.Complete(JobId, bParsed);
+	if (bParsed)
+	{
+		Speculator.StoreNarration(ActorName, Content, GetWorld() ? GetWorld()->GetTimeSeconds() : 0.0);
+	}
+	else
+	{
+		Speculator.CancelInFlight(ActorName);
+	}
+}
+
+bool AGameStateStoryGen::ParseChatResponse(FHttpResponsePtr Response, bool bWasSuccessful, FString& OutContent)
+{
+	/**
+	 * # ParseChatResponse
+	 *
+	 * ## Brief
+	 * Extracts `choices[0].message.content` from a chat completion response.
+	 *
+	 * ## Details
+	 * Also records the prompt cache statistics from the `usage` field, see `FStoryPromptBuilder::RecordUsage()`.
+	 * Returns false and logs an error if the request failed or the JSON could not be parsed.
+	 */
+	if (!bWasSuccessful || !Response.IsValid())
+	{
+		UE_LOG(LogTemp, Error, TEXT("LLM request failed or response is invalid."));
+		return false;
+	}
+
+	UE_LOG(LogTemp, Log, TEXT("LLM Respons is valid: "));
+	FString ResponseString = Response->GetContentAsString();
+	// parse the json string
+	TSharedPtr<FJsonObject> JsonResponse;
+	TSharedRef<TJsonReader<>> Reader = TJsonReaderFactory<>::Create(ResponseString);
+	if (!FJsonSerializer::Deserialize(Reader, JsonResponse) || !JsonResponse.IsValid())
+	{
+		UE_LOG(LogTemp, Error, TEXT("Failed to parse JSON response."));
+		return false;
+	}
 
-		// Navigate to the choices field and retrieve the response
-		const TArray<TSharedPtr<FJsonValue>>* ChoicesArray;
-		if (JsonResponse->TryGetArrayField(TEXT("choices"), ChoicesArray) && ChoicesArray->Num() > 0)
+	// Track how much of the prompt prefix the provider could reuse
+	PromptBuilder.RecordUsage(JsonResponse);
+
+	// Navigate to the choices field and retrieve the response
+	const TArray<TSharedPtr<FJsonValue>>* ChoicesArray;
+	if (JsonResponse->TryGetArrayField(TEXT("choices"), ChoicesArray) && ChoicesArray->Num() > 0)
+	{
+		TSharedPtr<FJsonObject> ChoiceObject = (*ChoicesArray)[0]->AsObject();
+		if (ChoiceObject.IsValid())
 		{
-			TSharedPtr<FJsonObject> ChoiceObject = (*ChoicesArray)[0]->AsObject();
-			if (ChoiceObject.IsValid())
+			TSharedPtr<FJsonObject> MessageObject = ChoiceObject->GetObjectField(TEXT("message"));
+			if (MessageObject.IsValid())
 			{
-				TSharedPtr<FJsonObject> MessageObject = ChoiceObject->GetObjectField(TEXT("message"));
-				if (MessageObject.IsValid())
-				{
-					// The respons in the Content variable:
-					FString Content = MessageObject->GetStringField(TEXT("content"));
-					FString FilePath = FPaths::ProjectDir() + TEXT("LLM_Response/LLM_response.txt");
-					UE_LOG(LogTemp, Log, TEXT("LLM Response: %s"), *Content);
-
-					if (FFileHelper::SaveStringToFile(Content, *FilePath))
-					{
-						UE_LOG(LogTemp, Log, TEXT("File written successfully to: %s"), *FilePath);
-					}
-					else
-					{
-						UE_LOG(LogTemp, Error, TEXT("Failed to write to file: %s"), *FilePath);
-					}
-					LLMResponseArray.Add(Content);
-				}
+				// The respons in the Content variable:
+				OutContent = MessageObject->GetStringField(TEXT("content"));
+				UE_LOG(LogTemp, Log, TEXT("LLM Response: %s"), *OutContent);
+				return true;
 			}
 		}
 	}
+	UE_LOG(LogTemp, Error, TEXT("No message content in LLM response."));
+	return false;
+}
+
+
+bool AGameStateStoryGen::ParseStreamResponse(FHttpResponsePtr Response, bool bWasSuccessful, int32 PlayerIndex, uint32 JobId, FString& OutContent)
+{
+	/**
+	 * # ParseStreamResponse
+	 *
+	 * ## Brief
+	 * Parses the rest of a streamed response and returns the whole narration.
+	 *
+	 * ## Details
+	 * The last pieces are broadcast with the player's `OnNarrationChunk` if the response is streamed to the HUD.
+	 * The `usage` event is passed to `FStoryPromptBuilder::RecordUsage()`.
+	 */
+	FNarrationStreamParser& Parser = StreamParsers.FindChecked(JobId);
+	if (!bWasSuccessful || !Response.IsValid())
+	{
+		UE_LOG(LogTemp, Error, TEXT("LLM request failed or response is invalid."));
+		return false;
+	}
+
+	FString Chunk;
+	FStoryPlayerStream* Player = GetPlayerStream(PlayerIndex);
+	if (Parser.Feed(Chunk, true) && Player && Player->ActiveStreamJob == JobId)
+	{
+		Player->OnNarrationChunk.Broadcast(JobId, Chunk);
+		ReplicateNarrationChunk(*Player, JobId, Chunk);
+	}
+	PromptBuilder.RecordUsage(Parser.GetUsageEvent());
+
+	OutContent = Parser.GetText();
+	if (OutContent.IsEmpty())
+	{
+		UE_LOG(LogTemp, Error, TEXT("No message content in streamed LLM response."));
+		return false;
+	}
+	UE_LOG(LogTemp, Log, TEXT("LLM Response: %s"), *OutContent);
+	return true;
+}
+
+void AGameStateStoryGen::HandleNarration(int32 PlayerIndex, const FString& Content, uint32 StreamId)
+{
+	/**
+	 * # HandleNarration
+	 *
+	 * ## Brief
+	 * Publishes a narration to a player, either a new LLM response or one served from the response cache.
+	 *
+	 * ## Details
+	 * - Broadcasts the player's `OnNarration`, which the HUD widgets of that player subscribe to. `StreamId` is set
+	 *   if the narration was already revealed piece by piece with `OnNarrationChunk`.
+	 * - Writes the content to `LLM_Response/LLM_response.txt` on a background thread, as a log of the latest narration.
+	 *   Each write carries a sequence number and is skipped if a newer narration was written first, so the background
+	 *   writes cannot finish out of order and leave an older narration in the file.
+	 * - Adds the content to the player's `FStorySummarizer`, which compacts older responses when needed.
+	 * - On a server with `bServerAuthoritativeStory`, sends the content to the clients, see `ReplicateNarration()`.
+	 */
+	FStoryPlayerStream* Player = GetPlayerStream(PlayerIndex);
+	if (!Player)
+	{
+		return;
+	}
+	Player->LatestNarration = Content;
+	Player->OnNarration.Broadcast(Content, StreamId);
+
+	ReplicateNarration(*Player, Content, StreamId);
+
+	FString FilePath = FPaths::ProjectDir() + TEXT("LLM_Response/LLM_response.txt");
+	const uint64 Sequence = ++NarrationFileSequence;
+	AsyncTask(ENamedThreads::AnyBackgroundThreadNormalTask, [File = NarrationFile, Sequence, FilePath, Content]()
+	{
+		FScopeLock Lock(&File->Lock);
+		if (Sequence < File->WrittenSequence)
+		{
+			return;
+		}
+		File->WrittenSequence = Sequence;
+		if (!FFileHelper::SaveStringToFile(Content, *FilePath))
+		{
+			UE_LOG(LogTemp, Error, TEXT("Failed to write to file: %s"), *FilePath);
+		}
+	});
+	Player->Summarizer.AddResponse(Content);
+}
+
+bool AGameStateStoryGen::ReplicatesNarration() const
+{
+	return bServerAuthoritativeStory && HasAuthority() && GetNetMode() != NM_Standalone;
+}
+
+void AGameStateStoryGen::ReplicateNarrationChunk(FStoryPlayerStream& Player, uint32 StreamId, const FString& Chunk)
+{
+	/**
+	 * # ReplicateNarrationChunk
+	 *
+	 * ## Brief
+	 * Sends a piece of a streamed narration to the owning client of the player, only the new text and encoded
+	 * by the codec of its `UStoryNarrationChannel`.
+	 *
+	 * ## Details
+	 * The LLM streams a few characters per piece. Each would be a reliable RPC, enough to fill the reliable buffer
+	 * of the connection during a long narration. The pieces are coalesced: the text is sent at most every
+	 * `NarrationDeltaInterval` seconds, from here or from `Tick()`, and the rest before the narration completes.
+	 */
+	if (!ReplicatesNarration() || !Player.PlayerState.IsValid() || !Player.Channel.IsValid())
+	{
+		return;
+	}
+	if (Player.ReplicatedStream != StreamId)
+	{
+		Player.ReplicatedStream = StreamId;
+		Player.ReplicatedText.Reset();
+		Player.PendingDelta.Reset();
+	}
+	Player.ReplicatedText += Chunk;
+	Player.PendingDelta += Chunk;
+	FlushNarrationDelta(Player, false);
+}
+
+void AGameStateStoryGen::FlushNarrationDelta(FStoryPlayerStream& Player, bool bForce)
+{
+	/**
+	 * # FlushNarrationDelta
+	 *
+	 * ## Brief
+	 * Sends the streamed text held back for the player, if `NarrationDeltaInterval` passed since the last piece or with `bForce`.
+	 */
+	UStoryNarrationChannel* Channel = Player.Channel.Get();
+	if (Player.PendingDelta.IsEmpty() || !Channel || !Player.PlayerState.IsValid())
+	{
+		return;
+	}
+	const double Now = GetWorld() ? GetWorld()->GetTimeSeconds() : 0.0;
+	if (!bForce && Player.LastDeltaTime >= 0.0 && Now - Player.LastDeltaTime < NarrationDeltaInterval)
+	{
+		return;
+	}
+
+	Player.ReplicatedMessages++;
+	Player.ReplicatedBytes += Channel->SendNarrationDelta(Player.PlayerState->GetPlayerId(), Player.ReplicatedStream, Player.PendingDelta);
+	Player.PendingDelta.Reset();
+	Player.LastDeltaTime = Now;
+}
+
+void AGameStateStoryGen::ReplicateNarration(FStoryPlayerStream& Player, const FString& Narration, uint32 StreamId)
+{
+	/**
+	 * # ReplicateNarration
+	 *
+	 * ## Brief
+	 * Completes a narration on the owning client of the player.
+	 *
+	 * ## Details
+	 * Narrations go to the player's own connection only, with a Client RPC of its `UStoryNarrationChannel`.
+	 * Other clients neither receive nor pay for them, and local players on a listen server have no channel.
+	 * A narration the client received piece by piece (`ReplicateNarrationChunk()`) is completed with an empty
+	 * message. Others (cached, speculative or not streamed) are sent whole.
+	 * The bytes of all messages of the narration are recorded against sending it as an FString,
+	 * see `FNarrationReplicationCodec::LogStats()`.
+	 */
+	UStoryNarrationChannel* Channel = Player.Channel.Get();
+	if (!ReplicatesNarration() || !Player.PlayerState.IsValid() || !Channel)
+	{
+		return;
+	}
+
+	const bool bStreamed = StreamId != 0 && Player.ReplicatedStream == StreamId && Player.ReplicatedText == Narration;
+	if (bStreamed)
+	{
+		FlushNarrationDelta(Player, true);
+	}
+	Player.PendingDelta.Reset();
+	const int32 Bytes = Channel->SendNarration(Player.PlayerState->GetPlayerId(), StreamId, Narration, bStreamed);
+
+	NarrationCodec.RecordNarration(Narration, Player.ReplicatedMessages + 1, Player.ReplicatedBytes + Bytes);
+	Player.ReplicatedStream = 0;
+	Player.ReplicatedText.Reset();
+	Player.ReplicatedMessages = 0;
+	Player.ReplicatedBytes = 0;
+}
+
+void AGameStateStoryGen::ReceiveNarration(int32 PlayerId, uint32 StreamId, const FString& Narration)
+{
+	/**
+	 * # ReceiveNarration
+	 *
+	 * ## Brief
+	 * Publishes a narration the server generated for the player `PlayerId` on its client.
+	 *
+	 * ## Details
+	 * Only the server tracks actors and talks to the LLM, so a session has one API stream and clients spend
+	 * nothing on prompts or responses. Each client receives the narrations of its own players only,
+	 * decoded by their `UStoryNarrationChannel`. Without a stream for the player (no HUD yet) the text is dropped.
+	 *
+	 * An empty `Narration` completes the text received with `ReceiveNarrationChunk()` for `StreamId`.
+	 *
+	 * ## Notes
+	 * Event history and synopsis stay on the server, clients do not need them.
+	 */
+	FStoryPlayerStream* Player = GetPlayerStream(FindPlayerById(PlayerId));
+	if (!Player)
+	{
+		return;
+	}
+
+	FString Text = Narration;
+	uint32 RevealedStream = 0;
+	if (Narration.IsEmpty())
+	{
+		if (StreamId == 0 || Player->ReplicatedStream != StreamId)
+		{
+			// None of its pieces arrived here
+			return;
+		}
+		Text = MoveTemp(Player->ReplicatedText);
+		RevealedStream = StreamId;
+	}
+	Player->ReplicatedStream = 0;
+	Player->ReplicatedText.Reset();
+
+	Player->LatestNarration = Text;
+	Player->OnNarration.Broadcast(Text, RevealedStream);
+}
+
+void AGameStateStoryGen::ReceiveNarrationChunk(int32 PlayerId, uint32 StreamId, const FString& Chunk)
+{
+	/**
+	 * # ReceiveNarrationChunk
+	 *
+	 * ## Brief
+	 * Reveals a piece of a streamed narration on a client with the player's `OnNarrationChunk`.
+	 */
+	FStoryPlayerStream* Player = GetPlayerStream(FindPlayerById(PlayerId));
+	if (!Player)
+	{
+		return;
+	}
+	if (Player->ReplicatedStream != StreamId)
+	{
+		Player->ReplicatedStream = StreamId;
+		Player->ReplicatedText.Reset();
+	}
+	Player->ReplicatedText += Chunk;
+	Player->OnNarrationChunk.Broadcast(StreamId, Chunk);
 }
@@ -6,7 +6,11 @@
 #include "Components/TextBlock.h"
 #include "Containers/Queue.h"
 #include "Components/Border.h"
+#include "Components/WrapBox.h"
+#include "Blueprint/WidgetTree.h"
 #include "Serialization/JsonReader.h"
+#include "GameStateStoryGen.h"
+#include "GameFramework/PlayerState.h"
 
 /**
  * # File: HUD_ContentRetriever.cpp
@@ -15,20 +19,85 @@
  * Responsible for retreiving and displaying LLM repsonses.
  *
  * ## Details
- * NativeTick() periodiclly reads the LLM repsonses and displays them in GameStateText.
+ * The widget subscribes to `OnNarration` of its owning player's story stream (see `FStoryPlayerStream`), so in a
+ * multi-user session every player sees its own story. Each new response is displayed in GameStateText
+ * when it arrives, see ProcessNewResponse(). NativeTick() does no file I/O or string comparison.
  * UpdateBorderVisibility() makes sure the HUD is not visible if there is no content.
+ *
+ * Streamed narrations (`OnNarrationChunk`) are revealed in StreamingTextBox with a typewriter effect, see
+ * FTypewriterText. Each completed word gets its own text block, so only the word being revealed is laid out again.
+ * The blocks are pooled and reused by the next narration. A narration longer than `MaxStreamTextBlocks` words folds
+ * its completed words into the first block, see FoldStreamText().
  * 
  */
 
-float TimeSinceLastRead_1 = 0.0f;
 float TimetoFade = 0.0f;
 
 void UHUD_ContentRetreiver::NativeConstruct()
 {
+    /**
+     * # NativeConstruct
+     *
+     * ## Brief
+     * Hides the border and subscribes to the narrations of the owning player's story stream.
+     *
+     * ## Details
+     * On a client the owning PlayerState may not have replicated yet when the widget is constructed,
+     * the subscription is then retried in NativeTick(), see SubscribeToStream().
+     */
     Super::NativeConstruct();
 
     if (GameStateBorder) GameStateBorder->SetVisibility(ESlateVisibility::Collapsed);
 
+    if (!SubscribeToStream())
+    {
+        UE_LOG(LogTemp, Log, TEXT("No story stream for the owning player yet, HUD subscribes once its PlayerState has replicated."));
+    }
+}
+
+bool UHUD_ContentRetreiver::SubscribeToStream()
+{
+    /**
+     * # SubscribeToStream
+     *
+     * ## Brief
+     * Subscribes to the narrations of the owning player's story stream. Returns false if there is no stream yet.
+     *
+     * ## Details
+     * A narration published before the widget subscribed is shown right away.
+     */
+    AGameStateStoryGen* GameState = GetWorld() ? GetWorld()->GetGameState<AGameStateStoryGen>() : nullptr;
+    const int32 Index = GameState ? GameState->FindOrAddPlayer(GetOwningPlayerState()) : INDEX_NONE;
+    FStoryPlayerStream* Stream = GameState ? GameState->GetPlayerStream(Index) : nullptr;
+    if (!Stream)
+    {
+        return false;
+    }
+
+    PlayerIndex = Index;
+    NarrationHandle = Stream->OnNarration.AddUObject(this, &UHUD_ContentRetreiver::OnNarration);
+    ChunkHandle = Stream->OnNarrationChunk.AddUObject(this, &UHUD_ContentRetreiver::OnNarrationChunk);
+    if (!Stream->LatestNarration.IsEmpty())
+    {
+        ProcessNewResponse(Stream->LatestNarration);
+    }
+    return true;
+}
+
+void UHUD_ContentRetreiver::NativeDestruct()
+{
+    AGameStateStoryGen* GameState = GetWorld() ? GetWorld()->GetGameState<AGameStateStoryGen>() : nullptr;
+    FStoryPlayerStream* Stream = GameState ? GameState->GetPlayerStream(PlayerIndex) : nullptr;
+    if (Stream)
+    {
+        Stream->OnNarration.Remove(NarrationHandle);
+        Stream->OnNarrationChunk.Remove(ChunkHandle);
+    }
+    PlayerIndex = INDEX_NONE;
+    NarrationHandle.Reset();
+    ChunkHandle.Reset();
+
+    Super::NativeDestruct();
 }
 
 
@@ -38,46 +107,49 @@ void UHUD_ContentRetreiver::NativeTick(const FGeometry& MyGeometry, float InDelt
      * # NativeTick
      *
      * ## Brief
-     * Overrides the native tick function to periodically update the HUD based on the contents of a file and handle fading animations.
+     * Overrides the native tick function to handle fading animations.
      *
      * ## Parameters
      * - `MyGeometry`: Geometry information of the widget.
      * - `InDeltaTime`: Time elapsed since the last frame, used for timing logic.
      *
      * ## Details
-     * This function performs the following tasks every tick:
-     * 1. Reads the content of `LLM_response.txt` every second:
-     *    - Checks if the content has changed since the last read.
-     *    - Updates the `GameStateText` widget with the new content if it differs from the previous response.
-     *    - Calls `UpdateBorderVisibility()` to adjust the HUD's border visibility.
-     * 2. Plays a fade-out animation if the fade timer exceeds 10 seconds.
+     * - Subscribes to the owning player's story stream, if that was not possible yet.
+     * - Reveals the streamed narration, if one is active. Completed words are added to StreamingTextBox,
+     *   the partially revealed word is the only text that changes.
+     * - Plays a fade-out animation if the fade timer exceeds 10 seconds.
      *
-     * ## Notes
-     * - The file path is hardcoded to `LLM_Response/LLM_response.txt` in the project directory.
+     * New responses are pushed to the widget by `ProcessNewResponse()`, so nothing is read here.
      *
      * ## See Also
-     * - UpdateBorderVisibility()
+     * - ProcessNewResponse()
      */
 
     Super::NativeTick(MyGeometry, InDeltaTime);
-    TimeSinceLastRead_1 += InDeltaTime;
-
 
-    if (TimeSinceLastRead_1 >= 1.0f)
+    if (PlayerIndex == INDEX_NONE)
     {
-        FString FilePath = FPaths::ProjectDir() + TEXT("LLM_Response/LLM_response.txt");
-        FString NewResponse;
+        SubscribeToStream();
+    }
 
-        if (FFileHelper::LoadFileToString(NewResponse, *FilePath))
+    if (ActiveStreamId != 0)
+    {
+        TArray<FString> Words;
+        FString Tail;
+        if (Typewriter.Advance(InDeltaTime, Words, Tail) && StreamTail)
         {
-            if (NewResponse != prevResponse)
+            // The tail block becomes the completed word, a new tail is added after it
+            for (const FString& Word : Words)
             {
-                //uppdatera HUD 
-                GameStateText->SetText(FText::FromString(NewResponse));
-                UpdateBorderVisibility();
+                StreamTail->SetText(FText::FromString(Word));
+                StreamTail = AddStreamText();
             }
+            StreamTail->SetText(FText::FromString(Tail));
+        }
+        if (Typewriter.IsComplete())
+        {
+            ActiveStreamId = 0;
         }
-        TimeSinceLastRead_1 = 0.0f;
     }
 
     if (TimetoFade >= 10.0f)
@@ -86,6 +158,167 @@ void UHUD_ContentRetreiver::NativeTick(const FGeometry& MyGeometry, float InDelt
     }
 }
 
+void UHUD_ContentRetreiver::ProcessNewResponse(const FString& NewResponse)
+{
+    /**
+     * # ProcessNewResponse
+     *
+     * ## Brief
+     * Displays a new LLM response, called by `OnNarration` of the player's story stream.
+     *
+     * ## Details
+     * - Updates the `GameStateText` widget with the new content.
+     * - Calls `UpdateBorderVisibility()` to adjust the HUD's border visibility.
+     *
+     * ## See Also
+     * - UpdateBorderVisibility()
+     */
+    if (!GameStateText)
+    {
+        return;
+    }
+
+    prevResponse = NewResponse;
+
+    // A complete narration replaces a stream that is still being revealed, the stream is shown whole when it completes
+    if (ActiveStreamId != 0)
+    {
+        InterruptedStreamId = ActiveStreamId;
+        ActiveStreamId = 0;
+    }
+
+    //uppdatera HUD 
+    if (StreamingTextBox) StreamingTextBox->SetVisibility(ESlateVisibility::Collapsed);
+    GameStateText->SetVisibility(ESlateVisibility::Visible);
+    GameStateText->SetText(FText::FromString(NewResponse));
+    UpdateBorderVisibility();
+}
+
+void UHUD_ContentRetreiver::OnNarration(const FString& NewResponse, uint32 StreamId)
+{
+    /**
+     * # OnNarration
+     *
+     * ## Brief
+     * Called by `OnNarration` of the player's story stream when a narration is complete.
+     *
+     * ## Details
+     * A narration that was streamed into StreamingTextBox finishes revealing there. Any other narration
+     * is shown at once with `ProcessNewResponse()`.
+     */
+    if (StreamId != 0 && StreamId == ActiveStreamId)
+    {
+        Typewriter.Finish();
+        prevResponse = NewResponse;
+        return;
+    }
+    ProcessNewResponse(NewResponse);
+}
+
+void UHUD_ContentRetreiver::OnNarrationChunk(uint32 StreamId, const FString& Chunk)
+{
+    /**
+     * # OnNarrationChunk
+     *
+     * ## Brief
+     * Appends a piece of a streamed narration. The text is revealed in NativeTick().
+     */
+    if (!StreamingTextBox || StreamId == InterruptedStreamId)
+    {
+        return;
+    }
+    if (StreamId != ActiveStreamId)
+    {
+        BeginStream(StreamId);
+    }
+    Typewriter.Append(Chunk);
+}
+
+void UHUD_ContentRetreiver::BeginStream(uint32 StreamId)
+{
+    /**
+     * # BeginStream
+     *
+     * ## Brief
+     * Clears StreamingTextBox for a new streamed narration and shows it instead of GameStateText.
+     */
+    ActiveStreamId = StreamId;
+    Typewriter.Configure(RevealCharactersPerSecond);
+    Typewriter.Reset();
+
+    for (int32 i = 0; i < NumStreamTexts; i++)
+    {
+        StreamTexts[i]->SetText(FText::GetEmpty());
+        StreamTexts[i]->SetAutoWrapText(false);
+        StreamTexts[i]->SetVisibility(ESlateVisibility::Collapsed);
+    }
+    NumStreamTexts = 0;
+    StreamTail = AddStreamText();
+
+    StreamingTextBox->SetVisibility(ESlateVisibility::Visible);
+    if (GameStateText) GameStateText->SetVisibility(ESlateVisibility::Collapsed);
+    if (GameStateBorder) GameStateBorder->SetVisibility(ESlateVisibility::Visible);
+}
+
+UTextBlock* UHUD_ContentRetreiver::AddStreamText()
+{
+    /**
+     * # AddStreamText
+     *
+     * ## Brief
+     * Returns the next text block of StreamingTextBox, from the pool if there is a free one.
+     */
+    if (NumStreamTexts >= FMath::Max(2, MaxStreamTextBlocks))
+    {
+        FoldStreamText();
+    }
+
+    if (StreamTexts.IsValidIndex(NumStreamTexts))
+    {
+        UTextBlock* TextBlock = StreamTexts[NumStreamTexts++];
+        TextBlock->SetVisibility(ESlateVisibility::SelfHitTestInvisible);
+        return TextBlock;
+    }
+
+    // Same look as GameStateText, which is the text block designed in the widget blueprint
+    UTextBlock* TextBlock = WidgetTree->ConstructWidget<UTextBlock>(UTextBlock::StaticClass());
+    if (GameStateText)
+    {
+        TextBlock->SetFont(GameStateText->GetFont());
+        TextBlock->SetColorAndOpacity(GameStateText->GetColorAndOpacity());
+    }
+    StreamingTextBox->AddChildToWrapBox(TextBlock);
+    StreamTexts.Add(TextBlock);
+    NumStreamTexts++;
+    return TextBlock;
+}
+
+void UHUD_ContentRetreiver::FoldStreamText()
+{
+    /**
+     * # FoldStreamText
+     *
+     * ## Brief
+     * Moves the text of all blocks in use into the first one, which wraps, and frees the others.
+     *
+     * ## Details
+     * Keeps the number of blocks bounded for long narrations. The first block is laid out again once per fold.
+     */
+    FString Folded;
+    for (int32 i = 0; i < NumStreamTexts; i++)
+    {
+        Folded += StreamTexts[i]->GetText().ToString();
+        if (i > 0)
+        {
+            StreamTexts[i]->SetText(FText::GetEmpty());
+            StreamTexts[i]->SetVisibility(ESlateVisibility::Collapsed);
+        }
+    }
+    StreamTexts[0]->SetAutoWrapText(true);
+    StreamTexts[0]->SetText(FText::FromString(Folded));
+    NumStreamTexts = 1;
+}
+
 void UHUD_ContentRetreiver::UpdateBorderVisibility()
 {
     /**
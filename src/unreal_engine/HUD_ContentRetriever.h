@@ -17,11 +17,16 @@ class PROJECT_API UHUD_ContentRetreiver : public UUserWidget
 
 public:
 	virtual void NativeConstruct() override;
+	virtual void NativeDestruct() override;
 	virtual void NativeTick(const FGeometry& MyGeometry, float InDeltaTime) override;
 
 	void ResponseFileRead();
 	void UpdateGameStateText();
+	void OnNarration(const FString& NewResponse, uint32 StreamId);
 	void ProcessNewResponse(const FString& NewResponse);
+	void UpdateTextBlocks();
+	void RotateHistory(const FString& NewResponse);
+	void ApplyHistoryOrder();
 	void UpdateBorderVisibility();
 	void UpdateWholeGameStateBorderVisibility();
 	void TriggerFadeOut();
@@ -36,6 +41,14 @@ public:
 
 	TQueue<FString> ResponseQueue;
 	TArray<class UTextBlock*> GameStateTexts;
+	TArray<class UBorder*> GameStateBorders;
+
+	// Entry of GameStateTexts/GameStateBorders with the newest response
+	int32 RingHead = 0;
+
+	// Rotate the history by reusing the oldest entry instead of shifting the text through all blocks
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "HUD")
+	bool bUseLayoutCache = true;
 
 	UPROPERTY(BlueprintReadWrite, EditAnywhere, meta = (BindWidget))
 	class UTextBlock* GameStateText_0;
@@ -63,4 +76,12 @@ public:
 
 	UPROPERTY(BlueprintReadOnly, Transient, meta = (BindWidgetAnim))
 	UWidgetAnimation* FadeOutAnimation;
+
+private:
+	// Subscription to OnNarration of the owning player's story stream
+	int32 PlayerIndex = INDEX_NONE;
+	FDelegateHandle NarrationHandle;
+
+	// Retried every tick until the owning PlayerState and the game state have replicated
+	bool SubscribeToStream();
 };
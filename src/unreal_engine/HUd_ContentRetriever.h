@@ -4,6 +4,7 @@
 
 #include "CoreMinimal.h"
 #include "Blueprint/UserWidget.h"
+#include "TypewriterText.h"
 #include "HUD_ContentRetreiver.generated.h"
 
 /**
@@ -16,14 +17,39 @@ class PROJECT_API UHUD_ContentRetreiver : public UUserWidget
 
 
 private:
+	// Subscriptions to OnNarration and OnNarrationChunk of the owning player's story stream
+	int32 PlayerIndex = INDEX_NONE;
+	FDelegateHandle NarrationHandle;
+	FDelegateHandle ChunkHandle;
 
+	// Retried every tick until the owning PlayerState and the game state have replicated
+	bool SubscribeToStream();
 
+	// Streamed narration shown in StreamingTextBox
+	FTypewriterText Typewriter;
+	uint32 ActiveStreamId = 0;
+	uint32 InterruptedStreamId = 0;
+
+	UPROPERTY(Transient)
+	class UTextBlock* StreamTail = nullptr;
+
+	// Text blocks of StreamingTextBox, reused by every streamed narration. The first NumStreamTexts are in use.
+	UPROPERTY(Transient)
+	TArray<class UTextBlock*> StreamTexts;
+	int32 NumStreamTexts = 0;
+
+	void BeginStream(uint32 StreamId);
+	class UTextBlock* AddStreamText();
+	void FoldStreamText();
 
 public:
 	virtual void NativeConstruct() override;
+	virtual void NativeDestruct() override;
 	virtual void NativeTick(const FGeometry& MyGeometry, float InDeltaTime) override;
 
 
+	void OnNarration(const FString& NewResponse, uint32 StreamId);
+	void OnNarrationChunk(uint32 StreamId, const FString& Chunk);
 	void ProcessNewResponse(const FString& NewResponse);
 	void UpdateBorderVisibility();
 
@@ -42,6 +68,17 @@ public:
 	UPROPERTY(BlueprintReadWrite, EditAnywhere, meta = (BindWidget))
 	class UBorder* GameStateBorder;
 
+	// Streamed narrations are revealed here word by word, GameStateText is used if it is not bound
+	UPROPERTY(BlueprintReadWrite, EditAnywhere, meta = (BindWidgetOptional))
+	class UWrapBox* StreamingTextBox;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Streaming")
+	float RevealCharactersPerSecond = 60.0f;
+
+	// Text blocks of a streamed narration, then the completed words are folded into the first block
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Streaming")
+	int32 MaxStreamTextBlocks = 48;
+
 
 	UPROPERTY(BlueprintReadOnly, Transient, meta = (BindWidgetAnim))
 	UWidgetAnimation* FadeOutAnimation;
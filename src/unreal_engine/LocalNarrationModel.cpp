@@ -0,0 +1,377 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "LocalNarrationModel.h"
+#include "Async/Async.h"
+#include "HAL/PlatformMisc.h"
+#include "HAL/PlatformProcess.h"
+#include "HAL/PlatformTime.h"
+#include "HAL/RunnableThread.h"
+#include "Misc/CommandLine.h"
+#include "Misc/Paths.h"
+
+#if WITH_LLAMACPP
+#include "llama.h"
+#endif
+
+/**
+ * # File: LocalNarrationModel.cpp
+ *
+ * ## Brief
+ * Implements the in-process narration model, an alternative to the LM Studio and OpenAI backends.
+ *
+ * ## Details
+ * A scene blurb is about 50 tokens, and for a small model the HTTP round trip, the JSON around the prompt and a
+ * context computed from scratch cost more than the generation. The model runs in the game process instead:
+ * - **Backend**: llama.cpp with a quantized GGUF model, compiled in when the build defines `WITH_LLAMACPP`.
+ *   Written against the llama.cpp C API of late 2024 (`llama_kv_cache_seq_rm`, sampler chains).
+ * - **Threads**: requests run one at a time on one inference thread, started when the model is loaded and woken
+ *   by `Submit()`. llama.cpp spreads each request over `Threads` CPU cores. The completion is called on the game thread,
+ *   also for a failed request, so the caller can fall back to HTTP.
+ * - **KV cache reuse**: the tokens of the last prompt stay in the KV cache. A new prompt only decodes the tokens after the
+ *   common prefix, so the instruction that starts every prompt is computed once. The generated tokens are removed again.
+ *
+ * The model is loaded from `Models/narration.gguf` in the project folder, or from `-NarrationModel=<path>`.
+ */
+
+static constexpr int32 ReservedCores = 2;
+
+FLocalNarrationModel::~FLocalNarrationModel()
+{
+	// Requests still queued are dropped, the game is shutting down
+	if (Thread)
+	{
+		Stop();
+		Thread->WaitForCompletion();
+		delete Thread;
+		Thread = nullptr;
+	}
+	if (WakeUp)
+	{
+		FPlatformProcess::ReturnSynchEventToPool(WakeUp);
+		WakeUp = nullptr;
+	}
+
+#if WITH_LLAMACPP
+	if (Sampler)
+	{
+		llama_sampler_free(Sampler);
+	}
+	if (Context)
+	{
+		llama_free(Context);
+	}
+	if (Model)
+	{
+		llama_free_model(Model);
+	}
+	if (bBackendInitialized)
+	{
+		llama_backend_free();
+	}
+#endif
+}
+
+TSharedPtr<FLocalNarrationModel, ESPMode::ThreadSafe> FLocalNarrationModel::GetShared()
+{
+	/**
+	 * # Function: GetShared()
+	 *
+	 * ## Brief
+	 * Returns the model shared by all HTTP handlers. The first call loads it, a failed load is not retried.
+	 * The initialization of the function-local static is thread-safe, concurrent first calls wait for one load.
+	 */
+	static const TSharedPtr<FLocalNarrationModel, ESPMode::ThreadSafe> Shared = LoadShared();
+	return Shared;
+}
+
+TSharedPtr<FLocalNarrationModel, ESPMode::ThreadSafe> FLocalNarrationModel::LoadShared()
+{
+	if (!IsCompiledIn())
+	{
+		return nullptr;
+	}
+
+	FLocalInferenceSettings DefaultSettings;
+	if (!FParse::Value(FCommandLine::Get(), TEXT("NarrationModel="), DefaultSettings.ModelPath))
+	{
+		DefaultSettings.ModelPath = FPaths::ProjectDir() + TEXT("Models/narration.gguf");
+	}
+	if (!FPaths::FileExists(DefaultSettings.ModelPath))
+	{
+		UE_LOG(LogTemp, Log, TEXT("No local narration model at %s, using the HTTP backend."), *DefaultSettings.ModelPath);
+		return nullptr;
+	}
+
+	TSharedPtr<FLocalNarrationModel, ESPMode::ThreadSafe> NewModel = MakeShared<FLocalNarrationModel, ESPMode::ThreadSafe>();
+	return NewModel->Load(DefaultSettings) ? NewModel : nullptr;
+}
+
+bool FLocalNarrationModel::Load(const FLocalInferenceSettings& InSettings)
+{
+	/**
+	 * # Function: Load()
+	 *
+	 * ## Brief
+	 * Loads the model, creates the context and the sampler and starts the inference thread.
+	 * Returns false without llama.cpp.
+	 */
+	Settings = InSettings;
+	if (Settings.Threads <= 0)
+	{
+		Settings.Threads = FMath::Max(1, FPlatformMisc::NumberOfCoresIncludingHyperthreads() - ReservedCores);
+	}
+
+#if WITH_LLAMACPP
+	llama_backend_init();
+	bBackendInitialized = true;
+
+	llama_model_params ModelParams = llama_model_default_params();
+	ModelParams.n_gpu_layers = 0;
+	Model = llama_load_model_from_file(TCHAR_TO_UTF8(*Settings.ModelPath), ModelParams);
+	if (!Model)
+	{
+		UE_LOG(LogTemp, Error, TEXT("Failed to load the local narration model %s."), *Settings.ModelPath);
+		return false;
+	}
+
+	llama_context_params ContextParams = llama_context_default_params();
+	ContextParams.n_ctx = Settings.ContextTokens;
+	ContextParams.n_batch = Settings.ContextTokens;
+	ContextParams.n_threads = Settings.Threads;
+	ContextParams.n_threads_batch = Settings.Threads;
+	Context = llama_new_context_with_model(Model, ContextParams);
+	if (!Context)
+	{
+		UE_LOG(LogTemp, Error, TEXT("Failed to create a context for the local narration model."));
+		return false;
+	}
+
+	Sampler = llama_sampler_chain_init(llama_sampler_chain_default_params());
+	llama_sampler_chain_add(Sampler, llama_sampler_init_temp(Settings.Temperature));
+	llama_sampler_chain_add(Sampler, llama_sampler_init_dist(LLAMA_DEFAULT_SEED));
+
+	WakeUp = FPlatformProcess::GetSynchEventFromPool(false);
+	Thread = FRunnableThread::Create(this, TEXT("LocalNarrationModel"), 0, TPri_BelowNormal);
+	if (!Thread)
+	{
+		UE_LOG(LogTemp, Error, TEXT("Failed to start the inference thread of the local narration model."));
+		return false;
+	}
+
+	UE_LOG(LogTemp, Log, TEXT("Local narration model %s loaded, %d context tokens on %d threads."), *Settings.ModelPath, Settings.ContextTokens, Settings.Threads);
+	return true;
+#else
+	return false;
+#endif
+}
+
+void FLocalNarrationModel::Submit(const FString& Prompt, int32 MaxTokens, FOnCompletion OnCompletion)
+{
+	/**
+	 * # Function: Submit()
+	 *
+	 * ## Brief
+	 * Queues a completion request and wakes the inference thread.
+	 * Without a loaded model the request fails, its completion is still called on the game thread.
+	 */
+	if (!IsLoaded() || !Thread)
+	{
+		if (OnCompletion)
+		{
+			CompleteOnGameThread(MoveTemp(OnCompletion), false, FString());
+		}
+		return;
+	}
+
+	{
+		FScopeLock ScopeLock(&Lock);
+		FRequest& Request = Pending.AddDefaulted_GetRef();
+		Request.Prompt = Prompt;
+		Request.MaxTokens = MaxTokens;
+		Request.OnCompletion = MoveTemp(OnCompletion);
+	}
+	WakeUp->Trigger();
+}
+
+void FLocalNarrationModel::CompleteOnGameThread(FOnCompletion&& OnCompletion, bool bSuccess, FString&& Text)
+{
+	AsyncTask(ENamedThreads::GameThread, [OnCompletion = MoveTemp(OnCompletion), bSuccess, Text = MoveTemp(Text)]() mutable
+	{
+		OnCompletion(bSuccess, Text);
+	});
+}
+
+uint32 FLocalNarrationModel::Run()
+{
+	/**
+	 * # Function: Run()
+	 *
+	 * ## Brief
+	 * Runs the pending requests in order on the inference thread, and waits for `Submit()` when the queue is empty.
+	 */
+	while (!bStopping)
+	{
+		FRequest Request;
+		bool bHasRequest = false;
+		{
+			FScopeLock ScopeLock(&Lock);
+			if (Pending.Num() > 0)
+			{
+				Request = MoveTemp(Pending[0]);
+				Pending.RemoveAt(0);
+				bHasRequest = true;
+			}
+		}
+		if (!bHasRequest)
+		{
+			// An auto-reset event, a Submit() between the check and the wait is not missed
+			WakeUp->Wait();
+			continue;
+		}
+
+		FString Text;
+		const bool bSuccess = Generate(Request.Prompt, Request.MaxTokens, Text);
+		if (Request.OnCompletion)
+		{
+			CompleteOnGameThread(MoveTemp(Request.OnCompletion), bSuccess, MoveTemp(Text));
+		}
+	}
+	return 0;
+}
+
+void FLocalNarrationModel::Stop()
+{
+	bStopping = true;
+	if (WakeUp)
+	{
+		WakeUp->Trigger();
+	}
+}
+
+bool FLocalNarrationModel::Generate(const FString& Prompt, int32 MaxTokens, FString& OutText)
+{
+	/**
+	 * # Function: Generate()
+	 *
+	 * ## Brief
+	 * Decodes the new part of the prompt and samples up to MaxTokens tokens.
+	 *
+	 * ## Details
+	 * The last prompt token is always decoded again, its logits start the generation. After the generation the
+	 * KV cache is cut back to the prompt, so the next request can reuse it.
+	 */
+#if WITH_LLAMACPP
+	FTCHARToUTF8 Utf8Prompt(*Prompt);
+	TArray<int32> Tokens;
+	Tokens.SetNumUninitialized(Utf8Prompt.Length() + 2);
+	const int32 NumTokens = llama_tokenize(Model, Utf8Prompt.Get(), Utf8Prompt.Length(), Tokens.GetData(), Tokens.Num(), true, false);
+	if (NumTokens <= 0 || NumTokens + MaxTokens > Settings.ContextTokens)
+	{
+		UE_LOG(LogTemp, Warning, TEXT("Local narration prompt does not fit the context (%d tokens)."), NumTokens);
+		return false;
+	}
+	Tokens.SetNum(NumTokens);
+
+	const double StartTime = FPlatformTime::Seconds();
+	const int32 Reused = FMath::Min(GetReusablePrefix(CachedTokens, Tokens), NumTokens - 1);
+	llama_kv_cache_seq_rm(Context, 0, Reused, -1);
+	CachedTokens = Tokens;
+	if (!Decode(TConstArrayView<int32>(Tokens).Slice(Reused, NumTokens - Reused), Reused))
+	{
+		CachedTokens.Reset();
+		llama_kv_cache_seq_rm(Context, 0, 0, -1);
+		return false;
+	}
+	const double PrefillTime = FPlatformTime::Seconds();
+
+	// Pieces can end inside a UTF-8 character, the text is converted at the end
+	TArray<ANSICHAR> Utf8Text;
+	int32 Generated = 0;
+	for (; Generated < MaxTokens; Generated++)
+	{
+		const llama_token Token = llama_sampler_sample(Sampler, Context, -1);
+		if (llama_token_is_eog(Model, Token))
+		{
+			break;
+		}
+
+		char Piece[128];
+		const int32 PieceLength = llama_token_to_piece(Model, Token, Piece, sizeof(Piece), 0, false);
+		if (PieceLength > 0)
+		{
+			Utf8Text.Append(Piece, PieceLength);
+		}
+
+		const int32 Next = Token;
+		if (!Decode(TConstArrayView<int32>(&Next, 1), NumTokens + Generated))
+		{
+			break;
+		}
+	}
+	llama_kv_cache_seq_rm(Context, 0, NumTokens, -1);
+	llama_sampler_reset(Sampler);
+
+	const FUTF8ToTCHAR Converted(Utf8Text.GetData(), Utf8Text.Num());
+	OutText = FString(Converted.Length(), Converted.Get());
+
+	const double EndTime = FPlatformTime::Seconds();
+	FScopeLock ScopeLock(&Lock);
+	Stats.Requests++;
+	Stats.PromptTokens += NumTokens;
+	Stats.ReusedTokens += Reused;
+	Stats.GeneratedTokens += Generated;
+	Stats.PrefillSeconds += PrefillTime - StartTime;
+	Stats.GenerateSeconds += EndTime - PrefillTime;
+	return true;
+#else
+	return false;
+#endif
+}
+
+bool FLocalNarrationModel::Decode(TConstArrayView<int32> Tokens, int32 StartPosition)
+{
+#if WITH_LLAMACPP
+	llama_batch Batch = llama_batch_init(Tokens.Num(), 0, 1);
+	for (int32 i = 0; i < Tokens.Num(); i++)
+	{
+		Batch.token[i] = Tokens[i];
+		Batch.pos[i] = StartPosition + i;
+		Batch.n_seq_id[i] = 1;
+		Batch.seq_id[i][0] = 0;
+		Batch.logits[i] = i == Tokens.Num() - 1;
+	}
+	Batch.n_tokens = Tokens.Num();
+
+	const bool bSuccess = llama_decode(Context, Batch) == 0;
+	llama_batch_free(Batch);
+	return bSuccess;
+#else
+	return false;
+#endif
+}
+
+int32 FLocalNarrationModel::GetReusablePrefix(TConstArrayView<int32> InCachedTokens, TConstArrayView<int32> PromptTokens)
+{
+	const int32 MaxLength = FMath::Min(InCachedTokens.Num(), PromptTokens.Num());
+	int32 Length = 0;
+	while (Length < MaxLength && InCachedTokens[Length] == PromptTokens[Length])
+	{
+		Length++;
+	}
+	return Length;
+}
+
+FLocalInferenceStats FLocalNarrationModel::GetStats() const
+{
+	FScopeLock ScopeLock(&Lock);
+	return Stats;
+}
+
+void FLocalNarrationModel::LogStats() const
+{
+	const FLocalInferenceStats Current = GetStats();
+	UE_LOG(LogTemp, Log, TEXT("Local narration model: %lld requests, %.1f%% of %lld prompt tokens reused from the KV cache, %.1f ms prefill per request, %.1f tokens/s."),
+		Current.Requests, Current.GetReuseRatio() * 100.0, Current.PromptTokens,
+		Current.Requests > 0 ? Current.PrefillSeconds * 1000.0 / Current.Requests : 0.0, Current.GetTokensPerSecond());
+}
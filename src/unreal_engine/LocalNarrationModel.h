@@ -0,0 +1,111 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "HAL/Runnable.h"
+
+// Set by the build rules when the llama.cpp library is found (see justering)
+#ifndef WITH_LLAMACPP
+#define WITH_LLAMACPP 0
+#endif
+
+struct llama_model;
+struct llama_context;
+struct llama_sampler;
+class FRunnableThread;
+class FEvent;
+
+/**
+ * Settings of the in-process narration model.
+ */
+struct FLocalInferenceSettings
+{
+	// Quantized GGUF model
+	FString ModelPath;
+	int32 ContextTokens = 2048;
+
+	// CPU threads used by one inference, 0 leaves two cores to the game
+	int32 Threads = 0;
+	float Temperature = 0.7f;
+};
+
+/**
+ * Counters of the in-process narration model.
+ */
+struct FLocalInferenceStats
+{
+	int64 Requests = 0;
+	int64 PromptTokens = 0;
+	int64 ReusedTokens = 0;
+	int64 GeneratedTokens = 0;
+	double PrefillSeconds = 0.0;
+	double GenerateSeconds = 0.0;
+
+	double GetReuseRatio() const { return PromptTokens > 0 ? double(ReusedTokens) / double(PromptTokens) : 0.0; }
+	double GetTokensPerSecond() const { return GenerateSeconds > 0.0 ? GeneratedTokens / GenerateSeconds : 0.0; }
+};
+
+/**
+ * Runs a small quantized model on the CPU for short narrations, without an HTTP round trip.
+ * The KV cache is kept between requests that share a prompt prefix. See LocalNarrationModel.cpp.
+ */
+class PROJECT_API FLocalNarrationModel : public TSharedFromThis<FLocalNarrationModel, ESPMode::ThreadSafe>, public FRunnable
+{
+public:
+	// Called on the game thread with the generated text, also when the request failed
+	typedef TUniqueFunction<void(bool bSuccess, const FString& Text)> FOnCompletion;
+
+	virtual ~FLocalNarrationModel();
+
+	// Model shared by all handlers, loaded on first use. Null without llama.cpp or model file.
+	static TSharedPtr<FLocalNarrationModel, ESPMode::ThreadSafe> GetShared();
+	static bool IsCompiledIn() { return WITH_LLAMACPP != 0; }
+
+	bool Load(const FLocalInferenceSettings& InSettings);
+	bool IsLoaded() const { return Model != nullptr && Context != nullptr; }
+
+	void Submit(const FString& Prompt, int32 MaxTokens, FOnCompletion OnCompletion);
+
+	// Number of tokens at the start of Prompt that are already in the KV cache
+	static int32 GetReusablePrefix(TConstArrayView<int32> CachedTokens, TConstArrayView<int32> PromptTokens);
+
+	FLocalInferenceStats GetStats() const;
+	void LogStats() const;
+
+	// FRunnable of the inference thread
+	virtual uint32 Run() override;
+	virtual void Stop() override;
+
+private:
+	struct FRequest
+	{
+		FString Prompt;
+		int32 MaxTokens = 0;
+		FOnCompletion OnCompletion;
+	};
+
+	static TSharedPtr<FLocalNarrationModel, ESPMode::ThreadSafe> LoadShared();
+	static void CompleteOnGameThread(FOnCompletion&& OnCompletion, bool bSuccess, FString&& Text);
+	bool Generate(const FString& Prompt, int32 MaxTokens, FString& OutText);
+	bool Decode(TConstArrayView<int32> Tokens, int32 StartPosition);
+
+	FLocalInferenceSettings Settings;
+
+	// Pending requests and statistics, shared with the inference thread
+	mutable FCriticalSection Lock;
+	TArray<FRequest> Pending;
+	FLocalInferenceStats Stats;
+
+	// One inference thread for the lifetime of the model, woken by Submit()
+	FRunnableThread* Thread = nullptr;
+	FEvent* WakeUp = nullptr;
+	TAtomic<bool> bStopping { false };
+	bool bBackendInitialized = false;
+
+	// Only used by the inference thread
+	TArray<int32> CachedTokens;
+	llama_model* Model = nullptr;
+	llama_context* Context = nullptr;
+	llama_sampler* Sampler = nullptr;
+};
@@ -0,0 +1,470 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "NarrationReplication.h"
+#include "StoryEvent.h"
+
+/**
+ * # File: NarrationReplication.cpp
+ *
+ * ## Brief
+ * Implements the compact encoding of narrations that the server replicates to its clients.
+ *
+ * ## Details
+ * Narrations repeat a small set of phrases: the actor names of the level and the direction phrases of the events
+ * (`FStoryEvent::DirectionToString()`). The server and the clients keep the same phrase dictionary, a narration is
+ * sent as UTF-8 text in which these phrases are replaced by their code:
+ * - `0x01 <code>`: a phrase of the dictionary.
+ * - `0x02 <code> <length> <UTF-8>`: a phrase used for the first time. It is added to the dictionary of every receiver
+ *   under `<code>`.
+ * - `0x03 <byte>`: an escaped control character of the text.
+ *
+ * Codes and lengths are varints, a phrase costs two bytes for the first 128 phrases.
+ * The direction phrases are built in, actor names are announced the first time a narration uses them.
+ * Messages are decoded in the order they were encoded, which the reliable Client RPCs of a player's
+ * `UStoryNarrationChannel` guarantee. An announcement carries its code, so a client that lost one still places
+ * the next at the code of the server. The lost code stays a gap, messages using it fail until a snapshot fills it. Each channel has its own codec, the dictionary of a player's client follows
+ * the narrations of that player only.
+ *
+ * A client that joins later, or joins in the middle of a streamed narration, has missed announcements.
+ * It receives a snapshot instead: the announced phrases (and optionally the latest narrations). The snapshot only ever
+ * grows with the dictionary, so reading it merges the missing phrases into the dictionary of the client.
+ */
+
+static constexpr uint8 PhraseCode = 0x01;
+static constexpr uint8 DefineCode = 0x02;
+static constexpr uint8 EscapeCode = 0x03;
+
+// Shorter phrases do not get smaller when replaced by a code
+static constexpr int32 MinPhraseLength = 4;
+static constexpr int32 MaxPhrases = 4096;
+
+static void WriteVarInt(TArray<uint8>& Out, uint32 Value)
+{
+	while (Value >= 0x80)
+	{
+		Out.Add(uint8(Value | 0x80));
+		Value >>= 7;
+	}
+	Out.Add(uint8(Value));
+}
+
+static bool ReadVarInt(TConstArrayView<uint8> Data, int32& Offset, uint32& OutValue)
+{
+	OutValue = 0;
+	for (int32 Shift = 0; Shift < 32 && Offset < Data.Num(); Shift += 7)
+	{
+		const uint8 Byte = Data[Offset++];
+		OutValue |= uint32(Byte & 0x7F) << Shift;
+		if ((Byte & 0x80) == 0)
+		{
+			return true;
+		}
+	}
+	return false;
+}
+
+static void WriteUtf8(TArray<uint8>& Out, const TCHAR* Text, int32 Length)
+{
+	if (Length > 0)
+	{
+		FTCHARToUTF8 Converted(Text, Length);
+		Out.Append(reinterpret_cast<const uint8*>(Converted.Get()), Converted.Length());
+	}
+}
+
+static FString ReadUtf8(TConstArrayView<uint8> Data, int32 Offset, int32 Length)
+{
+	if (Length <= 0)
+	{
+		return FString();
+	}
+	FUTF8ToTCHAR Converted(reinterpret_cast<const ANSICHAR*>(Data.GetData() + Offset), Length);
+	return FString(Converted.Length(), Converted.Get());
+}
+
+FNarrationReplicationCodec::FNarrationReplicationCodec()
+{
+	Reset();
+}
+
+void FNarrationReplicationCodec::Reset()
+{
+	/**
+	 * # Function: Reset()
+	 *
+	 * ## Brief
+	 * Restores the built-in phrases. Server and clients build them in the same order, so their codes match.
+	 */
+	Phrases.Reset();
+	PhraseCodes.Reset();
+	PhrasesByFirstChar.Reset();
+
+	for (uint8 Direction = 0; Direction <= uint8(EStoryDirection::BehindLeftBelow); Direction++)
+	{
+		AddPhrase(FStoryEvent::DirectionToString(EStoryDirection(Direction)));
+	}
+	AddPhrase(TEXT("near the player"));
+	AddPhrase(TEXT("the player"));
+	AddPhrase(TEXT("The wanderer"));
+	AddPhrase(TEXT("the wanderer"));
+	NumBuiltInPhrases = Phrases.Num();
+}
+
+void FNarrationReplicationCodec::AddPhrase(const FString& Phrase)
+{
+	if (Phrase.IsEmpty() || PhraseCodes.Contains(Phrase))
+	{
+		return;
+	}
+	PhraseCodes.Add(Phrase, Phrases.Add(Phrase));
+	AddMatchablePhrase(Phrase);
+}
+
+bool FNarrationReplicationCodec::SetPhrase(int32 Code, const FString& Phrase)
+{
+	/**
+	 * # Function: SetPhrase()
+	 *
+	 * ## Brief
+	 * Adds a phrase announced by the server under its code. Returns false if the client has a different phrase
+	 * under that code, or the phrase under another code.
+	 *
+	 * ## Details
+	 * Codes the client did not receive yet are kept as empty gaps, see `HasGaps()`.
+	 */
+	if (Code < 0 || Code >= MaxPhrases || Phrase.IsEmpty())
+	{
+		return false;
+	}
+	if (Phrases.IsValidIndex(Code) && !Phrases[Code].IsEmpty())
+	{
+		return Phrases[Code].Equals(Phrase, ESearchCase::CaseSensitive);
+	}
+	if (PhraseCodes.Contains(Phrase))
+	{
+		return false;
+	}
+
+	if (Code >= Phrases.Num())
+	{
+		Phrases.SetNum(Code + 1);
+	}
+	Phrases[Code] = Phrase;
+	PhraseCodes.Add(Phrase, Code);
+	AddMatchablePhrase(Phrase);
+	return true;
+}
+
+bool FNarrationReplicationCodec::HasGaps() const
+{
+	for (int32 Code = NumBuiltInPhrases; Code < Phrases.Num(); Code++)
+	{
+		if (Phrases[Code].IsEmpty())
+		{
+			return true;
+		}
+	}
+	return false;
+}
+
+void FNarrationReplicationCodec::AddMatchablePhrase(const FString& Phrase)
+{
+	TArray<FString>& Candidates = PhrasesByFirstChar.FindOrAdd(Phrase[0]);
+	if (!Candidates.Contains(Phrase))
+	{
+		Candidates.Add(Phrase);
+		Candidates.StableSort([](const FString& A, const FString& B) { return A.Len() > B.Len(); });
+	}
+}
+
+void FNarrationReplicationCodec::AddCandidatePhrase(const FString& Phrase)
+{
+	const FString Trimmed = Phrase.TrimStartAndEnd();
+	if (Trimmed.Len() >= MinPhraseLength)
+	{
+		AddMatchablePhrase(Trimmed);
+	}
+}
+
+int32 FNarrationReplicationCodec::MatchPhrase(const FString& Text, int32 Position) const
+{
+	/**
+	 * # Function: MatchPhrase()
+	 *
+	 * ## Brief
+	 * Returns the length of the longest phrase starting at `Position`, or 0.
+	 *
+	 * ## Details
+	 * Phrases only match whole words, "Lamp" is not found in "Lamppost".
+	 */
+	if (Position > 0 && FChar::IsAlnum(Text[Position - 1]))
+	{
+		return 0;
+	}
+
+	const TArray<FString>* Candidates = PhrasesByFirstChar.Find(Text[Position]);
+	if (!Candidates)
+	{
+		return 0;
+	}
+
+	for (const FString& Phrase : *Candidates)
+	{
+		const int32 End = Position + Phrase.Len();
+		if (End <= Text.Len() && FCString::Strncmp(*Text + Position, *Phrase, Phrase.Len()) == 0 && (End == Text.Len() || !FChar::IsAlnum(Text[End])))
+		{
+			return Phrase.Len();
+		}
+	}
+	return 0;
+}
+
+void FNarrationReplicationCodec::Encode(const FString& Text, TArray<uint8>& Out)
+{
+	EncodeText(Text, Out, true);
+}
+
+void FNarrationReplicationCodec::EncodeText(const FString& Text, TArray<uint8>& Out, bool bAnnounce)
+{
+	/**
+	 * # Function: EncodeText()
+	 *
+	 * ## Brief
+	 * Appends `Text` to `Out`, with the phrases of the dictionary replaced by their code.
+	 *
+	 * ## Details
+	 * With `bAnnounce` a candidate phrase is sent in full once and added to the dictionary. Without it (snapshots)
+	 * candidates stay plain text, so the dictionary does not change.
+	 */
+	int32 RunStart = 0;
+	int32 Position = 0;
+	while (Position < Text.Len())
+	{
+		const TCHAR Char = Text[Position];
+		if (Char >= PhraseCode && Char <= EscapeCode)
+		{
+			WriteUtf8(Out, *Text + RunStart, Position - RunStart);
+			Out.Add(EscapeCode);
+			Out.Add(uint8(Char));
+			RunStart = ++Position;
+			continue;
+		}
+
+		const int32 Length = MatchPhrase(Text, Position);
+		if (Length == 0)
+		{
+			Position++;
+			continue;
+		}
+
+		const FString Phrase = Text.Mid(Position, Length);
+		const int32* Code = PhraseCodes.Find(Phrase);
+		if (Code)
+		{
+			WriteUtf8(Out, *Text + RunStart, Position - RunStart);
+			Out.Add(PhraseCode);
+			WriteVarInt(Out, uint32(*Code));
+			RunStart = Position + Length;
+		}
+		else if (bAnnounce && Phrases.Num() < MaxPhrases)
+		{
+			WriteUtf8(Out, *Text + RunStart, Position - RunStart);
+			FTCHARToUTF8 Converted(*Phrase, Phrase.Len());
+			Out.Add(DefineCode);
+			WriteVarInt(Out, uint32(Phrases.Num()));
+			WriteVarInt(Out, uint32(Converted.Length()));
+			Out.Append(reinterpret_cast<const uint8*>(Converted.Get()), Converted.Length());
+			PhraseCodes.Add(Phrase, Phrases.Add(Phrase));
+			RunStart = Position + Length;
+		}
+		Position += Length;
+	}
+	WriteUtf8(Out, *Text + RunStart, Text.Len() - RunStart);
+}
+
+bool FNarrationReplicationCodec::Decode(TConstArrayView<uint8> Data, FString& OutText)
+{
+	/**
+	 * # Function: Decode()
+	 *
+	 * ## Brief
+	 * Decodes a message of `Encode()`. Returns false if the message is corrupt, uses an unknown phrase
+	 * or announces a phrase that conflicts with the dictionary.
+	 *
+	 * ## Details
+	 * An announcement is added under the code the server gave it, also after a gap left by a lost announcement.
+	 * A message using the code of the gap fails instead of decoding to another phrase.
+	 */
+	OutText.Reset();
+	int32 RunStart = 0;
+	int32 Offset = 0;
+	while (Offset < Data.Num())
+	{
+		const uint8 Byte = Data[Offset];
+		if (Byte > EscapeCode || Byte == 0)
+		{
+			Offset++;
+			continue;
+		}
+
+		OutText += ReadUtf8(Data, RunStart, Offset - RunStart);
+		Offset++;
+		if (Byte == PhraseCode)
+		{
+			uint32 Code = 0;
+			if (!ReadVarInt(Data, Offset, Code) || !Phrases.IsValidIndex(int32(Code)) || Phrases[Code].IsEmpty())
+			{
+				return false;
+			}
+			OutText += Phrases[Code];
+		}
+		else if (Byte == DefineCode)
+		{
+			uint32 Code = 0;
+			uint32 Length = 0;
+			if (!ReadVarInt(Data, Offset, Code) || !ReadVarInt(Data, Offset, Length) || int64(Offset) + Length > Data.Num())
+			{
+				return false;
+			}
+			const FString Phrase = ReadUtf8(Data, Offset, int32(Length));
+			Offset += int32(Length);
+			if (!SetPhrase(int32(Code), Phrase))
+			{
+				return false;
+			}
+			OutText += Phrase;
+		}
+		else
+		{
+			if (Offset >= Data.Num())
+			{
+				return false;
+			}
+			OutText.AppendChar(TCHAR(Data[Offset++]));
+		}
+		RunStart = Offset;
+	}
+	OutText += ReadUtf8(Data, RunStart, Data.Num() - RunStart);
+	return true;
+}
+
+void FNarrationReplicationCodec::WriteSnapshot(const TMap<int32, FString>& LatestNarrations, TArray<uint8>& Out)
+{
+	/**
+	 * # Function: WriteSnapshot()
+	 *
+	 * ## Brief
+	 * Writes the announced phrases and the latest narration of each player, see `ReadSnapshot()`.
+	 */
+	Out.Reset();
+	WriteVarInt(Out, uint32(Phrases.Num() - NumBuiltInPhrases));
+	for (int32 Code = NumBuiltInPhrases; Code < Phrases.Num(); Code++)
+	{
+		FTCHARToUTF8 Converted(*Phrases[Code], Phrases[Code].Len());
+		WriteVarInt(Out, uint32(Converted.Length()));
+		Out.Append(reinterpret_cast<const uint8*>(Converted.Get()), Converted.Length());
+	}
+
+	WriteVarInt(Out, uint32(LatestNarrations.Num()));
+	TArray<uint8> Encoded;
+	for (const TPair<int32, FString>& Latest : LatestNarrations)
+	{
+		Encoded.Reset();
+		EncodeText(Latest.Value, Encoded, false);
+		WriteVarInt(Out, uint32(Latest.Key));
+		WriteVarInt(Out, uint32(Encoded.Num()));
+		Out.Append(Encoded);
+	}
+}
+
+bool FNarrationReplicationCodec::ReadSnapshot(TConstArrayView<uint8> Data, TMap<int32, FString>& OutLatestNarrations)
+{
+	/**
+	 * # Function: ReadSnapshot()
+	 *
+	 * ## Brief
+	 * Merges the dictionary of the server and returns the latest narration of each player id.
+	 *
+	 * ## Details
+	 * The dictionaries of server and client are the same sequence of phrases, the client may know fewer or more
+	 * of them than the snapshot (announcements can arrive before or after it, or be lost). Missing phrases and
+	 * gaps are filled under their code, a phrase that differs from the one the client has under the same code
+	 * fails the snapshot.
+	 */
+	OutLatestNarrations.Reset();
+
+	int32 Offset = 0;
+	uint32 NumAnnounced = 0;
+	if (!ReadVarInt(Data, Offset, NumAnnounced))
+	{
+		return false;
+	}
+	for (uint32 i = 0; i < NumAnnounced; i++)
+	{
+		uint32 Length = 0;
+		if (!ReadVarInt(Data, Offset, Length) || int64(Offset) + Length > Data.Num())
+		{
+			return false;
+		}
+		const FString Phrase = ReadUtf8(Data, Offset, int32(Length));
+		Offset += int32(Length);
+		if (!SetPhrase(NumBuiltInPhrases + int32(i), Phrase))
+		{
+			return false;
+		}
+	}
+
+	uint32 NumNarrations = 0;
+	if (!ReadVarInt(Data, Offset, NumNarrations))
+	{
+		return false;
+	}
+	for (uint32 i = 0; i < NumNarrations; i++)
+	{
+		uint32 PlayerId = 0;
+		uint32 Length = 0;
+		FString Narration;
+		if (!ReadVarInt(Data, Offset, PlayerId) || !ReadVarInt(Data, Offset, Length) || int64(Offset) + Length > Data.Num()
+			|| !Decode(Data.Slice(Offset, int32(Length)), Narration))
+		{
+			return false;
+		}
+		Offset += int32(Length);
+		OutLatestNarrations.Add(int32(PlayerId), MoveTemp(Narration));
+	}
+	return true;
+}
+
+int32 FNarrationReplicationCodec::GetMessageBytes(int32 PayloadBytes)
+{
+	// Player id, stream id and array length of a narration message
+	return 12 + PayloadBytes;
+}
+
+int32 FNarrationReplicationCodec::GetNaiveBytes(const FString& Text)
+{
+	/**
+	 * # Function: GetNaiveBytes()
+	 *
+	 * ## Brief
+	 * Size of the narration sent once as an FString with the player id: length, characters and terminator,
+	 * one byte per character for ANSI text and two otherwise.
+	 */
+	const int32 CharSize = FCString::IsPureAnsi(*Text) ? 1 : 2;
+	return 8 + (Text.Len() + 1) * CharSize;
+}
+
+void FNarrationReplicationCodec::RecordNarration(const FString& Text, int32 Messages, int32 EncodedBytes)
+{
+	Stats.Narrations++;
+	Stats.Messages += Messages;
+	Stats.EncodedBytes += EncodedBytes;
+	Stats.NaiveBytes += GetNaiveBytes(Text);
+}
+
+void FNarrationReplicationCodec::LogStats() const
+{
+	UE_LOG(LogTemp, Log, TEXT("Narration replication: %lld narrations in %lld messages, %.1f bytes per narration per client (%.1f as FString), %d phrases."),
+		Stats.Narrations, Stats.Messages, Stats.GetBytesPerNarration(), Stats.GetNaiveBytesPerNarration(), Phrases.Num());
+}
@@ -0,0 +1,75 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+/**
+ * Bytes sent per narration, compared with replicating the whole narration as an FString.
+ */
+struct FNarrationReplicationStats
+{
+	int64 Narrations = 0;
+	int64 Messages = 0;
+	int64 EncodedBytes = 0;
+	int64 NaiveBytes = 0;
+
+	double GetBytesPerNarration() const { return Narrations > 0 ? double(EncodedBytes) / Narrations : 0.0; }
+	double GetNaiveBytesPerNarration() const { return Narrations > 0 ? double(NaiveBytes) / Narrations : 0.0; }
+};
+
+/**
+ * Encodes narration text for replication to clients with a phrase dictionary shared by the server and the clients.
+ * See NarrationReplication.cpp.
+ */
+class PROJECT_API FNarrationReplicationCodec
+{
+public:
+	FNarrationReplicationCodec();
+
+	// Back to the built-in phrases, forgets phrases announced in this session
+	void Reset();
+
+	// Server: a phrase (actor name) that is added to the dictionary the first time a narration uses it
+	void AddCandidatePhrase(const FString& Phrase);
+
+	// Server: appends the encoding of Text, announcing the candidate phrases it uses
+	void Encode(const FString& Text, TArray<uint8>& Out);
+
+	// Client: decodes a message of Encode() and learns the phrases it announces
+	bool Decode(TConstArrayView<uint8> Data, FString& OutText);
+
+	// Dictionary and latest narration per player id, for clients that join a running session or missed announcements.
+	// Reading merges the dictionary: phrases the client learned already are kept, the missing ones are added.
+	void WriteSnapshot(const TMap<int32, FString>& LatestNarrations, TArray<uint8>& Out);
+	bool ReadSnapshot(TConstArrayView<uint8> Data, TMap<int32, FString>& OutLatestNarrations);
+
+	int32 NumPhrases() const { return Phrases.Num(); }
+
+	// Client: an announcement was lost and its code is still unknown
+	bool HasGaps() const;
+
+	// Server: counts the messages of one narration against a single FString with the narration
+	void RecordNarration(const FString& Text, int32 Messages, int32 EncodedBytes);
+	static int32 GetMessageBytes(int32 PayloadBytes);
+	static int32 GetNaiveBytes(const FString& Text);
+	const FNarrationReplicationStats& GetStats() const { return Stats; }
+	void LogStats() const;
+
+private:
+	void AddPhrase(const FString& Phrase);
+	bool SetPhrase(int32 Code, const FString& Phrase);
+	void AddMatchablePhrase(const FString& Phrase);
+	void EncodeText(const FString& Text, TArray<uint8>& Out, bool bAnnounce);
+	int32 MatchPhrase(const FString& Text, int32 Position) const;
+
+	// Announced phrases, the index of a phrase is its code on the wire. Empty for codes the client has not received.
+	TArray<FString> Phrases;
+	TMap<FString, int32> PhraseCodes;
+	int32 NumBuiltInPhrases = 0;
+
+	// Announced and candidate phrases by first character, longest first
+	TMap<TCHAR, TArray<FString>> PhrasesByFirstChar;
+
+	FNarrationReplicationStats Stats;
+};
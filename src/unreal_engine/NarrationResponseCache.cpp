@@ -0,0 +1,138 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "NarrationResponseCache.h"
+#include "Hash/CityHash.h"
+
+/**
+ * # File: NarrationResponseCache.cpp
+ *
+ * ## Brief
+ * Implements the semantic response cache for repeated scenes.
+ *
+ * ## Details
+ * Players often trigger the same situation again, for example picking up the same object in front of them.
+ * A scene is described by its quantized events: actor name, direction code and distance bucket.
+ * Scenes with the same quantized events share a cache key, so their narration can be shown without an LLM round trip.
+ *
+ * - Up to `MaxVariants` narrations are stored per scene and served in rotation for variation.
+ * - Scenes are evicted least recently used first when `MaxEntries` is reached.
+ */
+
+FNarrationResponseCache::FNarrationResponseCache()
+	: Entries(Policy.MaxEntries)
+{
+}
+
+void FNarrationResponseCache::Configure(const FNarrationCachePolicy& InPolicy)
+{
+	/**
+	 * # Function: Configure()
+	 *
+	 * ## Brief
+	 * Applies a new policy. The cache is emptied since keys depend on the distance bucket size.
+	 */
+	Policy = InPolicy;
+	Policy.MaxEntries = FMath::Max(1, Policy.MaxEntries);
+	Policy.MaxVariants = FMath::Max(1, Policy.MaxVariants);
+	Policy.MinVariants = FMath::Clamp(Policy.MinVariants, 1, Policy.MaxVariants);
+	Policy.DistanceBucketSize = FMath::Max(1.0, Policy.DistanceBucketSize);
+	Empty();
+}
+
+uint64 FNarrationResponseCache::MakeSceneKey(TConstArrayView<FStoryEvent> Events) const
+{
+	/**
+	 * # Function: MakeSceneKey()
+	 *
+	 * ## Brief
+	 * Returns the canonical hash of an event batch, the events a request narrates.
+	 *
+	 * ## Details
+	 * Every event is quantized into `actor|direction|distance bucket`. The entries are sorted and
+	 * duplicates removed, so the order of the events and repeated movements of the same actor
+	 * within one batch do not change the key.
+	 */
+	TArray<FString> Quantized;
+	Quantized.Reserve(Events.Num());
+	for (const FStoryEvent& Event : Events)
+	{
+		const int32 DistanceBucket = FMath::FloorToInt32(Event.Distance / Policy.DistanceBucketSize);
+		Quantized.AddUnique(FString::Printf(TEXT("%s|%d|%d"), *Event.ActorName, (int32)Event.Direction, DistanceBucket));
+	}
+	Quantized.Sort();
+
+	FString Canonical = FString::Join(Quantized, TEXT(";"));
+	return CityHash64(reinterpret_cast<const char*>(*Canonical), Canonical.Len() * sizeof(TCHAR));
+}
+
+bool FNarrationResponseCache::Find(uint64 SceneKey, FString& OutNarration)
+{
+	/**
+	 * # Function: Find()
+	 *
+	 * ## Brief
+	 * Looks up a narration for a scene and marks the scene as recently used.
+	 *
+	 * ## Details
+	 * Returns false if the scene has fewer than `MinVariants` narrations, so the LLM is asked again
+	 * until there is enough variation. Otherwise the next variant in rotation is returned.
+	 */
+	const FCachedScene* Found = Entries.FindAndTouch(SceneKey);
+	if (!Found || Found->Variants.Num() < Policy.MinVariants)
+	{
+		Misses++;
+		return false;
+	}
+
+	// The cache only hands out const values, the scene with the next variant replaces the entry
+	FCachedScene Scene = *Found;
+	OutNarration = Scene.Variants[Scene.NextVariant % Scene.Variants.Num()];
+	Scene.NextVariant = (Scene.NextVariant + 1) % Scene.Variants.Num();
+	Entries.Add(SceneKey, MoveTemp(Scene));
+	Hits++;
+	return true;
+}
+
+void FNarrationResponseCache::Add(uint64 SceneKey, const FString& Narration)
+{
+	/**
+	 * # Function: Add()
+	 *
+	 * ## Brief
+	 * Stores a narration for a scene. The oldest variant is replaced when the scene has `MaxVariants` narrations.
+	 */
+	if (Narration.IsEmpty())
+	{
+		return;
+	}
+
+	FCachedScene Scene;
+	if (const FCachedScene* Found = Entries.FindAndTouch(SceneKey))
+	{
+		if (Found->Variants.Contains(Narration))
+		{
+			return;
+		}
+		Scene = *Found;
+		if (Scene.Variants.Num() >= Policy.MaxVariants)
+		{
+			Scene.Variants.RemoveAt(0);
+		}
+	}
+	Scene.Variants.Add(Narration);
+	Entries.Add(SceneKey, MoveTemp(Scene));
+}
+
+void FNarrationResponseCache::Empty()
+{
+	/**
+	 * # Function: Empty()
+	 *
+	 * ## Brief
+	 * Removes all scenes and resets the hit statistics.
+	 */
+	Entries.Empty(Policy.MaxEntries);
+	Hits = 0;
+	Misses = 0;
+}
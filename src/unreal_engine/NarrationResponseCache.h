@@ -0,0 +1,62 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Containers/LruCache.h"
+#include "StoryEvent.h"
+
+/**
+ * Reuse and variation settings of the narration response cache.
+ */
+struct FNarrationCachePolicy
+{
+	// Number of scenes kept, the least recently used scene is evicted first
+	int32 MaxEntries = 64;
+
+	// Distances are quantized into buckets of this size (Unreal units)
+	double DistanceBucketSize = 100.0;
+
+	// A scene is only served from the cache once it has this many narrations
+	int32 MinVariants = 1;
+
+	// Maximum number of narrations stored per scene, served in rotation
+	int32 MaxVariants = 3;
+
+	// Still send the request on a cache hit and store the result as a new variant
+	bool bRefreshInBackground = false;
+};
+
+/**
+ * Caches LLM narrations keyed by a canonical hash of the quantized event batch.
+ * See NarrationResponseCache.cpp.
+ */
+class PROJECT_API FNarrationResponseCache
+{
+public:
+	FNarrationResponseCache();
+
+	void Configure(const FNarrationCachePolicy& InPolicy);
+	const FNarrationCachePolicy& GetPolicy() const { return Policy; }
+
+	uint64 MakeSceneKey(TConstArrayView<FStoryEvent> Events) const;
+	bool Find(uint64 SceneKey, FString& OutNarration);
+	void Add(uint64 SceneKey, const FString& Narration);
+	void Empty();
+
+	int32 Num() const { return Entries.Num(); }
+	int32 GetHits() const { return Hits; }
+	int32 GetMisses() const { return Misses; }
+
+private:
+	struct FCachedScene
+	{
+		TArray<FString> Variants;
+		int32 NextVariant = 0;
+	};
+
+	FNarrationCachePolicy Policy;
+	TLruCache<uint64, FCachedScene> Entries;
+	int32 Hits = 0;
+	int32 Misses = 0;
+};
@@ -0,0 +1,375 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "NarrationScheduler.h"
+#include "HAL/PlatformTime.h"
+
+/**
+ * # File: NarrationScheduler.cpp
+ *
+ * ## Brief
+ * Implements the priority scheduler for narration requests.
+ *
+ * ## Details
+ * Interactions with objects the player is holding matter more than a distant object drifting.
+ * Every request is given a priority class (see `ClassifyEvent()`) and dispatched through the scheduler:
+ * - At most `MaxInFlight` requests run at the same time.
+ * - When the pipeline is saturated, a higher priority request preempts (cancels) the lowest priority request in flight.
+ * - Otherwise it waits in a queue ordered by priority. Low priority work is skipped instead of queued.
+ * - Latency from submit to completion is tracked per class and compared against the class SLO.
+ *
+ * Every job has an owner, the player it narrates for. Within a priority class the owner with the fewest
+ * requests in flight goes first, and a full queue drops the job of the owner with the most queued jobs.
+ * A player with many events cannot take all slots and keep another player waiting.
+ */
+
+void FNarrationScheduler::Configure(int32 InMaxInFlight, int32 InMaxQueued, const TArray<double>& InLatencySLOs)
+{
+	/**
+	 * # Function: Configure()
+	 *
+	 * ## Brief
+	 * Sets the number of concurrent requests, the queue length and the latency SLO (seconds) of each class.
+	 */
+	MaxInFlight = FMath::Max(1, InMaxInFlight);
+	MaxQueued = FMath::Max(0, InMaxQueued);
+	for (int32 i = 0; i < InLatencySLOs.Num() && i < (int32)ENarrationPriority::Count; i++)
+	{
+		LatencySLOs[i] = InLatencySLOs[i];
+	}
+}
+
+uint32 FNarrationScheduler::Submit(ENarrationPriority Priority, FStartJob Start, int32 Owner)
+{
+	/**
+	 * # Function: Submit()
+	 *
+	 * ## Brief
+	 * Starts, queues or skips a narration request depending on its priority and the current load.
+	 *
+	 * ## Details
+	 * Returns the job id, or 0 if the request was skipped. The job id must be passed to `Complete()`
+	 * when the request finishes.
+	 */
+	FNarrationClassStats& ClassStats = Stats[(int32)Priority];
+	ClassStats.Submitted++;
+
+	FNarrationJob Job;
+	Job.Id = NextJobId++;
+	Job.Priority = Priority;
+	Job.Owner = Owner;
+	Job.SubmitTime = FPlatformTime::Seconds();
+	Job.Start = MoveTemp(Start);
+
+	if (IsSaturated() && Priority == ENarrationPriority::Low)
+	{
+		ClassStats.Skipped++;
+		UE_LOG(LogTemp, Log, TEXT("Narration pipeline saturated, skipping low priority request."));
+		return 0;
+	}
+
+	if (!IsSaturated() || PreemptFor(Priority))
+	{
+		if (!StartJob(Job))
+		{
+			return 0;
+		}
+		InFlight.Add(MoveTemp(Job));
+		return InFlight.Last().Id;
+	}
+
+	// Make room in the queue by skipping the lowest priority job, or the job of an owner
+	// with more queued jobs at the same priority, or skip this one
+	if (Queue.Num() >= MaxQueued)
+	{
+		const int32 Victim = PickQueuedVictim();
+		if (Victim != INDEX_NONE && (Queue[Victim].Priority > Priority ||
+			(Queue[Victim].Priority == Priority && NumQueuedFor(Queue[Victim].Owner) > NumQueuedFor(Owner) + 1)))
+		{
+			Stats[(int32)Queue[Victim].Priority].Skipped++;
+			Queue.RemoveAt(Victim);
+		}
+		else
+		{
+			ClassStats.Skipped++;
+			UE_LOG(LogTemp, Log, TEXT("Narration queue full, skipping %s request."), PriorityToString(Priority));
+			return 0;
+		}
+	}
+
+	// Ordered by priority, first in first out within a class
+	uint32 JobId = Job.Id;
+	int32 Index = Queue.IndexOfByPredicate([Priority](const FNarrationJob& Queued) { return Queued.Priority > Priority; });
+	if (Index == INDEX_NONE)
+	{
+		Queue.Add(MoveTemp(Job));
+	}
+	else
+	{
+		Queue.Insert(MoveTemp(Job), Index);
+	}
+	return JobId;
+}
+
+void FNarrationScheduler::Complete(uint32 JobId, bool bSuccess)
+{
+	/**
+	 * # Function: Complete()
+	 *
+	 * ## Brief
+	 * Records the latency of a finished request and starts the next queued request.
+	 *
+	 * ## Note
+	 * Preempted jobs are already removed, so their (cancelled) completion is ignored.
+	 */
+	int32 Index = InFlight.IndexOfByPredicate([JobId](const FNarrationJob& Job) { return Job.Id == JobId; });
+	if (Index == INDEX_NONE)
+	{
+		return;
+	}
+
+	const FNarrationJob& Job = InFlight[Index];
+	FNarrationClassStats& ClassStats = Stats[(int32)Job.Priority];
+	if (bSuccess)
+	{
+		double Latency = FPlatformTime::Seconds() - Job.SubmitTime;
+		ClassStats.Completed++;
+		ClassStats.TotalLatency += Latency;
+		ClassStats.MaxLatency = FMath::Max(ClassStats.MaxLatency, Latency);
+
+		if (Latency > LatencySLOs[(int32)Job.Priority])
+		{
+			ClassStats.SloMisses++;
+			UE_LOG(LogTemp, Warning, TEXT("%s narration took %.2f s, SLO is %.2f s (%d misses)."),
+				PriorityToString(Job.Priority), Latency, LatencySLOs[(int32)Job.Priority], ClassStats.SloMisses);
+		}
+	}
+
+	InFlight.RemoveAt(Index);
+	Pump();
+}
+
+int32 FNarrationScheduler::NumInFlightFor(int32 Owner) const
+{
+	int32 Num = 0;
+	for (const FNarrationJob& Job : InFlight)
+	{
+		Num += Job.Owner == Owner ? 1 : 0;
+	}
+	return Num;
+}
+
+int32 FNarrationScheduler::NumQueuedFor(int32 Owner) const
+{
+	int32 Num = 0;
+	for (const FNarrationJob& Job : Queue)
+	{
+		Num += Job.Owner == Owner ? 1 : 0;
+	}
+	return Num;
+}
+
+void FNarrationScheduler::CancelAll()
+{
+	/**
+	 * # Function: CancelAll()
+	 *
+	 * ## Brief
+	 * Cancels all running requests and clears the queue.
+	 */
+	Queue.Empty();
+	TArray<FNarrationJob> Running = MoveTemp(InFlight);
+	InFlight.Reset();
+	for (FNarrationJob& Job : Running)
+	{
+		if (Job.Request.IsValid())
+		{
+			Job.Request->CancelRequest();
+		}
+	}
+}
+
+void FNarrationScheduler::LogStats() const
+{
+	for (int32 i = 0; i < (int32)ENarrationPriority::Count; i++)
+	{
+		const FNarrationClassStats& ClassStats = Stats[i];
+		UE_LOG(LogTemp, Log, TEXT("%s narrations: %d submitted, %d completed, %d skipped, %d preempted, avg %.2f s, max %.2f s, %d SLO misses (%.2f s)."),
+			PriorityToString((ENarrationPriority)i), ClassStats.Submitted, ClassStats.Completed, ClassStats.Skipped, ClassStats.Preempted,
+			ClassStats.GetAverageLatency(), ClassStats.MaxLatency, ClassStats.SloMisses, LatencySLOs[i]);
+	}
+}
+
+bool FNarrationScheduler::StartJob(FNarrationJob& Job)
+{
+	Job.Request = Job.Start(Job.Id);
+	return Job.Request.IsValid();
+}
+
+bool FNarrationScheduler::PreemptFor(ENarrationPriority Priority)
+{
+	/**
+	 * # Function: PreemptFor()
+	 *
+	 * ## Brief
+	 * Cancels the lowest priority request in flight if it has a lower priority than `Priority`.
+	 * Among requests of the same class, one of the owner with the most requests in flight is cancelled.
+	 */
+	int32 Lowest = INDEX_NONE;
+	for (int32 i = 0; i < InFlight.Num(); i++)
+	{
+		if (InFlight[i].Priority <= Priority)
+		{
+			continue;
+		}
+		if (Lowest == INDEX_NONE || InFlight[i].Priority > InFlight[Lowest].Priority ||
+			(InFlight[i].Priority == InFlight[Lowest].Priority && NumInFlightFor(InFlight[i].Owner) > NumInFlightFor(InFlight[Lowest].Owner)))
+		{
+			Lowest = i;
+		}
+	}
+	if (Lowest == INDEX_NONE)
+	{
+		return false;
+	}
+
+	FNarrationJob Preempted = MoveTemp(InFlight[Lowest]);
+	InFlight.RemoveAt(Lowest);
+	Stats[(int32)Preempted.Priority].Preempted++;
+	UE_LOG(LogTemp, Log, TEXT("Preempting %s narration for a %s one."), PriorityToString(Preempted.Priority), PriorityToString(Priority));
+
+	if (Preempted.Request.IsValid())
+	{
+		Preempted.Request->CancelRequest();
+	}
+	return true;
+}
+
+int32 FNarrationScheduler::PickQueued() const
+{
+	/**
+	 * # Function: PickQueued()
+	 *
+	 * ## Brief
+	 * The next queued job to start: the highest priority class, then the owner with the fewest requests in flight.
+	 *
+	 * ## Details
+	 * The queue is ordered by priority and first in first out within a class, so ties go to the oldest job.
+	 */
+	int32 Best = INDEX_NONE;
+	int32 BestInFlight = 0;
+	for (int32 i = 0; i < Queue.Num(); i++)
+	{
+		if (Best != INDEX_NONE && Queue[i].Priority != Queue[Best].Priority)
+		{
+			break;
+		}
+		const int32 OwnerInFlight = NumInFlightFor(Queue[i].Owner);
+		if (Best == INDEX_NONE || OwnerInFlight < BestInFlight)
+		{
+			Best = i;
+			BestInFlight = OwnerInFlight;
+		}
+	}
+	return Best;
+}
+
+int32 FNarrationScheduler::PickQueuedVictim() const
+{
+	/**
+	 * # Function: PickQueuedVictim()
+	 *
+	 * ## Brief
+	 * The queued job to drop for a new one: the lowest priority class, then the owner with the most queued jobs.
+	 *
+	 * ## Details
+	 * Ties go to the newest job.
+	 */
+	int32 Victim = INDEX_NONE;
+	int32 VictimQueued = 0;
+	for (int32 i = Queue.Num() - 1; i >= 0; i--)
+	{
+		if (Victim != INDEX_NONE && Queue[i].Priority != Queue[Victim].Priority)
+		{
+			break;
+		}
+		const int32 OwnerQueued = NumQueuedFor(Queue[i].Owner);
+		if (Victim == INDEX_NONE || OwnerQueued > VictimQueued)
+		{
+			Victim = i;
+			VictimQueued = OwnerQueued;
+		}
+	}
+	return Victim;
+}
+
+void FNarrationScheduler::Pump()
+{
+	while (!IsSaturated() && Queue.Num() > 0)
+	{
+		const int32 Next = PickQueued();
+		FNarrationJob Job = MoveTemp(Queue[Next]);
+		Queue.RemoveAt(Next);
+		if (StartJob(Job))
+		{
+			InFlight.Add(MoveTemp(Job));
+		}
+	}
+}
+
+ENarrationPriority FNarrationScheduler::ClassifyEvent(const FStoryEvent& Event, double HeldDistance, double ReachDistance)
+{
+	/**
+	 * # Function: ClassifyEvent()
+	 *
+	 * ## Brief
+	 * Derives the priority class of an event from its type, the `Interactable:` tag and the distance to the player.
+	 *
+	 * ## Details
+	 * - Predicted (speculative) events are **Low**.
+	 * - Interactable objects within `HeldDistance` are **Critical**, the player is most likely holding them.
+	 * - Interactable objects within `ReachDistance` are **High**.
+	 * - Everything else is **Normal**.
+	 */
+	if (Event.Type == EStoryEventType::Predicted)
+	{
+		return ENarrationPriority::Low;
+	}
+	if (Event.IsInteractable && Event.Distance <= HeldDistance)
+	{
+		return ENarrationPriority::Critical;
+	}
+	if (Event.IsInteractable && Event.Distance <= ReachDistance)
+	{
+		return ENarrationPriority::High;
+	}
+	return ENarrationPriority::Normal;
+}
+
+ENarrationPriority FNarrationScheduler::ClassifyBatch(const TArray<FStoryEvent>& Events, double HeldDistance, double ReachDistance)
+{
+	/**
+	 * # Function: ClassifyBatch()
+	 *
+	 * ## Brief
+	 * A batch gets the highest priority of its events.
+	 */
+	ENarrationPriority Priority = Events.Num() > 0 ? ENarrationPriority::Low : ENarrationPriority::Normal;
+	for (const FStoryEvent& Event : Events)
+	{
+		Priority = FMath::Min(Priority, ClassifyEvent(Event, HeldDistance, ReachDistance));
+	}
+	return Priority;
+}
+
+const TCHAR* FNarrationScheduler::PriorityToString(ENarrationPriority Priority)
+{
+	switch (Priority)
+	{
+	case ENarrationPriority::Critical: return TEXT("Critical");
+	case ENarrationPriority::High:     return TEXT("High");
+	case ENarrationPriority::Normal:   return TEXT("Normal");
+	case ENarrationPriority::Low:      return TEXT("Low");
+	default:                           return TEXT("Unknown");
+	}
+}
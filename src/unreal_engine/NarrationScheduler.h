@@ -0,0 +1,91 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Interfaces/IHttpRequest.h"
+#include "StoryEvent.h"
+
+/**
+ * Priority classes of narration requests, highest first.
+ */
+enum class ENarrationPriority : uint8
+{
+	Critical,	// Interactable object held by or right next to the player
+	High,		// Interactable object within reach
+	Normal,		// Any other movement close to the player
+	Low,		// Speculative requests and cache refreshes
+	Count
+};
+
+/**
+ * Latency and scheduling counters of one priority class.
+ */
+struct FNarrationClassStats
+{
+	int32 Submitted = 0;
+	int32 Completed = 0;
+	int32 Skipped = 0;
+	int32 Preempted = 0;
+	int32 SloMisses = 0;
+	double TotalLatency = 0.0;
+	double MaxLatency = 0.0;
+
+	double GetAverageLatency() const { return Completed > 0 ? TotalLatency / Completed : 0.0; }
+};
+
+/**
+ * Dispatches narration requests by priority class, see NarrationScheduler.cpp.
+ */
+class PROJECT_API FNarrationScheduler
+{
+public:
+	// Starts the request for a job and returns it, or nullptr if it could not be sent
+	typedef TFunction<FHttpRequestPtr(uint32 JobId)> FStartJob;
+
+	void Configure(int32 InMaxInFlight, int32 InMaxQueued, const TArray<double>& InLatencySLOs);
+
+	// Owner is the player the narration is for, jobs of different owners are dispatched fairly
+	uint32 Submit(ENarrationPriority Priority, FStartJob Start, int32 Owner = 0);
+	void Complete(uint32 JobId, bool bSuccess);
+	void CancelAll();
+
+	bool IsSaturated() const { return InFlight.Num() >= MaxInFlight; }
+	int32 NumInFlight() const { return InFlight.Num(); }
+	int32 NumQueued() const { return Queue.Num(); }
+	int32 NumInFlightFor(int32 Owner) const;
+	int32 NumQueuedFor(int32 Owner) const;
+	const FNarrationClassStats& GetStats(ENarrationPriority Priority) const { return Stats[(int32)Priority]; }
+	void LogStats() const;
+
+	// Priority classification
+	static ENarrationPriority ClassifyEvent(const FStoryEvent& Event, double HeldDistance, double ReachDistance);
+	static ENarrationPriority ClassifyBatch(const TArray<FStoryEvent>& Events, double HeldDistance, double ReachDistance);
+	static const TCHAR* PriorityToString(ENarrationPriority Priority);
+
+private:
+	struct FNarrationJob
+	{
+		uint32 Id = 0;
+		ENarrationPriority Priority = ENarrationPriority::Normal;
+		int32 Owner = 0;
+		double SubmitTime = 0.0;
+		FStartJob Start;
+		FHttpRequestPtr Request;
+	};
+
+	bool StartJob(FNarrationJob& Job);
+	bool PreemptFor(ENarrationPriority Priority);
+	int32 PickQueued() const;
+	int32 PickQueuedVictim() const;
+	void Pump();
+
+	int32 MaxInFlight = 2;
+	int32 MaxQueued = 4;
+	double LatencySLOs[(int32)ENarrationPriority::Count] = { 2.0, 4.0, 8.0, 20.0 };
+
+	TArray<FNarrationJob> InFlight;
+	TArray<FNarrationJob> Queue;
+	FNarrationClassStats Stats[(int32)ENarrationPriority::Count];
+	uint32 NextJobId = 1;
+};
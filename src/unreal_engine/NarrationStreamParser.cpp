@@ -0,0 +1,149 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "NarrationStreamParser.h"
+#include "Serialization/JsonReader.h"
+#include "Serialization/JsonSerializer.h"
+
+/**
+ * # File: NarrationStreamParser.cpp
+ *
+ * ## Brief
+ * Implements the parser for streamed chat completion responses.
+ *
+ * ## Details
+ * A streamed response is a list of server-sent events: `data: {json}` lines, ending with `data: [DONE]`.
+ * Each event holds the next piece of the narration in `choices[0].delta.content`.
+ *
+ * The body is not read from the response while the HTTP thread still appends to it. The request hands
+ * each received block to `Receive()` instead (`CreateReceiveDelegate()`), which only appends it to a locked
+ * buffer. `Feed()` takes the new bytes on the game thread and converts only the complete lines, the start of
+ * an incomplete line waits in `Partial`. Every byte is copied and parsed once, and a multi-byte UTF-8 character
+ * is never split.
+ */
+
+void FNarrationStreamParser::Reset()
+{
+	{
+		FScopeLock Lock(&Received->Lock);
+		Received->Bytes.Reset();
+	}
+	Partial.Reset();
+	Text.Reset();
+	bDone = false;
+	UsageEvent.Reset();
+}
+
+FHttpRequestStreamDelegate FNarrationStreamParser::CreateReceiveDelegate() const
+{
+	/**
+	 * # Function: CreateReceiveDelegate()
+	 *
+	 * ## Brief
+	 * Returns the delegate for `IHttpRequest::SetResponseBodyReceiveStreamDelegate()`.
+	 *
+	 * ## Details
+	 * The delegate holds the receive buffer, not the parser, so it stays valid if the parser is moved or removed.
+	 */
+	return FHttpRequestStreamDelegate::CreateLambda([Buffer = Received](void* Data, int64 Length)
+	{
+		FScopeLock Lock(&Buffer->Lock);
+		Buffer->Bytes.Append(static_cast<const uint8*>(Data), Length);
+		return true;
+	});
+}
+
+void FNarrationStreamParser::Receive(const void* Data, int64 Length)
+{
+	FScopeLock Lock(&Received->Lock);
+	Received->Bytes.Append(static_cast<const uint8*>(Data), Length);
+}
+
+bool FNarrationStreamParser::Feed(FString& OutChunk, bool bFinal)
+{
+	/**
+	 * # Function: Feed()
+	 *
+	 * ## Brief
+	 * Parses the complete lines received since the last call and returns the new narration text in `OutChunk`.
+	 *
+	 * ## Details
+	 * With `bFinal` the last line is parsed even if it does not end with a newline. Returns true if `OutChunk` is not empty.
+	 */
+	OutChunk.Reset();
+	{
+		FScopeLock Lock(&Received->Lock);
+		Partial.Append(Received->Bytes);
+		Received->Bytes.Reset();
+	}
+
+	int32 End = Partial.Num();
+	if (!bFinal)
+	{
+		// Only complete lines, the rest arrives with the next progress update
+		while (End > 0 && Partial[End - 1] != '\n')
+		{
+			End--;
+		}
+	}
+	if (End == 0)
+	{
+		return false;
+	}
+
+	FUTF8ToTCHAR Converted(reinterpret_cast<const ANSICHAR*>(Partial.GetData()), End);
+	FString NewLines(Converted.Length(), Converted.Get());
+	Partial.RemoveAt(0, End, false);
+
+	TArray<FString> Lines;
+	NewLines.ParseIntoArrayLines(Lines);
+	for (const FString& Line : Lines)
+	{
+		ParseLine(Line, OutChunk);
+	}
+
+	Text += OutChunk;
+	return !OutChunk.IsEmpty();
+}
+
+void FNarrationStreamParser::ParseLine(const FString& Line, FString& OutChunk)
+{
+	FString Trimmed = Line.TrimStartAndEnd();
+	if (!Trimmed.StartsWith(TEXT("data:")))
+	{
+		return;
+	}
+
+	FString Payload = Trimmed.Mid(5).TrimStart();
+	if (Payload == TEXT("[DONE]"))
+	{
+		bDone = true;
+		return;
+	}
+
+	TSharedPtr<FJsonObject> Event;
+	TSharedRef<TJsonReader<>> Reader = TJsonReaderFactory<>::Create(Payload);
+	if (!FJsonSerializer::Deserialize(Reader, Event) || !Event.IsValid())
+	{
+		UE_LOG(LogTemp, Warning, TEXT("Failed to parse streamed event: %s"), *Payload);
+		return;
+	}
+
+	const TSharedPtr<FJsonObject>* Usage;
+	if (Event->TryGetObjectField(TEXT("usage"), Usage))
+	{
+		UsageEvent = Event;
+	}
+
+	const TArray<TSharedPtr<FJsonValue>>* ChoicesArray;
+	if (Event->TryGetArrayField(TEXT("choices"), ChoicesArray) && ChoicesArray->Num() > 0)
+	{
+		TSharedPtr<FJsonObject> ChoiceObject = (*ChoicesArray)[0]->AsObject();
+		const TSharedPtr<FJsonObject>* Delta;
+		FString Piece;
+		if (ChoiceObject.IsValid() && ChoiceObject->TryGetObjectField(TEXT("delta"), Delta) && (*Delta)->TryGetStringField(TEXT("content"), Piece))
+		{
+			OutChunk += Piece;
+		}
+	}
+}
@@ -0,0 +1,46 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Dom/JsonObject.h"
+#include "Interfaces/IHttpRequest.h"
+
+/**
+ * Incremental parser for streamed (`"stream": true`) chat completion responses, see NarrationStreamParser.cpp.
+ */
+class PROJECT_API FNarrationStreamParser
+{
+public:
+	void Reset();
+
+	// Receives the body of a request as it arrives, on the HTTP thread (see Receive())
+	FHttpRequestStreamDelegate CreateReceiveDelegate() const;
+	// Appends newly received bytes, safe on any thread
+	void Receive(const void* Data, int64 Length);
+
+	// Parses the lines received since the last call and returns the new content. Game thread.
+	bool Feed(FString& OutChunk, bool bFinal = false);
+
+	bool IsDone() const { return bDone; }
+	const FString& GetText() const { return Text; }
+
+	// Last event with a `usage` field, for FStoryPromptBuilder::RecordUsage()
+	TSharedPtr<FJsonObject> GetUsageEvent() const { return UsageEvent; }
+
+private:
+	void ParseLine(const FString& Line, FString& OutChunk);
+
+	// Bytes received on the HTTP thread and not taken by Feed() yet
+	struct FReceiveBuffer
+	{
+		FCriticalSection Lock;
+		TArray<uint8> Bytes;
+	};
+
+	TSharedRef<FReceiveBuffer, ESPMode::ThreadSafe> Received = MakeShared<FReceiveBuffer, ESPMode::ThreadSafe>();
+	TArray<uint8> Partial;	// Start of a line that is not complete yet
+	FString Text;
+	bool bDone = false;
+	TSharedPtr<FJsonObject> UsageEvent;
+};
@@ -0,0 +1,116 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "StoryEvent.h"
+
+/**
+ * # File: StoryEvent.cpp
+ *
+ * ## Brief
+ * Implements the story event struct and the relative direction classification.
+ *
+ * ## Details
+ * Events keep the direction as a compact code instead of a sentence, so they can be compared
+ * and hashed (see `FNarrationResponseCache`). The sentence is only produced when the event is serialized.
+ */
+
+TSharedPtr<FJsonObject> FStoryEvent::ToJson(EStoryNumberPrecision Precision) const
+{
+	/**
+	 * # Function: ToJson()
+	 *
+	 * ## Brief
+	 * Converts the event into the JSON object sent in `Event_History`.
+	 */
+	TSharedPtr<FJsonObject> EventObject = MakeShareable(new FJsonObject());
+	EventObject->SetStringField(TEXT("Object"), ActorName);
+	FStoryNumberFormat::SetNumberField(*EventObject, TEXT("Distance from player"), Distance, Precision);
+	EventObject->SetStringField(TEXT("Relative Position to player"), FString::Printf(TEXT("Actor is %s."), DirectionToString(Direction)));
+	EventObject->SetStringField(TEXT("TimeStamp"), TimeStamp);
+	return EventObject;
+}
+
+EStoryDirection FStoryEvent::GetDirection(double ForwardDot, double RightDot, double VerticalDot)
+{
+	/**
+	 * # Function: GetDirection()
+	 *
+	 * ## Brief
+	 * Classifies a direction from the dot products with the player's forward, right and up vectors.
+	 *
+	 * ## Details
+	 * Directions closer than the threshold (0.8) to one axis are "directly" in that direction,
+	 * vertical first, then right/left, then front/behind. Everything else falls in one of the eight octants.
+	 */
+	const double VerticalThreshold = 0.8;
+	const double HorizontalThreshold = 0.8;
+
+	// Cases for when object is directly to any direction:
+	if (VerticalDot > VerticalThreshold)
+	{
+		return EStoryDirection::Above;
+	}
+	else if (VerticalDot < -VerticalThreshold)
+	{
+		return EStoryDirection::Below;
+	}
+	else if (RightDot > HorizontalThreshold)
+	{
+		return EStoryDirection::Right;
+	}
+	else if (RightDot < -HorizontalThreshold)
+	{
+		return EStoryDirection::Left;
+	}
+	else if (ForwardDot > HorizontalThreshold)
+	{
+		return EStoryDirection::Front;
+	}
+	else if (ForwardDot < -HorizontalThreshold)
+	{
+		return EStoryDirection::Behind;
+	}
+
+	// cases for when its not in a direct direction
+	if (ForwardDot > 0)
+	{
+		if (RightDot > 0)
+		{
+			return VerticalDot > 0 ? EStoryDirection::FrontRightAbove : EStoryDirection::FrontRightBelow;
+		}
+		return VerticalDot > 0 ? EStoryDirection::FrontLeftAbove : EStoryDirection::FrontLeftBelow;
+	}
+	if (RightDot > 0)
+	{
+		return VerticalDot > 0 ? EStoryDirection::BehindRightAbove : EStoryDirection::BehindRightBelow;
+	}
+	return VerticalDot > 0 ? EStoryDirection::BehindLeftAbove : EStoryDirection::BehindLeftBelow;
+}
+
+const TCHAR* FStoryEvent::DirectionToString(EStoryDirection Direction)
+{
+	/**
+	 * # Function: DirectionToString()
+	 *
+	 * ## Brief
+	 * Returns the description used in the prompts, for example "directly in front of the player".
+	 */
+	switch (Direction)
+	{
+	case EStoryDirection::Above:            return TEXT("directly above the player");
+	case EStoryDirection::Below:            return TEXT("directly below the player");
+	case EStoryDirection::Right:            return TEXT("directly to the right of the player");
+	case EStoryDirection::Left:             return TEXT("directly to the left of the player");
+	case EStoryDirection::Front:            return TEXT("directly in front of the player");
+	case EStoryDirection::Behind:           return TEXT("directly behind the player");
+	case EStoryDirection::FrontRightAbove:  return TEXT("in front-right-above the player");
+	case EStoryDirection::FrontRightBelow:  return TEXT("in front-right-below the player");
+	case EStoryDirection::FrontLeftAbove:   return TEXT("in front-left-above the player");
+	case EStoryDirection::FrontLeftBelow:   return TEXT("in front-left-below the player");
+	case EStoryDirection::BehindRightAbove: return TEXT("behind-right-above the player");
+	case EStoryDirection::BehindRightBelow: return TEXT("behind-right-below the player");
+	case EStoryDirection::BehindLeftAbove:  return TEXT("behind-left-above the player");
+	case EStoryDirection::BehindLeftBelow:  return TEXT("behind-left-below the player");
+	}
+	return TEXT("near the player");
+}
@@ -0,0 +1,57 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Dom/JsonObject.h"
+#include "StoryNumberFormat.h"
+
+/**
+ * Direction of an actor relative to the player, see FStoryEvent::GetDirection().
+ */
+enum class EStoryDirection : uint8
+{
+	Above,
+	Below,
+	Right,
+	Left,
+	Front,
+	Behind,
+	FrontRightAbove,
+	FrontRightBelow,
+	FrontLeftAbove,
+	FrontLeftBelow,
+	BehindRightAbove,
+	BehindRightBelow,
+	BehindLeftAbove,
+	BehindLeftBelow
+};
+
+/**
+ * Kind of event, used to prioritize narration requests.
+ */
+enum class EStoryEventType : uint8
+{
+	Moved,		// An actor moved near the player
+	Predicted	// An interaction predicted by FStorySpeculator
+};
+
+/**
+ * A single actor movement event, sent to the LLM in `Event_History`.
+ */
+struct FStoryEvent
+{
+	FString ActorName;
+	EStoryDirection Direction = EStoryDirection::Front;
+	double Distance = 0.0;
+	FString TimeStamp;
+	EStoryEventType Type = EStoryEventType::Moved;
+	bool IsInteractable = false;
+	bool IsNarrated = false;	// Already shown with a pre-generated narration, not dispatched on its own
+	uint32 TraceId = 0;	// FStoryLatencyTrace id, 0 when not traced (not sent to the LLM)
+
+	TSharedPtr<FJsonObject> ToJson(EStoryNumberPrecision Precision = EStoryNumberPrecision::Full) const;
+
+	static EStoryDirection GetDirection(double ForwardDot, double RightDot, double VerticalDot);
+	static const TCHAR* DirectionToString(EStoryDirection Direction);
+};
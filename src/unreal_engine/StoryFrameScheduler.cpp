@@ -0,0 +1,120 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "StoryFrameScheduler.h"
+#include "HAL/PlatformTime.h"
+
+/**
+ * # File: StoryFrameScheduler.cpp
+ *
+ * ## Brief
+ * Implements the frame-budgeted scheduler of the story pipeline.
+ *
+ * ## Details
+ * Run in one go inside timer callbacks and HTTP delegates, tracking and payload building show up as a
+ * frame-time spike every few seconds. In VR a frame at 90 Hz is 11 ms, so the story pipeline gets a small
+ * budget per frame instead:
+ * - **Sliced tasks**: game-thread work that touches actors is split into slices. `Tick()` runs slices,
+ *   round robin over the tasks, until the budget is used. Unfinished tasks continue next frame.
+ * - **Offloaded work**: pure-data work (JSON building, serialization, diffing) runs on the thread pool with `Offload()`.
+ *   Its game-thread continuation runs in `Tick()` and counts against the budget.
+ *
+ * At least one continuation and one slice run every frame, so the pipeline always makes progress.
+ */
+
+void FStoryFrameScheduler::SetBudget(double InBudgetMs)
+{
+	BudgetSeconds = FMath::Max(0.0, InBudgetMs) / 1000.0;
+}
+
+void FStoryFrameScheduler::AddTask(const TCHAR* Name, FSlicedTask Task)
+{
+	FTask& NewTask = Tasks.AddDefaulted_GetRef();
+	NewTask.Name = Name;
+	NewTask.Run = MoveTemp(Task);
+}
+
+bool FStoryFrameScheduler::HasTask(const TCHAR* Name) const
+{
+	return Tasks.ContainsByPredicate([Name](const FTask& Task) { return Task.Name == Name; });
+}
+
+void FStoryFrameScheduler::Tick()
+{
+	/**
+	 * # Function: Tick()
+	 *
+	 * ## Brief
+	 * Runs continuations of offloaded work and slices of the tasks until the frame budget is used.
+	 *
+	 * ## Details
+	 * Continuations run first, they finish work that is already paid for. Tasks are sliced round robin
+	 * so a long task (a large tracking sweep) does not starve the others.
+	 */
+	const double StartTime = FPlatformTime::Seconds();
+	const double EndTime = StartTime + BudgetSeconds;
+
+	TUniqueFunction<void()> Completion;
+	while (Completions->Dequeue(Completion))
+	{
+		Completion();
+		Stats.Completions++;
+		if (FPlatformTime::Seconds() >= EndTime)
+		{
+			break;
+		}
+	}
+
+	bool bRanSlice = false;
+	while (Tasks.Num() > 0 && (!bRanSlice || FPlatformTime::Seconds() < EndTime))
+	{
+		bRanSlice = true;
+		if (NextTask >= Tasks.Num())
+		{
+			NextTask = 0;
+		}
+
+		// The task may add tasks, so it is moved out while it runs
+		FSlicedTask Run = MoveTemp(Tasks[NextTask].Run);
+		bool bFinished = Run();
+		Stats.Slices++;
+
+		if (bFinished)
+		{
+			Tasks.RemoveAt(NextTask);
+		}
+		else
+		{
+			Tasks[NextTask].Run = MoveTemp(Run);
+			NextTask++;
+		}
+	}
+
+	const double FrameMs = (FPlatformTime::Seconds() - StartTime) * 1000.0;
+	Stats.Frames++;
+	Stats.TotalFrameMs += FrameMs;
+	Stats.MaxFrameMs = FMath::Max(Stats.MaxFrameMs, FrameMs);
+	if (FrameMs > BudgetSeconds * 1000.0)
+	{
+		Stats.FramesOverBudget++;
+	}
+}
+
+void FStoryFrameScheduler::Reset()
+{
+	/**
+	 * # Function: Reset()
+	 *
+	 * ## Brief
+	 * Drops all tasks and pending continuations. Offloaded work that is still running is discarded when it finishes.
+	 */
+	Tasks.Empty();
+	NextTask = 0;
+	Completions = MakeShared<FCompletionQueue, ESPMode::ThreadSafe>();
+}
+
+void FStoryFrameScheduler::LogStats() const
+{
+	UE_LOG(LogTemp, Log, TEXT("Story pipeline: %lld frames, avg %.3f ms, max %.3f ms, %lld over budget (%.3f ms), %lld slices, %lld continuations."),
+		Stats.Frames, Stats.GetAverageFrameMs(), Stats.MaxFrameMs, Stats.FramesOverBudget, BudgetSeconds * 1000.0, Stats.Slices, Stats.Completions);
+}
@@ -0,0 +1,69 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Async/Async.h"
+#include "Containers/Queue.h"
+
+/**
+ * Frame time counters of the story pipeline.
+ */
+struct FStoryFrameStats
+{
+	int64 Frames = 0;
+	int64 FramesOverBudget = 0;
+	int64 Slices = 0;
+	int64 Completions = 0;
+	double MaxFrameMs = 0.0;
+	double TotalFrameMs = 0.0;
+
+	double GetAverageFrameMs() const { return Frames > 0 ? TotalFrameMs / Frames : 0.0; }
+};
+
+/**
+ * Runs the game-thread work of the story pipeline in slices within a per-frame budget,
+ * and pure-data work on worker threads. See StoryFrameScheduler.cpp.
+ */
+class PROJECT_API FStoryFrameScheduler
+{
+public:
+	// Runs one slice of a task, returns true when the task is finished
+	typedef TUniqueFunction<bool()> FSlicedTask;
+
+	void SetBudget(double InBudgetMs);
+	void AddTask(const TCHAR* Name, FSlicedTask Task);
+	bool HasTask(const TCHAR* Name) const;
+	void Tick();
+	void Reset();
+
+	// Runs Work on a worker thread and OnGameThread with its result in a later Tick()
+	template<typename ResultType>
+	void Offload(TUniqueFunction<ResultType()>&& Work, TUniqueFunction<void(ResultType&)>&& OnGameThread)
+	{
+		TSharedRef<FCompletionQueue, ESPMode::ThreadSafe> Queue = Completions;
+		Async(EAsyncExecution::ThreadPool, [Queue, Work = MoveTemp(Work), OnGameThread = MoveTemp(OnGameThread)]() mutable
+		{
+			ResultType Result = Work();
+			Queue->Enqueue([Result = MoveTemp(Result), OnGameThread = MoveTemp(OnGameThread)]() mutable { OnGameThread(Result); });
+		});
+	}
+
+	const FStoryFrameStats& GetStats() const { return Stats; }
+	void LogStats() const;
+
+private:
+	typedef TQueue<TUniqueFunction<void()>, EQueueMode::Mpsc> FCompletionQueue;
+
+	struct FTask
+	{
+		FString Name;
+		FSlicedTask Run;
+	};
+
+	double BudgetSeconds = 0.002;
+	TArray<FTask> Tasks;
+	int32 NextTask = 0;
+	TSharedRef<FCompletionQueue, ESPMode::ThreadSafe> Completions = MakeShared<FCompletionQueue, ESPMode::ThreadSafe>();
+	FStoryFrameStats Stats;
+};
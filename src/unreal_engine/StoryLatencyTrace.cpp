@@ -0,0 +1,353 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "StoryLatencyTrace.h"
+#include "Dom/JsonObject.h"
+#include "Serialization/JsonWriter.h"
+#include "Serialization/JsonSerializer.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Paths.h"
+#include "Misc/DateTime.h"
+#include "Trace/Trace.inl"
+#include "ProfilingDebugging/MiscTrace.h"
+
+/**
+ * # File: StoryLatencyTrace.cpp
+ *
+ * ## Brief
+ * Implements the end-to-end latency tracing of the story events.
+ *
+ * ## Details
+ * The scheduler logs the latency of the requests, but not where the time between a movement and its narration
+ * on the HUD goes. Each event gets a trace id in `PublishEvent()` and a timestamp at every stage it reaches,
+ * see `EStoryLatencyStage`. An event batch is sent as one request, so from `Batched` on the stages are marked
+ * for the request (the `Scheduler` job id) and apply to all its events. The first timestamp of a stage is kept:
+ * a streamed narration is published with its first chunk, before the whole response is parsed.
+ *
+ * `Published` is the end of the trace: the narration is on the HUD of a local player, or sent to the owning client
+ * of a remote one. The time until a remote client shows it is not in the trace.
+ *
+ * The stages are emitted to two places:
+ * - **Unreal Insights**: a `StoryLatency.StageReached` event per stage on the `StoryLatency` channel, and a bookmark when
+ *   a request is published. Start the game with `-trace=default,StoryLatency` to record them.
+ * - **JSON trace file**: the closed events in the Chrome trace event format, written in `EndPlay()`. Opens in
+ *   Perfetto or `chrome://tracing`, one async track per event with a span per stage.
+ */
+
+#if UE_TRACE_ENABLED
+UE_TRACE_CHANNEL_DEFINE(StoryLatencyChannel)
+
+UE_TRACE_EVENT_BEGIN(StoryLatency, StageReached)
+	UE_TRACE_EVENT_FIELD(uint64, Cycle)
+	UE_TRACE_EVENT_FIELD(uint32, TraceId)
+	UE_TRACE_EVENT_FIELD(uint32, RequestId)
+	UE_TRACE_EVENT_FIELD(int32, PlayerIndex)
+	UE_TRACE_EVENT_FIELD(uint8, Stage)
+UE_TRACE_EVENT_END()
+#endif
+
+double FStoryLatencyRecord::GetStageSeconds(EStoryLatencyStage Stage) const
+{
+	if (Stage == EStoryLatencyStage::Detected || !HasStage(Stage))
+	{
+		return 0.0;
+	}
+
+	// Stages can be reached out of order (a streamed narration is published before it is parsed)
+	const double Reached = Seconds[(int32)Stage];
+	double Previous = 0.0;
+	for (int32 i = 0; i < (int32)EStoryLatencyStage::Count; i++)
+	{
+		if (Seconds[i] > 0.0 && (Seconds[i] < Reached || (Seconds[i] == Reached && i < (int32)Stage)))
+		{
+			Previous = FMath::Max(Previous, Seconds[i]);
+		}
+	}
+	return Previous > 0.0 ? Reached - Previous : 0.0;
+}
+
+double FStoryLatencyRecord::GetTotalSeconds() const
+{
+	if (!HasStage(EStoryLatencyStage::Detected) || !HasStage(EStoryLatencyStage::Published))
+	{
+		return 0.0;
+	}
+	return Seconds[(int32)EStoryLatencyStage::Published] - Seconds[(int32)EStoryLatencyStage::Detected];
+}
+
+uint32 FStoryLatencyTrace::BeginEvent(int32 PlayerIndex, double Seconds)
+{
+	/**
+	 * # Function: BeginEvent()
+	 *
+	 * ## Brief
+	 * Opens the record of a new event. At most `MaxOpenEvents` are open, the oldest is dropped to make room
+	 * (a request that was cancelled by the `Scheduler` never finishes its events).
+	 */
+	if (Open.Num() >= MaxOpenEvents)
+	{
+		uint32 Oldest = MAX_uint32;
+		for (const TPair<uint32, FStoryLatencyRecord>& Entry : Open)
+		{
+			Oldest = FMath::Min(Oldest, Entry.Key);
+		}
+		Open.Remove(Oldest);
+		Stats.Dropped++;
+	}
+
+	if (Origin == 0.0)
+	{
+		Origin = Seconds;
+	}
+
+	const uint32 TraceId = NextTraceId++;
+	FStoryLatencyRecord& Record = Open.Add(TraceId);
+	Record.TraceId = TraceId;
+	Record.PlayerIndex = PlayerIndex;
+	Mark(Record, EStoryLatencyStage::Detected, Seconds);
+	Stats.Events++;
+	return TraceId;
+}
+
+void FStoryLatencyTrace::MarkEvents(const TArray<uint32>& TraceIds, EStoryLatencyStage Stage, double Seconds)
+{
+	for (uint32 TraceId : TraceIds)
+	{
+		if (FStoryLatencyRecord* Record = Open.Find(TraceId))
+		{
+			Mark(*Record, Stage, Seconds);
+		}
+	}
+}
+
+void FStoryLatencyTrace::LinkRequest(uint32 RequestId, const TArray<uint32>& TraceIds)
+{
+	if (RequestId == 0 || TraceIds.Num() == 0)
+	{
+		return;
+	}
+	if (Requests.Num() >= MaxOpenEvents)
+	{
+		uint32 Oldest = MAX_uint32;
+		for (const TPair<uint32, TArray<uint32>>& Entry : Requests)
+		{
+			Oldest = FMath::Min(Oldest, Entry.Key);
+		}
+		Requests.Remove(Oldest);
+	}
+
+	for (uint32 TraceId : TraceIds)
+	{
+		if (FStoryLatencyRecord* Record = Open.Find(TraceId))
+		{
+			Record->RequestId = RequestId;
+		}
+	}
+	Requests.FindOrAdd(RequestId).Append(TraceIds);
+}
+
+void FStoryLatencyTrace::MarkRequest(uint32 RequestId, EStoryLatencyStage Stage, double Seconds)
+{
+	if (const TArray<uint32>* TraceIds = Requests.Find(RequestId))
+	{
+		MarkEvents(*TraceIds, Stage, Seconds);
+	}
+}
+
+void FStoryLatencyTrace::FinishRequest(uint32 RequestId)
+{
+	TArray<uint32> TraceIds;
+	if (!Requests.RemoveAndCopyValue(RequestId, TraceIds))
+	{
+		return;
+	}
+
+#if UE_TRACE_ENABLED
+	double Slowest = 0.0;
+	for (uint32 TraceId : TraceIds)
+	{
+		if (const FStoryLatencyRecord* Record = Open.Find(TraceId))
+		{
+			Slowest = FMath::Max(Slowest, Record->GetTotalSeconds());
+		}
+	}
+	if (Slowest > 0.0)
+	{
+		TRACE_BOOKMARK(TEXT("Narration %u published, %d events, %.1f ms after the first movement"), RequestId, TraceIds.Num(), Slowest * 1000.0);
+	}
+#endif
+
+	FinishEvents(TraceIds);
+}
+
+void FStoryLatencyTrace::FinishEvents(const TArray<uint32>& TraceIds)
+{
+	for (uint32 TraceId : TraceIds)
+	{
+		Close(TraceId);
+	}
+}
+
+void FStoryLatencyTrace::Mark(FStoryLatencyRecord& Record, EStoryLatencyStage Stage, double Seconds)
+{
+	if (Record.HasStage(Stage))
+	{
+		return;
+	}
+	Record.Seconds[(int32)Stage] = Seconds;
+
+#if UE_TRACE_ENABLED
+	UE_TRACE_LOG(StoryLatency, StageReached, StoryLatencyChannel)
+		<< StageReached.Cycle(uint64(Seconds / FPlatformTime::GetSecondsPerCycle64()))
+		<< StageReached.TraceId(Record.TraceId)
+		<< StageReached.RequestId(Record.RequestId)
+		<< StageReached.PlayerIndex(Record.PlayerIndex)
+		<< StageReached.Stage(uint8(Stage));
+#endif
+}
+
+void FStoryLatencyTrace::Close(uint32 TraceId)
+{
+	/**
+	 * # Function: Close()
+	 *
+	 * ## Brief
+	 * Moves an open event to the `Records` of the trace file and adds its stage times to the `Stats`.
+	 */
+	FStoryLatencyRecord Record;
+	if (!Open.RemoveAndCopyValue(TraceId, Record))
+	{
+		return;
+	}
+
+	for (int32 i = 1; i < (int32)EStoryLatencyStage::Count; i++)
+	{
+		if (Record.Seconds[i] > 0.0)
+		{
+			Stats.StageCount[i]++;
+			Stats.StageSeconds[i] += Record.GetStageSeconds((EStoryLatencyStage)i);
+		}
+	}
+	if (Record.HasStage(EStoryLatencyStage::Published))
+	{
+		const double Total = Record.GetTotalSeconds();
+		Stats.Published++;
+		Stats.TotalSeconds += Total;
+		Stats.MaxTotalSeconds = FMath::Max(Stats.MaxTotalSeconds, Total);
+	}
+
+	if (Records.Num() < MaxRecords)
+	{
+		Records.Add(Record);
+	}
+}
+
+const TCHAR* FStoryLatencyTrace::StageToString(EStoryLatencyStage Stage)
+{
+	switch (Stage)
+	{
+	case EStoryLatencyStage::Detected:	return TEXT("Detected");
+	case EStoryLatencyStage::Batched:	return TEXT("Batched");
+	case EStoryLatencyStage::Serialized:	return TEXT("Serialized");
+	case EStoryLatencyStage::HttpSent:	return TEXT("HttpSent");
+	case EStoryLatencyStage::FirstByte:	return TEXT("FirstByte");
+	case EStoryLatencyStage::Parsed:	return TEXT("Parsed");
+	case EStoryLatencyStage::Published:	return TEXT("Published");
+	default:				return TEXT("Unknown");
+	}
+}
+
+FString FStoryLatencyTrace::ToTraceJson() const
+{
+	/**
+	 * # Function: ToTraceJson()
+	 *
+	 * ## Brief
+	 * Writes the closed events as nestable async events (`b`/`e`) of the Chrome trace event format.
+	 *
+	 * ## Details
+	 * Each event is one track (`id` is the trace id) with a `Story event` span from the first to the last stage
+	 * it reached. Inside it one span per reached stage, named after the stage and ending when the stage was reached.
+	 * Timestamps are microseconds since the first traced event, `tid` is the player index.
+	 */
+	TArray<TSharedPtr<FJsonValue>> TraceEvents;
+	auto AddEvent = [this, &TraceEvents](const FStoryLatencyRecord& Record, const TCHAR* Name, const TCHAR* Phase, double Seconds)
+	{
+		TSharedPtr<FJsonObject> Event = MakeShareable(new FJsonObject());
+		Event->SetStringField(TEXT("name"), Name);
+		Event->SetStringField(TEXT("cat"), TEXT("story"));
+		Event->SetStringField(TEXT("ph"), Phase);
+		Event->SetNumberField(TEXT("ts"), FMath::RoundToDouble((Seconds - Origin) * 1000000.0));
+		Event->SetNumberField(TEXT("pid"), 1);
+		Event->SetNumberField(TEXT("tid"), Record.PlayerIndex);
+		Event->SetStringField(TEXT("id"), FString::Printf(TEXT("0x%x"), Record.TraceId));
+
+		TSharedPtr<FJsonObject> Args = MakeShareable(new FJsonObject());
+		Args->SetNumberField(TEXT("trace_id"), Record.TraceId);
+		Args->SetNumberField(TEXT("request_id"), Record.RequestId);
+		Event->SetObjectField(TEXT("args"), Args);
+		TraceEvents.Add(MakeShareable(new FJsonValueObject(Event)));
+	};
+
+	for (const FStoryLatencyRecord& Record : Records)
+	{
+		double Last = Record.Seconds[(int32)EStoryLatencyStage::Detected];
+		for (double Seconds : Record.Seconds)
+		{
+			Last = FMath::Max(Last, Seconds);
+		}
+
+		AddEvent(Record, TEXT("Story event"), TEXT("b"), Record.Seconds[(int32)EStoryLatencyStage::Detected]);
+		for (int32 i = 1; i < (int32)EStoryLatencyStage::Count; i++)
+		{
+			const double StageSeconds = Record.GetStageSeconds((EStoryLatencyStage)i);
+			if (StageSeconds > 0.0)
+			{
+				const TCHAR* Name = StageToString((EStoryLatencyStage)i);
+				AddEvent(Record, Name, TEXT("b"), Record.Seconds[i] - StageSeconds);
+				AddEvent(Record, Name, TEXT("e"), Record.Seconds[i]);
+			}
+		}
+		AddEvent(Record, TEXT("Story event"), TEXT("e"), Last);
+	}
+
+	TSharedPtr<FJsonObject> Root = MakeShareable(new FJsonObject());
+	Root->SetStringField(TEXT("displayTimeUnit"), TEXT("ms"));
+	Root->SetArrayField(TEXT("traceEvents"), TraceEvents);
+
+	FString Output;
+	TSharedRef<TJsonWriter<TCHAR, TCondensedJsonPrintPolicy<TCHAR>>> Writer = TJsonWriterFactory<TCHAR, TCondensedJsonPrintPolicy<TCHAR>>::Create(&Output);
+	FJsonSerializer::Serialize(Root.ToSharedRef(), Writer);
+	return Output;
+}
+
+bool FStoryLatencyTrace::WriteTraceFile(const FString& FilePath) const
+{
+	if (Records.Num() == 0)
+	{
+		return false;
+	}
+	if (!FFileHelper::SaveStringToFile(ToTraceJson(), *FilePath))
+	{
+		UE_LOG(LogTemp, Error, TEXT("Failed to write story latency trace: %s"), *FilePath);
+		return false;
+	}
+	UE_LOG(LogTemp, Log, TEXT("Story latency trace of %d events written to %s"), Records.Num(), *FilePath);
+	return true;
+}
+
+FString FStoryLatencyTrace::GetDefaultTraceFilePath() const
+{
+	return FPaths::ProjectSavedDir() / TEXT("Traces") / FString::Printf(TEXT("StoryLatency_%s.json"), *FDateTime::Now().ToString(TEXT("%Y%m%d_%H%M%S")));
+}
+
+void FStoryLatencyTrace::LogStats() const
+{
+	UE_LOG(LogTemp, Log, TEXT("Story latency: %lld events, %lld published, avg %.1f ms, max %.1f ms from movement to publication, %lld dropped."),
+		Stats.Events, Stats.Published, Stats.GetAverageTotalMs(), Stats.MaxTotalSeconds * 1000.0, Stats.Dropped);
+	for (int32 i = 1; i < (int32)EStoryLatencyStage::Count; i++)
+	{
+		UE_LOG(LogTemp, Log, TEXT("  %-10s avg %.1f ms (%lld events)"),
+			StageToString((EStoryLatencyStage)i), Stats.GetAverageStageMs((EStoryLatencyStage)i), Stats.StageCount[i]);
+	}
+}
@@ -0,0 +1,99 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+/**
+ * Stages of a story event, from the movement to the published narration. All stages are stamped on the machine that
+ * runs the story pipeline, the server with `bServerAuthoritativeStory`.
+ */
+enum class EStoryLatencyStage : uint8
+{
+	Detected,	// Movement found by the tracking, see PublishEvent()
+	Batched,	// Event batch submitted to the Scheduler, see SendPayload()
+	Serialized,	// Payload built and serialized on a worker thread
+	HttpSent,	// ProcessRequest() called
+	FirstByte,	// First part of the response received
+	Parsed,		// Response parsed in OnResponseReceived()
+	Published,	// Narration (or its first streamed chunk) broadcast to the local HUD and handed to replication. The transit
+			// to a remote owning client and its HUD are not traced, the client has no trace and another clock
+	Count
+};
+
+/**
+ * Timestamps of one story event. Zero for the stages it did not reach.
+ */
+struct FStoryLatencyRecord
+{
+	uint32 TraceId = 0;
+	uint32 RequestId = 0;
+	int32 PlayerIndex = 0;
+	double Seconds[(int32)EStoryLatencyStage::Count] = {};
+
+	bool HasStage(EStoryLatencyStage Stage) const { return Seconds[(int32)Stage] > 0.0; }
+	// Time since the stage reached last before this one, 0 if the stage was not reached
+	double GetStageSeconds(EStoryLatencyStage Stage) const;
+	double GetTotalSeconds() const;
+};
+
+/**
+ * Latency counters of the traced events.
+ */
+struct FStoryLatencyStats
+{
+	int64 Events = 0;
+	int64 Published = 0;
+	int64 Dropped = 0;
+	int64 StageCount[(int32)EStoryLatencyStage::Count] = {};
+	double StageSeconds[(int32)EStoryLatencyStage::Count] = {};
+	double TotalSeconds = 0.0;
+	double MaxTotalSeconds = 0.0;
+
+	double GetAverageStageMs(EStoryLatencyStage Stage) const { return StageCount[(int32)Stage] > 0 ? StageSeconds[(int32)Stage] * 1000.0 / StageCount[(int32)Stage] : 0.0; }
+	double GetAverageTotalMs() const { return Published > 0 ? TotalSeconds * 1000.0 / Published : 0.0; }
+};
+
+/**
+ * Traces each story event through the pipeline and emits the stages to Unreal Insights and a JSON trace file.
+ * Game thread only. See StoryLatencyTrace.cpp.
+ */
+class PROJECT_API FStoryLatencyTrace
+{
+public:
+	// Starts tracing an event at Detected and returns its trace id
+	uint32 BeginEvent(int32 PlayerIndex, double Seconds = FPlatformTime::Seconds());
+	void MarkEvents(const TArray<uint32>& TraceIds, EStoryLatencyStage Stage, double Seconds = FPlatformTime::Seconds());
+	// The events are sent with the request RequestId from now on
+	void LinkRequest(uint32 RequestId, const TArray<uint32>& TraceIds);
+	void MarkRequest(uint32 RequestId, EStoryLatencyStage Stage, double Seconds = FPlatformTime::Seconds());
+	// Closes the events of the request, also when it failed
+	void FinishRequest(uint32 RequestId);
+	// Closes events that were narrated without a request (response cache)
+	void FinishEvents(const TArray<uint32>& TraceIds);
+
+	static const TCHAR* StageToString(EStoryLatencyStage Stage);
+
+	// Closed events in the Chrome trace event format, one span per stage
+	FString ToTraceJson() const;
+	bool WriteTraceFile(const FString& FilePath) const;
+	FString GetDefaultTraceFilePath() const;
+
+	const TArray<FStoryLatencyRecord>& GetRecords() const { return Records; }
+	const FStoryLatencyStats& GetStats() const { return Stats; }
+	void LogStats() const;
+
+	int32 MaxOpenEvents = 1024;
+	int32 MaxRecords = 8192;
+
+private:
+	void Mark(FStoryLatencyRecord& Record, EStoryLatencyStage Stage, double Seconds);
+	void Close(uint32 TraceId);
+
+	TMap<uint32, FStoryLatencyRecord> Open;
+	TMap<uint32, TArray<uint32>> Requests;
+	TArray<FStoryLatencyRecord> Records;
+	FStoryLatencyStats Stats;
+	uint32 NextTraceId = 1;
+	double Origin = 0.0;
+};
@@ -0,0 +1,210 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "StoryNarrationChannel.h"
+#include "GameStateStoryGen.h"
+#include "GameFramework/PlayerController.h"
+#include "Net/UnrealNetwork.h"
+
+/**
+ * # File: StoryNarrationChannel.cpp
+ *
+ * ## Brief
+ * Implements the per-player delivery of narrations from the server to the clients.
+ *
+ * ## Details
+ * With `bServerAuthoritativeStory` only the server talks to the LLM. Each remote player gets a channel on its
+ * PlayerController, and its narrations are sent with Client RPCs of that channel. A PlayerController only exists
+ * on the server and its owning client, so no client receives (or pays for) the narrations of the other players.
+ *
+ * Every channel has its own `FNarrationReplicationCodec`. The codec of the server and the one of the owning client
+ * see the same messages in the same order, so their phrase dictionaries stay the same. Phrases announced on one
+ * channel are unknown on the others.
+ *
+ * The channel is added to the controller while the game runs, and a Client RPC of a component the client has not
+ * created yet is lost. The server holds the encoded messages back until the client's channel calls
+ * `ServerChannelReady()` from its `BeginPlay()`, then sends them in order.
+ *
+ * A client can miss announcements: its channel replicates after the first messages were sent, or it joins while
+ * a narration is streamed. Whenever a message grows the dictionary the server rewrites `NarrationSnapshot`, an
+ * owner-only property with the announced phrases, and the client merges it, see `OnRep_NarrationSnapshot()`.
+ */
+
+UStoryNarrationChannel::UStoryNarrationChannel()
+{
+	PrimaryComponentTick.bCanEverTick = false;
+	SetIsReplicatedByDefault(true);
+}
+
+UStoryNarrationChannel* UStoryNarrationChannel::FindOrAdd(APlayerController* Controller, const FNarrationReplicationCodec& Codec)
+{
+	/**
+	 * # Function: FindOrAdd()
+	 *
+	 * ## Brief
+	 * Returns the channel of a PlayerController, and adds one on the server if it has none yet.
+	 *
+	 * ## Details
+	 * The channel starts with a copy of `Codec`: the built-in phrases of the dictionary and the candidate phrases
+	 * of the level. The channel on the client is created by replication and its codec is not replicated: it starts
+	 * with the built-in phrases only. Candidate phrases stay on the server, each is announced the first time
+	 * a narration of the channel uses it.
+	 */
+	if (!Controller)
+	{
+		return nullptr;
+	}
+
+	UStoryNarrationChannel* Channel = Controller->FindComponentByClass<UStoryNarrationChannel>();
+	if (!Channel && Controller->HasAuthority())
+	{
+		Channel = NewObject<UStoryNarrationChannel>(Controller);
+		Channel->Codec = Codec;
+		Channel->RegisterComponent();
+	}
+	return Channel;
+}
+
+int32 UStoryNarrationChannel::SendNarration(int32 PlayerId, uint32 StreamId, const FString& Narration, bool bStreamed)
+{
+	const int32 PreviousPhrases = Codec.NumPhrases();
+	TArray<uint8> Encoded;
+	if (!bStreamed)
+	{
+		Codec.Encode(Narration, Encoded);
+	}
+	const int32 Bytes = FNarrationReplicationCodec::GetMessageBytes(Encoded.Num());
+	SendMessage(PlayerId, bStreamed ? StreamId : 0, MoveTemp(Encoded), false);
+	UpdateSnapshot(PreviousPhrases);
+	return Bytes;
+}
+
+int32 UStoryNarrationChannel::SendNarrationDelta(int32 PlayerId, uint32 StreamId, const FString& Chunk)
+{
+	const int32 PreviousPhrases = Codec.NumPhrases();
+	TArray<uint8> Delta;
+	Codec.Encode(Chunk, Delta);
+	const int32 Bytes = FNarrationReplicationCodec::GetMessageBytes(Delta.Num());
+	SendMessage(PlayerId, StreamId, MoveTemp(Delta), true);
+	UpdateSnapshot(PreviousPhrases);
+	return Bytes;
+}
+
+void UStoryNarrationChannel::SendMessage(int32 PlayerId, uint32 StreamId, TArray<uint8>&& Data, bool bDelta)
+{
+	if (!bClientReady)
+	{
+		QueuedMessages.Add({ PlayerId, StreamId, MoveTemp(Data), bDelta });
+		return;
+	}
+
+	if (bDelta)
+	{
+		ClientNarrationDelta(PlayerId, StreamId, Data);
+	}
+	else
+	{
+		ClientNarration(PlayerId, StreamId, Data);
+	}
+}
+
+void UStoryNarrationChannel::BeginPlay()
+{
+	Super::BeginPlay();
+
+	// The server created the channel, the client's copy exists once it begins play
+	if (GetOwnerRole() != ROLE_Authority)
+	{
+		ServerChannelReady();
+	}
+}
+
+void UStoryNarrationChannel::ServerChannelReady_Implementation()
+{
+	/**
+	 * # Function: ServerChannelReady()
+	 *
+	 * ## Brief
+	 * Sends the messages held back while the client's channel did not exist, in the order they were encoded.
+	 */
+	bClientReady = true;
+	TArray<FQueuedMessage> Messages = MoveTemp(QueuedMessages);
+	for (FQueuedMessage& Message : Messages)
+	{
+		SendMessage(Message.PlayerId, Message.StreamId, MoveTemp(Message.Data), Message.bDelta);
+	}
+}
+
+void UStoryNarrationChannel::UpdateSnapshot(int32 PreviousPhrases)
+{
+	if (Codec.NumPhrases() != PreviousPhrases)
+	{
+		Codec.WriteSnapshot({}, NarrationSnapshot);
+	}
+}
+
+void UStoryNarrationChannel::OnRep_NarrationSnapshot()
+{
+	/**
+	 * # Function: OnRep_NarrationSnapshot()
+	 *
+	 * ## Brief
+	 * Adds the phrases the client missed to its dictionary.
+	 *
+	 * ## Details
+	 * The snapshot may arrive before or after the messages that announced its phrases, both orders give the
+	 * dictionary of the server. A message using a phrase whose announcement and snapshot did not arrive yet
+	 * cannot be decoded and is dropped.
+	 */
+	TMap<int32, FString> LatestNarrations;
+	if (!Codec.ReadSnapshot(NarrationSnapshot, LatestNarrations))
+	{
+		UE_LOG(LogTemp, Error, TEXT("Could not read the narration snapshot."));
+	}
+}
+
+void UStoryNarrationChannel::GetLifetimeReplicatedProps(TArray<FLifetimeProperty>& OutLifetimeProps) const
+{
+	Super::GetLifetimeReplicatedProps(OutLifetimeProps);
+
+	DOREPLIFETIME_CONDITION(UStoryNarrationChannel, NarrationSnapshot, COND_OwnerOnly);
+}
+
+void UStoryNarrationChannel::ClientNarration_Implementation(int32 PlayerId, uint32 StreamId, const TArray<uint8>& Narration)
+{
+	/**
+	 * # Function: ClientNarration()
+	 *
+	 * ## Brief
+	 * Decodes a narration on the owning client and publishes it, see `AGameStateStoryGen::ReceiveNarration()`.
+	 *
+	 * ## Details
+	 * The message is decoded even if the game state has not replicated yet, so the dictionary stays in step with the server.
+	 */
+	FString Text;
+	if (Narration.Num() > 0 && !Codec.Decode(Narration, Text))
+	{
+		UE_LOG(LogTemp, Error, TEXT("Could not decode the narration of player %d."), PlayerId);
+		return;
+	}
+
+	if (AGameStateStoryGen* GameState = GetWorld() ? GetWorld()->GetGameState<AGameStateStoryGen>() : nullptr)
+	{
+		GameState->ReceiveNarration(PlayerId, StreamId, Text);
+	}
+}
+
+void UStoryNarrationChannel::ClientNarrationDelta_Implementation(int32 PlayerId, uint32 StreamId, const TArray<uint8>& Delta)
+{
+	FString Chunk;
+	if (!Codec.Decode(Delta, Chunk))
+	{
+		UE_LOG(LogTemp, Error, TEXT("Could not decode a narration chunk of player %d."), PlayerId);
+		return;
+	}
+
+	if (AGameStateStoryGen* GameState = GetWorld() ? GetWorld()->GetGameState<AGameStateStoryGen>() : nullptr)
+	{
+		GameState->ReceiveNarrationChunk(PlayerId, StreamId, Chunk);
+	}
+}
@@ -0,0 +1,80 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Components/ActorComponent.h"
+#include "NarrationReplication.h"
+#include "StoryNarrationChannel.generated.h"
+
+class APlayerController;
+
+/**
+ * Narration channel of one remote player: the server sends the player's narrations to the owning connection only.
+ * Added to the player's PlayerController. See StoryNarrationChannel.cpp.
+ */
+UCLASS()
+class PROJECT_API UStoryNarrationChannel : public UActorComponent
+{
+	GENERATED_BODY()
+
+public:
+	UStoryNarrationChannel();
+
+	// Server: the channel of the controller, added on first use with a copy of Codec (the candidate phrases of the level)
+	static UStoryNarrationChannel* FindOrAdd(APlayerController* Controller, const FNarrationReplicationCodec& Codec);
+
+	// Server: a phrase of a tracked object added after the channel was opened
+	void AddCandidatePhrase(const FString& Phrase) { Codec.AddCandidatePhrase(Phrase); }
+
+	// Server: encode with the dictionary of this channel and send to the owning client. Return the bytes sent.
+	int32 SendNarration(int32 PlayerId, uint32 StreamId, const FString& Narration, bool bStreamed);
+	int32 SendNarrationDelta(int32 PlayerId, uint32 StreamId, const FString& Chunk);
+
+	// Narration of the player PlayerId. Narration is empty if it was sent piece by piece with ClientNarrationDelta already.
+	UFUNCTION(Client, Reliable)
+	void ClientNarration(int32 PlayerId, uint32 StreamId, const TArray<uint8>& Narration);
+
+	UFUNCTION(Client, Reliable)
+	void ClientNarrationDelta(int32 PlayerId, uint32 StreamId, const TArray<uint8>& Delta);
+
+	// Client: the channel replicated, messages sent from now on reach it
+	UFUNCTION(Server, Reliable)
+	void ServerChannelReady();
+
+	// Server: messages held back until the client's channel is ready
+	int32 NumQueuedMessages() const { return QueuedMessages.Num(); }
+	int32 NumPhrases() const { return Codec.NumPhrases(); }
+
+	virtual void BeginPlay() override;
+	virtual void GetLifetimeReplicatedProps(TArray<FLifetimeProperty>& OutLifetimeProps) const override;
+
+private:
+	struct FQueuedMessage
+	{
+		int32 PlayerId = 0;
+		uint32 StreamId = 0;
+		TArray<uint8> Data;
+		bool bDelta = false;
+	};
+
+	// Server: sends the message now, or queues it while the client's channel is not ready
+	void SendMessage(int32 PlayerId, uint32 StreamId, TArray<uint8>&& Data, bool bDelta);
+
+	// Server: rewrites the snapshot if the last message announced phrases
+	void UpdateSnapshot(int32 PreviousPhrases);
+
+	// Phrase dictionary of the server and the owning client only. On the client it starts with the built-in phrases.
+	FNarrationReplicationCodec Codec;
+
+	// Server: encoded messages in the order they were encoded, see ServerChannelReady()
+	TArray<FQueuedMessage> QueuedMessages;
+	bool bClientReady = false;
+
+	// Announced phrases of the dictionary, rewritten whenever it grows, for a client that missed announcements
+	UPROPERTY(ReplicatedUsing = OnRep_NarrationSnapshot)
+	TArray<uint8> NarrationSnapshot;
+
+	UFUNCTION()
+	void OnRep_NarrationSnapshot();
+};
@@ -0,0 +1,132 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "StoryNumberFormat.h"
+
+/**
+ * # File: StoryNumberFormat.cpp
+ *
+ * ## Brief
+ * Implements the precision policy for numbers in the scene payloads.
+ *
+ * ## Details
+ * `SetNumberField()` stores a double, and the JSON writer prints it with 17 significant digits: a position like
+ * `1234.56789012` costs more bytes and tokens than the object name, and the model cannot use the digits.
+ * - The precision rounds positions, sizes and distances to whole centimetres or one decimal.
+ * - `FormatFixed()` writes the rounded value from an integer, digit by digit, instead of going through printf.
+ * - `MakeNumber()` keeps that text in an `FJsonValueNumberString`, which the JSON writer copies as a number.
+ */
+
+static constexpr int32 MaxDecimals = 6;
+
+// Largest integer a double holds exactly, larger values go through printf
+static constexpr double MaxExactInteger = 9007199254740992.0;
+
+static constexpr double PowersOfTen[MaxDecimals + 1] = { 1.0, 10.0, 100.0, 1000.0, 10000.0, 100000.0, 1000000.0 };
+
+int32 FStoryNumberFormat::GetDecimals(EStoryNumberPrecision Precision)
+{
+	switch (Precision)
+	{
+	case EStoryNumberPrecision::Centimetre:
+		return 0;
+	case EStoryNumberPrecision::OneDecimal:
+		return 1;
+	default:
+		return INDEX_NONE;
+	}
+}
+
+double FStoryNumberFormat::Quantize(double Value, EStoryNumberPrecision Precision)
+{
+	const int32 Decimals = GetDecimals(Precision);
+	if (Decimals == INDEX_NONE)
+	{
+		return Value;
+	}
+	return FMath::RoundToDouble(Value * PowersOfTen[Decimals]) / PowersOfTen[Decimals];
+}
+
+int32 FStoryNumberFormat::FormatFixed(double Value, int32 Decimals, TCHAR (&Buffer)[MaxFixedLength])
+{
+	/**
+	 * # Function: FormatFixed()
+	 *
+	 * ## Brief
+	 * Writes a rounded number as decimal text, `1234.56789` with one decimal becomes `1234.6`.
+	 *
+	 * ## Details
+	 * The value is scaled and rounded to an integer once, the digits are then taken from the integer.
+	 * Trailing zeros of the fraction are dropped, `75.0` is written as `75`. Values that are not finite are written as `0`.
+	 */
+	Decimals = FMath::Clamp(Decimals, 0, MaxDecimals);
+	const double Scaled = FMath::RoundToDouble(Value * PowersOfTen[Decimals]);
+	if (!FMath::IsFinite(Scaled))
+	{
+		Buffer[0] = TEXT('0');
+		Buffer[1] = TEXT('\0');
+		return 1;
+	}
+	if (FMath::Abs(Scaled) >= MaxExactInteger)
+	{
+		return FCString::Snprintf(Buffer, MaxFixedLength, TEXT("%.17g"), Value);
+	}
+
+	const int64 Fixed = (int64)Scaled;
+	uint64 Magnitude = Fixed < 0 ? uint64(-Fixed) : uint64(Fixed);
+	while (Decimals > 0 && Magnitude % 10 == 0)
+	{
+		Magnitude /= 10;
+		Decimals--;
+	}
+
+	// Digits from the last one, at least one before the decimal point
+	TCHAR Digits[24];
+	int32 NumDigits = 0;
+	do
+	{
+		Digits[NumDigits++] = TCHAR(TEXT('0') + Magnitude % 10);
+		Magnitude /= 10;
+	} while (Magnitude > 0 || NumDigits <= Decimals);
+
+	int32 Length = 0;
+	if (Fixed < 0)
+	{
+		Buffer[Length++] = TEXT('-');
+	}
+	for (int32 i = NumDigits - 1; i >= 0; i--)
+	{
+		if (i == Decimals - 1)
+		{
+			Buffer[Length++] = TEXT('.');
+		}
+		Buffer[Length++] = Digits[i];
+	}
+	Buffer[Length] = TEXT('\0');
+	return Length;
+}
+
+void FStoryNumberFormat::AppendFixed(double Value, int32 Decimals, FString& Out)
+{
+	TCHAR Buffer[MaxFixedLength];
+	const int32 Length = FormatFixed(Value, Decimals, Buffer);
+	Out.AppendChars(Buffer, Length);
+}
+
+TSharedPtr<FJsonValue> FStoryNumberFormat::MakeNumber(double Value, EStoryNumberPrecision Precision)
+{
+	const int32 Decimals = GetDecimals(Precision);
+	if (Decimals == INDEX_NONE)
+	{
+		return MakeShareable(new FJsonValueNumber(Value));
+	}
+
+	TCHAR Buffer[MaxFixedLength];
+	const int32 Length = FormatFixed(Value, Decimals, Buffer);
+	return MakeShareable(new FJsonValueNumberString(FString(Length, Buffer)));
+}
+
+void FStoryNumberFormat::SetNumberField(FJsonObject& Object, const FString& Field, double Value, EStoryNumberPrecision Precision)
+{
+	Object.SetField(Field, MakeNumber(Value, Precision));
+}
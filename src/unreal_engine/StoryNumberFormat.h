@@ -0,0 +1,41 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Dom/JsonObject.h"
+#include "Dom/JsonValue.h"
+#include "StoryNumberFormat.generated.h"
+
+/**
+ * Precision of the positions, sizes and distances written into the scene payloads.
+ */
+UENUM(BlueprintType)
+enum class EStoryNumberPrecision : uint8
+{
+	Full,			// All digits of the double
+	Centimetre,		// Whole Unreal units
+	OneDecimal,		// Millimetres
+};
+
+/**
+ * Rounds scene numbers to a precision and formats them as short fixed-point text.
+ * See StoryNumberFormat.cpp.
+ */
+class PROJECT_API FStoryNumberFormat
+{
+public:
+	// Longest text written by FormatFixed(), sign and terminator included
+	static constexpr int32 MaxFixedLength = 32;
+
+	static int32 GetDecimals(EStoryNumberPrecision Precision);
+	static double Quantize(double Value, EStoryNumberPrecision Precision);
+
+	// Writes Value with at most Decimals (0-6) decimals, without trailing zeros. Returns the length.
+	static int32 FormatFixed(double Value, int32 Decimals, TCHAR (&Buffer)[MaxFixedLength]);
+	static void AppendFixed(double Value, int32 Decimals, FString& Out);
+
+	// JSON number that is written with the digits of the precision only
+	static TSharedPtr<FJsonValue> MakeNumber(double Value, EStoryNumberPrecision Precision);
+	static void SetNumberField(FJsonObject& Object, const FString& Field, double Value, EStoryNumberPrecision Precision);
+};
@@ -0,0 +1,186 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "StoryPromptBuilder.h"
+#include "Serialization/JsonWriter.h"
+#include "Serialization/JsonSerializer.h"
+#include "Policies/CondensedJsonPrintPolicy.h"
+
+/**
+ * # File: StoryPromptBuilder.cpp
+ *
+ * ## Brief
+ * Implements the message layout for the story requests.
+ *
+ * ## Details
+ * Providers with prompt caching only reuse a prefix that is byte-identical between requests.
+ * The messages are therefore ordered as:
+ * 1. **System**: the story instructions.
+ * 2. **System**: `Start_environment`, serialized once per session.
+ * 3. **System**: `Story_Synopsis`, only changes when the summarizer finishes a compaction.
+ * 4. **User**: the volatile data (`Current_environment`, `Event_History`, `Old_AI_Responses`).
+ *
+ * The static parts are kept as serialized strings so they are never re-serialized differently.
+ *
+ * The scene data is written as condensed JSON or, for local models, in the compact encoding of `FStorySceneEncoder`.
+ * The compact encoding appends its legend to the instructions so the prefix stays stable.
+ */
+
+void FStoryPromptBuilder::SetInstructions(const FString& InInstructions)
+{
+	/**
+	 * # Function: SetInstructions()
+	 *
+	 * ## Brief
+	 * Sets the system message holding the story instructions.
+	 */
+	Instructions = InInstructions;
+}
+
+void FStoryPromptBuilder::SetStartEnvironment(const TSharedPtr<FJsonObject>& InStartEnvironment)
+{
+	/**
+	 * # Function: SetStartEnvironment()
+	 *
+	 * ## Brief
+	 * Serializes the start environment once. The string is reused for every request of the session.
+	 */
+	StartEnvironment = InStartEnvironment;
+	StartEnvironmentContent.Empty();
+	if (StartEnvironment.IsValid())
+	{
+		StartEnvironmentContent = TEXT("Start_environment: ") + SerializeScene(StartEnvironment);
+	}
+}
+
+void FStoryPromptBuilder::SetSynopsis(const FString& InSynopsis)
+{
+	/**
+	 * # Function: SetSynopsis()
+	 *
+	 * ## Brief
+	 * Updates the synopsis message. The synopsis only changes when a compaction has finished,
+	 * so the prefix stays the same between those requests.
+	 */
+	SynopsisContent = InSynopsis.IsEmpty() ? FString() : TEXT("Story_Synopsis: ") + InSynopsis;
+}
+
+void FStoryPromptBuilder::SetSceneEncoding(EStorySceneEncoding InEncoding, const FStorySceneEncodingOptions& InOptions)
+{
+	/**
+	 * # Function: SetSceneEncoding()
+	 *
+	 * ## Brief
+	 * Selects how scene data is written. The start environment is serialized again in the new encoding.
+	 */
+	SceneEncoding = InEncoding;
+	SceneOptions = InOptions;
+	SetStartEnvironment(StartEnvironment);
+}
+
+FString FStoryPromptBuilder::SerializeScene(const TSharedPtr<FJsonObject>& JsonObject) const
+{
+	if (SceneEncoding == EStorySceneEncoding::Compact)
+	{
+		return FStorySceneEncoder::Encode(JsonObject, SceneOptions);
+	}
+	return SerializeCondensed(JsonObject);
+}
+
+TArray<TSharedPtr<FJsonValue>> FStoryPromptBuilder::BuildMessages(const TSharedPtr<FJsonObject>& VolatileContent) const
+{
+	/**
+	 * # Function: BuildMessages()
+	 *
+	 * ## Brief
+	 * Returns the `messages` array for a chat completion request.
+	 *
+	 * ## Details
+	 * The static messages are added first, in a fixed order. The volatile content is serialized
+	 * into the last user message without any extra quoting.
+	 */
+	TArray<TSharedPtr<FJsonValue>> MessagesArray;
+	MessagesArray.Add(MakeMessage(TEXT("system"), SceneEncoding == EStorySceneEncoding::Compact
+		? Instructions + TEXT("\n") + FStorySceneEncoder::GetLegend() : Instructions));
+
+	if (!StartEnvironmentContent.IsEmpty())
+	{
+		MessagesArray.Add(MakeMessage(TEXT("system"), StartEnvironmentContent));
+	}
+	if (!SynopsisContent.IsEmpty())
+	{
+		MessagesArray.Add(MakeMessage(TEXT("system"), SynopsisContent));
+	}
+
+	if (VolatileContent.IsValid())
+	{
+		MessagesArray.Add(MakeMessage(TEXT("user"), SerializeScene(VolatileContent)));
+	}
+	return MessagesArray;
+}
+
+void FStoryPromptBuilder::RecordUsage(const TSharedPtr<FJsonObject>& JsonResponse)
+{
+	/**
+	 * # Function: RecordUsage()
+	 *
+	 * ## Brief
+	 * Reads `usage.prompt_tokens` and `usage.prompt_tokens_details.cached_tokens` from a response and updates the cache statistics.
+	 *
+	 * ## Note
+	 * Backends without prompt caching do not send `prompt_tokens_details`, they are counted as misses.
+	 */
+	if (!JsonResponse.IsValid())
+	{
+		return;
+	}
+
+	const TSharedPtr<FJsonObject>* Usage;
+	if (!JsonResponse->TryGetObjectField(TEXT("usage"), Usage))
+	{
+		return;
+	}
+
+	int64 PromptTokens = 0;
+	int64 CachedTokens = 0;
+	(*Usage)->TryGetNumberField(TEXT("prompt_tokens"), PromptTokens);
+
+	const TSharedPtr<FJsonObject>* Details;
+	if ((*Usage)->TryGetObjectField(TEXT("prompt_tokens_details"), Details))
+	{
+		(*Details)->TryGetNumberField(TEXT("cached_tokens"), CachedTokens);
+	}
+
+	CacheStats.Requests++;
+	CacheStats.PromptTokens += PromptTokens;
+	CacheStats.CachedTokens += CachedTokens;
+	if (CachedTokens > 0)
+	{
+		CacheStats.CacheHits++;
+	}
+
+	UE_LOG(LogTemp, Log, TEXT("Prompt cache: %lld/%lld tokens cached this request, %lld/%lld requests hit, %.1f%% of all prompt tokens cached."),
+		CachedTokens, PromptTokens, CacheStats.CacheHits, CacheStats.Requests, CacheStats.GetTokenHitRatio() * 100.0);
+}
+
+FString FStoryPromptBuilder::SerializeCondensed(const TSharedPtr<FJsonObject>& JsonObject)
+{
+	/**
+	 * # Function: SerializeCondensed()
+	 *
+	 * ## Brief
+	 * Serializes a JSON object without whitespace.
+	 */
+	FString Serialized;
+	TSharedRef<TJsonWriter<TCHAR, TCondensedJsonPrintPolicy<TCHAR>>> Writer = TJsonWriterFactory<TCHAR, TCondensedJsonPrintPolicy<TCHAR>>::Create(&Serialized);
+	FJsonSerializer::Serialize(JsonObject.ToSharedRef(), Writer);
+	return Serialized;
+}
+
+TSharedPtr<FJsonValue> FStoryPromptBuilder::MakeMessage(const FString& Role, const FString& Content)
+{
+	TSharedPtr<FJsonObject> Message = MakeShareable(new FJsonObject);
+	Message->SetStringField(TEXT("role"), Role);
+	Message->SetStringField(TEXT("content"), Content);
+	return MakeShareable(new FJsonValueObject(Message));
+}
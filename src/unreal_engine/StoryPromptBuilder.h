@@ -0,0 +1,69 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Dom/JsonObject.h"
+#include "Dom/JsonValue.h"
+#include "StorySceneEncoder.h"
+
+/**
+ * Prompt-cache counters read from the `usage` field of the LLM responses.
+ */
+struct FPromptCacheStats
+{
+	int64 Requests = 0;
+	int64 CacheHits = 0;
+	int64 PromptTokens = 0;
+	int64 CachedTokens = 0;
+
+	double GetTokenHitRatio() const { return PromptTokens > 0 ? double(CachedTokens) / double(PromptTokens) : 0.0; }
+};
+
+/**
+ * How the scene data (environment, events) is written into the prompt.
+ */
+enum class EStorySceneEncoding : uint8
+{
+	Json,		// Condensed JSON, for hosted models
+	Compact,	// FStorySceneEncoder, fewer tokens for local models
+};
+
+/**
+ * Builds the chat messages for the story requests with a byte-stable prefix.
+ * Static parts (instructions, start environment, synopsis) come first, volatile data last.
+ */
+class PROJECT_API FStoryPromptBuilder
+{
+public:
+	// Static prefix
+	void SetInstructions(const FString& InInstructions);
+	void SetStartEnvironment(const TSharedPtr<FJsonObject>& InStartEnvironment);
+	void SetSynopsis(const FString& InSynopsis);
+
+	// Encoding of the start environment and the volatile content, set per backend
+	void SetSceneEncoding(EStorySceneEncoding InEncoding, const FStorySceneEncodingOptions& InOptions = FStorySceneEncodingOptions());
+	EStorySceneEncoding GetSceneEncoding() const { return SceneEncoding; }
+	FString SerializeScene(const TSharedPtr<FJsonObject>& JsonObject) const;
+
+	TArray<TSharedPtr<FJsonValue>> BuildMessages(const TSharedPtr<FJsonObject>& VolatileContent) const;
+
+	// Prompt cache statistics
+	void RecordUsage(const TSharedPtr<FJsonObject>& JsonResponse);
+	const FPromptCacheStats& GetCacheStats() const { return CacheStats; }
+
+	static FString SerializeCondensed(const TSharedPtr<FJsonObject>& JsonObject);
+
+private:
+	static TSharedPtr<FJsonValue> MakeMessage(const FString& Role, const FString& Content);
+
+	FString Instructions;
+	TSharedPtr<FJsonObject> StartEnvironment;
+	FString StartEnvironmentContent;
+	FString SynopsisContent;
+
+	EStorySceneEncoding SceneEncoding = EStorySceneEncoding::Json;
+	FStorySceneEncodingOptions SceneOptions;
+
+	FPromptCacheStats CacheStats;
+};
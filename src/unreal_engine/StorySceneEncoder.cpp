@@ -0,0 +1,335 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "StorySceneEncoder.h"
+#include "Dom/JsonValue.h"
+#include "StoryNumberFormat.h"
+
+/**
+ * # File: StorySceneEncoder.cpp
+ *
+ * ## Brief
+ * Implements the compact scene encoding, an alternative to JSON for local model backends.
+ *
+ * ## Details
+ * A local model tokenizes every quote, brace and long key of the JSON on the CPU. The compact encoding writes
+ * the same data with fewer tokens:
+ * - **Short keys**: `Distance from player` becomes `dist`, see `GetShortKey()`. Unknown keys are kept.
+ * - **Rounded numbers**: numbers are rounded to `Quantum`, whole centimetres by default.
+ * - **Vectors**: objects with only `x`, `y` and `z` are written as `x,y,z`.
+ * - **Tables**: lists of objects with the same keys get one header `key[count]{columns}:` and one line per object
+ *   with the values separated by `|`. With `bDeltaPositions` a position is written relative to the one above as `^dx,dy,dz`.
+ * - Other objects are written as `key{a=1;b=2}`, top-level fields one per line. Inside them `\` escapes
+ *   the separators `;{}=` of a string.
+ * - With `bSingleLine` the lines are separated by ` ~ `, for prompts with one event per line (`FCompletionSession`).
+ *
+ * The format is explained once by `GetLegend()`, which is part of the cacheable instructions.
+ */
+
+static const TMap<FString, FString>& GetShortKeys()
+{
+	static const TMap<FString, FString> ShortKeys = {
+		{ TEXT("Current_environment"), TEXT("env") },
+		{ TEXT("Event_History"), TEXT("events") },
+		{ TEXT("Old_AI_Responses"), TEXT("prev") },
+		{ TEXT("Predicted_Event"), TEXT("next") },
+		{ TEXT("game_title"), TEXT("title") },
+		{ TEXT("description"), TEXT("desc") },
+		{ TEXT("dimensions"), TEXT("dim") },
+		{ TEXT("width"), TEXT("w") },
+		{ TEXT("depth"), TEXT("d") },
+		{ TEXT("height"), TEXT("h") },
+		{ TEXT("objects"), TEXT("objs") },
+		{ TEXT("Interactable"), TEXT("int") },
+		{ TEXT("position"), TEXT("pos") },
+		{ TEXT("Object"), TEXT("obj") },
+		{ TEXT("Distance from player"), TEXT("dist") },
+		{ TEXT("Relative Position to player"), TEXT("dir") },
+		{ TEXT("TimeStamp"), TEXT("t") },
+	};
+	return ShortKeys;
+}
+
+FString FStorySceneEncoder::GetShortKey(const FString& Key)
+{
+	const FString* ShortKey = GetShortKeys().Find(Key);
+	return ShortKey ? *ShortKey : Key;
+}
+
+const TCHAR* FStorySceneEncoder::GetLegend()
+{
+	return TEXT("Scene data is compact text, not JSON. key=value, key{...} is an object with fields separated by ;. ")
+		TEXT("key[n]{columns}: is a table of n rows, one per line, values separated by |. x,y,z is a vector in centimetres, ")
+		TEXT("^x,y,z a position relative to the row above. ~ separates lines written on one line, \\ escapes the next character. ")
+		TEXT("Keys: env=Current_environment, events=Event_History, prev=Old_AI_Responses, ")
+		TEXT("next=Predicted_Event, title=game_title, desc=description, dim=dimensions (w,d,h), objs=objects, int=Interactable, ")
+		TEXT("pos=position, obj=Object, dist=Distance from player, dir=Relative Position to player, t=TimeStamp.");
+}
+
+static double GetQuantum(const FStorySceneEncodingOptions& Options)
+{
+	return Options.Quantum > 0.0 ? Options.Quantum : 1.0;
+}
+
+static double Quantize(double Value, const FStorySceneEncodingOptions& Options)
+{
+	return FMath::RoundToDouble(Value / GetQuantum(Options)) * GetQuantum(Options);
+}
+
+static void WriteNumber(double Value, const FStorySceneEncodingOptions& Options, FString& Out)
+{
+	const double Quantum = GetQuantum(Options);
+	const double Rounded = Quantize(Value, Options);
+	const int32 Decimals = Quantum >= 1.0 ? 0 : FMath::CeilToInt32(-FMath::LogX(10.0, Quantum) - KINDA_SMALL_NUMBER);
+	FStoryNumberFormat::AppendFixed(Rounded, Decimals, Out);
+}
+
+static void WriteVector(const FVector& Vector, const FStorySceneEncodingOptions& Options, FString& Out)
+{
+	WriteNumber(Vector.X, Options, Out);
+	Out.AppendChar(TEXT(','));
+	WriteNumber(Vector.Y, Options, Out);
+	Out.AppendChar(TEXT(','));
+	WriteNumber(Vector.Z, Options, Out);
+}
+
+static bool AsVector(const TSharedPtr<FJsonValue>& Value, FVector& OutVector)
+{
+	const TSharedPtr<FJsonObject>* Object;
+	return Value.IsValid() && Value->TryGetObject(Object) && (*Object)->Values.Num() == 3
+		&& (*Object)->TryGetNumberField(TEXT("x"), OutVector.X)
+		&& (*Object)->TryGetNumberField(TEXT("y"), OutVector.Y)
+		&& (*Object)->TryGetNumberField(TEXT("z"), OutVector.Z);
+}
+
+static void WriteLineBreak(const FStorySceneEncodingOptions& Options, FString& Out)
+{
+	Out += Options.bSingleLine ? TEXT(" ~ ") : TEXT("\n");
+}
+
+static void WriteString(const FString& Value, const FStorySceneEncodingOptions& Options, bool bNested, FString& Out)
+{
+	// Rows end with a line break and values are separated by |, fields of nested objects by ; and =
+	for (TCHAR Char : Value)
+	{
+		if (Char == TEXT('\n') || Char == TEXT('\r'))
+		{
+			Out.AppendChar(TEXT(' '));
+			continue;
+		}
+		if (Char == TEXT('|'))
+		{
+			Out.AppendChar(TEXT('/'));
+			continue;
+		}
+		if ((bNested && (Char == TEXT(';') || Char == TEXT('{') || Char == TEXT('}') || Char == TEXT('=') || Char == TEXT('\\')))
+			|| (Options.bSingleLine && Char == TEXT('~')))
+		{
+			Out.AppendChar(TEXT('\\'));
+		}
+		Out.AppendChar(Char);
+	}
+}
+
+static void WriteField(const FString& Key, const TSharedPtr<FJsonValue>& Value, const FStorySceneEncodingOptions& Options, bool bNested, FString& Out);
+
+static void WriteValue(const TSharedPtr<FJsonValue>& Value, const FStorySceneEncodingOptions& Options, bool bNested, FString& Out)
+{
+	if (!Value.IsValid())
+	{
+		return;
+	}
+
+	FVector Vector;
+	switch (Value->Type)
+	{
+	case EJson::String:
+		WriteString(Value->AsString(), Options, bNested, Out);
+		break;
+	case EJson::Number:
+		WriteNumber(Value->AsNumber(), Options, Out);
+		break;
+	case EJson::Boolean:
+		Out += Value->AsBool() ? TEXT("true") : TEXT("false");
+		break;
+	case EJson::Object:
+		if (AsVector(Value, Vector))
+		{
+			WriteVector(Vector, Options, Out);
+			break;
+		}
+		Out.AppendChar(TEXT('{'));
+		{
+			bool bFirst = true;
+			for (const TPair<FString, TSharedPtr<FJsonValue>>& Field : Value->AsObject()->Values)
+			{
+				if (!bFirst)
+				{
+					Out.AppendChar(TEXT(';'));
+				}
+				bFirst = false;
+				WriteField(Field.Key, Field.Value, Options, true, Out);
+			}
+		}
+		Out.AppendChar(TEXT('}'));
+		break;
+	case EJson::Array:
+		Out.AppendChar(TEXT('['));
+		for (int32 i = 0; i < Value->AsArray().Num(); i++)
+		{
+			if (i > 0)
+			{
+				Out.AppendChar(TEXT(','));
+			}
+			WriteValue(Value->AsArray()[i], Options, true, Out);
+		}
+		Out.AppendChar(TEXT(']'));
+		break;
+	default:
+		break;
+	}
+}
+
+static bool GetTableColumns(const TArray<TSharedPtr<FJsonValue>>& Rows, TArray<FString>& OutColumns)
+{
+	// A table needs objects with the same keys in the same order
+	OutColumns.Reset();
+	for (const TSharedPtr<FJsonValue>& Row : Rows)
+	{
+		const TSharedPtr<FJsonObject>* Object;
+		if (!Row.IsValid() || !Row->TryGetObject(Object))
+		{
+			return false;
+		}
+
+		TArray<FString> Keys;
+		(*Object)->Values.GenerateKeyArray(Keys);
+		if (OutColumns.Num() == 0)
+		{
+			OutColumns = MoveTemp(Keys);
+		}
+		else if (Keys != OutColumns)
+		{
+			return false;
+		}
+	}
+	return OutColumns.Num() > 0;
+}
+
+static void WriteTable(const TArray<TSharedPtr<FJsonValue>>& Rows, const TArray<FString>& Columns, const FStorySceneEncodingOptions& Options, FString& Out)
+{
+	Out.AppendChar(TEXT('{'));
+	for (int32 Column = 0; Column < Columns.Num(); Column++)
+	{
+		if (Column > 0)
+		{
+			Out.AppendChar(TEXT(','));
+		}
+		Out += FStorySceneEncoder::GetShortKey(Columns[Column]);
+	}
+	Out += TEXT("}:");
+	WriteLineBreak(Options, Out);
+
+	TArray<FVector> Previous;
+	Previous.SetNumZeroed(Columns.Num());
+	for (int32 Row = 0; Row < Rows.Num(); Row++)
+	{
+		const TSharedPtr<FJsonObject> Object = Rows[Row]->AsObject();
+		for (int32 Column = 0; Column < Columns.Num(); Column++)
+		{
+			if (Column > 0)
+			{
+				Out.AppendChar(TEXT('|'));
+			}
+
+			const TSharedPtr<FJsonValue> Value = Object->Values.FindRef(Columns[Column]);
+			FVector Position;
+			if (Options.bDeltaPositions && Columns[Column] == TEXT("position") && AsVector(Value, Position))
+			{
+				// Deltas between rounded positions, so the rounding errors do not add up down the table
+				Position = FVector(Quantize(Position.X, Options), Quantize(Position.Y, Options), Quantize(Position.Z, Options));
+				if (Row > 0)
+				{
+					Out.AppendChar(TEXT('^'));
+					WriteVector(Position - Previous[Column], Options, Out);
+				}
+				else
+				{
+					WriteVector(Position, Options, Out);
+				}
+				Previous[Column] = Position;
+				continue;
+			}
+			WriteValue(Value, Options, false, Out);
+		}
+		WriteLineBreak(Options, Out);
+	}
+}
+
+static void WriteField(const FString& Key, const TSharedPtr<FJsonValue>& Value, const FStorySceneEncodingOptions& Options, bool bNested, FString& Out)
+{
+	Out += FStorySceneEncoder::GetShortKey(Key);
+
+	const TArray<TSharedPtr<FJsonValue>>* Array;
+	if (Value.IsValid() && Value->TryGetArray(Array))
+	{
+		Out.Appendf(TEXT("[%d]"), Array->Num());
+
+		TArray<FString> Columns;
+		if (GetTableColumns(*Array, Columns))
+		{
+			WriteTable(*Array, Columns, Options, Out);
+			return;
+		}
+
+		// Other lists one value per line, the responses are long
+		Out.AppendChar(TEXT(':'));
+		WriteLineBreak(Options, Out);
+		for (const TSharedPtr<FJsonValue>& Element : *Array)
+		{
+			WriteValue(Element, Options, bNested, Out);
+			WriteLineBreak(Options, Out);
+		}
+		return;
+	}
+
+	FVector Vector;
+	if (Value.IsValid() && Value->Type == EJson::Object && !AsVector(Value, Vector))
+	{
+		WriteValue(Value, Options, bNested, Out);
+		return;
+	}
+	Out.AppendChar(TEXT('='));
+	WriteValue(Value, Options, bNested, Out);
+}
+
+FString FStorySceneEncoder::Encode(const TSharedPtr<FJsonObject>& Object, const FStorySceneEncodingOptions& Options)
+{
+	/**
+	 * # Function: Encode()
+	 *
+	 * ## Brief
+	 * Writes a JSON object in the compact encoding, one top-level field per line. Safe to call on any thread.
+	 * With `bSingleLine` there is no separator after the last line.
+	 */
+	FString Out;
+	if (!Object.IsValid())
+	{
+		return Out;
+	}
+
+	const TCHAR* LineBreak = Options.bSingleLine ? TEXT(" ~ ") : TEXT("\n");
+	for (const TPair<FString, TSharedPtr<FJsonValue>>& Field : Object->Values)
+	{
+		WriteField(Field.Key, Field.Value, Options, false, Out);
+		if (!Out.EndsWith(LineBreak))
+		{
+			WriteLineBreak(Options, Out);
+		}
+	}
+	if (Options.bSingleLine)
+	{
+		Out.RemoveFromEnd(LineBreak);
+	}
+	return Out;
+}
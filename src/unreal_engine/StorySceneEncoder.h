@@ -0,0 +1,39 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Dom/JsonObject.h"
+
+/**
+ * Precision and layout of the compact scene encoding.
+ */
+struct FStorySceneEncodingOptions
+{
+	// Numbers are rounded to multiples of this, positions and sizes are in centimetres
+	double Quantum = 1.0;
+
+	// Positions in a list are written relative to the row above
+	bool bDeltaPositions = true;
+
+	// Lines are separated by " ~ " instead of line breaks, for prompts with one event per line
+	bool bSingleLine = false;
+};
+
+/**
+ * Writes scene JSON as compact text for local models: short keys, rounded numbers, lists as tables.
+ * See StorySceneEncoder.cpp.
+ */
+class PROJECT_API FStorySceneEncoder
+{
+public:
+	static FString Encode(const TSharedPtr<FJsonObject>& Object, const FStorySceneEncodingOptions& Options = FStorySceneEncodingOptions());
+
+	// Explains the format and the short keys, sent once in the instructions
+	static const TCHAR* GetLegend();
+
+	static FString GetShortKey(const FString& Key);
+
+	// Rough token count, about four characters per token for English text and JSON
+	static int32 EstimateTokens(const FString& Text) { return (Text.Len() + 3) / 4; }
+};
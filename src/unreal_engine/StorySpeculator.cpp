@@ -0,0 +1,169 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "StorySpeculator.h"
+
+/**
+ * # File: StorySpeculator.cpp
+ *
+ * ## Brief
+ * Implements speculative pre-generation of narrations.
+ *
+ * ## Details
+ * A narration is normally requested after an event is observed, so the player waits the full model latency.
+ * The speculator uses the same spatial data as `GetPlayerRelativity()` to predict which interactable
+ * objects the player is about to use (within reach and in front of the player). Narrations for those
+ * objects are requested at low priority ahead of time, and shown immediately if the predicted object moves.
+ *
+ * Speculative narrations expire after `Lifetime` seconds or when the object is no longer a candidate,
+ * since the scene around it may have changed.
+ */
+
+void FStorySpeculator::Configure(double InReach, int32 InMaxCandidates, double InLifetime)
+{
+	/**
+	 * # Function: Configure()
+	 *
+	 * ## Brief
+	 * Sets the interaction reach, the number of objects narrated ahead of time and how long a narration stays valid.
+	 */
+	Reach = FMath::Max(1.0, InReach);
+	MaxCandidates = FMath::Max(0, InMaxCandidates);
+	Lifetime = FMath::Max(1.0, InLifetime);
+	Ready.Empty();
+	InFlight.Empty();
+	Hits = 0;
+}
+
+void FStorySpeculator::PredictInteractions(const FVector& PlayerPosition, const FVector& PlayerForward, const FVector& PlayerRight,
+	const TArray<FSpeculationCandidate>& Nearby, TArray<FSpeculationCandidate>& OutCandidates) const
+{
+	/**
+	 * # Function: PredictInteractions()
+	 *
+	 * ## Brief
+	 * Ranks interactable objects by how likely the player is to interact with them next.
+	 *
+	 * ## Details
+	 * - Only objects within `Reach` and in front of the player (forward dot > 0.5) are considered.
+	 * - The score favours objects straight ahead and close by: `ForwardDot * (1 - Distance / Reach)`.
+	 * - At most `MaxCandidates` objects are returned, best first.
+	 */
+	OutCandidates.Reset();
+
+	for (const FSpeculationCandidate& Object : Nearby)
+	{
+		FVector RelativeVector = Object.Location - PlayerPosition;
+		double Distance = RelativeVector.Size();
+		if (Distance > Reach)
+		{
+			continue;
+		}
+
+		FVector NormalizedRelativeVector = RelativeVector.GetSafeNormal();
+		double ForwardDot = FVector::DotProduct(PlayerForward, NormalizedRelativeVector);
+		if (ForwardDot < 0.5)
+		{
+			continue;
+		}
+
+		FSpeculationCandidate Candidate = Object;
+		Candidate.Distance = Distance;
+		Candidate.Direction = FStoryEvent::GetDirection(ForwardDot, FVector::DotProduct(PlayerRight, NormalizedRelativeVector), FVector::DotProduct(FVector::UpVector, NormalizedRelativeVector));
+		Candidate.Score = ForwardDot * (1.0 - Distance / Reach);
+		OutCandidates.Add(Candidate);
+	}
+
+	OutCandidates.Sort([](const FSpeculationCandidate& A, const FSpeculationCandidate& B) { return A.Score > B.Score; });
+	if (OutCandidates.Num() > MaxCandidates)
+	{
+		OutCandidates.SetNum(MaxCandidates);
+	}
+}
+
+bool FStorySpeculator::NeedsNarration(const FString& ActorName) const
+{
+	return !Ready.Contains(ActorName) && !InFlight.Contains(ActorName);
+}
+
+void FStorySpeculator::MarkInFlight(const FString& ActorName)
+{
+	InFlight.Add(ActorName);
+}
+
+void FStorySpeculator::CancelInFlight(const FString& ActorName)
+{
+	InFlight.Remove(ActorName);
+}
+
+void FStorySpeculator::StoreNarration(const FString& ActorName, const FString& Narration, double Now)
+{
+	/**
+	 * # Function: StoreNarration()
+	 *
+	 * ## Brief
+	 * Stores a pre-generated narration. Results for objects that were pruned while the request was running are dropped.
+	 */
+	if (InFlight.Remove(ActorName) == 0 || Narration.IsEmpty())
+	{
+		return;
+	}
+
+	FSpeculation& Speculation = Ready.FindOrAdd(ActorName);
+	Speculation.Narration = Narration;
+	Speculation.CreatedTime = Now;
+}
+
+void FStorySpeculator::Prune(const TArray<FSpeculationCandidate>& Candidates, double Now)
+{
+	/**
+	 * # Function: Prune()
+	 *
+	 * ## Brief
+	 * Drops narrations that expired or belong to objects that are no longer predicted.
+	 * Requests still running for those objects are forgotten, so `StoreNarration()` drops their results.
+	 */
+	auto IsCandidate = [&Candidates](const FString& ActorName)
+	{
+		return Candidates.ContainsByPredicate([&ActorName](const FSpeculationCandidate& Candidate) { return Candidate.ActorName == ActorName; });
+	};
+
+	for (auto It = Ready.CreateIterator(); It; ++It)
+	{
+		if (!IsCandidate(It.Key()) || Now - It.Value().CreatedTime > Lifetime)
+		{
+			It.RemoveCurrent();
+		}
+	}
+	for (auto It = InFlight.CreateIterator(); It; ++It)
+	{
+		if (!IsCandidate(*It))
+		{
+			It.RemoveCurrent();
+		}
+	}
+}
+
+bool FStorySpeculator::TakeNarration(const FStoryEvent& Event, FString& OutNarration)
+{
+	/**
+	 * # Function: TakeNarration()
+	 *
+	 * ## Brief
+	 * Returns the pre-generated narration if the event is the predicted interaction.
+	 *
+	 * ## Details
+	 * The prediction matches when the moved object has a narration and is still within reach.
+	 * The narration is consumed so it is only shown once.
+	 */
+	const FSpeculation* Speculation = Ready.Find(Event.ActorName);
+	if (!Speculation || Event.Distance > Reach)
+	{
+		return false;
+	}
+
+	OutNarration = Speculation->Narration;
+	Ready.Remove(Event.ActorName);
+	Hits++;
+	return true;
+}
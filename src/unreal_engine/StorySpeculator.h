@@ -0,0 +1,58 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "StoryEvent.h"
+
+/**
+ * An actor the player is likely to interact with next.
+ */
+struct FSpeculationCandidate
+{
+	FString ActorName;
+	FVector Location = FVector::ZeroVector;
+	EStoryDirection Direction = EStoryDirection::Front;
+	double Distance = 0.0;
+	double Score = 0.0;
+};
+
+/**
+ * Pre-generates narrations for predicted interactions and serves them when the predicted event happens.
+ * See StorySpeculator.cpp.
+ */
+class PROJECT_API FStorySpeculator
+{
+public:
+	void Configure(double InReach, int32 InMaxCandidates, double InLifetime);
+
+	// Prediction
+	void PredictInteractions(const FVector& PlayerPosition, const FVector& PlayerForward, const FVector& PlayerRight,
+		const TArray<FSpeculationCandidate>& Nearby, TArray<FSpeculationCandidate>& OutCandidates) const;
+
+	// Bookkeeping of the pre-generated narrations
+	bool NeedsNarration(const FString& ActorName) const;
+	void MarkInFlight(const FString& ActorName);
+	void StoreNarration(const FString& ActorName, const FString& Narration, double Now);
+	void CancelInFlight(const FString& ActorName);
+	void Prune(const TArray<FSpeculationCandidate>& Candidates, double Now);
+	bool TakeNarration(const FStoryEvent& Event, FString& OutNarration);
+
+	int32 NumInFlight() const { return InFlight.Num(); }
+	int32 GetHits() const { return Hits; }
+
+private:
+	struct FSpeculation
+	{
+		FString Narration;
+		double CreatedTime = 0.0;
+	};
+
+	double Reach = 250.0;
+	int32 MaxCandidates = 2;
+	double Lifetime = 30.0;
+
+	TMap<FString, FSpeculation> Ready;
+	TSet<FString> InFlight;
+	int32 Hits = 0;
+};
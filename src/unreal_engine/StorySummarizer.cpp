@@ -0,0 +1,225 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "StorySummarizer.h"
+#include "Async/Async.h"
+
+/**
+ * # File: StorySummarizer.cpp
+ *
+ * ## Brief
+ * Implements the rolling story summarization used for `Old_AI_Responses`.
+ *
+ * ## Details
+ * Sending every LLM response in full on each request makes the payload grow for the whole session.
+ * The summarizer keeps the last responses verbatim and, once the history passes a threshold,
+ * compacts the older ones into a synopsis on a worker thread. The synopsis is cached between
+ * requests and only changes when a compaction finishes.
+ */
+
+FStorySummarizer::FStorySummarizer()
+{
+}
+
+void FStorySummarizer::Configure(int32 InCompactThreshold, int32 InVerbatimCount, int32 InMaxSynopsisLength)
+{
+	/**
+	 * # Function: Configure()
+	 *
+	 * ## Brief
+	 * Sets the compaction threshold, how many responses are kept verbatim and the synopsis length limit.
+	 *
+	 * ## Note
+	 * The threshold is clamped so that there is always at least one response to compact.
+	 */
+	VerbatimCount = FMath::Max(0, InVerbatimCount);
+	CompactThreshold = FMath::Max(VerbatimCount + 1, InCompactThreshold);
+	MaxSynopsisLength = FMath::Max(1, InMaxSynopsisLength);
+}
+
+void FStorySummarizer::AddResponse(const FString& Response)
+{
+	/**
+	 * # Function: AddResponse()
+	 *
+	 * ## Brief
+	 * Stores a new LLM response and starts a background compaction if the history is too long.
+	 */
+	CollectCompaction();
+
+	if (Response.IsEmpty())
+	{
+		return;
+	}
+	Responses.Add(Response);
+
+	if (Responses.Num() > CompactThreshold && !IsCompacting())
+	{
+		StartCompaction();
+	}
+}
+
+void FStorySummarizer::Reset()
+{
+	/**
+	 * # Function: Reset()
+	 *
+	 * ## Brief
+	 * Clears the synopsis and all stored responses. A running compaction is discarded.
+	 */
+	Responses.Empty();
+	Synopsis.Empty();
+	CompactingCount = 0;
+	PendingSynopsis = TFuture<FString>();
+}
+
+const FString& FStorySummarizer::GetSynopsis()
+{
+	/**
+	 * # Function: GetSynopsis()
+	 *
+	 * ## Brief
+	 * Returns the cached synopsis of the compacted responses. Empty until the first compaction has finished.
+	 */
+	CollectCompaction();
+	return Synopsis;
+}
+
+void FStorySummarizer::GetRecentResponses(TArray<FString>& OutResponses)
+{
+	/**
+	 * # Function: GetRecentResponses()
+	 *
+	 * ## Brief
+	 * Returns the responses that are not part of the synopsis yet, oldest first.
+	 *
+	 * ## Details
+	 * Responses handed to a running compaction are still included, so no context is lost
+	 * while the worker thread is busy.
+	 */
+	CollectCompaction();
+	OutResponses = Responses;
+}
+
+void FStorySummarizer::StartCompaction()
+{
+	/**
+	 * # Function: StartCompaction()
+	 *
+	 * ## Brief
+	 * Hands every response except the last `VerbatimCount` to a thread pool task that folds them into the synopsis.
+	 */
+	CompactingCount = Responses.Num() - VerbatimCount;
+	if (CompactingCount <= 0)
+	{
+		CompactingCount = 0;
+		return;
+	}
+
+	TArray<FString> OldResponses(Responses.GetData(), CompactingCount);
+	FString PreviousSynopsis = Synopsis;
+	int32 MaxLength = MaxSynopsisLength;
+
+	PendingSynopsis = Async(EAsyncExecution::ThreadPool, [PreviousSynopsis, OldResponses = MoveTemp(OldResponses), MaxLength]()
+		{
+			return FStorySummarizer::SummarizeExtractive(PreviousSynopsis, OldResponses, MaxLength);
+		});
+
+	UE_LOG(LogTemp, Log, TEXT("Compacting %d old LLM responses into the story synopsis."), CompactingCount);
+}
+
+void FStorySummarizer::CollectCompaction()
+{
+	/**
+	 * # Function: CollectCompaction()
+	 *
+	 * ## Brief
+	 * Applies the result of a finished compaction. Does nothing while the task is still running.
+	 */
+	if (!PendingSynopsis.IsValid() || !PendingSynopsis.IsReady())
+	{
+		return;
+	}
+
+	Synopsis = PendingSynopsis.Get();
+	PendingSynopsis = TFuture<FString>();
+	Responses.RemoveAt(0, FMath::Min(CompactingCount, Responses.Num()));
+	CompactingCount = 0;
+
+	// More responses may have arrived while the worker was busy
+	if (Responses.Num() > CompactThreshold)
+	{
+		StartCompaction();
+	}
+}
+
+FString FStorySummarizer::SummarizeExtractive(const FString& PreviousSynopsis, const TArray<FString>& OldResponses, int32 MaxLength)
+{
+	/**
+	 * # Function: SummarizeExtractive()
+	 *
+	 * ## Brief
+	 * Extractive summarizer: keeps the leading sentence of every response and appends it to the previous synopsis.
+	 *
+	 * ## Details
+	 * - Whitespace and line breaks are collapsed.
+	 * - Sentences already present in the synopsis are skipped.
+	 * - If the result is longer than `MaxLength`, the oldest sentences are dropped so the most recent story is kept.
+	 *
+	 * Runs on a worker thread, so it only touches its arguments.
+	 */
+	TArray<FString> Sentences;
+	PreviousSynopsis.ParseIntoArray(Sentences, TEXT("\n"), true);
+
+	for (const FString& Response : OldResponses)
+	{
+		FString Flat = Response.Replace(TEXT("\r"), TEXT(" ")).Replace(TEXT("\n"), TEXT(" ")).TrimStartAndEnd();
+		if (Flat.IsEmpty())
+		{
+			continue;
+		}
+
+		// The lead sentence ends at the first '.', '!' or '?' followed by a space or the end of the text
+		int32 End = Flat.Len();
+		for (int32 i = 0; i < Flat.Len(); i++)
+		{
+			const TCHAR Char = Flat[i];
+			if ((Char == TEXT('.') || Char == TEXT('!') || Char == TEXT('?')) && (i + 1 == Flat.Len() || FChar::IsWhitespace(Flat[i + 1])))
+			{
+				End = i + 1;
+				break;
+			}
+		}
+
+		FString Lead = Flat.Left(End).TrimStartAndEnd();
+		if (!Lead.IsEmpty() && !Sentences.Contains(Lead))
+		{
+			Sentences.Add(Lead);
+		}
+	}
+
+	// Drop the oldest sentences until the synopsis fits
+	int32 TotalLength = 0;
+	int32 FirstKept = Sentences.Num();
+	for (int32 i = Sentences.Num() - 1; i >= 0; --i)
+	{
+		int32 SentenceLength = Sentences[i].Len() + 1;
+		if (TotalLength + SentenceLength > MaxLength && FirstKept < Sentences.Num())
+		{
+			break;
+		}
+		TotalLength += SentenceLength;
+		FirstKept = i;
+	}
+
+	FString Result;
+	for (int32 i = FirstKept; i < Sentences.Num(); i++)
+	{
+		if (!Result.IsEmpty())
+		{
+			Result += TEXT("\n");
+		}
+		Result += Sentences[i];
+	}
+	return Result.Left(MaxLength);
+}
@@ -0,0 +1,45 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Async/Future.h"
+
+/**
+ * Keeps the LLM response history bounded by folding older responses into a running synopsis.
+ * Only the last `VerbatimCount` responses are kept word for word, see StorySummarizer.cpp.
+ */
+class PROJECT_API FStorySummarizer
+{
+public:
+	FStorySummarizer();
+
+	void Configure(int32 InCompactThreshold, int32 InVerbatimCount, int32 InMaxSynopsisLength);
+	void AddResponse(const FString& Response);
+	void Reset();
+
+	// Payload accessors
+	const FString& GetSynopsis();
+	void GetRecentResponses(TArray<FString>& OutResponses);
+	int32 GetResponseCount() const { return Responses.Num(); }
+	bool IsCompacting() const { return PendingSynopsis.IsValid(); }
+
+	static FString SummarizeExtractive(const FString& PreviousSynopsis, const TArray<FString>& OldResponses, int32 MaxLength);
+
+private:
+	void StartCompaction();
+	void CollectCompaction();
+
+	int32 CompactThreshold = 8;
+	int32 VerbatimCount = 3;
+	int32 MaxSynopsisLength = 1200;
+
+	// Responses not yet folded into the synopsis, oldest first
+	TArray<FString> Responses;
+
+	// Number of responses at the front of `Responses` handed to the running compaction
+	int32 CompactingCount = 0;
+
+	FString Synopsis;
+	TFuture<FString> PendingSynopsis;
+};
@@ -0,0 +1,186 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "TrackingLOD.h"
+
+/**
+ * # File: TrackingLOD.cpp
+ *
+ * ## Brief
+ * Implements the tracking level of detail of the tracked objects.
+ *
+ * ## Details
+ * Checking every tracked object at the same cadence makes nearby objects react late and wastes work
+ * on distant props. Each object is in one of three tiers instead:
+ * - **Near**: within `NearDistance` of the player, checked every frame.
+ * - **Mid**: within `MidDistance` and moving, checked every `MidInterval` seconds.
+ * - **Far**: further away, or not moving, checked every `FarInterval` seconds.
+ *
+ * A tier holds the indices of its objects. Each frame `CollectDue()` takes the next objects of each tier,
+ * round robin, so every object of the tier is checked once per interval. The work of a frame is proportional
+ * to the number of checked objects, not to the number of tracked objects, and capped by `MaxSamplesPerFrame`.
+ * The tier of an object is updated with `Assign()` after each check, an O(1) move between the index arrays.
+ * Objects added or removed at runtime are linked into or unlinked from their tier the same way.
+ */
+
+void FTrackingLOD::Configure(const FTrackingLODSettings& InSettings)
+{
+	Settings = InSettings;
+	Settings.MaxSamplesPerFrame = FMath::Max(1, Settings.MaxSamplesPerFrame);
+}
+
+void FTrackingLOD::Reset(int32 NumObjects)
+{
+	/**
+	 * # Function: Reset()
+	 *
+	 * ## Brief
+	 * Puts all objects in the Near tier, so each is checked and classified soon.
+	 */
+	for (FTier& Tier : Tiers)
+	{
+		Tier = FTier();
+	}
+
+	FTier& Near = Tiers[(int32)ETrackingTier::Near];
+	ObjectTier.Init(ETrackingTier::Near, NumObjects);
+	ObjectSlot.SetNumUninitialized(NumObjects);
+	Near.Objects.SetNumUninitialized(NumObjects);
+	for (int32 Index = 0; Index < NumObjects; Index++)
+	{
+		Near.Objects[Index] = Index;
+		ObjectSlot[Index] = Index;
+	}
+}
+
+void FTrackingLOD::Add(int32 Index)
+{
+	while (ObjectTier.Num() <= Index)
+	{
+		ObjectTier.Add(ETrackingTier::Count);
+		ObjectSlot.Add(INDEX_NONE);
+	}
+
+	if (ObjectTier[Index] == ETrackingTier::Count)
+	{
+		Link(Index, ETrackingTier::Near);
+	}
+}
+
+void FTrackingLOD::Remove(int32 Index)
+{
+	if (ObjectTier.IsValidIndex(Index) && ObjectTier[Index] != ETrackingTier::Count)
+	{
+		Unlink(Index);
+	}
+}
+
+void FTrackingLOD::Assign(int32 Index, double DistanceToPlayer, bool bMoving)
+{
+	if (!ObjectTier.IsValidIndex(Index) || ObjectTier[Index] == ETrackingTier::Count)
+	{
+		return;
+	}
+
+	const ETrackingTier NewTier = Classify(DistanceToPlayer, bMoving);
+	if (NewTier != ObjectTier[Index])
+	{
+		Unlink(Index);
+		Link(Index, NewTier);
+	}
+}
+
+void FTrackingLOD::Link(int32 Index, ETrackingTier Tier)
+{
+	ObjectSlot[Index] = Tiers[(int32)Tier].Objects.Add(Index);
+	ObjectTier[Index] = Tier;
+}
+
+void FTrackingLOD::Unlink(int32 Index)
+{
+	// Swap-remove from the tier, the last object takes the freed slot
+	FTier& From = Tiers[(int32)ObjectTier[Index]];
+	const int32 Slot = ObjectSlot[Index];
+	const int32 Last = From.Objects.Last();
+	From.Objects[Slot] = Last;
+	ObjectSlot[Last] = Slot;
+	From.Objects.Pop(EAllowShrinking::No);
+
+	ObjectSlot[Index] = INDEX_NONE;
+	ObjectTier[Index] = ETrackingTier::Count;
+}
+
+void FTrackingLOD::CollectDue(double DeltaTime, TArray<int32>& OutDue)
+{
+	/**
+	 * # Function: CollectDue()
+	 *
+	 * ## Brief
+	 * Collects the objects to check this frame.
+	 *
+	 * ## Details
+	 * A tier earns `Num * DeltaTime / Interval` checks per frame, the Near tier checks all its objects.
+	 * Tiers are served in order until `MaxSamplesPerFrame` is reached. Checks a tier could not get
+	 * are kept as credit for the next frame, up to one full round of the tier.
+	 */
+	OutDue.Reset();
+	Frames++;
+
+	for (int32 TierIndex = 0; TierIndex < (int32)ETrackingTier::Count; TierIndex++)
+	{
+		FTier& Tier = Tiers[TierIndex];
+		const int32 Num = Tier.Objects.Num();
+		if (Num == 0)
+		{
+			Tier.Credit = 0.0;
+			continue;
+		}
+
+		const double Interval = GetInterval((ETrackingTier)TierIndex);
+		Tier.Credit = Interval > 0.0 ? FMath::Min(Tier.Credit + Num * DeltaTime / Interval, (double)Num) : (double)Num;
+
+		const int32 Remaining = Settings.MaxSamplesPerFrame - OutDue.Num();
+		const int32 Count = FMath::Min(FMath::FloorToInt32(Tier.Credit), Remaining);
+		for (int32 i = 0; i < Count; i++)
+		{
+			if (Tier.Cursor >= Num)
+			{
+				Tier.Cursor = 0;
+			}
+			OutDue.Add(Tier.Objects[Tier.Cursor++]);
+		}
+		Tier.Credit -= Count;
+	}
+
+	Samples += OutDue.Num();
+}
+
+ETrackingTier FTrackingLOD::Classify(double DistanceToPlayer, bool bMoving) const
+{
+	if (DistanceToPlayer < Settings.NearDistance)
+	{
+		return ETrackingTier::Near;
+	}
+	if (DistanceToPlayer < Settings.MidDistance && bMoving)
+	{
+		return ETrackingTier::Mid;
+	}
+	return ETrackingTier::Far;
+}
+
+double FTrackingLOD::GetInterval(ETrackingTier Tier) const
+{
+	switch (Tier)
+	{
+	case ETrackingTier::Mid: return Settings.MidInterval;
+	case ETrackingTier::Far: return Settings.FarInterval;
+	default: return 0.0;
+	}
+}
+
+void FTrackingLOD::LogStats() const
+{
+	UE_LOG(LogTemp, Log, TEXT("Tracking LOD: %d near, %d mid, %d far, %.1f checks per frame."),
+		NumInTier(ETrackingTier::Near), NumInTier(ETrackingTier::Mid), NumInTier(ETrackingTier::Far),
+		Frames > 0 ? (double)Samples / Frames : 0.0);
+}
@@ -0,0 +1,73 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+/**
+ * How often a tracked object is checked for movement.
+ */
+enum class ETrackingTier : uint8
+{
+	Near,	// Within interaction range, every frame
+	Mid,	// Every MidInterval seconds
+	Far,	// Far away or not moving, every FarInterval seconds
+	Count	// Not in any tier (a free slot)
+};
+
+/**
+ * Distances and intervals of the tracking tiers.
+ */
+struct FTrackingLODSettings
+{
+	double NearDistance = 800.0;
+	double MidDistance = 3000.0;
+	double MidInterval = 0.5;
+	double FarInterval = 3.0;
+	int32 MaxSamplesPerFrame = 512;
+};
+
+/**
+ * Per-object tracking level of detail: picks the tracked objects to check each frame. See TrackingLOD.cpp.
+ */
+class PROJECT_API FTrackingLOD
+{
+public:
+	void Configure(const FTrackingLODSettings& InSettings);
+	void Reset(int32 NumObjects);
+
+	// Adds an object to the Near tier, or removes it from its tier, for tracked objects added and removed at runtime
+	void Add(int32 Index);
+	void Remove(int32 Index);
+
+	// Moves an object to the tier of its distance to the player. Objects that are not moving are never in the Mid tier.
+	void Assign(int32 Index, double DistanceToPlayer, bool bMoving);
+
+	// Objects due for a check this frame, near objects first, at most MaxSamplesPerFrame
+	void CollectDue(double DeltaTime, TArray<int32>& OutDue);
+
+	ETrackingTier GetTier(int32 Index) const { return ObjectTier[Index]; }
+	int32 NumInTier(ETrackingTier Tier) const { return Tiers[(int32)Tier].Objects.Num(); }
+	int64 GetSamples() const { return Samples; }
+	void LogStats() const;
+
+private:
+	struct FTier
+	{
+		TArray<int32> Objects;
+		int32 Cursor = 0;
+		double Credit = 0.0;
+	};
+
+	ETrackingTier Classify(double DistanceToPlayer, bool bMoving) const;
+	void Link(int32 Index, ETrackingTier Tier);
+	void Unlink(int32 Index);
+	double GetInterval(ETrackingTier Tier) const;
+
+	FTrackingLODSettings Settings;
+	FTier Tiers[(int32)ETrackingTier::Count];
+	TArray<ETrackingTier> ObjectTier;
+	TArray<int32> ObjectSlot;
+	int64 Samples = 0;
+	int64 Frames = 0;
+};
@@ -0,0 +1,128 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "TrackingSweep.h"
+#include "Async/TaskGraphInterfaces.h"
+
+/**
+ * # File: TrackingSweep.cpp
+ *
+ * ## Brief
+ * Implements the movement detection of the tracking sweep.
+ *
+ * ## Details
+ * With tens of thousands of tracked objects, comparing positions and computing the direction to the player
+ * is the bulk of a sweep. `FTrackingSweep::Run()` splits a range of tracked objects into contiguous chunks
+ * and runs them with `ParallelFor`:
+ * - **Load balancing**: there are a few chunks per worker thread. Idle workers take the next unclaimed chunk,
+ *   so a chunk with many moved objects does not hold up the others.
+ * - **No locks**: each chunk collects its movements in its own buffer. The buffers are appended in chunk order
+ *   after `ParallelFor` returns, which keeps the movements in the order of the tracked objects.
+ *
+ * The views of all players are read once per sweep. Detection only compares positions, the direction of the
+ * moved objects is then computed in bulk against every view with `GetRelativities()`, in one pass for all players.
+ *
+ * Actors are not read on the workers: the caller copies the positions of the range on the game thread before `Run()`.
+ * Publishing events (cache, speculation, requests) is not thread-safe and stays on the game thread.
+ * `Test_TrackingSweep.cpp` measures the scaling from one to all worker threads, and the bulk relativity with many movers.
+ */
+
+bool FTrackingSweep::GetRelativity(const FTrackingPlayerView& Player, const FVector& Location, double MaxDistance, double& OutDistance, EStoryDirection& OutDirection)
+{
+	/**
+	 * # Function: GetRelativity()
+	 *
+	 * ## Brief
+	 * Calculates the distance and direction of a location relative to the player's location and orientation.
+	 *
+	 * ## Details
+	 * The direction is classified from the dot products with the player's forward, right and up vectors,
+	 * see `FStoryEvent::GetDirection()`. Only reads its arguments, so it is safe on any thread.
+	 */
+	const FVector RelativeVector = Location - Player.Position;
+	OutDistance = RelativeVector.Size();
+	if (OutDistance >= MaxDistance)
+	{
+		return false;
+	}
+
+	const FVector NormalizedRelativeVector = RelativeVector.GetSafeNormal();
+	const double ForwardDot = FVector::DotProduct(Player.Forward, NormalizedRelativeVector);
+	const double RightDot = FVector::DotProduct(Player.Right, NormalizedRelativeVector);
+	const double VerticalDot = FVector::DotProduct(Player.Up, NormalizedRelativeVector);
+	OutDirection = FStoryEvent::GetDirection(ForwardDot, RightDot, VerticalDot);
+	return true;
+}
+
+void FTrackingSweep::GetRelativities(TConstArrayView<FTrackingPlayerView> Players, double MaxDistance, TArray<FTrackedMovement>& InOutMoved)
+{
+	/**
+	 * # Function: GetRelativities()
+	 *
+	 * ## Brief
+	 * Calculates the distance and direction of every movement relative to every player, like `GetRelativity()`
+	 * for one location and one player.
+	 *
+	 * ## Details
+	 * The `Distance` set by the detection is the distance to the nearest player. A movement `MaxDistance` or further
+	 * from the nearest player is dropped without looking at the players. Otherwise there is one entry per player
+	 * the movement is near, with `Player` set to the index of the view. Entries stay in the order of the movements,
+	 * then of the players.
+	 *
+	 * Players are filtered on the squared distance. Each entry then takes one square root for its distance, which
+	 * also normalizes the relative vector. The nearest distance of the detection took one more.
+	 */
+	const double MaxDistanceSquared = MaxDistance * MaxDistance;
+	TArray<FTrackedMovement> Related;
+	Related.Reserve(InOutMoved.Num());
+
+	for (const FTrackedMovement& Movement : InOutMoved)
+	{
+		if (Movement.Distance >= MaxDistance)
+		{
+			continue;
+		}
+
+		for (int32 PlayerIndex = 0; PlayerIndex < Players.Num(); PlayerIndex++)
+		{
+			const FTrackingPlayerView& Player = Players[PlayerIndex];
+			const FVector RelativeVector = Movement.Location - Player.Position;
+			const double DistanceSquared = RelativeVector.SizeSquared();
+			if (!Player.bValid || DistanceSquared >= MaxDistanceSquared)
+			{
+				continue;
+			}
+
+			FTrackedMovement& Relative = Related.Add_GetRef(Movement);
+			Relative.Player = PlayerIndex;
+			Relative.Distance = FMath::Sqrt(DistanceSquared);
+
+			const FVector NormalizedRelativeVector = Relative.Distance > KINDA_SMALL_NUMBER ? RelativeVector / Relative.Distance : FVector::ZeroVector;
+			Relative.Direction = FStoryEvent::GetDirection(
+				FVector::DotProduct(Player.Forward, NormalizedRelativeVector),
+				FVector::DotProduct(Player.Right, NormalizedRelativeVector),
+				FVector::DotProduct(Player.Up, NormalizedRelativeVector));
+		}
+	}
+	InOutMoved = MoveTemp(Related);
+}
+
+double FTrackingSweep::GetNearestDistance(TConstArrayView<FTrackingPlayerView> Players, const FVector& Location)
+{
+	double NearestSquared = TNumericLimits<double>::Max();
+	for (const FTrackingPlayerView& Player : Players)
+	{
+		if (Player.bValid)
+		{
+			NearestSquared = FMath::Min(NearestSquared, FVector::DistSquared(Location, Player.Position));
+		}
+	}
+	return NearestSquared < TNumericLimits<double>::Max() ? FMath::Sqrt(NearestSquared) : TNumericLimits<double>::Max();
+}
+
+int32 FTrackingSweep::GetNumChunks(int32 Num, int32 MinBatchSize)
+{
+	const int32 MaxChunks = FMath::Max(1, Num / FMath::Max(1, MinBatchSize));
+	const int32 Workers = FTaskGraphInterface::IsRunning() ? FTaskGraphInterface::Get().GetNumWorkerThreads() + 1 : 1;
+	return FMath::Clamp(Workers * 4, 1, MaxChunks);
+}
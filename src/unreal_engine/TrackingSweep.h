@@ -0,0 +1,128 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Async/ParallelFor.h"
+#include "StoryEvent.h"
+
+/**
+ * Position and orientation of a player, read once per sweep. Views that are not valid are skipped.
+ */
+struct FTrackingPlayerView
+{
+	FVector Position = FVector::ZeroVector;
+	FVector Forward = FVector::ZeroVector;
+	FVector Right = FVector::ZeroVector;
+	FVector Up = FVector::UpVector;
+	bool bValid = false;
+};
+
+/**
+ * A tracked object that moved near a player, found by FTrackingSweep.
+ */
+struct FTrackedMovement
+{
+	int32 Index = INDEX_NONE;
+	int32 Player = 0;
+	FVector Location = FVector::ZeroVector;
+	double Distance = 0.0;
+	EStoryDirection Direction = EStoryDirection::Front;
+};
+
+/**
+ * Movement detection over the tracked objects, spread over worker threads. See TrackingSweep.cpp.
+ */
+class PROJECT_API FTrackingSweep
+{
+public:
+	// Distance and direction of Location relative to the player, returns false if it is MaxDistance or further away
+	static bool GetRelativity(const FTrackingPlayerView& Player, const FVector& Location, double MaxDistance, double& OutDistance, EStoryDirection& OutDirection);
+
+	// Relativity of every movement to every player view, one entry per player the movement is near. Keeps the order.
+	static void GetRelativities(TConstArrayView<FTrackingPlayerView> Players, double MaxDistance, TArray<FTrackedMovement>& InOutMoved);
+	static void GetRelativities(const FTrackingPlayerView& Player, double MaxDistance, TArray<FTrackedMovement>& InOutMoved)
+	{
+		GetRelativities(MakeArrayView(&Player, 1), MaxDistance, InOutMoved);
+	}
+
+	// Distance to the nearest valid player view, or the largest distance if there is none
+	static double GetNearestDistance(TConstArrayView<FTrackingPlayerView> Players, const FVector& Location);
+
+	// True if an object last published at LastPublishedTime (negative if never) may publish again at Now
+	static bool IsPublishDue(double LastPublishedTime, double Now, double MinInterval)
+	{
+		return LastPublishedTime < 0.0 || Now - LastPublishedTime >= MinInterval;
+	}
+
+	// Chunks for Num objects with at least MinBatchSize objects each, a few per worker thread
+	static int32 GetNumChunks(int32 Num, int32 MinBatchSize);
+
+	/**
+	 * Calls Detect(Index, OutMovement) for every index in [Begin, End), in NumChunks contiguous chunks run with ParallelFor.
+	 * Detect returns true for a moved object and may only write state of its own index. It runs on worker threads
+	 * and must not read actors, pass it positions copied on the game thread.
+	 * OutMoved holds the movements in index order.
+	 */
+	template<typename DetectType>
+	static void Run(int32 Begin, int32 End, int32 NumChunks, const DetectType& Detect, TArray<FTrackedMovement>& OutMoved)
+	{
+		RunChunks(Begin, End, NumChunks, Detect, [](TArray<FTrackedMovement>&) {}, OutMoved);
+	}
+
+	/**
+	 * Like Run(), but Detect only sets the Location of a moved object and its Distance to the nearest player.
+	 * The relativity to every player is computed in bulk with GetRelativities() for the movements of each chunk,
+	 * on the thread that ran the chunk.
+	 */
+	template<typename DetectType>
+	static void Run(int32 Begin, int32 End, int32 NumChunks, TConstArrayView<FTrackingPlayerView> Players, double MaxDistance, const DetectType& Detect, TArray<FTrackedMovement>& OutMoved)
+	{
+		RunChunks(Begin, End, NumChunks, Detect, [Players, MaxDistance](TArray<FTrackedMovement>& ChunkMoved) { GetRelativities(Players, MaxDistance, ChunkMoved); }, OutMoved);
+	}
+
+private:
+	template<typename DetectType, typename FinishType>
+	static void RunChunks(int32 Begin, int32 End, int32 NumChunks, const DetectType& Detect, const FinishType& FinishChunk, TArray<FTrackedMovement>& OutMoved)
+	{
+		OutMoved.Reset();
+		const int32 Num = End - Begin;
+		if (Num <= 0)
+		{
+			return;
+		}
+		NumChunks = FMath::Clamp(NumChunks, 1, Num);
+
+		// One buffer per chunk, each written by the one thread running the chunk
+		TArray<TArray<FTrackedMovement>> ChunkMoved;
+		ChunkMoved.SetNum(NumChunks);
+
+		ParallelFor(NumChunks, [&](int32 Chunk)
+		{
+			const int32 ChunkBegin = Begin + (int32)((int64)Num * Chunk / NumChunks);
+			const int32 ChunkEnd = Begin + (int32)((int64)Num * (Chunk + 1) / NumChunks);
+			for (int32 Index = ChunkBegin; Index < ChunkEnd; Index++)
+			{
+				FTrackedMovement Movement;
+				if (Detect(Index, Movement))
+				{
+					Movement.Index = Index;
+					ChunkMoved[Chunk].Add(Movement);
+				}
+			}
+			FinishChunk(ChunkMoved[Chunk]);
+		}, NumChunks == 1 ? EParallelForFlags::ForceSingleThread : EParallelForFlags::Unbalanced);
+
+		// Chunks are contiguous, so appending them in chunk order keeps the index order
+		int32 NumMoved = 0;
+		for (const TArray<FTrackedMovement>& Moved : ChunkMoved)
+		{
+			NumMoved += Moved.Num();
+		}
+		OutMoved.Reserve(NumMoved);
+		for (const TArray<FTrackedMovement>& Moved : ChunkMoved)
+		{
+			OutMoved.Append(Moved);
+		}
+	}
+};
@@ -0,0 +1,96 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "TypewriterText.h"
+
+/**
+ * # File: TypewriterText.cpp
+ *
+ * ## Brief
+ * Implements the typewriter reveal of streamed narrations.
+ *
+ * ## Details
+ * Streamed chunks are appended as they arrive and revealed at `CharactersPerSecond`.
+ * The revealed text is handed to the HUD in two parts:
+ * - **Words**: completed words (with their trailing whitespace). The HUD lays out each word once and never changes it.
+ * - **Tail**: the partially revealed word, the only text that changes from frame to frame.
+ *
+ * The layout cost of a frame is bounded by the words revealed in that frame, not by the length of the narration.
+ */
+
+void FTypewriterText::Configure(float InCharactersPerSecond)
+{
+	CharactersPerSecond = FMath::Max(1.0f, InCharactersPerSecond);
+}
+
+void FTypewriterText::Reset()
+{
+	Received.Reset();
+	Revealed = 0;
+	Committed = 0;
+	RevealBudget = 0.0;
+	bFinished = false;
+}
+
+void FTypewriterText::Append(const FString& Chunk)
+{
+	Received += Chunk;
+}
+
+void FTypewriterText::Finish()
+{
+	/**
+	 * # Function: Finish()
+	 *
+	 * ## Brief
+	 * Marks the stream as complete, so the last word is committed once it is revealed.
+	 */
+	bFinished = true;
+}
+
+bool FTypewriterText::Advance(float DeltaTime, TArray<FString>& OutWords, FString& OutTail)
+{
+	/**
+	 * # Function: Advance()
+	 *
+	 * ## Brief
+	 * Reveals the characters due after `DeltaTime` seconds.
+	 *
+	 * ## Details
+	 * Returns true if anything changed. `OutWords` holds the words completed in this call,
+	 * `OutTail` the revealed part of the current word.
+	 */
+	OutWords.Reset();
+
+	int32 PreviousRevealed = Revealed;
+	if (Revealed < Received.Len())
+	{
+		RevealBudget += DeltaTime * CharactersPerSecond;
+		int32 Characters = FMath::FloorToInt32(RevealBudget);
+		RevealBudget -= Characters;
+		Revealed = FMath::Min(Received.Len(), Revealed + Characters);
+	}
+	else
+	{
+		// Waiting for the next chunk, do not save up time to burst it out
+		RevealBudget = 0.0;
+	}
+
+	int32 PreviousCommitted = Committed;
+	for (int32 i = Committed; i < Revealed; i++)
+	{
+		if (FChar::IsWhitespace(Received[i]))
+		{
+			OutWords.Add(Received.Mid(Committed, i + 1 - Committed));
+			Committed = i + 1;
+		}
+	}
+	if (bFinished && Revealed == Received.Len() && Committed < Revealed)
+	{
+		OutWords.Add(Received.Mid(Committed, Revealed - Committed));
+		Committed = Revealed;
+	}
+
+	OutTail = Received.Mid(Committed, Revealed - Committed);
+	return Revealed != PreviousRevealed || Committed != PreviousCommitted;
+}
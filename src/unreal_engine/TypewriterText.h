@@ -0,0 +1,32 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+/**
+ * Reveals streamed text at a fixed rate, word by word. See TypewriterText.cpp.
+ */
+class PROJECT_API FTypewriterText
+{
+public:
+	void Configure(float InCharactersPerSecond);
+	void Reset();
+
+	void Append(const FString& Chunk);
+	void Finish();
+
+	// Reveals the text due this frame: words completed since the last call, and the partially revealed word
+	bool Advance(float DeltaTime, TArray<FString>& OutWords, FString& OutTail);
+
+	bool IsComplete() const { return bFinished && Committed == Received.Len(); }
+	bool IsFinished() const { return bFinished; }
+
+private:
+	FString Received;
+	int32 Revealed = 0;
+	int32 Committed = 0;
+	double RevealBudget = 0.0;
+	float CharactersPerSecond = 60.0f;
+	bool bFinished = false;
+};
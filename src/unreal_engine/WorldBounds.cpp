@@ -0,0 +1,104 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "WorldBounds.h"
+#include "GameFramework/Actor.h"
+
+/**
+ * # File: WorldBounds.cpp
+ *
+ * ## Brief
+ * Implements the cached bounding box of the story environment.
+ *
+ * ## Details
+ * The `space` of the start environment describes the size of the level. The box is kept per actor and updated
+ * when an actor spawns, moves or is destroyed, so a snapshot takes it without another pass over the actors:
+ * - A box that grows the bounds, or changes inside them, is merged in O(1).
+ * - A box on the edge of the bounds that shrinks or is removed may shrink the bounds. They are marked dirty and
+ *   recomputed from all boxes the next time they are read. Story objects rarely sit on the edge of the level.
+ *
+ * The owner removes the box of a destroyed actor (`AGameStateStoryGen::OnActorDestroyed()`). Boxes of actors that
+ * are gone without that notification are dropped at the next recompute.
+ */
+
+// Boxes larger than this in any direction (Unreal units) are not part of the environment
+static constexpr double MaxRelevantExtent = 10000.0;
+
+bool FWorldBounds::IsRelevantExtent(const FVector& BoxExtent)
+{
+	return !BoxExtent.IsNearlyZero() && BoxExtent.GetMax() <= MaxRelevantExtent;
+}
+
+void FWorldBounds::Update(const AActor* Actor, const FVector& Origin, const FVector& BoxExtent)
+{
+	/**
+	 * # Function: Update()
+	 *
+	 * ## Brief
+	 * Sets the box of an actor. Actors without a relevant extent are removed.
+	 */
+	if (!IsRelevantExtent(BoxExtent))
+	{
+		Remove(Actor);
+		return;
+	}
+
+	const FBox NewBox = FBox::BuildAABB(Origin, BoxExtent);
+	FBox& Box = Boxes.FindOrAdd(TObjectKey<AActor>(Actor), FBox(ForceInit));
+	const bool bContainsOldBox = NewBox.IsInsideOrOn(Box.Min) && NewBox.IsInsideOrOn(Box.Max);
+	if (Box.IsValid && !bContainsOldBox && TouchesBounds(Box))
+	{
+		bDirty = true;
+	}
+	Box = NewBox;
+	Bounds += NewBox;
+}
+
+void FWorldBounds::Remove(const AActor* Actor)
+{
+	FBox Box;
+	if (Boxes.RemoveAndCopyValue(TObjectKey<AActor>(Actor), Box) && TouchesBounds(Box))
+	{
+		bDirty = true;
+	}
+}
+
+void FWorldBounds::Reset()
+{
+	Boxes.Reset();
+	Bounds = FBox(ForceInit);
+	bDirty = false;
+}
+
+const FBox& FWorldBounds::GetBounds()
+{
+	/**
+	 * # Function: GetBounds()
+	 *
+	 * ## Brief
+	 * Returns the bounds, recomputed first if a box on their edge shrank or was removed.
+	 * The recompute drops the boxes of actors that no longer exist.
+	 */
+	if (bDirty)
+	{
+		Bounds = FBox(ForceInit);
+		for (auto It = Boxes.CreateIterator(); It; ++It)
+		{
+			if (!It.Key().ResolveObjectPtr())
+			{
+				It.RemoveCurrent();
+				continue;
+			}
+			Bounds += It.Value();
+		}
+		bDirty = false;
+		Recomputes++;
+	}
+	return Bounds;
+}
+
+bool FWorldBounds::TouchesBounds(const FBox& Box) const
+{
+	return Box.Min.X <= Bounds.Min.X || Box.Min.Y <= Bounds.Min.Y || Box.Min.Z <= Bounds.Min.Z
+		|| Box.Max.X >= Bounds.Max.X || Box.Max.Y >= Bounds.Max.Y || Box.Max.Z >= Bounds.Max.Z;
+}
@@ -0,0 +1,38 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "UObject/ObjectKey.h"
+
+class AActor;
+
+/**
+ * Bounding box of the story objects, kept up to date as they spawn, move and are destroyed.
+ * See WorldBounds.cpp.
+ */
+class PROJECT_API FWorldBounds
+{
+public:
+	// False for boxes without extent or larger than a level part (light volumes, sky spheres)
+	static bool IsRelevantExtent(const FVector& BoxExtent);
+
+	void Update(const AActor* Actor, const FVector& Origin, const FVector& BoxExtent);
+	void Remove(const AActor* Actor);
+	void Reset();
+
+	// Box around all relevant actors, invalid if there are none
+	const FBox& GetBounds();
+
+	int32 Num() const { return Boxes.Num(); }
+	int32 GetRecomputes() const { return Recomputes; }
+
+private:
+	bool TouchesBounds(const FBox& Box) const;
+
+	// Keyed by object index and serial number, a new actor at the address of a destroyed one gets its own box
+	TMap<TObjectKey<AActor>, FBox> Boxes;
+	FBox Bounds = FBox(ForceInit);
+	bool bDirty = false;
+	int32 Recomputes = 0;
+};
@@ -0,0 +1,153 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "WorldSnapshot.h"
+#include "WorldBounds.h"
+#include "EngineUtils.h"
+#include "GameFramework/Actor.h"
+#include "GameFramework/Pawn.h"
+#include "GameFramework/PlayerController.h"
+
+/**
+ * # File: WorldSnapshot.cpp
+ *
+ * ## Brief
+ * Captures the actor data the story JSON is built from.
+ *
+ * ## Details
+ * Building and serializing the environment JSON is the expensive part of a request, but only reading
+ * the actors has to happen on the game thread. `Capture()` copies names, positions, bounds and tags into
+ * plain arrays. The snapshot is not changed afterwards, so the JSON can be built from it on a worker thread
+ * while the game keeps running. See `AGameStateStoryGen::BuildEnvironment()` and `AprojectGameMode::BuildWorldDataJson()`.
+ */
+
+FString FActorSnapshot::FindTag(const TCHAR* Prefix, const FString& Default) const
+{
+	for (const FString& Tag : Tags)
+	{
+		if (Tag.StartsWith(Prefix))
+		{
+			return Tag.Mid(FCString::Strlen(Prefix)).TrimStartAndEnd();
+		}
+	}
+	return Default;
+}
+
+static void CaptureActor(const AActor* Actor, bool bWithBounds, FActorSnapshot& OutActor)
+{
+	OutActor.Name = Actor->GetName();
+	OutActor.Label = Actor->GetActorLabel();
+	if (OutActor.Label.IsEmpty())
+	{
+		OutActor.Label = OutActor.Name;
+	}
+	OutActor.ClassName = Actor->GetClass()->GetName();
+	OutActor.Position = Actor->GetActorLocation();
+
+	if (bWithBounds)
+	{
+		Actor->GetActorBounds(true, OutActor.BoxOrigin, OutActor.BoxExtent);
+	}
+
+	OutActor.Tags.Reserve(Actor->Tags.Num());
+	for (const FName& Tag : Actor->Tags)
+	{
+		OutActor.Tags.Add(Tag.ToString());
+	}
+}
+
+void FWorldSnapshot::Capture(UWorld* World, bool bStoryObjectsOnly)
+{
+	/**
+	 * # Function: Capture()
+	 *
+	 * ## Brief
+	 * Copies the actors of `World` into the snapshot. Must be called on the game thread.
+	 *
+	 * ## Details
+	 * With `bStoryObjectsOnly` only actors with a `Type:` tag are captured, together with their bounds.
+	 * These are the objects of the story environment, `Bounds` is the box around them.
+	 * Otherwise every actor is captured without bounds.
+	 * The pawn of the first player controller is captured as `Player`.
+	 */
+	Actors.Reset();
+	Bounds = FBox(ForceInit);
+	bHasPlayer = false;
+	bHasWorld = World != nullptr;
+	if (!World)
+	{
+		return;
+	}
+
+	for (TActorIterator<AActor> ActorItr(World); ActorItr; ++ActorItr)
+	{
+		const AActor* Actor = *ActorItr;
+		if (!Actor)
+		{
+			continue;
+		}
+
+		if (bStoryObjectsOnly && !IsStoryObject(Actor))
+		{
+			continue;
+		}
+		FActorSnapshot& Captured = Actors.AddDefaulted_GetRef();
+		CaptureActor(Actor, bStoryObjectsOnly, Captured);
+		if (bStoryObjectsOnly && FWorldBounds::IsRelevantExtent(Captured.BoxExtent))
+		{
+			Bounds += FBox::BuildAABB(Captured.BoxOrigin, Captured.BoxExtent);
+		}
+	}
+
+	CapturePlayer(World);
+}
+
+void FWorldSnapshot::CaptureStoryObjects(UWorld* World, const TSet<TWeakObjectPtr<AActor>>& StoryObjects, const FBox& StoryBounds)
+{
+	/**
+	 * # Function: CaptureStoryObjects()
+	 *
+	 * ## Brief
+	 * Like `Capture()` with `bStoryObjectsOnly`, from a set of story objects kept up to date by the caller.
+	 *
+	 * ## Details
+	 * Only the story objects are visited instead of every actor of the world.
+	 * `StoryBounds` is kept up to date by the caller as well, see `FWorldBounds`. Objects that are gone are skipped.
+	 */
+	Actors.Reset();
+	Bounds = StoryBounds;
+	bHasPlayer = false;
+	bHasWorld = World != nullptr;
+	if (!World)
+	{
+		return;
+	}
+
+	Actors.Reserve(StoryObjects.Num());
+	for (const TWeakObjectPtr<AActor>& StoryObject : StoryObjects)
+	{
+		const AActor* Actor = StoryObject.Get();
+		if (IsValid(Actor))
+		{
+			CaptureActor(Actor, true, Actors.AddDefaulted_GetRef());
+		}
+	}
+
+	CapturePlayer(World);
+}
+
+bool FWorldSnapshot::IsStoryObject(const AActor* Actor)
+{
+	return Actor && Actor->Tags.ContainsByPredicate([](const FName& Tag) { return Tag.ToString().StartsWith(TEXT("Type:")); });
+}
+
+void FWorldSnapshot::CapturePlayer(UWorld* World)
+{
+	APlayerController* PlayerController = World->GetFirstPlayerController();
+	APawn* PlayerPawn = PlayerController ? PlayerController->GetPawn() : nullptr;
+	if (PlayerPawn)
+	{
+		CaptureActor(PlayerPawn, false, Player);
+		bHasPlayer = true;
+	}
+}
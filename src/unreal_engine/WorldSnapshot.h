@@ -0,0 +1,47 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+/**
+ * Copy of the data of one actor, taken on the game thread.
+ */
+struct FActorSnapshot
+{
+	FString Name;
+	FString Label;		// Actor label, or the name if the actor has no label
+	FString ClassName;
+	FVector Position = FVector::ZeroVector;
+	FVector BoxOrigin = FVector::ZeroVector;	// Center of the bounds, not always the actor location
+	FVector BoxExtent = FVector::ZeroVector;
+	TArray<FString> Tags;
+
+	// Value of the first tag starting with Prefix (e.g. "Type:"), trimmed, or Default
+	FString FindTag(const TCHAR* Prefix, const FString& Default) const;
+};
+
+/**
+ * Immutable copy of the world taken on the game thread, so JSON can be built on any thread.
+ * See WorldSnapshot.cpp.
+ */
+struct PROJECT_API FWorldSnapshot
+{
+	TArray<FActorSnapshot> Actors;
+	FActorSnapshot Player;
+	bool bHasPlayer = false;
+	bool bHasWorld = false;
+
+	// Box around the story objects with a relevant extent, see FWorldBounds
+	FBox Bounds = FBox(ForceInit);
+
+	// Game thread only
+	void Capture(UWorld* World, bool bStoryObjectsOnly);
+	void CaptureStoryObjects(UWorld* World, const TSet<TWeakObjectPtr<AActor>>& StoryObjects, const FBox& StoryBounds);
+
+	// Actors with a Type: tag, the objects of the story environment
+	static bool IsStoryObject(const AActor* Actor);
+
+private:
+	void CapturePlayer(UWorld* World);
+};
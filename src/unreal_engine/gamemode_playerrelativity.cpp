@@ -309,13 +309,28 @@ void AprojectGameMode::SendPayload(const FString& Payload, const FString& indica
 	UE_LOG(LogTemp, Log, TEXT("SEND PAYLOAD FUNCTION TRIGGERED"));
 	if (UWorld* World = GetWorld())
 	{
-		HttpHandler = CreateWidget<UHttpHandler_Get>(World, UHttpHandler_Get::StaticClass());
+		// One handler for the whole game, it keeps the prompt sessions of the local server
+		if (!HttpHandler)
+		{
+			HttpHandler = CreateWidget<UHttpHandler_Get>(World, UHttpHandler_Get::StaticClass());
+			if (HttpHandler)
+			{
+				HttpHandler->AddToViewport();
+			}
+		}
 		if (HttpHandler)
 		{
-			HttpHandler->AddToViewport();
 			UE_LOG(LogTemp, Log, TEXT("INSIDE SENDPAYLOAD BLOCK"));
-			HttpHandler->httpSendReq(Payload, question, context);
 
+			// Actors that move in the same window share one request
+			if (PayloadBatcher.Add({ Payload, question, context }))
+			{
+				World->GetTimerManager().SetTimer(BatchTimerHandle, this, &AprojectGameMode::FlushPayloads, PayloadBatcher.WindowSeconds, false);
+			}
+			if (PayloadBatcher.IsFull())
+			{
+				FlushPayloads();
+			}
 		}
 		else
 		{
@@ -324,6 +339,21 @@ void AprojectGameMode::SendPayload(const FString& Payload, const FString& indica
 	}
 }
 
+void AprojectGameMode::FlushPayloads()
+{
+	if (UWorld* World = GetWorld())
+	{
+		World->GetTimerManager().ClearTimer(BatchTimerHandle);
+	}
+
+	TArray<FBatchedPayload> Batch = PayloadBatcher.TakeBatch();
+	if (HttpHandler && Batch.Num() > 0)
+	{
+		HttpHandler->httpSendBatch(Batch);
+		PayloadBatcher.LogStats();
+	}
+}
+
 void AprojectGameMode::GetPlayerRelativity(const AActor* TargetActor)
 {
 	if (!TargetActor || !TrackedObjects.Num())
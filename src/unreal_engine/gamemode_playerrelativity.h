@@ -4,6 +4,7 @@
 
 #include "CoreMinimal.h"
 #include "HttpHandler_Get.h"
+#include "CompletionBatcher.h"
 #include "GameFramework/GameModeBase.h"
 #include "projectGameMode.generated.h"
 
@@ -37,8 +38,10 @@ public:
 
 	// HHTP commication
 	void SendPayload(const FString& Payload, const FString& indicator, const FString& context);
+	void FlushPayloads();
 	FString question_prompt(const FString& indicator);
-	UHttpHandler_Get* HttpHandler;
+	UPROPERTY()
+	UHttpHandler_Get* HttpHandler = nullptr;
 	void httpSendReq(FString Payload, FString question, FString context); 
 
 	// Example variable for Blueprint access
@@ -49,6 +52,10 @@ private:
 	// Timer
 	FTimerHandle TimerHandle;
 
+	// Payloads of actors that moved together, sent as one batched completion
+	FCompletionBatcher PayloadBatcher;
+	FTimerHandle BatchTimerHandle;
+
 	// Tracked objects struct
 	struct FTrackedObject {
 		AActor* Actor;
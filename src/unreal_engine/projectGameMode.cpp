@@ -9,6 +9,8 @@
 #include "Serialization/JsonSerializer.h"
 #include "Dom/JsonObject.h"
 #include "Serialization/JsonReader.h"
+#include "Async/Async.h"
+#include "StoryNumberFormat.h"
 
 
 void AprojectGameMode::BeginPlay()
@@ -48,8 +50,40 @@ void AprojectGameMode::TickForGetWorld()
 
 void AprojectGameMode::wrapper()
 {
+    /*
+       Captures a snapshot of the world on the game thread and builds the JSON from it on a worker thread.
+       The comparison with the previous JSON runs back on the game thread once the JSON is done.
+       A new snapshot is only taken when the previous one is finished.
+    */
     numberOfTicks++;
-    newJSON = GetWorldDataAsJson();
+    if (bWorldDataPending)
+    {
+        return;
+    }
+
+    FWorldSnapshot Snapshot;
+    Snapshot.Capture(GetWorld(), false);
+    bWorldDataPending = true;
+
+    TWeakObjectPtr<AprojectGameMode> WeakThis(this);
+    Async(EAsyncExecution::ThreadPool, [WeakThis, Snapshot = MoveTemp(Snapshot)]()
+        {
+            FString Json = BuildWorldDataJson(Snapshot);
+            AsyncTask(ENamedThreads::GameThread, [WeakThis, Json = MoveTemp(Json)]()
+                {
+                    AprojectGameMode* GameMode = WeakThis.Get();
+                    if (GameMode)
+                    {
+                        GameMode->bWorldDataPending = false;
+                        GameMode->OnWorldDataBuilt(Json);
+                    }
+                });
+        });
+}
+
+void AprojectGameMode::OnWorldDataBuilt(const FString& Json)
+{
+    newJSON = Json;
    // UE_LOG(LogTemp, Log, TEXT("NEWJSON AS: %s"), *newJSON);
     bool is_changed = CompareJsonStrings();
     UpdatePrevJson();
@@ -62,13 +96,21 @@ void AprojectGameMode::wrapper()
 }
 
 FString AprojectGameMode::GetWorldDataAsJson()
+{
+    FWorldSnapshot Snapshot;
+    Snapshot.Capture(GetWorld(), false);
+    return BuildWorldDataJson(Snapshot);
+}
+
+FString AprojectGameMode::BuildWorldDataJson(const FWorldSnapshot& Snapshot)
 {
     /*
        Root JSON Object - creates the root object to hold all data
-       Actors Data - Iterates through actors, creating a JSON object for each actor and adding it to an arrya
+       Actors Data - Iterates through the captured actors, creating a JSON object for each actor and adding it to an arrya
        Player data - Creates json object for the player and adds it to the root object
        Serialize to string - converts the json object into a string using UE's serializer
 
+       Only reads the snapshot, so it can run on any thread.
    */
     TSharedPtr<FJsonObject> RootObject = MakeShareable(new FJsonObject());
     TArray<TSharedPtr<FJsonValue>> ActorsArray;
@@ -76,14 +118,10 @@ FString AprojectGameMode::GetWorldDataAsJson()
     TArray<TSharedPtr<FJsonValue>> GameplayArray;
 
     // Actor Data
-    UWorld* World = GetWorld();
-
-    if (World)
+    if (Snapshot.bHasWorld)
     {
-        for (TActorIterator<AActor> ActorItr(World); ActorItr; ++ActorItr)
+        for (const FActorSnapshot& Actor : Snapshot.Actors)
         {
-            AActor* Actor = *ActorItr;
-
             /*
                 FJsonObject - represents a JSON object in ue. can be used to create or parse json objects
                 TSharedPtr<FJsonObject> - A shared pointer used for handling FJsonObject instances
@@ -93,27 +131,27 @@ FString AprojectGameMode::GetWorldDataAsJson()
             TSharedPtr<FJsonObject> ActorObject = MakeShareable(new FJsonObject());
 
             // basic variables
-            ActorObject->SetStringField(TEXT("Name"), Actor->GetName());
-            ActorObject->SetStringField(TEXT("Class"), Actor->GetClass()->GetName());
+            ActorObject->SetStringField(TEXT("Name"), Actor.Name);
+            ActorObject->SetStringField(TEXT("Class"), Actor.ClassName);
 
             // location nested object (easier for LLM to understand than using string):
             TSharedPtr<FJsonObject> LocationObject = MakeShareable(new FJsonObject());
-            FVector ActorLocation = Actor->GetActorLocation();
-            LocationObject->SetNumberField(TEXT("X"), ActorLocation.X);
-            LocationObject->SetNumberField(TEXT("Y"), ActorLocation.Y);
-            LocationObject->SetNumberField(TEXT("Z"), ActorLocation.Z);
+            // whole centimetres, sub-centimetre jitter is not a change of the world
+            FStoryNumberFormat::SetNumberField(*LocationObject, TEXT("X"), Actor.Position.X, EStoryNumberPrecision::Centimetre);
+            FStoryNumberFormat::SetNumberField(*LocationObject, TEXT("Y"), Actor.Position.Y, EStoryNumberPrecision::Centimetre);
+            FStoryNumberFormat::SetNumberField(*LocationObject, TEXT("Z"), Actor.Position.Z, EStoryNumberPrecision::Centimetre);
             ActorObject->SetObjectField(TEXT("Location"), LocationObject);
 
             TArray<TSharedPtr<FJsonValue>> TagsArray;
 
             // categorize / tags
-            if (Actor->GetClass()->GetName() == TEXT("SkyLight"))
+            if (Actor.ClassName == TEXT("SkyLight"))
             {
                 TagsArray.Add(MakeShareable(new FJsonValueString(TEXT("Environment"))));
                 TagsArray.Add(MakeShareable(new FJsonValueString(TEXT("Lighting"))));
                 LightingArray.Add(MakeShareable(new FJsonValueObject(ActorObject)));
             }
-            else if (Actor->GetClass()->GetName() == TEXT("PlayerStart"))
+            else if (Actor.ClassName == TEXT("PlayerStart"))
             {
                 TagsArray.Add(MakeShareable(new FJsonValueString(TEXT("Gameplay"))));
                 TagsArray.Add(MakeShareable(new FJsonValueString(TEXT("Spawn"))));
@@ -135,35 +173,31 @@ FString AprojectGameMode::GetWorldDataAsJson()
 
     // Player Data
     TSharedPtr<FJsonObject> PlayerObject = MakeShareable(new FJsonObject());
-    APlayerController* PlayerController = World ? World->GetFirstPlayerController() : nullptr;
-    if (PlayerController)
+    if (Snapshot.bHasPlayer)
     {
-        APawn* PlayerPawn = PlayerController->GetPawn();
-        if (PlayerPawn)
-        {
-            // Create a JSON object for the player
-            PlayerObject->SetStringField(TEXT("Name"), PlayerPawn->GetName());
-            PlayerObject->SetStringField(TEXT("Class"), PlayerPawn->GetClass()->GetName());
-
-            // nested location object
-            TSharedPtr<FJsonObject> PlayerLocationObject = MakeShareable(new FJsonObject());
-            FVector PlayerLocation = PlayerPawn->GetActorLocation();
-            PlayerLocationObject->SetNumberField(TEXT("X"), PlayerLocation.X);
-            PlayerLocationObject->SetNumberField(TEXT("Y"), PlayerLocation.Y);
-            PlayerLocationObject->SetNumberField(TEXT("Z"), PlayerLocation.Z);
-            PlayerObject->SetObjectField(TEXT("Location"), PlayerLocationObject);
-
-            // tags and player states ( not sure if state is nesseccary)
-            TArray<TSharedPtr<FJsonValue>> PlayerTags;
-            PlayerTags.Add(MakeShareable(new FJsonValueString(TEXT("Player"))));
-            PlayerTags.Add(MakeShareable(new FJsonValueString(TEXT("Controllable"))));
-            PlayerObject->SetArrayField(TEXT("Tags"), PlayerTags);
-
-            TSharedPtr<FJsonObject> PlayerStateObject = MakeShareable(new FJsonObject());
-            PlayerStateObject->SetNumberField(TEXT("Health"), 100); // Example value 
-            PlayerStateObject->SetStringField(TEXT("Status"), TEXT("Idle")); // Example state 
-            PlayerObject->SetObjectField(TEXT("State"), PlayerStateObject);
-        }
+        const FActorSnapshot& PlayerPawn = Snapshot.Player;
+
+        // Create a JSON object for the player
+        PlayerObject->SetStringField(TEXT("Name"), PlayerPawn.Name);
+        PlayerObject->SetStringField(TEXT("Class"), PlayerPawn.ClassName);
+
+        // nested location object
+        TSharedPtr<FJsonObject> PlayerLocationObject = MakeShareable(new FJsonObject());
+        FStoryNumberFormat::SetNumberField(*PlayerLocationObject, TEXT("X"), PlayerPawn.Position.X, EStoryNumberPrecision::Centimetre);
+        FStoryNumberFormat::SetNumberField(*PlayerLocationObject, TEXT("Y"), PlayerPawn.Position.Y, EStoryNumberPrecision::Centimetre);
+        FStoryNumberFormat::SetNumberField(*PlayerLocationObject, TEXT("Z"), PlayerPawn.Position.Z, EStoryNumberPrecision::Centimetre);
+        PlayerObject->SetObjectField(TEXT("Location"), PlayerLocationObject);
+
+        // tags and player states ( not sure if state is nesseccary)
+        TArray<TSharedPtr<FJsonValue>> PlayerTags;
+        PlayerTags.Add(MakeShareable(new FJsonValueString(TEXT("Player"))));
+        PlayerTags.Add(MakeShareable(new FJsonValueString(TEXT("Controllable"))));
+        PlayerObject->SetArrayField(TEXT("Tags"), PlayerTags);
+
+        TSharedPtr<FJsonObject> PlayerStateObject = MakeShareable(new FJsonObject());
+        PlayerStateObject->SetNumberField(TEXT("Health"), 100); // Example value 
+        PlayerStateObject->SetStringField(TEXT("Status"), TEXT("Idle")); // Example state 
+        PlayerObject->SetObjectField(TEXT("State"), PlayerStateObject);
     }
     RootObject->SetObjectField(TEXT("Player"), PlayerObject);
 
@@ -171,7 +205,7 @@ FString AprojectGameMode::GetWorldDataAsJson()
     TSharedRef<TJsonWriter<>> Writer = TJsonWriterFactory<>::Create(&JSONString);
     FJsonSerializer::Serialize(RootObject.ToSharedRef(), Writer);
 
-    return *JSONString;
+    return JSONString;
 }
 
 
@@ -4,6 +4,7 @@
 
 #include "CoreMinimal.h"
 #include "HttpHandler_Get.h"
+#include "WorldSnapshot.h"
 #include "GameFramework/GameModeBase.h"
 #include "projectGameMode.generated.h"
 
@@ -20,10 +21,13 @@ public:
 
 	FTimerHandle TimerHandle;
 	int numberOfTicks;
+	bool bWorldDataPending = false;
 
 	void TickForGetWorld();
 	void wrapper();
+	void OnWorldDataBuilt(const FString& Json);
 	FString GetWorldDataAsJson();
+	static FString BuildWorldDataJson(const FWorldSnapshot& Snapshot);
 	bool CompareJsonStrings();
 	void UpdatePrevJson();
 	void HandleWorldDataChange();
@@ -7,9 +7,21 @@
 #include "Blueprint/UserWidget.h"
 #include "HttpModule.h"
 #include "Components/TextBlock.h"
+#include "CompletionSession.h"
+#include "CompletionBatcher.h"
 #include "HttpHandler_Get.generated.h"
 
 
+/**
+ * Prompt of a batch, kept until the response so it can be sent again on its own.
+ */
+struct FBatchedPrompt
+{
+	FString Prompt;
+	int32 Slot = INDEX_NONE;
+	FString Context;
+};
+
 UCLASS(Blueprintable)
 class PROJECT_API UHttpHandler_Get : public UUserWidget
 {
@@ -18,9 +30,32 @@ class PROJECT_API UHttpHandler_Get : public UUserWidget
 
 public:
 	virtual void NativeConstruct() override;
+	virtual void NativeDestruct() override;
 	void httpSendReq(FString Payload, FString question, FString context);
+	void httpSendBatch(const TArray<FBatchedPayload>& Batch);
 	FString LLM_repsonse;
 	FString TrimResponse(const FString& InputString);
+	void HandleResponse(const FString& AIResponse, const FString& context);
+
+	// Use the in-process model when it is built in and a model file is found, LM Studio otherwise
+	UPROPERTY(BlueprintReadWrite, EditAnywhere, Category = "LLM-Service")
+	bool bUseLocalModel = true;
+
+	UPROPERTY(BlueprintReadWrite, EditAnywhere, Category = "LLM-Service")
+	int32 LocalMaxTokens = 64;
+
+	// Scene payloads in the compact encoding of FStorySceneEncoder instead of JSON, per backend.
+	// The in-process model tokenizes on the CPU of the game and gains the most.
+	UPROPERTY(BlueprintReadWrite, EditAnywhere, Category = "LLM-Service")
+	bool bCompactSceneEncodingLocal = true;
+
+	UPROPERTY(BlueprintReadWrite, EditAnywhere, Category = "LLM-Service")
+	bool bCompactSceneEncodingServer = false;
+
+	// Parallel slots of the local server (llama.cpp --parallel). Single prompts of a session are pinned to slot 0 to
+	// ServerSlots - 1, 0 sends no id_slot and leaves the choice to the server. Batches are never pinned.
+	UPROPERTY(BlueprintReadWrite, EditAnywhere, Category = "LLM-Service")
+	int32 ServerSlots = 0;
 	//void FetchGameState();
 
 	UPROPERTY(BlueprintReadWrite, EditAnywhere, meta = (BindWidget))
@@ -29,4 +64,32 @@ public:
 
 private:
 	void OnResponseReceived(FHttpRequestPtr Request, FHttpResponsePtr Response, bool bWasSuccessful, FString context);
+	void OnBatchResponseReceived(FHttpRequestPtr Request, FHttpResponsePtr Response, bool bWasSuccessful, TArray<FBatchedPrompt> Prompts);
+
+	// HTTP request of prompts that are already built, Slot is sent as id_slot unless it is INDEX_NONE
+	void SendPrompt(const FString& Prompt, int32 Slot, const FString& Context);
+	// HTTP request of the prompts of a batch, without id_slot
+	void SendBatchRequest(TArray<FBatchedPrompt> Prompts);
+	FCompletionSession& GetSession(const FString& question, const FString& context, bool bCompact);
+
+	// The in-process model takes the requests, see bUseLocalModel
+	bool UsesLocalModel() const;
+	bool UsesCompactEncoding() const { return UsesLocalModel() ? bCompactSceneEncodingLocal : bCompactSceneEncodingServer; }
+
+	// A request went to the in-process model, its statistics are logged when the widget is destructed
+	bool bUsedLocalModel = false;
+
+	// Prompts per request and generated tokens per second of the HTTP backend
+	void BeginRequest(int32 NumPrompts);
+	void EndRequest();
+	void RecordResponse(const TSharedPtr<FJsonValue>& JsonResponse, TConstArrayView<FString> Texts);
+	void LogRequestStats() const;
+	FCompletionBatchStats RequestStats;
+	int32 NumPendingRequests = 0;
+	int32 NumResponses = 0;
+	double BusySince = 0.0;
+
+	// One append-only prompt per question, context and encoding, each in its own server slot while there are enough slots.
+	// Game states and actor moves share a question, their events differ in size and would roll each other over.
+	TMap<FString, FCompletionSession> Sessions;
 };
@@ -10,6 +10,21 @@
 #include "Misc/Paths.h"
 #include "HAL/PlatformFilemanager.h"
 #include "Engine/Engine.h"
+#include "LocalNarrationModel.h"
+#include "StorySceneEncoder.h"
+
+static FString EncodeScenePayload(const FString& Payload)
+{
+    // Payloads that are not a JSON object are sent as they are. One line, the session has one event per line.
+    TSharedPtr<FJsonObject> Object;
+    if (!FJsonSerializer::Deserialize(TJsonReaderFactory<>::Create(Payload), Object) || !Object.IsValid())
+    {
+        return Payload;
+    }
+    FStorySceneEncodingOptions Options;
+    Options.bSingleLine = true;
+    return FStorySceneEncoder::Encode(Object, Options);
+}
 
 void UHttpHandler_Get::NativeConstruct()
 {
@@ -27,28 +42,85 @@ void UHttpHandler_Get::NativeConstruct()
     }
 }
 
+void UHttpHandler_Get::NativeDestruct()
+{
+    if (RequestStats.Batches > 0)
+    {
+        LogRequestStats();
+    }
+
+    // The model is shared by all handlers, its statistics cover every request sent to it so far
+    if (bUsedLocalModel)
+    {
+        if (TSharedPtr<FLocalNarrationModel, ESPMode::ThreadSafe> LocalModel = FLocalNarrationModel::GetShared())
+        {
+            LocalModel->LogStats();
+        }
+    }
+
+    Super::NativeDestruct();
+}
+
 void UHttpHandler_Get::httpSendReq(FString Payload, FString question, FString context)
 {
-    FHttpModule* Http = &FHttpModule::Get();
-    TSharedRef<IHttpRequest, ESPMode::ThreadSafe> Request = Http->CreateRequest();
+    // Same prefix as the last request of this question, the server only computes the new event
+    const bool bCompact = UsesCompactEncoding();
+    FCompletionSession& Session = GetSession(question, context, bCompact);
+    FString prompt = Session.BuildPrompt(bCompact ? EncodeScenePayload(Payload) : Payload);
+
+    // In-process model, same prompt and same response handling without the HTTP hop
+    TSharedPtr<FLocalNarrationModel, ESPMode::ThreadSafe> LocalModel = bUseLocalModel ? FLocalNarrationModel::GetShared() : nullptr;
+    if (LocalModel.IsValid())
+    {
+        bUsedLocalModel = true;
+        TWeakObjectPtr<UHttpHandler_Get> WeakThis(this);
+        const int32 Slot = Session.GetSlot();
+        LocalModel->Submit(prompt, LocalMaxTokens, [WeakThis, prompt, Slot, context](bool bSuccess, const FString& AIResponse)
+            {
+                UHttpHandler_Get* Handler = WeakThis.Get();
+                if (!Handler)
+                {
+                    return;
+                }
+                if (bSuccess)
+                {
+                    Handler->HandleResponse(AIResponse, context);
+                    return;
+                }
+                // The prompt does not fit the context or the model failed, LM Studio gets the same prompt
+                UE_LOG(LogTemp, Warning, TEXT("Local narration model failed, sending the prompt to the HTTP backend."));
+                Handler->SendPrompt(prompt, Slot, context);
+            });
+        return;
+    }
 
-    FString prompt = question + Payload;
+    SendPrompt(prompt, Session.GetSlot(), context);
+}
 
+void UHttpHandler_Get::SendPrompt(const FString& Prompt, int32 Slot, const FString& Context)
+{
     TSharedPtr<FJsonObject> JsonPayload = MakeShareable(new FJsonObject);
-    JsonPayload->SetStringField(TEXT("prompt"), prompt);
+    JsonPayload->SetStringField(TEXT("prompt"), Prompt);
+    JsonPayload->SetBoolField(TEXT("cache_prompt"), true);
+    if (Slot != INDEX_NONE)
+    {
+        JsonPayload->SetNumberField(TEXT("id_slot"), Slot);
+    }
 
     FString SerializedPayload;
     TSharedRef<TJsonWriter<>> Writer = TJsonWriterFactory<>::Create(&SerializedPayload);
     FJsonSerializer::Serialize(JsonPayload.ToSharedRef(), Writer);
 
+    TSharedRef<IHttpRequest, ESPMode::ThreadSafe> Request = FHttpModule::Get().CreateRequest();
     Request->SetURL(TEXT("http://127.0.0.1:1234/v1/completions")); // LM Studio URL
     Request->SetVerb(TEXT("POST"));
     Request->SetHeader(TEXT("Content-Type"), TEXT("application/json; charset=utf-8"));
 
     Request->SetContentAsString(SerializedPayload);
-    Request->OnProcessRequestComplete().BindUObject(this, &UHttpHandler_Get::OnResponseReceived, context);
+    Request->OnProcessRequestComplete().BindUObject(this, &UHttpHandler_Get::OnResponseReceived, Context);
     if (Request->ProcessRequest())
     {
+        BeginRequest(1);
         UE_LOG(LogTemp, Log, TEXT("Payload sent: %s"), *SerializedPayload);
     }
     else
@@ -57,8 +129,194 @@ void UHttpHandler_Get::httpSendReq(FString Payload, FString question, FString co
     }
 }
 
+void UHttpHandler_Get::httpSendBatch(const TArray<FBatchedPayload>& Batch)
+{
+    // The in-process model runs one prompt at a time anyway, it gets them one by one
+    if (Batch.Num() == 1 || UsesLocalModel())
+    {
+        for (const FBatchedPayload& Item : Batch)
+        {
+            httpSendReq(Item.Payload, Item.Question, Item.Context);
+        }
+        return;
+    }
+
+    // The payloads of each session, in the order of the batch
+    const bool bCompact = UsesCompactEncoding();
+    TArray<FCompletionSession*> BatchSessions;
+    TArray<TArray<int32>> SessionItems;
+    for (int32 i = 0; i < Batch.Num(); i++)
+    {
+        FCompletionSession* Session = &GetSession(Batch[i].Question, Batch[i].Context, bCompact);
+        int32 SessionIndex = BatchSessions.Find(Session);
+        if (SessionIndex == INDEX_NONE)
+        {
+            SessionIndex = BatchSessions.Add(Session);
+            SessionItems.AddDefaulted();
+        }
+        SessionItems[SessionIndex].Add(i);
+    }
+
+    // One prompt per payload. Payloads of the same session extend the same transcript, no prompt repeats the others.
+    TArray<FBatchedPrompt> Prompts;
+    Prompts.SetNum(Batch.Num());
+    for (int32 SessionIndex = 0; SessionIndex < BatchSessions.Num(); SessionIndex++)
+    {
+        TArray<FString> Events;
+        for (int32 Item : SessionItems[SessionIndex])
+        {
+            Events.Add(bCompact ? EncodeScenePayload(Batch[Item].Payload) : Batch[Item].Payload);
+        }
+        TArray<FString> SessionPrompts;
+        BatchSessions[SessionIndex]->BuildPrompts(Events, SessionPrompts);
+        for (int32 i = 0; i < SessionPrompts.Num(); i++)
+        {
+            const int32 Item = SessionItems[SessionIndex][i];
+            Prompts[Item] = { MoveTemp(SessionPrompts[i]), BatchSessions[SessionIndex]->GetSlot(), Batch[Item].Context };
+        }
+    }
+
+    // Not pinned to a slot, the server computes the prompts of the batch in parallel slots
+    SendBatchRequest(MoveTemp(Prompts));
+}
+
+void UHttpHandler_Get::SendBatchRequest(TArray<FBatchedPrompt> Prompts)
+{
+    // The choices come back with the index of their prompt
+    TArray<TSharedPtr<FJsonValue>> PromptValues;
+    for (const FBatchedPrompt& Prompt : Prompts)
+    {
+        PromptValues.Add(MakeShareable(new FJsonValueString(Prompt.Prompt)));
+    }
+
+    TSharedPtr<FJsonObject> JsonPayload = MakeShareable(new FJsonObject);
+    JsonPayload->SetArrayField(TEXT("prompt"), PromptValues);
+    JsonPayload->SetBoolField(TEXT("cache_prompt"), true);
+
+    FString SerializedPayload;
+    TSharedRef<TJsonWriter<>> Writer = TJsonWriterFactory<>::Create(&SerializedPayload);
+    FJsonSerializer::Serialize(JsonPayload.ToSharedRef(), Writer);
+
+    const int32 NumPrompts = Prompts.Num();
+    TSharedRef<IHttpRequest, ESPMode::ThreadSafe> Request = FHttpModule::Get().CreateRequest();
+    Request->SetURL(TEXT("http://127.0.0.1:1234/v1/completions")); // LM Studio URL
+    Request->SetVerb(TEXT("POST"));
+    Request->SetHeader(TEXT("Content-Type"), TEXT("application/json; charset=utf-8"));
+    Request->SetContentAsString(SerializedPayload);
+    Request->OnProcessRequestComplete().BindUObject(this, &UHttpHandler_Get::OnBatchResponseReceived, MoveTemp(Prompts));
+    if (Request->ProcessRequest())
+    {
+        BeginRequest(NumPrompts);
+        UE_LOG(LogTemp, Log, TEXT("Batch of %d prompts sent."), NumPrompts);
+    }
+    else
+    {
+        UE_LOG(LogTemp, Error, TEXT("Failed to send batch of %d prompts."), NumPrompts);
+    }
+}
+
+void UHttpHandler_Get::OnBatchResponseReceived(FHttpRequestPtr Request, FHttpResponsePtr Response, bool bWasSuccessful, TArray<FBatchedPrompt> Prompts)
+{
+    EndRequest();
+
+    // A completion with choices, or an array with one result per prompt from llama.cpp
+    TSharedPtr<FJsonValue> JsonResponse;
+    TArray<FString> Texts;
+    if (!bWasSuccessful || !Response.IsValid()
+        || !FJsonSerializer::Deserialize(TJsonReaderFactory<>::Create(Response->GetContentAsString()), JsonResponse)
+        || !FCompletionBatcher::Demultiplex(JsonResponse, Prompts.Num(), Texts))
+    {
+        // The server may not take prompt arrays, every prompt is sent again on its own
+        UE_LOG(LogTemp, Warning, TEXT("Batched HTTP request failed or response is invalid, sending %d prompts one by one."), Prompts.Num());
+        for (const FBatchedPrompt& Prompt : Prompts)
+        {
+            SendPrompt(Prompt.Prompt, Prompt.Slot, Prompt.Context);
+        }
+        return;
+    }
+
+    RecordResponse(JsonResponse, Texts);
+
+    // Responses to the same file are joined, one after the other would overwrite each other
+    TMap<FString, FString> ContextTexts;
+    for (int32 i = 0; i < Prompts.Num(); i++)
+    {
+        const FString Text = TrimResponse(Texts[i]).TrimStartAndEnd();
+        if (Text.IsEmpty())
+        {
+            // Its event is in the session already, the prompt is sent again on its own
+            UE_LOG(LogTemp, Warning, TEXT("No choice for prompt %d of the batch, sending it again."), i);
+            SendPrompt(Prompts[i].Prompt, Prompts[i].Slot, Prompts[i].Context);
+            continue;
+        }
+        FString& Joined = ContextTexts.FindOrAdd(Prompts[i].Context);
+        Joined += Joined.IsEmpty() ? Text : TEXT("\n") + Text;
+    }
+    for (const TPair<FString, FString>& ContextText : ContextTexts)
+    {
+        HandleResponse(ContextText.Value, ContextText.Key);
+    }
+}
+
+bool UHttpHandler_Get::UsesLocalModel() const
+{
+    return bUseLocalModel && FLocalNarrationModel::GetShared().IsValid();
+}
+
+FCompletionSession& UHttpHandler_Get::GetSession(const FString& question, const FString& context, bool bCompact)
+{
+    // The encoding is part of the key, compact events need the legend in the prefix
+    const FString Key = FString::Printf(TEXT("%s\x01%s%s"), *question, *context, bCompact ? TEXT("\x01compact") : TEXT(""));
+    FCompletionSession* Session = Sessions.Find(Key);
+    if (!Session)
+    {
+        Session = &Sessions.Add(Key);
+        // More questions than slots share them, a session can then evict the cache of another one
+        const FString Prefix = bCompact ? question + FStorySceneEncoder::GetLegend() + TEXT("\n") : question;
+        Session->Start(Prefix, ServerSlots > 0 ? (Sessions.Num() - 1) % ServerSlots : INDEX_NONE);
+    }
+    return *Session;
+}
+
+void UHttpHandler_Get::BeginRequest(int32 NumPrompts)
+{
+    // Only the time with requests in flight counts, overlapping requests are counted once
+    if (NumPendingRequests++ == 0)
+    {
+        BusySince = FPlatformTime::Seconds();
+    }
+    RequestStats.Batches++;
+    RequestStats.Payloads += NumPrompts;
+}
+
+void UHttpHandler_Get::EndRequest()
+{
+    if (NumPendingRequests > 0 && --NumPendingRequests == 0)
+    {
+        RequestStats.ResponseSeconds += FPlatformTime::Seconds() - BusySince;
+    }
+}
+
+void UHttpHandler_Get::RecordResponse(const TSharedPtr<FJsonValue>& JsonResponse, TConstArrayView<FString> Texts)
+{
+    // Throughput of the server with the batch sizes of this session, logged every few responses
+    RequestStats.CompletionTokens += FCompletionBatcher::CountCompletionTokens(JsonResponse, Texts);
+    if (++NumResponses % 16 == 0)
+    {
+        LogRequestStats();
+    }
+}
+
+void UHttpHandler_Get::LogRequestStats() const
+{
+    UE_LOG(LogTemp, Log, TEXT("Completion requests: %lld prompts in %lld requests (%.2f per request), %lld tokens generated at %.1f tokens/s."),
+        RequestStats.Payloads, RequestStats.Batches, RequestStats.GetAverageBatchSize(), RequestStats.CompletionTokens, RequestStats.GetTokensPerSecond());
+}
+
 void UHttpHandler_Get::OnResponseReceived(FHttpRequestPtr Request, FHttpResponsePtr Response, bool bWasSuccessful, FString context)
 {
+    EndRequest();
+
     if (bWasSuccessful && Response.IsValid())
     {
         UE_LOG(LogTemp, Warning, TEXT("HTTP request was successful."));
@@ -84,37 +342,8 @@ void UHttpHandler_Get::OnResponseReceived(FHttpRequestPtr Request, FHttpResponse
                         FString AIResponse;
                         if (ChoiceObject->TryGetStringField(TEXT("text"), AIResponse))
                         {
-                            if (AIResponse != "")
-                            {
-                                UE_LOG(LogTemp, Warning, TEXT("AI response: %s"), *AIResponse);
-
-                                FString FileContent = TrimResponse(*AIResponse);
-                                FString FilePath;
-
-                                if (context == "WholeGameState")
-                                {
-                                    FilePath = FPaths::ProjectDir() + TEXT("LLM_Response/Whole_LLM_response.txt");
-                                }
-                                else if (context == "Actor_Relocation")
-                                {
-                                    FilePath = FPaths::ProjectDir() + TEXT("LLM_Response/Actor_LLM_response.txt");
-                                }
-                                else
-                                {
-                                    FilePath = FPaths::ProjectDir() + TEXT("LLM_Response/DefaultResponse.txt"); 
-                                }
-
-                                UE_LOG(LogTemp, Log, TEXT("RESPONSE IS: %s"), *FileContent);
-
-                                if (FFileHelper::SaveStringToFile(FileContent, *FilePath))
-                                {
-                                    UE_LOG(LogTemp, Log, TEXT("File written successfully to: %s"), *FilePath);
-                                }
-                                else
-                                {
-                                    UE_LOG(LogTemp, Error, TEXT("Failed to write to file: %s"), *FilePath);
-                                }
-                            }
+                            RecordResponse(MakeShareable(new FJsonValueObject(JsonResponse)), MakeArrayView(&AIResponse, 1));
+                            HandleResponse(AIResponse, context);
                             return;
                         }
                         else
@@ -148,6 +377,43 @@ void UHttpHandler_Get::OnResponseReceived(FHttpRequestPtr Request, FHttpResponse
     }
 }
 
+void UHttpHandler_Get::HandleResponse(const FString& AIResponse, const FString& context)
+{
+    // Shared by the HTTP and the in-process backend
+    if (AIResponse == "")
+    {
+        return;
+    }
+    UE_LOG(LogTemp, Warning, TEXT("AI response: %s"), *AIResponse);
+
+    FString FileContent = TrimResponse(*AIResponse);
+    FString FilePath;
+
+    if (context == "WholeGameState")
+    {
+        FilePath = FPaths::ProjectDir() + TEXT("LLM_Response/Whole_LLM_response.txt");
+    }
+    else if (context == "Actor_Relocation")
+    {
+        FilePath = FPaths::ProjectDir() + TEXT("LLM_Response/Actor_LLM_response.txt");
+    }
+    else
+    {
+        FilePath = FPaths::ProjectDir() + TEXT("LLM_Response/DefaultResponse.txt"); 
+    }
+
+    UE_LOG(LogTemp, Log, TEXT("RESPONSE IS: %s"), *FileContent);
+
+    if (FFileHelper::SaveStringToFile(FileContent, *FilePath))
+    {
+        UE_LOG(LogTemp, Log, TEXT("File written successfully to: %s"), *FilePath);
+    }
+    else
+    {
+        UE_LOG(LogTemp, Error, TEXT("Failed to write to file: %s"), *FilePath);
+    }
+}
+
 FString UHttpHandler_Get::TrimResponse(const FString& InputString)
 {
     FString Result = InputString;
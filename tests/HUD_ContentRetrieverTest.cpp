@@ -48,47 +48,24 @@ bool FHUDContentRetriever_NativeTickTest::RunTest(const FString& Parameters)
 
     TestNotNull("GameStateText should not be null", HUDWidget->GameStateText);
 
-    AddInfo("Resetting prevResponse...");
-    HUDWidget->prevResponse = TEXT("");
+    AddInfo("Pushing a response as AGameStateStoryGen::OnNarration does...");
+    FString MockResponse = TEXT("First Response");
+    HUDWidget->ProcessNewResponse(MockResponse);
+    TestEqual("GameStateText should update with the pushed response", MockTextBlock->GetText().ToString(), MockResponse);
+    TestTrue("GameStateBorder should be visible", MockBorder->GetVisibility() == ESlateVisibility::Visible);
 
-    AddInfo("Setting up mock file...");
+    AddInfo("Writing a different response to the old response file...");
     FString DirectoryPath = FPaths::ProjectDir() + TEXT("LLM_Response");
     FString MockFilePath = DirectoryPath + TEXT("/LLM_response.txt");
-    FString MockResponse = TEXT("First Response");
-
-    // Ensure the directory exists
     if (!IFileManager::Get().DirectoryExists(*DirectoryPath))
     {
         IFileManager::Get().MakeDirectory(*DirectoryPath);
     }
-
-    // Write the mock file
-    bool bFileWritten = FFileHelper::SaveStringToFile(MockResponse, *MockFilePath);
-    if (!bFileWritten)
-    {
-        AddError(FString::Printf(TEXT("Failed to write mock file: %s"), *MockFilePath));
-        return false; // Stop the test if the file cannot be written
-    }
-
-    AddInfo(FString::Printf(TEXT("Mock file written to: %s"), *MockFilePath));
-
-    // Attempt to read the mock file
-    FString FileContent;
-    bool bFileRead = FFileHelper::LoadFileToString(FileContent, *MockFilePath);
-    if (!bFileRead)
-    {
-        AddError(FString::Printf(TEXT("Failed to read mock file: %s"), *MockFilePath));
-        return false; // Stop the test if the file cannot be read
-    }
-
-    AddInfo(FString::Printf(TEXT("File content read: %s"), *FileContent));
-    TestEqual("Mock file content should match the expected response", FileContent, MockResponse);
+    FFileHelper::SaveStringToFile(TEXT("Polled Response"), *MockFilePath);
 
     AddInfo("Simulating 1.1 seconds in one tick...");
     HUDWidget->NativeTick(FGeometry(), 1.1f);
-
-    AddInfo(FString::Printf(TEXT("Validating GameStateText. Expected: '%s', Actual: '%s'"), *MockResponse, *MockTextBlock->GetText().ToString()));
-    TestEqual("GameStateText should update with the response from file", MockTextBlock->GetText().ToString(), MockResponse);
+    TestEqual("NativeTick should not poll the response file", MockTextBlock->GetText().ToString(), MockResponse);
 
     HUDWidget->RemoveFromRoot();
     IFileManager::Get().Delete(*MockFilePath); // Clean up
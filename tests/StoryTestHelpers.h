@@ -0,0 +1,112 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Dom/JsonObject.h"
+#include "Dom/JsonValue.h"
+#include "StoryEvent.h"
+#include "StorySpeculator.h"
+#include "TrackingSweep.h"
+#include "WorldSnapshot.h"
+
+/**
+ * Fixtures shared by the story tests. Each factory fills in only the fields the tests look at.
+ */
+
+// Scene of one moved object, as sent in the volatile prompt message
+inline TSharedPtr<FJsonObject> MakeScene(const FString& Name, double Distance)
+{
+    TSharedPtr<FJsonObject> Scene = MakeShareable(new FJsonObject());
+    Scene->SetStringField(TEXT("TargetObject"), Name);
+    Scene->SetNumberField(TEXT("Distance"), Distance);
+    return Scene;
+}
+
+// Movement event of an actor at a direction and distance from the player
+inline FStoryEvent MakeTestEvent(const FString& Name, EStoryDirection Direction, double Distance)
+{
+    FStoryEvent Event;
+    Event.ActorName = Name;
+    Event.Direction = Direction;
+    Event.Distance = Distance;
+    Event.TimeStamp = FDateTime::Now().ToString();
+    return Event;
+}
+
+// Object near the player that FStorySpeculator can predict an interaction with
+inline FSpeculationCandidate MakeCandidate(const FString& Name, const FVector& Location)
+{
+    FSpeculationCandidate Candidate;
+    Candidate.ActorName = Name;
+    Candidate.Location = Location;
+    return Candidate;
+}
+
+// Snapshot of a static mesh actor with its label, bounds and tags
+inline FActorSnapshot MakeActor(const FString& Label, const FVector& Position, const FVector& BoxExtent, const TArray<FString>& Tags)
+{
+    FActorSnapshot Actor;
+    Actor.Name = Label + TEXT("_C_0");
+    Actor.Label = Label;
+    Actor.ClassName = TEXT("StaticMeshActor");
+    Actor.Position = Position;
+    Actor.BoxExtent = BoxExtent;
+    Actor.Tags = Tags;
+    return Actor;
+}
+
+// Player at the origin looking along X
+inline FTrackingPlayerView MakePlayer()
+{
+    FTrackingPlayerView Player;
+    Player.Forward = FVector::ForwardVector;
+    Player.Right = FVector::RightVector;
+    Player.bValid = true;
+    return Player;
+}
+
+// Sweeps the positions in NumChunks chunks and returns the objects that moved within 800 units of the player
+inline TArray<FTrackedMovement> SweepPositions(const TArray<FVector>& Current, TArray<FVector>& Previous, const FTrackingPlayerView& Player, int32 NumChunks)
+{
+    TArray<FTrackedMovement> Moved;
+    FTrackingSweep::Run(0, Current.Num(), NumChunks, [&Current, &Previous, &Player](int32 Index, FTrackedMovement& OutMovement)
+    {
+        if (Current[Index].Equals(Previous[Index], KINDA_SMALL_NUMBER))
+        {
+            return false;
+        }
+        Previous[Index] = Current[Index];
+        return FTrackingSweep::GetRelativity(Player, Current[Index], 800.0, OutMovement.Distance, OutMovement.Direction);
+    }, Moved);
+    return Moved;
+}
+
+// JSON vector with x, y and z fields
+inline TSharedPtr<FJsonObject> MakeVectorObject(double X, double Y, double Z)
+{
+    TSharedPtr<FJsonObject> Vector = MakeShareable(new FJsonObject);
+    Vector->SetNumberField(TEXT("x"), X);
+    Vector->SetNumberField(TEXT("y"), Y);
+    Vector->SetNumberField(TEXT("z"), Z);
+    return Vector;
+}
+
+// Start environment with NumObjects interactable crates, positions with decimals to round
+inline TSharedPtr<FJsonObject> MakeTestEnvironment(int32 NumObjects)
+{
+    TSharedPtr<FJsonObject> Environment = MakeShareable(new FJsonObject);
+    Environment->SetStringField(TEXT("game_title"), TEXT("Lantern Hall"));
+
+    TArray<TSharedPtr<FJsonValue>> Objects;
+    for (int32 i = 0; i < NumObjects; i++)
+    {
+        TSharedPtr<FJsonObject> Object = MakeShareable(new FJsonObject);
+        Object->SetStringField(TEXT("name"), FString::Printf(TEXT("Crate_%d"), i));
+        Object->SetStringField(TEXT("description"), TEXT("A wooden crate"));
+        Object->SetBoolField(TEXT("Interactable"), true);
+        Object->SetObjectField(TEXT("position"), MakeVectorObject(1000.24 + i * 100.0, -250.4 + i * 20.0, 12.6));
+        Object->SetObjectField(TEXT("dimensions"), MakeVectorObject(50.0, 50.0, 75.5));
+        Objects.Add(MakeShareable(new FJsonValueObject(Object)));
+    }
+    Environment->SetArrayField(TEXT("objects"), Objects);
+    return Environment;
+}
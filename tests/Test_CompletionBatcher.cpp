@@ -0,0 +1,106 @@
+#include "CoreMinimal.h"
+#include "Misc/AutomationTest.h"
+#include "CompletionBatcher.h"
+#include "Serialization/JsonReader.h"
+#include "Serialization/JsonSerializer.h"
+
+/**
+ * Tests for FCompletionBatcher: batch windows and the choices of a batched response.
+ */
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FCompletionBatcherWindowTest, "Project.GameStateStoryGen.CompletionBatcher.Window", EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::ProductFilter)
+bool FCompletionBatcherWindowTest::RunTest(const FString& Parameters)
+{
+    FCompletionBatcher Batcher;
+    Batcher.MaxBatchSize = 3;
+
+    TestTrue(TEXT("First payload opens the window"), Batcher.Add({ TEXT("{ \"TargetObject\": \"Crate\" }"), TEXT("Q"), TEXT("Actor_Relocation") }));
+    TestFalse(TEXT("Second payload joins it"), Batcher.Add({ TEXT("{ \"TargetObject\": \"Lantern\" }"), TEXT("Q"), TEXT("Actor_Relocation") }));
+    TestFalse(TEXT("Not full yet"), Batcher.IsFull());
+    Batcher.Add({ TEXT("{ \"TargetObject\": \"Rope\" }"), TEXT("Q"), TEXT("Actor_Relocation") });
+    TestTrue(TEXT("Full"), Batcher.IsFull());
+
+    const TArray<FBatchedPayload> Batch = Batcher.TakeBatch();
+    TestEqual(TEXT("Batch size"), Batch.Num(), 3);
+    TestEqual(TEXT("Order is kept"), Batch[1].Payload, FString(TEXT("{ \"TargetObject\": \"Lantern\" }")));
+    TestFalse(TEXT("Nothing pending"), Batcher.HasPending());
+    TestTrue(TEXT("Next payload opens a new window"), Batcher.Add({ TEXT("{}"), TEXT("Q"), TEXT("Actor_Relocation") }));
+    TestEqual(TEXT("Average batch size"), Batcher.GetStats().GetAverageBatchSize(), 3.0);
+
+    return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FCompletionBatcherDemultiplexTest, "Project.GameStateStoryGen.CompletionBatcher.Demultiplex", EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::ProductFilter)
+bool FCompletionBatcherDemultiplexTest::RunTest(const FString& Parameters)
+{
+    // Choices out of order, one prompt without a choice and one index outside the batch
+    const FString Response = TEXT("{\"choices\":[")
+        TEXT("{\"index\":2,\"text\":\"The rope falls.\"},")
+        TEXT("{\"index\":0,\"text\":\"The crate slides.\"},")
+        TEXT("{\"index\":7,\"text\":\"Stray.\"}]}");
+    TSharedPtr<FJsonValue> JsonResponse;
+    TestTrue(TEXT("Response parses"), FJsonSerializer::Deserialize(TJsonReaderFactory<>::Create(Response), JsonResponse));
+
+    TArray<FString> Texts;
+    TestTrue(TEXT("Choices are read"), FCompletionBatcher::Demultiplex(JsonResponse, 3, Texts));
+    TestEqual(TEXT("One text per prompt"), Texts.Num(), 3);
+    TestEqual(TEXT("Prompt 0"), Texts[0], FString(TEXT("The crate slides.")));
+    TestTrue(TEXT("Prompt 1 has no choice"), Texts[1].IsEmpty());
+    TestEqual(TEXT("Prompt 2"), Texts[2], FString(TEXT("The rope falls.")));
+
+    // Without an index the choices are taken in order
+    TSharedPtr<FJsonValue> Unindexed;
+    FJsonSerializer::Deserialize(TJsonReaderFactory<>::Create(TEXT("{\"choices\":[{\"text\":\"A\"},{\"text\":\"B\"}]}")), Unindexed);
+    FCompletionBatcher::Demultiplex(Unindexed, 2, Texts);
+    TestEqual(TEXT("Second choice"), Texts[1], FString(TEXT("B")));
+
+    return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FCompletionBatcherResultArrayTest, "Project.GameStateStoryGen.CompletionBatcher.ResultArray", EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::ProductFilter)
+bool FCompletionBatcherResultArrayTest::RunTest(const FString& Parameters)
+{
+    // llama.cpp answers a multi-prompt request with one result per prompt
+    TSharedPtr<FJsonValue> Completions;
+    FJsonSerializer::Deserialize(TJsonReaderFactory<>::Create(TEXT("[{\"choices\":[{\"index\":0,\"text\":\"A\"}]},{\"choices\":[{\"index\":0,\"text\":\"B\"}]}]")), Completions);
+    TArray<FString> Texts;
+    TestTrue(TEXT("Completions are read"), FCompletionBatcher::Demultiplex(Completions, 2, Texts));
+    TestEqual(TEXT("First completion"), Texts[0], FString(TEXT("A")));
+    TestEqual(TEXT("Second completion, not the choice index"), Texts[1], FString(TEXT("B")));
+
+    TSharedPtr<FJsonValue> Contents;
+    FJsonSerializer::Deserialize(TJsonReaderFactory<>::Create(TEXT("[{\"index\":1,\"content\":\"The rope falls.\"},{\"index\":0,\"content\":\"The crate slides.\"}]")), Contents);
+    TestTrue(TEXT("Contents are read"), FCompletionBatcher::Demultiplex(Contents, 2, Texts));
+    TestEqual(TEXT("Prompt 0 by index"), Texts[0], FString(TEXT("The crate slides.")));
+    TestEqual(TEXT("Prompt 1 by index"), Texts[1], FString(TEXT("The rope falls.")));
+
+    // Anything else makes the handler send the prompts one by one
+    TSharedPtr<FJsonValue> Error;
+    FJsonSerializer::Deserialize(TJsonReaderFactory<>::Create(TEXT("{\"error\":{\"message\":\"prompt must be a string\"}}")), Error);
+    TestFalse(TEXT("Error response is rejected"), FCompletionBatcher::Demultiplex(Error, 2, Texts));
+    TestEqual(TEXT("Still one empty text per prompt"), Texts.Num(), 2);
+
+    return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FCompletionBatcherTokensTest, "Project.GameStateStoryGen.CompletionBatcher.Tokens", EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::ProductFilter)
+bool FCompletionBatcherTokensTest::RunTest(const FString& Parameters)
+{
+    const TArray<FString> Texts = { TEXT("The crate slides."), TEXT("The rope falls.") };
+
+    // OpenAI-style usage of the whole request
+    TSharedPtr<FJsonValue> Usage;
+    FJsonSerializer::Deserialize(TJsonReaderFactory<>::Create(TEXT("{\"choices\":[],\"usage\":{\"completion_tokens\":42}}")), Usage);
+    TestEqual(TEXT("Usage of the request"), FCompletionBatcher::CountCompletionTokens(Usage, Texts), int64(42));
+
+    // llama.cpp results count their own tokens
+    TSharedPtr<FJsonValue> Results;
+    FJsonSerializer::Deserialize(TJsonReaderFactory<>::Create(TEXT("[{\"content\":\"A\",\"tokens_predicted\":12},{\"content\":\"B\",\"tokens_predicted\":30}]")), Results);
+    TestEqual(TEXT("Sum over the results"), FCompletionBatcher::CountCompletionTokens(Results, Texts), int64(42));
+
+    // Without counts the texts are estimated at four characters per token
+    TSharedPtr<FJsonValue> Plain;
+    FJsonSerializer::Deserialize(TJsonReaderFactory<>::Create(TEXT("{\"choices\":[]}")), Plain);
+    TestEqual(TEXT("Estimate from the texts"), FCompletionBatcher::CountCompletionTokens(Plain, Texts), int64((17 + 3) / 4 + (15 + 3) / 4));
+
+    return true;
+}
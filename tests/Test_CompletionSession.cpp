@@ -0,0 +1,104 @@
+#include "CoreMinimal.h"
+#include "Misc/AutomationTest.h"
+#include "CompletionSession.h"
+
+/**
+ * Tests for FCompletionSession: append-only prompts, batches, rollover, the prompt limit with large events
+ * and the share of new prompt characters.
+ */
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FCompletionSessionAppendTest, "Project.GameStateStoryGen.CompletionSession.Append", EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::ProductFilter)
+bool FCompletionSessionAppendTest::RunTest(const FString& Parameters)
+{
+    FCompletionSession Session;
+    Session.Start(TEXT("Write a short scene using the following details in 50 tokens or less.\n"), 2);
+    TestEqual(TEXT("Slot"), Session.GetSlot(), 2);
+
+    const FString First = Session.BuildPrompt(TEXT("{ \"TargetObject\": \"Crate\", \"Distance\": 120.00 }"));
+    const FString Second = Session.BuildPrompt(TEXT("{ \"TargetObject\": \"Lantern\",\n\"Distance\": 80.00 }"));
+    TestTrue(TEXT("Question first"), First.StartsWith(TEXT("Write a short scene")));
+    TestTrue(TEXT("Second prompt extends the first"), Second.StartsWith(First));
+    TestTrue(TEXT("New event is one line at the end"), Second.EndsWith(TEXT("{ \"TargetObject\": \"Lantern\", \"Distance\": 80.00 }\n")));
+    TestEqual(TEXT("New characters of the second prompt"), Session.GetStats().NewChars, int64(Second.Len()));
+
+    return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FCompletionSessionRolloverTest, "Project.GameStateStoryGen.CompletionSession.Rollover", EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::ProductFilter)
+bool FCompletionSessionRolloverTest::RunTest(const FString& Parameters)
+{
+    FCompletionSession Session;
+    Session.MaxPromptChars = 400;
+    Session.KeepEvents = 2;
+    Session.Start(TEXT("Write a short scene.\n"), 0);
+
+    int32 MaxLength = 0;
+    for (int32 i = 0; i < 50; i++)
+    {
+        const FString Prompt = Session.BuildPrompt(FString::Printf(TEXT("{ \"TargetObject\": \"Crate_%02d\", \"Distance\": 100.00 }"), i));
+        MaxLength = FMath::Max(MaxLength, Prompt.Len());
+        TestTrue(TEXT("Prompt keeps the question"), Prompt.StartsWith(TEXT("Write a short scene.\n")));
+    }
+
+    const FCompletionSessionStats& Stats = Session.GetStats();
+    TestTrue(TEXT("Session started over"), Stats.Rollovers > 0);
+    TestTrue(TEXT("Prompt stays within the limit"), MaxLength <= Session.MaxPromptChars);
+    TestTrue(TEXT("Kept events and the new one"), Session.NumEvents() <= 8);
+    AddInfo(FString::Printf(TEXT("%.1f%% of the prompt characters were new to the server."), Stats.GetNewRatio() * 100.0));
+    TestTrue(TEXT("Most of each prompt is reused"), Stats.GetNewRatio() < 0.5);
+
+    return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FCompletionSessionLargeEventTest, "Project.GameStateStoryGen.CompletionSession.LargeEvent", EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::ProductFilter)
+bool FCompletionSessionLargeEventTest::RunTest(const FString& Parameters)
+{
+    FCompletionSession Session;
+    Session.MaxPromptChars = 400;
+    Session.KeepEvents = 4;
+    Session.Start(TEXT("Write a short scene.\n"), 0);
+
+    // Small actor moves, then a whole game state under the same session
+    for (int32 i = 0; i < 4; i++)
+    {
+        Session.BuildPrompt(FString::Printf(TEXT("{ \"TargetObject\": \"Crate_%02d\", \"Distance\": 100.00 }"), i));
+    }
+    const FString GameState = FString::ChrN(300, TEXT('x'));
+    const FString WithGameState = Session.BuildPrompt(GameState);
+    TestTrue(TEXT("Kept events are trimmed to the limit"), WithGameState.Len() <= Session.MaxPromptChars);
+    TestTrue(TEXT("The new event is whole"), WithGameState.EndsWith(GameState + TEXT("\n")));
+    TestTrue(TEXT("Fewer than KeepEvents events kept"), Session.NumEvents() < Session.KeepEvents + 1);
+
+    // The next small event fits next to the game state
+    const FString Next = Session.BuildPrompt(TEXT("{ \"TargetObject\": \"Lantern\" }"));
+    TestTrue(TEXT("Next prompt within the limit"), Next.Len() <= Session.MaxPromptChars);
+
+    // An event larger than a whole prompt is cut
+    const FString Huge = Session.BuildPrompt(FString::ChrN(1000, TEXT('y')));
+    TestTrue(TEXT("Huge event within the limit"), Huge.Len() <= Session.MaxPromptChars);
+    TestTrue(TEXT("Prompt keeps the question"), Huge.StartsWith(TEXT("Write a short scene.\n")));
+    TestEqual(TEXT("One event cut"), Session.GetStats().CutEvents, int64(1));
+
+    return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FCompletionSessionBatchTest, "Project.GameStateStoryGen.CompletionSession.Batch", EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::ProductFilter)
+bool FCompletionSessionBatchTest::RunTest(const FString& Parameters)
+{
+    FCompletionSession Session;
+    Session.Start(TEXT("Write a short scene.\n"), 0);
+    const FString Before = Session.BuildPrompt(TEXT("{ \"TargetObject\": \"Crate\" }"));
+
+    TArray<FString> Prompts;
+    Session.BuildPrompts({ TEXT("{ \"TargetObject\": \"Lantern\" }"), TEXT("{ \"TargetObject\": \"Rope\" }") }, Prompts);
+    TestEqual(TEXT("One prompt per event"), Prompts.Num(), 2);
+    TestTrue(TEXT("Both extend the transcript before the batch"), Prompts[0].StartsWith(Before) && Prompts[1].StartsWith(Before));
+    TestFalse(TEXT("Second prompt does not repeat the first event of the batch"), Prompts[1].Contains(TEXT("Lantern")));
+    TestTrue(TEXT("Second prompt ends with its own event"), Prompts[1].EndsWith(TEXT("{ \"TargetObject\": \"Rope\" }\n")));
+
+    // The next prompt has the whole batch in order
+    const FString After = Session.BuildPrompt(TEXT("{ \"TargetObject\": \"Torch\" }"));
+    TestTrue(TEXT("Batch events are in the transcript"), After.Contains(TEXT("Lantern\" }\n{ \"TargetObject\": \"Rope")));
+    TestEqual(TEXT("Events of the session"), Session.NumEvents(), 4);
+
+    return true;
+}
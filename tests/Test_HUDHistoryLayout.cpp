@@ -0,0 +1,98 @@
+#include "CoreMinimal.h"
+#include "Misc/AutomationTest.h"
+#include "HUD_ContentRetreiver.h"
+#include "Components/TextBlock.h"
+#include "Components/Border.h"
+#include "Components/VerticalBox.h"
+#include "Slate/WidgetRenderer.h"
+#include "Engine/TextureRenderTarget2D.h"
+#include "RenderingThread.h"
+
+/**
+ * Performance test of the HUD history: Slate prepass and paint after each new response,
+ * shifting the text through all blocks (before) against rotating the ring of entries (after).
+ */
+struct FHistoryLayoutTiming
+{
+    double UpdateMs = 0.0;
+    double PrepassMs = 0.0;
+    double PaintMs = 0.0;
+};
+
+static FHistoryLayoutTiming MeasureHistoryLayout(bool bUseLayoutCache, int32 NumResponses)
+{
+    UHUD_ContentRetreiver* HUDWidget = NewObject<UHUD_ContentRetreiver>();
+    HUDWidget->AddToRoot();
+    HUDWidget->bUseLayoutCache = bUseLayoutCache;
+
+    // The three history entries in a panel, as in the widget blueprint
+    UVerticalBox* Panel = NewObject<UVerticalBox>(HUDWidget);
+    for (int32 i = 0; i < 3; i++)
+    {
+        UBorder* Border = NewObject<UBorder>(HUDWidget);
+        UTextBlock* Text = NewObject<UTextBlock>(HUDWidget);
+        Text->SetAutoWrapText(true);
+        Border->SetContent(Text);
+        Panel->AddChildToVerticalBox(Border);
+        HUDWidget->GameStateTexts.Add(Text);
+        HUDWidget->GameStateBorders.Add(Border);
+    }
+
+    const FVector2D DrawSize(800.0, 600.0);
+    TSharedRef<SWidget> SlateWidget = Panel->TakeWidget();
+    FWidgetRenderer Renderer(true, false);
+    UTextureRenderTarget2D* Target = FWidgetRenderer::CreateTargetFor(DrawSize, TF_Bilinear, false);
+    Target->AddToRoot();
+    Renderer.DrawWidget(Target, SlateWidget, DrawSize, 0.0f);
+    FlushRenderingCommands();
+
+    FHistoryLayoutTiming Timing;
+    for (int32 i = 0; i < NumResponses; i++)
+    {
+        // A narration of a few wrapped lines, like the LLM responses
+        HUDWidget->ResponseQueue.Enqueue(FString::Printf(TEXT("Response %d. The wanderer lifts the lantern and its light flickers over the boulders. ")
+            TEXT("A crow lands on the stump and watches the wanderer closely, then the fog rolls in over the clearing."), i));
+
+        double StartTime = FPlatformTime::Seconds();
+        HUDWidget->UpdateTextBlocks();
+        if (bUseLayoutCache)
+        {
+            HUDWidget->ApplyHistoryOrder();
+        }
+        Timing.UpdateMs += (FPlatformTime::Seconds() - StartTime) * 1000.0;
+
+        StartTime = FPlatformTime::Seconds();
+        SlateWidget->SlatePrepass(1.0f);
+        Timing.PrepassMs += (FPlatformTime::Seconds() - StartTime) * 1000.0;
+
+        // Game-thread cost of the paint, the GPU work is flushed outside the measurement
+        StartTime = FPlatformTime::Seconds();
+        Renderer.DrawWidget(Target, SlateWidget, DrawSize, 0.0f);
+        Timing.PaintMs += (FPlatformTime::Seconds() - StartTime) * 1000.0;
+        FlushRenderingCommands();
+    }
+
+    Timing.UpdateMs /= NumResponses;
+    Timing.PrepassMs /= NumResponses;
+    Timing.PaintMs /= NumResponses;
+
+    Target->RemoveFromRoot();
+    HUDWidget->RemoveFromRoot();
+    return Timing;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FHUDHistoryLayoutTest, "Project.HUD.HistoryLayout", EAutomationTestFlags::EditorContext | EAutomationTestFlags::PerfFilter)
+bool FHUDHistoryLayoutTest::RunTest(const FString& Parameters)
+{
+    const int32 NumResponses = 200;
+    const FHistoryLayoutTiming Shift = MeasureHistoryLayout(false, NumResponses);
+    const FHistoryLayoutTiming Ring = MeasureHistoryLayout(true, NumResponses);
+
+    AddInfo(FString::Printf(TEXT("Shift: update %.3f ms, prepass %.3f ms, paint %.3f ms per response"), Shift.UpdateMs, Shift.PrepassMs, Shift.PaintMs));
+    AddInfo(FString::Printf(TEXT("Ring:  update %.3f ms, prepass %.3f ms, paint %.3f ms per response"), Ring.UpdateMs, Ring.PrepassMs, Ring.PaintMs));
+    const double ShiftTotal = Shift.UpdateMs + Shift.PrepassMs + Shift.PaintMs;
+    const double RingTotal = Ring.UpdateMs + Ring.PrepassMs + Ring.PaintMs;
+    AddInfo(FString::Printf(TEXT("Ring takes %.0f%% of the shifting path's update, prepass and paint time"), ShiftTotal > 0.0 ? RingTotal / ShiftTotal * 100.0 : 0.0));
+
+    return true;
+}
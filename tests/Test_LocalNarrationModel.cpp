@@ -0,0 +1,54 @@
+#include "CoreMinimal.h"
+#include "Misc/AutomationTest.h"
+#include "Async/TaskGraphInterfaces.h"
+#include "LocalNarrationModel.h"
+
+/**
+ * Tests for FLocalNarrationModel: the reusable KV cache prefix and the fallback without a loaded model.
+ */
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FLocalNarrationModelPrefixTest, "Project.GameStateStoryGen.LocalModel.Prefix", EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::ProductFilter)
+bool FLocalNarrationModelPrefixTest::RunTest(const FString& Parameters)
+{
+    const TArray<int32> Cached = { 1, 50, 51, 52, 900, 901 };
+
+    // Same instruction, new event
+    TestEqual(TEXT("Shared instruction is reused"), FLocalNarrationModel::GetReusablePrefix(Cached, { 1, 50, 51, 52, 700, 701, 702 }), 4);
+    TestEqual(TEXT("Longer prompt reuses all of the cache"), FLocalNarrationModel::GetReusablePrefix(Cached, { 1, 50, 51, 52, 900, 901, 5 }), 6);
+    TestEqual(TEXT("Shorter prompt"), FLocalNarrationModel::GetReusablePrefix(Cached, { 1, 50 }), 2);
+    TestEqual(TEXT("Different instruction"), FLocalNarrationModel::GetReusablePrefix(Cached, { 1, 60, 51 }), 1);
+    TestEqual(TEXT("Empty cache"), FLocalNarrationModel::GetReusablePrefix({}, { 1, 50 }), 0);
+
+    return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FLocalNarrationModelFallbackTest, "Project.GameStateStoryGen.LocalModel.Fallback", EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::ProductFilter)
+bool FLocalNarrationModelFallbackTest::RunTest(const FString& Parameters)
+{
+    // A model that is not loaded fails right away, so the handler can fall back to HTTP
+    TSharedRef<FLocalNarrationModel, ESPMode::ThreadSafe> Model = MakeShared<FLocalNarrationModel, ESPMode::ThreadSafe>();
+    TestFalse(TEXT("Not loaded"), Model->IsLoaded());
+
+    bool bCalled = false;
+    bool bResult = true;
+    bool bOnGameThread = false;
+    Model->Submit(TEXT("Write a short scene."), 16, [&bCalled, &bResult, &bOnGameThread](bool bSuccess, const FString& Text)
+    {
+        bCalled = true;
+        bResult = bSuccess;
+        bOnGameThread = IsInGameThread();
+    });
+
+    // The completion is queued for the game thread, not called from Submit()
+    TestFalse(TEXT("Not called from Submit()"), bCalled);
+    FTaskGraphInterface::Get().ProcessThreadUntilIdle(ENamedThreads::GameThread);
+    TestTrue(TEXT("Completion called"), bCalled);
+    TestFalse(TEXT("Completion failed"), bResult);
+    TestTrue(TEXT("Completion on the game thread"), bOnGameThread);
+
+    if (!FLocalNarrationModel::IsCompiledIn())
+    {
+        TestFalse(TEXT("No shared model without llama.cpp"), FLocalNarrationModel::GetShared().IsValid());
+    }
+
+    return true;
+}
@@ -0,0 +1,365 @@
+#include "CoreMinimal.h"
+#include "Misc/AutomationTest.h"
+#include "NarrationReplication.h"
+#include "GameStateStoryGen.h"
+#include "StoryNarrationChannel.h"
+#include "GameFramework/PlayerState.h"
+#include "GameFramework/PlayerController.h"
+#include "Kismet/GameplayStatics.h"
+#include "Engine/World.h"
+
+/**
+ * Tests for FNarrationReplicationCodec: phrase codes, announced phrases, snapshots for late joiners,
+ * the dictionaries of the per-player channels, the routing of narrations to the channel of their owner
+ * and the narrations a client assembles from them.
+ */
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FNarrationReplicationRoundTripTest, "Project.GameStateStoryGen.Replication.RoundTrip", EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::ProductFilter)
+bool FNarrationReplicationRoundTripTest::RunTest(const FString& Parameters)
+{
+    FNarrationReplicationCodec Server;
+    FNarrationReplicationCodec Client;
+    Server.AddCandidatePhrase(TEXT("Brass Lantern"));
+
+    const FString First = TEXT("The wanderer sees the Brass Lantern directly in front of the player.");
+    TArray<uint8> Encoded;
+    Server.Encode(First, Encoded);
+    FString Decoded;
+    TestTrue(TEXT("First narration decodes"), Client.Decode(Encoded, Decoded));
+    TestEqual(TEXT("First narration"), Decoded, First);
+    TestEqual(TEXT("Actor name was announced to the client"), Client.NumPhrases(), Server.NumPhrases());
+
+    // The announced name is only a code now
+    const FString Second = TEXT("The Brass Lantern flickers.");
+    TArray<uint8> SecondEncoded;
+    Server.Encode(Second, SecondEncoded);
+    TestTrue(TEXT("Second narration decodes"), Client.Decode(SecondEncoded, Decoded));
+    TestEqual(TEXT("Second narration"), Decoded, Second);
+    TestTrue(TEXT("Announced phrase is sent as a code"), SecondEncoded.Num() < Second.Len() - 8);
+
+    // Phrases match whole words only, control characters and non-ASCII text survive
+    const FString Other = TEXT("Brass Lanterns \x01 glow \u00e5t the wanderer");
+    TArray<uint8> OtherEncoded;
+    Server.Encode(Other, OtherEncoded);
+    TestTrue(TEXT("Other narration decodes"), Client.Decode(OtherEncoded, Decoded));
+    TestEqual(TEXT("Other narration"), Decoded, Other);
+
+    // A code the client does not know is rejected
+    const TArray<uint8> Unknown = { 0x01, 0x7F };
+    TestFalse(TEXT("Unknown code fails"), Client.Decode(Unknown, Decoded));
+
+    return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FNarrationReplicationSnapshotTest, "Project.GameStateStoryGen.Replication.Snapshot", EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::ProductFilter)
+bool FNarrationReplicationSnapshotTest::RunTest(const FString& Parameters)
+{
+    FNarrationReplicationCodec Server;
+    Server.AddCandidatePhrase(TEXT("Old Chair"));
+    Server.AddCandidatePhrase(TEXT("Rope"));
+
+    TArray<uint8> Encoded;
+    Server.Encode(TEXT("The Old Chair creaks."), Encoded);
+
+    // The snapshot does not announce Rope, so the dictionary of the server does not change
+    TMap<int32, FString> Latest;
+    Latest.Add(7, TEXT("The Old Chair creaks near the Rope."));
+    TArray<uint8> Snapshot;
+    const int32 NumPhrases = Server.NumPhrases();
+    Server.WriteSnapshot(Latest, Snapshot);
+    TestEqual(TEXT("Snapshot announces nothing"), Server.NumPhrases(), NumPhrases);
+
+    FNarrationReplicationCodec LateJoiner;
+    TMap<int32, FString> Received;
+    TestTrue(TEXT("Snapshot is read"), LateJoiner.ReadSnapshot(Snapshot, Received));
+    TestEqual(TEXT("Latest narration of the player"), Received.FindRef(7), Latest[7]);
+    TestEqual(TEXT("Dictionary of the server"), LateJoiner.NumPhrases(), Server.NumPhrases());
+
+    // Messages after the snapshot use the server's codes
+    Encoded.Reset();
+    Server.Encode(TEXT("The Old Chair tips over the Rope."), Encoded);
+    FString Decoded;
+    TestTrue(TEXT("Next narration decodes"), LateJoiner.Decode(Encoded, Decoded));
+    TestEqual(TEXT("Next narration"), Decoded, FString(TEXT("The Old Chair tips over the Rope.")));
+
+    return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FNarrationReplicationMidStreamJoinTest, "Project.GameStateStoryGen.Replication.MidStreamJoin", EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::ProductFilter)
+bool FNarrationReplicationMidStreamJoinTest::RunTest(const FString& Parameters)
+{
+    // The server streams a narration, the pieces announce phrases. As UStoryNarrationChannel does,
+    // the snapshot is rewritten whenever a piece grows the dictionary.
+    FNarrationReplicationCodec Server;
+    Server.AddCandidatePhrase(TEXT("Brass Lantern"));
+    Server.AddCandidatePhrase(TEXT("Iron Gate"));
+    FNarrationReplicationCodec Client;
+    TArray<uint8> Snapshot;
+    TMap<int32, FString> Latest;
+
+    const FString Pieces[] = {
+        TEXT("The wanderer lifts the Brass Lantern "),
+        TEXT("and walks to the Iron Gate. "),
+        TEXT("The Brass Lantern swings at the Iron Gate.") };
+    TArray<TArray<uint8>> Deltas;
+    for (const FString& Piece : Pieces)
+    {
+        const int32 PreviousPhrases = Server.NumPhrases();
+        Server.Encode(Piece, Deltas.AddDefaulted_GetRef());
+        if (Server.NumPhrases() != PreviousPhrases)
+        {
+            Server.WriteSnapshot({}, Snapshot);
+        }
+    }
+
+    // The client received the first piece before the snapshot
+    FString Decoded;
+    TestTrue(TEXT("First piece decodes"), Client.Decode(Deltas[0], Decoded));
+
+    // The second piece is lost (the channel was not open yet), the snapshot brings its phrase
+    TestTrue(TEXT("Snapshot merges"), Client.ReadSnapshot(Snapshot, Latest));
+    TestEqual(TEXT("Dictionary of the server"), Client.NumPhrases(), Server.NumPhrases());
+    TestTrue(TEXT("Last piece decodes with the codes of both phrases"), Client.Decode(Deltas[2], Decoded));
+    TestEqual(TEXT("Last piece"), Decoded, Pieces[2]);
+
+    // A client that joins mid-stream starts from the snapshot alone
+    FNarrationReplicationCodec Joiner;
+    TestTrue(TEXT("Joiner reads the snapshot"), Joiner.ReadSnapshot(Snapshot, Latest));
+    TestTrue(TEXT("Joiner decodes the next piece"), Joiner.Decode(Deltas[2], Decoded));
+    TestEqual(TEXT("Next piece"), Decoded, Pieces[2]);
+
+    // An older snapshot keeps the phrases the client learned since, a different dictionary fails
+    TArray<uint8> Older;
+    FNarrationReplicationCodec Early;
+    Early.AddCandidatePhrase(TEXT("Brass Lantern"));
+    TArray<uint8> Unused;
+    Early.Encode(Pieces[0], Unused);
+    Early.WriteSnapshot({}, Older);
+    TestTrue(TEXT("Older snapshot merges"), Client.ReadSnapshot(Older, Latest));
+    TestEqual(TEXT("Nothing forgotten"), Client.NumPhrases(), Server.NumPhrases());
+
+    FNarrationReplicationCodec Other;
+    Other.AddCandidatePhrase(TEXT("Old Chair"));
+    Other.Encode(TEXT("The Old Chair creaks."), Unused);
+    TArray<uint8> Conflicting;
+    Other.WriteSnapshot({}, Conflicting);
+    TestFalse(TEXT("Different phrase under the same code fails"), Client.ReadSnapshot(Conflicting, Latest));
+
+    return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FNarrationReplicationLostDefineTest, "Project.GameStateStoryGen.Replication.LostDefine", EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::ProductFilter)
+bool FNarrationReplicationLostDefineTest::RunTest(const FString& Parameters)
+{
+    FNarrationReplicationCodec Server;
+    Server.AddCandidatePhrase(TEXT("Brass Lantern"));
+    Server.AddCandidatePhrase(TEXT("Iron Gate"));
+    FNarrationReplicationCodec Client;
+
+    // The announcement of the lantern is lost, the one of the gate arrives
+    TArray<uint8> Lost;
+    Server.Encode(TEXT("The Brass Lantern glows."), Lost);
+    TArray<uint8> GateDefine;
+    Server.Encode(TEXT("The Iron Gate opens."), GateDefine);
+    FString Decoded;
+    TestTrue(TEXT("Gate announcement decodes"), Client.Decode(GateDefine, Decoded));
+    TestEqual(TEXT("Gate narration"), Decoded, FString(TEXT("The Iron Gate opens.")));
+    TestTrue(TEXT("The lantern's code is a gap"), Client.HasGaps());
+
+    // The gate keeps the server's code, the lantern's code is not decoded as the gate
+    TArray<uint8> Both;
+    Server.Encode(TEXT("The Iron Gate and the Brass Lantern."), Both);
+    TArray<uint8> GateOnly;
+    Server.Encode(TEXT("The Iron Gate closes."), GateOnly);
+    TestFalse(TEXT("The lost code fails"), Client.Decode(Both, Decoded));
+    TestTrue(TEXT("The gate's code decodes"), Client.Decode(GateOnly, Decoded));
+    TestEqual(TEXT("Gate code"), Decoded, FString(TEXT("The Iron Gate closes.")));
+
+    // The snapshot fills the gap without a conflict
+    TArray<uint8> Snapshot;
+    Server.WriteSnapshot({}, Snapshot);
+    TMap<int32, FString> Latest;
+    TestTrue(TEXT("Snapshot merges"), Client.ReadSnapshot(Snapshot, Latest));
+    TestFalse(TEXT("No gap left"), Client.HasGaps());
+    TestTrue(TEXT("Both codes decode"), Client.Decode(Both, Decoded));
+    TestEqual(TEXT("Both phrases"), Decoded, FString(TEXT("The Iron Gate and the Brass Lantern.")));
+
+    return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FNarrationReplicationBytesTest, "Project.GameStateStoryGen.Replication.Bytes", EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::PerfFilter)
+bool FNarrationReplicationBytesTest::RunTest(const FString& Parameters)
+{
+    FNarrationReplicationCodec Server;
+    const TCHAR* Actors[] = { TEXT("Brass Lantern"), TEXT("Old Chair"), TEXT("Wooden Crate"), TEXT("Iron Gate") };
+    for (const TCHAR* Actor : Actors)
+    {
+        Server.AddCandidatePhrase(Actor);
+    }
+
+    // Narrations streamed in three pieces, each piece one message
+    for (int32 i = 0; i < 100; i++)
+    {
+        const FString Actor = Actors[i % UE_ARRAY_COUNT(Actors)];
+        const FString Pieces[] = {
+            FString::Printf(TEXT("The wanderer notices the %s "), *Actor),
+            TEXT("directly to the left of the player, "),
+            FString::Printf(TEXT("and the %s settles near the player."), *Actor) };
+
+        FString Narration;
+        int32 Bytes = 0;
+        for (const FString& Piece : Pieces)
+        {
+            TArray<uint8> Delta;
+            Server.Encode(Piece, Delta);
+            Bytes += FNarrationReplicationCodec::GetMessageBytes(Delta.Num());
+            Narration += Piece;
+        }
+        Bytes += FNarrationReplicationCodec::GetMessageBytes(0);
+        Server.RecordNarration(Narration, UE_ARRAY_COUNT(Pieces) + 1, Bytes);
+    }
+
+    const FNarrationReplicationStats& Stats = Server.GetStats();
+    AddInfo(FString::Printf(TEXT("%.1f bytes per narration per client, %.1f as FString."), Stats.GetBytesPerNarration(), Stats.GetNaiveBytesPerNarration()));
+    TestTrue(TEXT("Encoded narrations are smaller than FStrings"), Stats.GetBytesPerNarration() < Stats.GetNaiveBytesPerNarration());
+
+    return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FNarrationReplicationOwnerOnlyTest, "Project.GameStateStoryGen.Replication.OwnerOnly", EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::ProductFilter)
+bool FNarrationReplicationOwnerOnlyTest::RunTest(const FString& Parameters)
+{
+    // The server opens a channel per remote player, each starting with the candidate phrases of the level
+    FNarrationReplicationCodec Level;
+    Level.AddCandidatePhrase(TEXT("Brass Lantern"));
+    FNarrationReplicationCodec ServerA = Level;
+    FNarrationReplicationCodec ServerB = Level;
+    FNarrationReplicationCodec ClientA;
+    FNarrationReplicationCodec ClientB;
+
+    // Player A is narrated first, the phrase is announced on its channel only
+    TArray<uint8> ToA;
+    ServerA.Encode(TEXT("The wanderer lifts the Brass Lantern."), ToA);
+    FString Decoded;
+    TestTrue(TEXT("Client A decodes its narration"), ClientA.Decode(ToA, Decoded));
+    TestEqual(TEXT("Client B learned nothing"), ClientB.NumPhrases(), Level.NumPhrases());
+
+    // Player B never received A's narration and still decodes its own
+    TArray<uint8> ToB;
+    ServerB.Encode(TEXT("The Brass Lantern lies near the player."), ToB);
+    TestTrue(TEXT("Client B decodes its narration"), ClientB.Decode(ToB, Decoded));
+    TestEqual(TEXT("Narration of B"), Decoded, FString(TEXT("The Brass Lantern lies near the player.")));
+    TestEqual(TEXT("Dictionaries of A in step"), ClientA.NumPhrases(), ServerA.NumPhrases());
+    TestEqual(TEXT("Dictionaries of B in step"), ClientB.NumPhrases(), ServerB.NumPhrases());
+
+    // Later narrations use the codes of their own channel
+    ToA.Reset();
+    ServerA.Encode(TEXT("The Brass Lantern flickers."), ToA);
+    TestTrue(TEXT("Client A decodes the code"), ClientA.Decode(ToA, Decoded));
+    TestEqual(TEXT("Second narration of A"), Decoded, FString(TEXT("The Brass Lantern flickers.")));
+
+    return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FNarrationReplicationChannelRoutingTest, "Project.GameStateStoryGen.Replication.ChannelRouting", EAutomationTestFlags::EditorContext | EAutomationTestFlags::ProductFilter)
+bool FNarrationReplicationChannelRoutingTest::RunTest(const FString& Parameters)
+{
+    UWorld* World = UGameplayStatics::CreateWorld(EWorldType::Game, false, FName("NarrationRoutingWorld"));
+    if (!World)
+    {
+        AddError(TEXT("Failed to create test world."));
+        return false;
+    }
+    APlayerController* ControllerA = World->SpawnActor<APlayerController>();
+    APlayerController* ControllerB = World->SpawnActor<APlayerController>();
+    if (!ControllerA || !ControllerB)
+    {
+        AddError(TEXT("Failed to spawn the player controllers."));
+        World->DestroyWorld(false);
+        return false;
+    }
+
+    // Each remote player gets its own channel on its own controller
+    FNarrationReplicationCodec Level;
+    Level.AddCandidatePhrase(TEXT("Brass Lantern"));
+    UStoryNarrationChannel* ChannelA = UStoryNarrationChannel::FindOrAdd(ControllerA, Level);
+    UStoryNarrationChannel* ChannelB = UStoryNarrationChannel::FindOrAdd(ControllerB, Level);
+    TestTrue(TEXT("A channel per controller"), ChannelA && ChannelB && ChannelA != ChannelB);
+    if (!ChannelA || !ChannelB)
+    {
+        World->DestroyWorld(false);
+        return false;
+    }
+    TestTrue(TEXT("Channel A is owned by controller A"), ChannelA->GetOwner() == ControllerA);
+    TestTrue(TEXT("Channel B is owned by controller B"), ChannelB->GetOwner() == ControllerB);
+    TestTrue(TEXT("The channel is found again"), UStoryNarrationChannel::FindOrAdd(ControllerA, Level) == ChannelA);
+
+    // A narration of player A goes to A's channel only, held back until A's client channel is ready
+    ChannelA->SendNarration(1, 0, TEXT("The wanderer lifts the Brass Lantern."), false);
+    ChannelA->SendNarrationDelta(1, 5, TEXT("The Brass Lantern "));
+    TestEqual(TEXT("Messages of A wait for its client"), ChannelA->NumQueuedMessages(), 2);
+    TestEqual(TEXT("Nothing for B"), ChannelB->NumQueuedMessages(), 0);
+    TestEqual(TEXT("Phrase announced on A"), ChannelA->NumPhrases(), Level.NumPhrases() + 1);
+    TestEqual(TEXT("B's dictionary is unchanged"), ChannelB->NumPhrases(), Level.NumPhrases());
+
+    // Once A's client is ready the queue is sent, B still waits for its own client
+    ChannelA->ServerChannelReady();
+    ChannelB->SendNarration(2, 0, TEXT("The gate creaks."), false);
+    TestEqual(TEXT("Queue of A sent"), ChannelA->NumQueuedMessages(), 0);
+    TestEqual(TEXT("B waits for its client"), ChannelB->NumQueuedMessages(), 1);
+
+    World->DestroyWorld(false);
+    return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FNarrationReplicationClientStreamTest, "Project.GameStateStoryGen.Replication.ClientStream", EAutomationTestFlags::EditorContext | EAutomationTestFlags::ProductFilter)
+bool FNarrationReplicationClientStreamTest::RunTest(const FString& Parameters)
+{
+    UWorld* World = UGameplayStatics::CreateWorld(EWorldType::Game, false, FName("NarrationClientWorld"));
+    if (!World)
+    {
+        AddError(TEXT("Failed to create test world."));
+        return false;
+    }
+    AGameStateStoryGen* GameState = World->SpawnActor<AGameStateStoryGen>();
+    APlayerState* PlayerState = World->SpawnActor<APlayerState>();
+    if (!GameState || !PlayerState)
+    {
+        AddError(TEXT("Failed to spawn the game state or the player state."));
+        World->DestroyWorld(false);
+        return false;
+    }
+    PlayerState->SetPlayerId(7);
+
+    // The HUD of player 7 opened its stream, as the channel's RPCs would deliver them on the client
+    FStoryPlayerStream* Stream = GameState->GetPlayerStream(GameState->FindOrAddPlayer(PlayerState));
+    TestNotNull(TEXT("Stream of the player"), Stream);
+    if (!Stream)
+    {
+        World->DestroyWorld(false);
+        return false;
+    }
+    FString Revealed;
+    TArray<FString> Narrations;
+    TArray<uint32> Streams;
+    Stream->OnNarrationChunk.AddLambda([&Revealed](uint32 StreamId, const FString& Chunk) { Revealed += Chunk; });
+    Stream->OnNarration.AddLambda([&Narrations, &Streams](const FString& Narration, uint32 StreamId) { Narrations.Add(Narration); Streams.Add(StreamId); });
+
+    // A streamed narration is assembled from its pieces and completed by an empty message
+    GameState->ReceiveNarrationChunk(7, 3, TEXT("The wanderer "));
+    GameState->ReceiveNarrationChunk(7, 3, TEXT("opens the gate."));
+    GameState->ReceiveNarration(7, 3, FString());
+    TestEqual(TEXT("Pieces revealed"), Revealed, FString(TEXT("The wanderer opens the gate.")));
+    TestEqual(TEXT("One narration"), Narrations.Num(), 1);
+    TestEqual(TEXT("Completed from the pieces"), Narrations.Num() > 0 ? Narrations[0] : FString(), FString(TEXT("The wanderer opens the gate.")));
+    TestEqual(TEXT("Revealed stream"), Streams.Num() > 0 ? Streams[0] : 0u, 3u);
+
+    // Whole narrations, completions without pieces and other players
+    GameState->ReceiveNarration(7, 0, TEXT("The gate creaks."));
+    GameState->ReceiveNarration(7, 4, FString());
+    GameState->ReceiveNarration(8, 0, TEXT("Someone else's story."));
+    TestEqual(TEXT("Only the whole narration of the player added"), Narrations.Num(), 2);
+    TestEqual(TEXT("Latest narration"), Stream->LatestNarration, FString(TEXT("The gate creaks.")));
+
+    World->DestroyWorld(false);
+    return true;
+}
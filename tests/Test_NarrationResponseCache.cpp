@@ -0,0 +1,87 @@
+#include "CoreMinimal.h"
+#include "Misc/AutomationTest.h"
+#include "NarrationResponseCache.h"
+#include "GameStateStoryGen.h"
+#include "StoryTestHelpers.h"
+
+/**
+ * Tests for FNarrationResponseCache, the cache of narrations for repeated scenes.
+ */
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FNarrationResponseCacheKeyTest, "Project.GameStateStoryGen.ResponseCache.SceneKey", EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::ProductFilter)
+bool FNarrationResponseCacheKeyTest::RunTest(const FString& Parameters)
+{
+    FNarrationResponseCache Cache;
+    FNarrationCachePolicy Policy;
+    Policy.DistanceBucketSize = 100.0;
+    Cache.Configure(Policy);
+
+    TArray<FStoryEvent> Batch = { MakeTestEvent(TEXT("Lantern"), EStoryDirection::Front, 120.0), MakeTestEvent(TEXT("Rock"), EStoryDirection::Left, 430.0) };
+    TArray<FStoryEvent> Reordered = { MakeTestEvent(TEXT("Rock"), EStoryDirection::Left, 410.0), MakeTestEvent(TEXT("Lantern"), EStoryDirection::Front, 180.0) };
+    TArray<FStoryEvent> Moved = { MakeTestEvent(TEXT("Lantern"), EStoryDirection::Front, 220.0), MakeTestEvent(TEXT("Rock"), EStoryDirection::Left, 430.0) };
+
+    // Same actors, directions and distance buckets give the same key regardless of order and timestamps
+    TestEqual(TEXT("Reordered batch in the same buckets has the same key"), Cache.MakeSceneKey(Batch), Cache.MakeSceneKey(Reordered));
+
+    // A different distance bucket is a different scene
+    TestNotEqual(TEXT("Different distance bucket changes the key"), Cache.MakeSceneKey(Batch), Cache.MakeSceneKey(Moved));
+
+    return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FNarrationResponseCachePolicyTest, "Project.GameStateStoryGen.ResponseCache.Policy", EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::ProductFilter)
+bool FNarrationResponseCachePolicyTest::RunTest(const FString& Parameters)
+{
+    FNarrationResponseCache Cache;
+    FNarrationCachePolicy Policy;
+    Policy.MaxEntries = 2;
+    Policy.MinVariants = 2;
+    Policy.MaxVariants = 2;
+    Cache.Configure(Policy);
+
+    FString Narration;
+    Cache.Add(1, TEXT("The wanderer picks up the lantern."));
+    TestFalse(TEXT("Scene with too few variants is not served"), Cache.Find(1, Narration));
+
+    Cache.Add(1, TEXT("The lantern is lifted from the ground."));
+    TestTrue(TEXT("Scene with enough variants is served"), Cache.Find(1, Narration));
+    FString Second;
+    Cache.Find(1, Second);
+    TestNotEqual(TEXT("Variants are served in rotation"), Narration, Second);
+
+    // Scene 1 was used last, so scene 2 is evicted when scene 3 is added
+    Cache.Add(2, TEXT("A rock rolls away."));
+    Cache.Find(1, Narration);
+    Cache.Add(3, TEXT("A crow lands."));
+    TestEqual(TEXT("Cache is bounded"), Cache.Num(), 2);
+    TestTrue(TEXT("Recently used scene is kept"), Cache.Find(1, Narration));
+
+    return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FNarrationResponseCacheHistoryTest, "Project.GameStateStoryGen.ResponseCache.History", EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::ProductFilter)
+bool FNarrationResponseCacheHistoryTest::RunTest(const FString& Parameters)
+{
+    FNarrationResponseCache Cache;
+    Cache.Configure(FNarrationCachePolicy());
+
+    // The player picks up the lantern, the narration is cached under the narrated events
+    FStoryPlayerStream First;
+    First.Events.Add(MakeTestEvent(TEXT("Lantern"), EStoryDirection::Front, 120.0));
+    First.EventCount = 1;
+    Cache.Add(Cache.MakeSceneKey(First.GetPendingEvents()), TEXT("The wanderer picks up the lantern."));
+
+    // Later a rock rolls (narrated in its own batch), then the lantern is picked up again
+    FStoryPlayerStream Later = First;
+    Later.Events.Add(MakeTestEvent(TEXT("Rock"), EStoryDirection::Left, 430.0));
+    Later.EventCount = 0;
+    Later.Events.Add(MakeTestEvent(TEXT("Lantern"), EStoryDirection::Front, 140.0));
+    Later.EventCount = 1;
+    TestEqual(TEXT("Only the new event is narrated"), Later.GetPendingEvents().Num(), 1);
+
+    FString Narration;
+    TestTrue(TEXT("Same scene hits despite the earlier events"), Cache.Find(Cache.MakeSceneKey(Later.GetPendingEvents()), Narration));
+    TestEqual(TEXT("Cached narration"), Narration, FString(TEXT("The wanderer picks up the lantern.")));
+    TestNotEqual(TEXT("The whole history is another scene"), Cache.MakeSceneKey(Later.Events), Cache.MakeSceneKey(First.Events));
+
+    return true;
+}
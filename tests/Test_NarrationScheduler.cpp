@@ -0,0 +1,103 @@
+#include "CoreMinimal.h"
+#include "Misc/AutomationTest.h"
+#include "HttpModule.h"
+#include "NarrationScheduler.h"
+
+/**
+ * Tests for FNarrationScheduler, the priority scheduler of narration requests.
+ */
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FNarrationSchedulerClassifyTest, "Project.GameStateStoryGen.Scheduler.Classify", EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::ProductFilter)
+bool FNarrationSchedulerClassifyTest::RunTest(const FString& Parameters)
+{
+    FStoryEvent Held;
+    Held.IsInteractable = true;
+    Held.Distance = 100.0;
+
+    FStoryEvent InReach = Held;
+    InReach.Distance = 300.0;
+
+    FStoryEvent Drifting;
+    Drifting.Distance = 100.0;
+
+    FStoryEvent Predicted = Held;
+    Predicted.Type = EStoryEventType::Predicted;
+
+    TestTrue(TEXT("Held interactable is Critical"), FNarrationScheduler::ClassifyEvent(Held, 150.0, 400.0) == ENarrationPriority::Critical);
+    TestTrue(TEXT("Interactable within reach is High"), FNarrationScheduler::ClassifyEvent(InReach, 150.0, 400.0) == ENarrationPriority::High);
+    TestTrue(TEXT("Non-interactable movement is Normal"), FNarrationScheduler::ClassifyEvent(Drifting, 150.0, 400.0) == ENarrationPriority::Normal);
+    TestTrue(TEXT("Predicted event is Low"), FNarrationScheduler::ClassifyEvent(Predicted, 150.0, 400.0) == ENarrationPriority::Low);
+    TestTrue(TEXT("Batch gets the highest priority"), FNarrationScheduler::ClassifyBatch({ Drifting, InReach }, 150.0, 400.0) == ENarrationPriority::High);
+
+    return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FNarrationSchedulerDispatchTest, "Project.GameStateStoryGen.Scheduler.Dispatch", EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::ProductFilter)
+bool FNarrationSchedulerDispatchTest::RunTest(const FString& Parameters)
+{
+    FNarrationScheduler Scheduler;
+    Scheduler.Configure(1, 1, { 2.0, 4.0, 8.0, 20.0 });
+
+    // Requests are created but never processed
+    auto Start = [](uint32 JobId) -> FHttpRequestPtr { return FHttpModule::Get().CreateRequest(); };
+
+    uint32 LowJob = Scheduler.Submit(ENarrationPriority::Low, Start);
+    TestTrue(TEXT("Low priority request starts on an idle pipeline"), LowJob != 0);
+    TestTrue(TEXT("Pipeline is saturated"), Scheduler.IsSaturated());
+
+    TestTrue(TEXT("Low priority request is skipped when saturated"), Scheduler.Submit(ENarrationPriority::Low, Start) == 0);
+
+    uint32 HighJob = Scheduler.Submit(ENarrationPriority::High, Start);
+    TestEqual(TEXT("High priority request preempts the Low one"), Scheduler.GetStats(ENarrationPriority::Low).Preempted, 1);
+    TestEqual(TEXT("Only one request in flight"), Scheduler.NumInFlight(), 1);
+
+    uint32 NormalJob = Scheduler.Submit(ENarrationPriority::Normal, Start);
+    TestTrue(TEXT("Normal priority request is queued"), NormalJob != 0 && Scheduler.NumQueued() == 1);
+
+    // Completing the preempted job is ignored, completing the running one starts the queued one
+    Scheduler.Complete(LowJob, true);
+    TestEqual(TEXT("Preempted job completion is ignored"), Scheduler.NumQueued(), 1);
+    Scheduler.Complete(HighJob, true);
+    TestEqual(TEXT("Queued request started"), Scheduler.NumQueued(), 0);
+    TestEqual(TEXT("High latency recorded"), Scheduler.GetStats(ENarrationPriority::High).Completed, 1);
+
+    Scheduler.CancelAll();
+    TestEqual(TEXT("All requests cancelled"), Scheduler.NumInFlight(), 0);
+
+    return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FNarrationSchedulerFairnessTest, "Project.GameStateStoryGen.Scheduler.Fairness", EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::ProductFilter)
+bool FNarrationSchedulerFairnessTest::RunTest(const FString& Parameters)
+{
+    FNarrationScheduler Scheduler;
+    Scheduler.Configure(2, 4, { 2.0, 4.0, 8.0, 20.0 });
+
+    auto Start = [](uint32 JobId) -> FHttpRequestPtr { return FHttpModule::Get().CreateRequest(); };
+
+    // A busy player 0 takes both slots and fills the queue
+    TArray<uint32> BusyJobs;
+    for (int32 i = 0; i < 6; i++)
+    {
+        BusyJobs.Add(Scheduler.Submit(ENarrationPriority::Normal, Start, 0));
+    }
+    TestEqual(TEXT("Busy player fills the slots"), Scheduler.NumInFlightFor(0), 2);
+    TestEqual(TEXT("Busy player fills the queue"), Scheduler.NumQueuedFor(0), 4);
+
+    // A request of player 1 replaces a queued request of player 0 instead of being skipped
+    uint32 QuietJob = Scheduler.Submit(ENarrationPriority::Normal, Start, 1);
+    TestTrue(TEXT("Quiet player is queued"), QuietJob != 0 && Scheduler.NumQueuedFor(1) == 1);
+    TestEqual(TEXT("Busy player lost a queued request"), Scheduler.NumQueuedFor(0), 3);
+    TestEqual(TEXT("Skip recorded"), Scheduler.GetStats(ENarrationPriority::Normal).Skipped, 1);
+
+    // The next free slot goes to the player with the fewest requests in flight, not to the oldest request
+    Scheduler.Complete(BusyJobs[0], true);
+    TestEqual(TEXT("Quiet player's request started first"), Scheduler.NumInFlightFor(1), 1);
+    TestEqual(TEXT("Busy player keeps its queued requests"), Scheduler.NumQueuedFor(0), 3);
+
+    // Equal share: once both have one request in flight, the oldest request goes next
+    Scheduler.Complete(BusyJobs[1], true);
+    TestEqual(TEXT("Busy player's oldest queued request started"), Scheduler.NumInFlightFor(0), 1);
+
+    Scheduler.CancelAll();
+    return true;
+}
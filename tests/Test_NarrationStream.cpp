@@ -0,0 +1,94 @@
+#include "CoreMinimal.h"
+#include "Misc/AutomationTest.h"
+#include "NarrationStreamParser.h"
+#include "TypewriterText.h"
+#include "Async/Async.h"
+
+/**
+ * Tests for streamed narrations: FNarrationStreamParser and the FTypewriterText reveal.
+ */
+static void ReceiveUtf8(FNarrationStreamParser& Parser, const FString& Text)
+{
+    FTCHARToUTF8 Converted(*Text);
+    Parser.Receive(Converted.Get(), Converted.Length());
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FNarrationStreamParserTest, "Project.GameStateStoryGen.Streaming.Parser", EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::ProductFilter)
+bool FNarrationStreamParserTest::RunTest(const FString& Parameters)
+{
+    FNarrationStreamParser Parser;
+    FString Chunk;
+
+    // A partial line is kept until the rest arrives
+    ReceiveUtf8(Parser, TEXT("data: {\"choices\":[{\"delta\":{\"content\":\"The wanderer \"}}]}\n\ndata: {\"choices\":[{\"delta\""));
+    TestTrue(TEXT("First complete event is parsed"), Parser.Feed(Chunk));
+    TestEqual(TEXT("First chunk"), Chunk, FString(TEXT("The wanderer ")));
+    TestFalse(TEXT("Nothing new without received bytes"), Parser.Feed(Chunk));
+
+    // Only the new bytes are received, the start of the line was kept by the parser
+    ReceiveUtf8(Parser, TEXT(":{\"content\":\"lifts the lantern.\"}}]}\n\ndata: {\"choices\":[],\"usage\":{\"prompt_tokens\":12}}\n\ndata: [DONE]\n\n"));
+    TestTrue(TEXT("Rest of the event is parsed"), Parser.Feed(Chunk));
+    TestEqual(TEXT("Second chunk"), Chunk, FString(TEXT("lifts the lantern.")));
+    TestEqual(TEXT("Whole narration"), Parser.GetText(), FString(TEXT("The wanderer lifts the lantern.")));
+    TestTrue(TEXT("Usage event is kept"), Parser.GetUsageEvent().IsValid());
+    TestTrue(TEXT("Stream is done"), Parser.IsDone());
+
+    return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FNarrationStreamReceiveTest, "Project.GameStateStoryGen.Streaming.Receive", EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::ProductFilter)
+bool FNarrationStreamReceiveTest::RunTest(const FString& Parameters)
+{
+    FNarrationStreamParser Parser;
+    FString Chunk;
+
+    // The receive delegate is called on the HTTP thread, in blocks that can split a UTF-8 character
+    FTCHARToUTF8 Converted(TEXT("data: {\"choices\":[{\"delta\":{\"content\":\"Sm\u00e5 steg.\"}}]}\n"));
+    TArray<uint8> Body(reinterpret_cast<const uint8*>(Converted.Get()), Converted.Length());
+    FHttpRequestStreamDelegate Delegate = Parser.CreateReceiveDelegate();
+    const int32 Split = Body.IndexOfByKey(uint8(0xC3)) + 1;
+    Async(EAsyncExecution::Thread, [&Delegate, &Body, Split]()
+    {
+        Delegate.Execute(Body.GetData(), Split);
+        Delegate.Execute(Body.GetData() + Split, Body.Num() - Split);
+    }).Wait();
+
+    TestTrue(TEXT("Event parsed from the received blocks"), Parser.Feed(Chunk));
+    TestEqual(TEXT("Character not split"), Chunk, FString(TEXT("Sm\u00e5 steg.")));
+
+    // A final line without a newline is parsed at the end of the response
+    ReceiveUtf8(Parser, TEXT("data: {\"choices\":[{\"delta\":{\"content\":\" Mer.\"}}]}"));
+    TestFalse(TEXT("Incomplete line waits"), Parser.Feed(Chunk));
+    TestTrue(TEXT("Parsed when final"), Parser.Feed(Chunk, true));
+    TestEqual(TEXT("Whole narration"), Parser.GetText(), FString(TEXT("Sm\u00e5 steg. Mer.")));
+
+    return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FTypewriterTextTest, "Project.HUD.Streaming.Typewriter", EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::ProductFilter)
+bool FTypewriterTextTest::RunTest(const FString& Parameters)
+{
+    FTypewriterText Typewriter;
+    Typewriter.Configure(10.0f);
+    Typewriter.Append(TEXT("A crow lands"));
+
+    TArray<FString> Words;
+    FString Tail;
+
+    // 10 characters per second: 0.6 s reveals "A crow"
+    TestTrue(TEXT("Text is revealed"), Typewriter.Advance(0.6f, Words, Tail));
+    TestEqual(TEXT("Completed words"), Words.Num(), 1);
+    TestEqual(TEXT("Only the partial word is in the tail"), Tail, FString(TEXT("crow")));
+
+    // Without Finish the last word stays in the tail
+    Typewriter.Advance(10.0f, Words, Tail);
+    TestEqual(TEXT("Last word waits for the end of the stream"), Tail, FString(TEXT("lands")));
+    TestFalse(TEXT("Not complete before Finish"), Typewriter.IsComplete());
+
+    Typewriter.Finish();
+    Typewriter.Advance(0.0f, Words, Tail);
+    TestTrue(TEXT("Last word committed"), Words.Num() == 1 && Words[0] == TEXT("lands") && Tail.IsEmpty());
+    TestTrue(TEXT("Complete after Finish"), Typewriter.IsComplete());
+
+    return true;
+}
@@ -0,0 +1,74 @@
+#include "CoreMinimal.h"
+#include "Misc/AutomationTest.h"
+#include "StoryFrameScheduler.h"
+
+/**
+ * Tests for FStoryFrameScheduler: sliced tasks within the frame budget and offloaded work.
+ */
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FStoryFrameSchedulerSliceTest, "Project.GameStateStoryGen.FrameScheduler.Slices", EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::ProductFilter)
+bool FStoryFrameSchedulerSliceTest::RunTest(const FString& Parameters)
+{
+    FStoryFrameScheduler Scheduler;
+    Scheduler.SetBudget(0.0);
+
+    // With no budget left, one slice still runs per frame
+    int32 Cursor = 0;
+    Scheduler.AddTask(TEXT("Sweep"), [&Cursor]() { Cursor += 10; return Cursor >= 30; });
+    TestTrue(TEXT("Task is pending"), Scheduler.HasTask(TEXT("Sweep")));
+
+    Scheduler.Tick();
+    TestEqual(TEXT("One slice in the first frame"), Cursor, 10);
+    Scheduler.Tick();
+    Scheduler.Tick();
+    TestEqual(TEXT("Sweep is done after three frames"), Cursor, 30);
+    TestFalse(TEXT("Finished task is removed"), Scheduler.HasTask(TEXT("Sweep")));
+
+    // Tasks are sliced round robin
+    TArray<FString> Order;
+    Scheduler.AddTask(TEXT("A"), [&Order]() { Order.Add(TEXT("A")); return Order.Num() >= 3; });
+    Scheduler.AddTask(TEXT("B"), [&Order]() { Order.Add(TEXT("B")); return true; });
+    Scheduler.Tick();
+    Scheduler.Tick();
+    Scheduler.Tick();
+    TestEqual(TEXT("Round robin order"), FString::Join(Order, TEXT("")), FString(TEXT("ABA")));
+    TestEqual(TEXT("Slices are counted"), Scheduler.GetStats().Slices, (int64)6);
+
+    // A large budget finishes the task in one frame
+    Scheduler.SetBudget(1000.0);
+    Cursor = 0;
+    Scheduler.AddTask(TEXT("Sweep"), [&Cursor]() { Cursor += 10; return Cursor >= 30; });
+    Scheduler.Tick();
+    TestFalse(TEXT("Sweep is done in one frame"), Scheduler.HasTask(TEXT("Sweep")));
+
+    return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FStoryFrameSchedulerOffloadTest, "Project.GameStateStoryGen.FrameScheduler.Offload", EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::ProductFilter)
+bool FStoryFrameSchedulerOffloadTest::RunTest(const FString& Parameters)
+{
+    FStoryFrameScheduler Scheduler;
+    Scheduler.SetBudget(1000.0);
+
+    FString Received;
+    Scheduler.Offload<FString>([]() { return FString(TEXT("{\"model\":\"gpt-4o\"}")); }, [&Received](FString& Payload) { Received = Payload; });
+
+    // The continuation runs in a Tick() on this thread, once the worker is done
+    const double Timeout = FPlatformTime::Seconds() + 5.0;
+    while (Received.IsEmpty() && FPlatformTime::Seconds() < Timeout)
+    {
+        FPlatformProcess::Sleep(0.01f);
+        Scheduler.Tick();
+    }
+    TestEqual(TEXT("Continuation received the payload"), Received, FString(TEXT("{\"model\":\"gpt-4o\"}")));
+    TestEqual(TEXT("Continuation is counted"), Scheduler.GetStats().Completions, (int64)1);
+
+    // Continuations of work offloaded before Reset() are dropped
+    bool bRan = false;
+    Scheduler.Offload<int32>([]() { return 1; }, [&bRan](int32&) { bRan = true; });
+    Scheduler.Reset();
+    FPlatformProcess::Sleep(0.1f);
+    Scheduler.Tick();
+    TestFalse(TEXT("Dropped continuation does not run"), bRan);
+
+    return true;
+}
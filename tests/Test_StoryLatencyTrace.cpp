@@ -0,0 +1,95 @@
+#include "CoreMinimal.h"
+#include "Misc/AutomationTest.h"
+#include "StoryLatencyTrace.h"
+#include "Serialization/JsonReader.h"
+#include "Serialization/JsonSerializer.h"
+
+/**
+ * Tests for FStoryLatencyTrace: stage times of batched events and the JSON trace file.
+ */
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FStoryLatencyTraceStagesTest, "Project.GameStateStoryGen.StoryLatencyTrace.Stages", EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::ProductFilter)
+bool FStoryLatencyTraceStagesTest::RunTest(const FString& Parameters)
+{
+    FStoryLatencyTrace Trace;
+    const uint32 First = Trace.BeginEvent(0, 10.0);
+    const uint32 Second = Trace.BeginEvent(0, 10.5);
+    TestNotEqual(TEXT("Separate trace ids"), First, Second);
+
+    // Both events go out with request 7
+    Trace.MarkEvents({ First, Second }, EStoryLatencyStage::Batched, 11.0);
+    Trace.LinkRequest(7, { First, Second });
+    Trace.MarkRequest(7, EStoryLatencyStage::Serialized, 11.25);
+    Trace.MarkRequest(7, EStoryLatencyStage::HttpSent, 11.5);
+    Trace.MarkRequest(7, EStoryLatencyStage::FirstByte, 12.0);
+    // Streamed: the first chunk is shown before the response is parsed, and later marks do not move a stage
+    Trace.MarkRequest(7, EStoryLatencyStage::Published, 12.25);
+    Trace.MarkRequest(7, EStoryLatencyStage::Parsed, 13.0);
+    Trace.MarkRequest(7, EStoryLatencyStage::Published, 13.0);
+    Trace.FinishRequest(7);
+
+    TestEqual(TEXT("Both events closed"), Trace.GetRecords().Num(), 2);
+    const FStoryLatencyRecord& Record = Trace.GetRecords()[0];
+    TestEqual(TEXT("Linked to the request"), Record.RequestId, uint32(7));
+    TestEqual(TEXT("Batched"), Record.GetStageSeconds(EStoryLatencyStage::Batched), 1.0);
+    TestEqual(TEXT("Serialized"), Record.GetStageSeconds(EStoryLatencyStage::Serialized), 0.25);
+    TestEqual(TEXT("Published after the first byte"), Record.GetStageSeconds(EStoryLatencyStage::Published), 0.25);
+    TestEqual(TEXT("Parsed after the publication"), Record.GetStageSeconds(EStoryLatencyStage::Parsed), 0.75);
+    TestEqual(TEXT("Movement to publication"), Record.GetTotalSeconds(), 2.25);
+
+    const FStoryLatencyStats& Stats = Trace.GetStats();
+    TestEqual(TEXT("Published events"), Stats.Published, int64(2));
+    TestEqual(TEXT("Average batching"), Stats.GetAverageStageMs(EStoryLatencyStage::Batched), 750.0);
+    TestEqual(TEXT("Max movement to publication"), Stats.MaxTotalSeconds, 2.25);
+
+    // A request that failed closes its events without Published, unknown ids are ignored
+    const uint32 Failed = Trace.BeginEvent(1, 20.0);
+    Trace.LinkRequest(8, { Failed, 999 });
+    Trace.MarkRequest(8, EStoryLatencyStage::HttpSent, 20.5);
+    Trace.FinishRequest(8);
+    TestEqual(TEXT("Failed event closed"), Trace.GetRecords().Num(), 3);
+    TestFalse(TEXT("Never published"), Trace.GetRecords()[2].HasStage(EStoryLatencyStage::Published));
+    TestEqual(TEXT("Still two published"), Trace.GetStats().Published, int64(2));
+
+    return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FStoryLatencyTraceJsonTest, "Project.GameStateStoryGen.StoryLatencyTrace.Json", EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::ProductFilter)
+bool FStoryLatencyTraceJsonTest::RunTest(const FString& Parameters)
+{
+    FStoryLatencyTrace Trace;
+    Trace.MaxOpenEvents = 2;
+
+    // The oldest open event is dropped when a third one begins
+    Trace.BeginEvent(0, 1.0);
+    const uint32 Cached = Trace.BeginEvent(0, 2.0);
+    const uint32 Sent = Trace.BeginEvent(0, 3.0);
+    TestEqual(TEXT("Dropped"), Trace.GetStats().Dropped, int64(1));
+
+    // Narrated from the response cache, without a request
+    Trace.MarkEvents({ Cached }, EStoryLatencyStage::Published, 2.5);
+    Trace.FinishEvents({ Cached });
+    Trace.LinkRequest(3, { Sent });
+    Trace.MarkRequest(3, EStoryLatencyStage::HttpSent, 3.5);
+    Trace.MarkRequest(3, EStoryLatencyStage::Published, 4.0);
+    Trace.FinishRequest(3);
+
+    TSharedPtr<FJsonObject> Root;
+    TestTrue(TEXT("Trace parses"), FJsonSerializer::Deserialize(TJsonReaderFactory<>::Create(Trace.ToTraceJson()), Root));
+    const TArray<TSharedPtr<FJsonValue>>* TraceEvents;
+    TestTrue(TEXT("Has traceEvents"), Root.IsValid() && Root->TryGetArrayField(TEXT("traceEvents"), TraceEvents));
+    if (!Root.IsValid() || !Root->TryGetArrayField(TEXT("traceEvents"), TraceEvents))
+    {
+        return false;
+    }
+
+    // Cached: event span and one stage, sent: event span and two stages, each a begin and an end
+    TestEqual(TEXT("Begin and end of every span"), TraceEvents->Num(), 10);
+    const TSharedPtr<FJsonObject> Begin = (*TraceEvents)[0]->AsObject();
+    TestEqual(TEXT("Event span first"), Begin->GetStringField(TEXT("name")), FString(TEXT("Story event")));
+    TestEqual(TEXT("Microseconds since the first event"), Begin->GetNumberField(TEXT("ts")), 1000000.0);
+    const TSharedPtr<FJsonObject> Published = (*TraceEvents)[2]->AsObject();
+    TestEqual(TEXT("Stage end"), Published->GetStringField(TEXT("ph")), FString(TEXT("e")));
+    TestEqual(TEXT("Published half a second later"), Published->GetNumberField(TEXT("ts")), 1500000.0);
+
+    return true;
+}
@@ -0,0 +1,76 @@
+#include "CoreMinimal.h"
+#include "Misc/AutomationTest.h"
+#include "GameStateStoryGen.h"
+#include "StoryNumberFormat.h"
+#include "StoryPromptBuilder.h"
+
+/**
+ * Tests for FStoryNumberFormat: fixed-point text, rounding policies and the numbers in the serialized payloads.
+ */
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FStoryNumberFormatFixedTest, "Project.GameStateStoryGen.NumberFormat.Fixed", EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::ProductFilter)
+bool FStoryNumberFormatFixedTest::RunTest(const FString& Parameters)
+{
+    auto Format = [](double Value, int32 Decimals)
+    {
+        FString Out;
+        FStoryNumberFormat::AppendFixed(Value, Decimals, Out);
+        return Out;
+    };
+
+    TestEqual(TEXT("Whole centimetres"), Format(1234.56789012, 0), FString(TEXT("1235")));
+    TestEqual(TEXT("One decimal"), Format(1234.56789012, 1), FString(TEXT("1234.6")));
+    TestEqual(TEXT("Negative"), Format(-250.44, 1), FString(TEXT("-250.4")));
+    TestEqual(TEXT("Below one"), Format(0.05, 2), FString(TEXT("0.05")));
+    TestEqual(TEXT("Trailing zeros dropped"), Format(75.0, 1), FString(TEXT("75")));
+    TestEqual(TEXT("No negative zero"), Format(-0.04, 1), FString(TEXT("0")));
+    TestEqual(TEXT("Not finite"), Format(std::numeric_limits<double>::quiet_NaN(), 1), FString(TEXT("0")));
+
+    TestEqual(TEXT("Quantize to one decimal"), FStoryNumberFormat::Quantize(12.345, EStoryNumberPrecision::OneDecimal), 12.3);
+    TestEqual(TEXT("Full precision is kept"), FStoryNumberFormat::Quantize(12.345, EStoryNumberPrecision::Full), 12.345);
+
+    // The payload holds the rounded digits only
+    const FVector Position(1234.56789012, -98.7654321, 0.0);
+    TestEqual(TEXT("Vector in whole centimetres"),
+        FStoryPromptBuilder::SerializeCondensed(AGameStateStoryGen::SerializeVector(Position, EStoryNumberPrecision::Centimetre)),
+        FString(TEXT("{\"x\":1235,\"y\":-99,\"z\":0}")));
+    TestEqual(TEXT("Vector with one decimal"),
+        FStoryPromptBuilder::SerializeCondensed(AGameStateStoryGen::SerializeVector(Position, EStoryNumberPrecision::OneDecimal)),
+        FString(TEXT("{\"x\":1234.6,\"y\":-98.8,\"z\":0}")));
+    TestEqual(TEXT("Number still reads as a number"),
+        AGameStateStoryGen::SerializeVector(Position, EStoryNumberPrecision::OneDecimal)->GetNumberField(TEXT("x")), 1234.6);
+
+    return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FStoryNumberFormatSpeedTest, "Project.GameStateStoryGen.NumberFormat.Speed", EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::PerfFilter)
+bool FStoryNumberFormatSpeedTest::RunTest(const FString& Parameters)
+{
+    const int32 Count = 100000;
+    FRandomStream Random(46);
+    TArray<double> Values;
+    for (int32 i = 0; i < Count; i++)
+    {
+        Values.Add(Random.FRandRange(-20000.0, 20000.0));
+    }
+
+    FString Printf;
+    double StartTime = FPlatformTime::Seconds();
+    for (double Value : Values)
+    {
+        Printf += FString::Printf(TEXT("%.17g"), Value);
+    }
+    const double PrintfMs = (FPlatformTime::Seconds() - StartTime) * 1000.0;
+
+    FString Fixed;
+    StartTime = FPlatformTime::Seconds();
+    for (double Value : Values)
+    {
+        FStoryNumberFormat::AppendFixed(Value, 1, Fixed);
+    }
+    const double FixedMs = (FPlatformTime::Seconds() - StartTime) * 1000.0;
+
+    AddInfo(FString::Printf(TEXT("%d numbers: printf %.2f ms, %d characters; fixed-point %.2f ms, %d characters."), Count, PrintfMs, Printf.Len(), FixedMs, Fixed.Len()));
+    TestTrue(TEXT("One decimal is less than half the characters"), Fixed.Len() * 2 < Printf.Len());
+
+    return true;
+}
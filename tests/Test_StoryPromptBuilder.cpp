@@ -0,0 +1,111 @@
+#include "CoreMinimal.h"
+#include "Misc/AutomationTest.h"
+#include "StoryPromptBuilder.h"
+#include "Serialization/JsonReader.h"
+#include "Serialization/JsonSerializer.h"
+#include "StoryTestHelpers.h"
+
+/**
+ * Tests for FStoryPromptBuilder: the byte-stable prefix the prompt cache depends on, the message order, the synopsis and the cache statistics.
+ */
+static FString GetMessageField(const TArray<TSharedPtr<FJsonValue>>& Messages, int32 Index, const TCHAR* Field)
+{
+    return Messages.IsValidIndex(Index) ? Messages[Index]->AsObject()->GetStringField(Field) : FString();
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FStoryPromptBuilderPrefixTest, "Project.GameStateStoryGen.PromptBuilder.Prefix", EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::ProductFilter)
+bool FStoryPromptBuilderPrefixTest::RunTest(const FString& Parameters)
+{
+    FStoryPromptBuilder Builder;
+    Builder.SetInstructions(TEXT("Write a short scene."));
+    Builder.SetStartEnvironment(MakeScene(TEXT("Start"), 0.0));
+
+    const TArray<TSharedPtr<FJsonValue>> First = Builder.BuildMessages(MakeScene(TEXT("Crate"), 120.0));
+    const TArray<TSharedPtr<FJsonValue>> Second = Builder.BuildMessages(MakeScene(TEXT("Lantern"), 80.0));
+
+    // Instructions, start environment, then the volatile data in the last user message
+    TestEqual(TEXT("Three messages without a synopsis"), First.Num(), 3);
+    TestEqual(TEXT("Instructions first"), GetMessageField(First, 0, TEXT("content")), FString(TEXT("Write a short scene.")));
+    TestEqual(TEXT("Instructions are a system message"), GetMessageField(First, 0, TEXT("role")), FString(TEXT("system")));
+    TestTrue(TEXT("Start environment second"), GetMessageField(First, 1, TEXT("content")).StartsWith(TEXT("Start_environment: ")));
+    TestEqual(TEXT("Volatile data last"), GetMessageField(First, 2, TEXT("role")), FString(TEXT("user")));
+    TestTrue(TEXT("Volatile data is the new scene"), GetMessageField(Second, 2, TEXT("content")).Contains(TEXT("Lantern")));
+
+    // Only the volatile message changes between requests
+    for (int32 i = 0; i < 2; i++)
+    {
+        TestEqual(FString::Printf(TEXT("Prefix message %d is byte-identical"), i), GetMessageField(Second, i, TEXT("content")), GetMessageField(First, i, TEXT("content")));
+    }
+    TestNotEqual(TEXT("Volatile message differs"), GetMessageField(Second, 2, TEXT("content")), GetMessageField(First, 2, TEXT("content")));
+
+    // The start environment is serialized once, changing the object afterwards does not change the prefix
+    TSharedPtr<FJsonObject> Start = MakeScene(TEXT("Start"), 0.0);
+    Builder.SetStartEnvironment(Start);
+    const FString Prefix = GetMessageField(Builder.BuildMessages(nullptr), 1, TEXT("content"));
+    Start->SetStringField(TEXT("TargetObject"), TEXT("Changed"));
+    TestEqual(TEXT("Start environment kept as serialized"), GetMessageField(Builder.BuildMessages(nullptr), 1, TEXT("content")), Prefix);
+
+    return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FStoryPromptBuilderSynopsisTest, "Project.GameStateStoryGen.PromptBuilder.Synopsis", EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::ProductFilter)
+bool FStoryPromptBuilderSynopsisTest::RunTest(const FString& Parameters)
+{
+    FStoryPromptBuilder Builder;
+    Builder.SetInstructions(TEXT("Write a short scene."));
+    Builder.SetStartEnvironment(MakeScene(TEXT("Start"), 0.0));
+    const TArray<TSharedPtr<FJsonValue>> Before = Builder.BuildMessages(MakeScene(TEXT("Crate"), 120.0));
+
+    // The synopsis goes after the start environment and before the volatile data
+    Builder.SetSynopsis(TEXT("The wanderer lifts the lantern."));
+    const TArray<TSharedPtr<FJsonValue>> With = Builder.BuildMessages(MakeScene(TEXT("Crate"), 120.0));
+    TestEqual(TEXT("Four messages"), With.Num(), 4);
+    TestEqual(TEXT("Synopsis third"), GetMessageField(With, 2, TEXT("content")), FString(TEXT("Story_Synopsis: The wanderer lifts the lantern.")));
+    TestEqual(TEXT("Synopsis is a system message"), GetMessageField(With, 2, TEXT("role")), FString(TEXT("system")));
+    TestEqual(TEXT("Volatile data still last"), GetMessageField(With, 3, TEXT("role")), FString(TEXT("user")));
+
+    // Adding the synopsis keeps the messages before it
+    TestEqual(TEXT("Instructions unchanged"), GetMessageField(With, 0, TEXT("content")), GetMessageField(Before, 0, TEXT("content")));
+    TestEqual(TEXT("Start environment unchanged"), GetMessageField(With, 1, TEXT("content")), GetMessageField(Before, 1, TEXT("content")));
+
+    // The same synopsis gives the same prefix, an empty one removes the message
+    Builder.SetSynopsis(TEXT("The wanderer lifts the lantern."));
+    TestEqual(TEXT("Synopsis is stable"), GetMessageField(Builder.BuildMessages(nullptr), 2, TEXT("content")), GetMessageField(With, 2, TEXT("content")));
+    Builder.SetSynopsis(FString());
+    TestEqual(TEXT("No synopsis message"), Builder.BuildMessages(nullptr).Num(), 2);
+
+    return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FStoryPromptBuilderRecordUsageTest, "Project.GameStateStoryGen.PromptBuilder.RecordUsage", EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::ProductFilter)
+bool FStoryPromptBuilderRecordUsageTest::RunTest(const FString& Parameters)
+{
+    FStoryPromptBuilder Builder;
+
+    // First request computes the whole prompt, the second finds 1024 of its tokens in the cache
+    TSharedPtr<FJsonObject> Miss;
+    FJsonSerializer::Deserialize(TJsonReaderFactory<>::Create(TEXT("{\"usage\":{\"prompt_tokens\":1200,\"prompt_tokens_details\":{\"cached_tokens\":0}}}")), Miss);
+    TSharedPtr<FJsonObject> Hit;
+    FJsonSerializer::Deserialize(TJsonReaderFactory<>::Create(TEXT("{\"usage\":{\"prompt_tokens\":1300,\"prompt_tokens_details\":{\"cached_tokens\":1024}}}")), Hit);
+    Builder.RecordUsage(Miss);
+    Builder.RecordUsage(Hit);
+
+    TestEqual(TEXT("Two requests"), Builder.GetCacheStats().Requests, int64(2));
+    TestEqual(TEXT("One hit"), Builder.GetCacheStats().CacheHits, int64(1));
+    TestEqual(TEXT("Prompt tokens summed"), Builder.GetCacheStats().PromptTokens, int64(2500));
+    TestEqual(TEXT("Cached tokens summed"), Builder.GetCacheStats().CachedTokens, int64(1024));
+    TestEqual(TEXT("Token hit ratio"), Builder.GetCacheStats().GetTokenHitRatio(), 1024.0 / 2500.0);
+
+    // A backend without prompt caching counts as a miss, a response without usage is not counted
+    TSharedPtr<FJsonObject> NoDetails;
+    FJsonSerializer::Deserialize(TJsonReaderFactory<>::Create(TEXT("{\"usage\":{\"prompt_tokens\":500}}")), NoDetails);
+    Builder.RecordUsage(NoDetails);
+    TestEqual(TEXT("Counted as a request"), Builder.GetCacheStats().Requests, int64(3));
+    TestEqual(TEXT("Not a hit"), Builder.GetCacheStats().CacheHits, int64(1));
+
+    Builder.RecordUsage(MakeShareable(new FJsonObject()));
+    Builder.RecordUsage(nullptr);
+    TestEqual(TEXT("No usage, not counted"), Builder.GetCacheStats().Requests, int64(3));
+
+    return true;
+}
@@ -0,0 +1,91 @@
+#include "CoreMinimal.h"
+#include "Misc/AutomationTest.h"
+#include "StoryPromptBuilder.h"
+#include "StorySceneEncoder.h"
+#include "StoryTestHelpers.h"
+
+/**
+ * Tests for FStorySceneEncoder: short keys, rounded numbers, tables with delta positions, escaped separators,
+ * single-line events and the size against JSON.
+ */
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FStorySceneEncoderFormatTest, "Project.GameStateStoryGen.SceneEncoder.Format", EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::ProductFilter)
+bool FStorySceneEncoderFormatTest::RunTest(const FString& Parameters)
+{
+    const FString Encoded = FStorySceneEncoder::Encode(MakeTestEnvironment(2));
+    const FString Expected =
+        TEXT("title=Lantern Hall\n")
+        TEXT("objs[2]{name,desc,int,pos,dim}:\n")
+        TEXT("Crate_0|A wooden crate|true|1000,-250,13|50,50,76\n")
+        TEXT("Crate_1|A wooden crate|true|^100,20,0|50,50,76\n");
+    TestEqual(TEXT("Environment as a table"), Encoded, Expected);
+
+    // One decimal, no delta positions
+    FStorySceneEncodingOptions Options;
+    Options.Quantum = 0.1;
+    Options.bDeltaPositions = false;
+    const FString Precise = FStorySceneEncoder::Encode(MakeTestEnvironment(2), Options);
+    TestTrue(TEXT("Rounded to one decimal"), Precise.Contains(TEXT("|1100.2,-230.4,12.6|50,50,75.5\n")));
+
+    // Nested objects and lists of strings, separators inside values are replaced
+    TSharedPtr<FJsonObject> Volatile = MakeShareable(new FJsonObject);
+    TSharedPtr<FJsonObject> Space = MakeShareable(new FJsonObject);
+    Space->SetStringField(TEXT("id"), TEXT("Hall"));
+    Space->SetNumberField(TEXT("width"), 1200.0);
+    Volatile->SetObjectField(TEXT("space"), Space);
+    Volatile->SetArrayField(TEXT("Old_AI_Responses"), { MakeShareable(new FJsonValueString(TEXT("The crate | falls.\nIt breaks."))) });
+    TestEqual(TEXT("Volatile content"), FStorySceneEncoder::Encode(Volatile),
+        FString(TEXT("space{id=Hall;w=1200}\nprev[1]:\nThe crate / falls. It breaks.\n")));
+
+    // Separators of nested objects inside their strings are escaped
+    Space->SetStringField(TEXT("id"), TEXT("Hall {east}; a=b \\ c"));
+    TestEqual(TEXT("Escaped separators"), FStorySceneEncoder::Encode(Volatile),
+        FString(TEXT("space{id=Hall \\{east\\}\\; a\\=b \\\\ c;w=1200}\nprev[1]:\nThe crate / falls. It breaks.\n")));
+    Space->SetStringField(TEXT("id"), TEXT("Hall"));
+
+    // An event of a completion session is one line
+    FStorySceneEncodingOptions SingleLine;
+    SingleLine.bSingleLine = true;
+    TestEqual(TEXT("One line"), FStorySceneEncoder::Encode(MakeTestEnvironment(2), SingleLine),
+        FString(TEXT("title=Lantern Hall ~ objs[2]{name,desc,int,pos,dim}: ~ Crate_0|A wooden crate|true|1000,-250,13|50,50,76 ~ Crate_1|A wooden crate|true|^100,20,0|50,50,76")));
+
+    // The prompt builder uses the compact encoding and adds the legend once
+    FStoryPromptBuilder Builder;
+    Builder.SetInstructions(TEXT("Tell a story."));
+    Builder.SetStartEnvironment(MakeTestEnvironment(2));
+    Builder.SetSceneEncoding(EStorySceneEncoding::Compact);
+    const TArray<TSharedPtr<FJsonValue>> Messages = Builder.BuildMessages(Volatile);
+    TestTrue(TEXT("Legend in the instructions"), Messages[0]->AsObject()->GetStringField(TEXT("content")).EndsWith(FStorySceneEncoder::GetLegend()));
+    TestEqual(TEXT("Start environment encoded again"), Messages[1]->AsObject()->GetStringField(TEXT("content")), TEXT("Start_environment: ") + Expected);
+
+    return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FStorySceneEncoderSizeTest, "Project.GameStateStoryGen.SceneEncoder.Size", EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::PerfFilter)
+bool FStorySceneEncoderSizeTest::RunTest(const FString& Parameters)
+{
+    // Size and encoding time of a start environment, as JSON and in the compact encoding
+    const TSharedPtr<FJsonObject> Environment = MakeTestEnvironment(200);
+    const int32 Iterations = 100;
+
+    FString Json;
+    double StartTime = FPlatformTime::Seconds();
+    for (int32 i = 0; i < Iterations; i++)
+    {
+        Json = FStoryPromptBuilder::SerializeCondensed(Environment);
+    }
+    const double JsonMs = (FPlatformTime::Seconds() - StartTime) * 1000.0 / Iterations;
+
+    FString Compact;
+    StartTime = FPlatformTime::Seconds();
+    for (int32 i = 0; i < Iterations; i++)
+    {
+        Compact = FStorySceneEncoder::Encode(Environment);
+    }
+    const double CompactMs = (FPlatformTime::Seconds() - StartTime) * 1000.0 / Iterations;
+
+    AddInfo(FString::Printf(TEXT("200 objects: JSON %d characters (~%d tokens, %.3f ms), compact %d characters (~%d tokens, %.3f ms)."),
+        Json.Len(), FStorySceneEncoder::EstimateTokens(Json), JsonMs, Compact.Len(), FStorySceneEncoder::EstimateTokens(Compact), CompactMs));
+    TestTrue(TEXT("Compact encoding is less than half the size of JSON"), Compact.Len() * 2 < Json.Len());
+
+    return true;
+}
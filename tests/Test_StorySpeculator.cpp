@@ -0,0 +1,92 @@
+#include "CoreMinimal.h"
+#include "Misc/AutomationTest.h"
+#include "StorySpeculator.h"
+#include "StoryTestHelpers.h"
+
+/**
+ * Tests for FStorySpeculator: prediction of the next interaction and the bookkeeping of pre-generated narrations.
+ */
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FStorySpeculatorPredictTest, "Project.GameStateStoryGen.Speculator.Predict", EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::ProductFilter)
+bool FStorySpeculatorPredictTest::RunTest(const FString& Parameters)
+{
+    FStorySpeculator Speculator;
+    Speculator.Configure(250.0, 2, 30.0);
+
+    // Player at the origin looking along X
+    const TArray<FSpeculationCandidate> Nearby = {
+        MakeCandidate(TEXT("Lantern"), FVector(200.0, 0.0, 0.0)),
+        MakeCandidate(TEXT("Crate"), FVector(50.0, 0.0, 0.0)),
+        MakeCandidate(TEXT("Rope"), FVector(100.0, 20.0, 0.0)),
+        MakeCandidate(TEXT("Behind"), FVector(-50.0, 0.0, 0.0)),
+        MakeCandidate(TEXT("Far"), FVector(400.0, 0.0, 0.0))
+    };
+
+    TArray<FSpeculationCandidate> Candidates;
+    Speculator.PredictInteractions(FVector::ZeroVector, FVector::ForwardVector, FVector::RightVector, Nearby, Candidates);
+
+    TestEqual(TEXT("At most MaxCandidates"), Candidates.Num(), 2);
+    TestEqual(TEXT("Closest ahead first"), Candidates[0].ActorName, FString(TEXT("Crate")));
+    TestEqual(TEXT("Then the next closest"), Candidates[1].ActorName, FString(TEXT("Rope")));
+    TestEqual(TEXT("Distance is filled in"), Candidates[0].Distance, 50.0);
+    TestFalse(TEXT("Objects behind the player are skipped"), Candidates.ContainsByPredicate([](const FSpeculationCandidate& C) { return C.ActorName == TEXT("Behind"); }));
+
+    return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FStorySpeculatorNarrationTest, "Project.GameStateStoryGen.Speculator.Narration", EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::ProductFilter)
+bool FStorySpeculatorNarrationTest::RunTest(const FString& Parameters)
+{
+    FStorySpeculator Speculator;
+    Speculator.Configure(250.0, 2, 30.0);
+    const TArray<FSpeculationCandidate> Candidates = { MakeCandidate(TEXT("Crate"), FVector(50.0, 0.0, 0.0)) };
+
+    TestTrue(TEXT("Needs a narration"), Speculator.NeedsNarration(TEXT("Crate")));
+    Speculator.MarkInFlight(TEXT("Crate"));
+    TestFalse(TEXT("Not requested twice"), Speculator.NeedsNarration(TEXT("Crate")));
+    Speculator.StoreNarration(TEXT("Crate"), TEXT("The crate slides."), 1.0);
+    TestEqual(TEXT("Nothing in flight"), Speculator.NumInFlight(), 0);
+
+    // Only a move within reach takes the narration, and only once
+    FString Narration;
+    TestFalse(TEXT("Out of reach"), Speculator.TakeNarration(MakeTestEvent(TEXT("Crate"), EStoryDirection::Front, 400.0), Narration));
+    TestTrue(TEXT("Predicted interaction"), Speculator.TakeNarration(MakeTestEvent(TEXT("Crate"), EStoryDirection::Front, 40.0), Narration));
+    TestEqual(TEXT("Pre-generated text"), Narration, FString(TEXT("The crate slides.")));
+    TestFalse(TEXT("Consumed"), Speculator.TakeNarration(MakeTestEvent(TEXT("Crate"), EStoryDirection::Front, 40.0), Narration));
+    TestEqual(TEXT("One hit"), Speculator.GetHits(), 1);
+
+    // Narrations expire after the lifetime
+    Speculator.MarkInFlight(TEXT("Crate"));
+    Speculator.StoreNarration(TEXT("Crate"), TEXT("The crate slides."), 1.0);
+    Speculator.Prune(Candidates, 40.0);
+    TestTrue(TEXT("Expired"), Speculator.NeedsNarration(TEXT("Crate")));
+
+    return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FStorySpeculatorPruneTest, "Project.GameStateStoryGen.Speculator.Prune", EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::ProductFilter)
+bool FStorySpeculatorPruneTest::RunTest(const FString& Parameters)
+{
+    FStorySpeculator Speculator;
+    Speculator.Configure(250.0, 2, 30.0);
+
+    // The player turns away while the request for the crate is running
+    Speculator.MarkInFlight(TEXT("Crate"));
+    Speculator.MarkInFlight(TEXT("Rope"));
+    Speculator.Prune({ MakeCandidate(TEXT("Rope"), FVector(100.0, 0.0, 0.0)) }, 2.0);
+    TestEqual(TEXT("Request of the pruned object forgotten"), Speculator.NumInFlight(), 1);
+
+    // Its late result is dropped, the one of the remaining candidate is stored
+    Speculator.StoreNarration(TEXT("Crate"), TEXT("The crate slides."), 3.0);
+    Speculator.StoreNarration(TEXT("Rope"), TEXT("The rope falls."), 3.0);
+    FString Narration;
+    TestFalse(TEXT("Pruned result dropped"), Speculator.TakeNarration(MakeTestEvent(TEXT("Crate"), EStoryDirection::Front, 40.0), Narration));
+    TestTrue(TEXT("Candidate result kept"), Speculator.TakeNarration(MakeTestEvent(TEXT("Rope"), EStoryDirection::Front, 40.0), Narration));
+
+    // A stored narration of an object that is no longer predicted is dropped as well
+    Speculator.MarkInFlight(TEXT("Rope"));
+    Speculator.StoreNarration(TEXT("Rope"), TEXT("The rope falls."), 4.0);
+    Speculator.Prune({}, 5.0);
+    TestTrue(TEXT("Dropped when no longer predicted"), Speculator.NeedsNarration(TEXT("Rope")));
+
+    return true;
+}
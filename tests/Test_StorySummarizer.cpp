@@ -0,0 +1,62 @@
+#include "CoreMinimal.h"
+#include "Misc/AutomationTest.h"
+#include "StorySummarizer.h"
+
+/**
+ * Tests for FStorySummarizer, the rolling summary of old LLM responses.
+ */
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FStorySummarizerExtractiveTest, "Project.GameStateStoryGen.Summarizer.Extractive", EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::ProductFilter)
+bool FStorySummarizerExtractiveTest::RunTest(const FString& Parameters)
+{
+    TArray<FString> OldResponses = {
+        TEXT("The wanderer lifts the lantern. Its light flickers over the boulders."),
+        TEXT("A crow lands on the stump!\nIt watches the wanderer closely."),
+        TEXT("The wanderer lifts the lantern. Nothing else happens.")
+    };
+
+    FString Synopsis = FStorySummarizer::SummarizeExtractive(TEXT(""), OldResponses, 1000);
+
+    // Only the lead sentence of every response is kept, duplicates are skipped
+    TestEqual(TEXT("Synopsis keeps lead sentences"), Synopsis, TEXT("The wanderer lifts the lantern.\nA crow lands on the stump!"));
+
+    // Appending to an existing synopsis keeps the old sentences first
+    FString Next = FStorySummarizer::SummarizeExtractive(Synopsis, { TEXT("The fog rolls in. It is cold.") }, 1000);
+    TestTrue(TEXT("New sentence is appended"), Next.EndsWith(TEXT("The fog rolls in.")));
+    TestTrue(TEXT("Old sentences are kept"), Next.StartsWith(TEXT("The wanderer lifts the lantern.")));
+
+    // When the limit is reached the oldest sentences are dropped
+    FString Short = FStorySummarizer::SummarizeExtractive(Synopsis, { TEXT("The fog rolls in. It is cold.") }, 20);
+    TestEqual(TEXT("Only the most recent sentence fits"), Short, TEXT("The fog rolls in."));
+
+    return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FStorySummarizerHistoryTest, "Project.GameStateStoryGen.Summarizer.History", EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::ProductFilter)
+bool FStorySummarizerHistoryTest::RunTest(const FString& Parameters)
+{
+    FStorySummarizer Summarizer;
+    Summarizer.Configure(4, 2, 500);
+
+    for (int32 i = 0; i < 4; i++)
+    {
+        Summarizer.AddResponse(FString::Printf(TEXT("Response %d."), i));
+    }
+
+    // Below the threshold nothing is compacted
+    TestFalse(TEXT("No compaction below the threshold"), Summarizer.IsCompacting());
+    TestEqual(TEXT("All responses are kept"), Summarizer.GetResponseCount(), 4);
+
+    Summarizer.AddResponse(TEXT("Response 4."));
+    TArray<FString> Recent;
+    Summarizer.GetRecentResponses(Recent);
+
+    // Responses being compacted are still sent until the synopsis is ready
+    TestTrue(TEXT("Compaction started or already finished"), Summarizer.IsCompacting() || !Summarizer.GetSynopsis().IsEmpty());
+    TestTrue(TEXT("Last response is always kept verbatim"), Recent.Num() >= 2 && Recent.Last() == TEXT("Response 4."));
+
+    Summarizer.Reset();
+    TestEqual(TEXT("Reset clears the history"), Summarizer.GetResponseCount(), 0);
+    TestTrue(TEXT("Reset clears the synopsis"), Summarizer.GetSynopsis().IsEmpty());
+
+    return true;
+}
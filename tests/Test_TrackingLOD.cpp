@@ -0,0 +1,111 @@
+#include "CoreMinimal.h"
+#include "Misc/AutomationTest.h"
+#include "TrackingLOD.h"
+
+/**
+ * Tests for FTrackingLOD: tier classification and the checks collected per frame.
+ */
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FTrackingLODTiersTest, "Project.GameStateStoryGen.TrackingLOD.Tiers", EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::ProductFilter)
+bool FTrackingLODTiersTest::RunTest(const FString& Parameters)
+{
+    FTrackingLOD LOD;
+    LOD.Configure(FTrackingLODSettings());
+    LOD.Reset(4);
+    TestEqual(TEXT("All objects start near"), LOD.NumInTier(ETrackingTier::Near), 4);
+
+    LOD.Assign(0, 100.0, false);
+    LOD.Assign(1, 1500.0, true);
+    LOD.Assign(2, 1500.0, false);
+    LOD.Assign(3, 10000.0, true);
+
+    TestTrue(TEXT("Close object is near, moving or not"), LOD.GetTier(0) == ETrackingTier::Near);
+    TestTrue(TEXT("Moving object in mid range is mid"), LOD.GetTier(1) == ETrackingTier::Mid);
+    TestTrue(TEXT("Idle object in mid range is far"), LOD.GetTier(2) == ETrackingTier::Far);
+    TestTrue(TEXT("Distant object is far"), LOD.GetTier(3) == ETrackingTier::Far);
+    TestEqual(TEXT("Far tier"), LOD.NumInTier(ETrackingTier::Far), 2);
+
+    // Moving back keeps the index arrays consistent
+    LOD.Assign(2, 100.0, false);
+    TestTrue(TEXT("Object moved back to near"), LOD.GetTier(2) == ETrackingTier::Near);
+    TestEqual(TEXT("Near tier"), LOD.NumInTier(ETrackingTier::Near), 2);
+    TestEqual(TEXT("Far tier after the move"), LOD.NumInTier(ETrackingTier::Far), 1);
+
+    return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FTrackingLODCollectTest, "Project.GameStateStoryGen.TrackingLOD.Collect", EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::ProductFilter)
+bool FTrackingLODCollectTest::RunTest(const FString& Parameters)
+{
+    FTrackingLODSettings Settings;
+    Settings.MidInterval = 0.5;
+    Settings.FarInterval = 3.0;
+    FTrackingLOD LOD;
+    LOD.Configure(Settings);
+
+    // 10 near, 30 mid and 300 far objects
+    LOD.Reset(340);
+    for (int32 Index = 10; Index < 40; Index++)
+    {
+        LOD.Assign(Index, 1500.0, true);
+    }
+    for (int32 Index = 40; Index < 340; Index++)
+    {
+        LOD.Assign(Index, 10000.0, false);
+    }
+
+    // At 10 frames per second each mid object is checked every 5 frames, each far object every 30
+    TMap<int32, int32> Checks;
+    TArray<int32> Due;
+    for (int32 Frame = 0; Frame < 30; Frame++)
+    {
+        LOD.CollectDue(0.1, Due);
+        for (int32 Index : Due)
+        {
+            Checks.FindOrAdd(Index)++;
+        }
+    }
+    TestEqual(TEXT("Near object every frame"), Checks.FindRef(0), 30);
+    TestEqual(TEXT("Mid object every 0.5 s"), Checks.FindRef(10), 6);
+    TestEqual(TEXT("Far object every 3 s"), Checks.FindRef(40), 1);
+    TestEqual(TEXT("Checks over 3 s"), (int32)LOD.GetSamples(), 10 * 30 + 30 * 6 + 300);
+
+    // The frame cap bounds the checks of a frame, near objects first
+    Settings.MaxSamplesPerFrame = 12;
+    LOD.Configure(Settings);
+    LOD.CollectDue(3.0, Due);
+    TestEqual(TEXT("Checks are capped"), Due.Num(), 12);
+    TestTrue(TEXT("Near objects come first"), Due.Contains(0) && Due.Contains(9));
+
+    return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FTrackingLODAddRemoveTest, "Project.GameStateStoryGen.TrackingLOD.AddRemove", EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::ProductFilter)
+bool FTrackingLODAddRemoveTest::RunTest(const FString& Parameters)
+{
+    FTrackingLOD LOD;
+    LOD.Configure(FTrackingLODSettings());
+    LOD.Reset(3);
+    LOD.Assign(2, 10000.0, false);
+
+    // A destroyed actor frees its slot, it is never collected again
+    LOD.Remove(1);
+    TestTrue(TEXT("Removed object is in no tier"), LOD.GetTier(1) == ETrackingTier::Count);
+    TestEqual(TEXT("Near tier after the removal"), LOD.NumInTier(ETrackingTier::Near), 1);
+    LOD.Assign(1, 100.0, true);
+    TestTrue(TEXT("Free slot is not assigned"), LOD.GetTier(1) == ETrackingTier::Count);
+
+    TArray<int32> Due;
+    LOD.CollectDue(0.1, Due);
+    TestFalse(TEXT("Free slot is not collected"), Due.Contains(1));
+
+    // A spawned actor reuses the slot or grows the arrays, and starts near
+    LOD.Add(1);
+    LOD.Add(5);
+    TestTrue(TEXT("Reused slot starts near"), LOD.GetTier(1) == ETrackingTier::Near);
+    TestTrue(TEXT("Appended object starts near"), LOD.GetTier(5) == ETrackingTier::Near);
+    TestTrue(TEXT("Skipped indices are free"), LOD.GetTier(4) == ETrackingTier::Count);
+    TestEqual(TEXT("Near tier after the additions"), LOD.NumInTier(ETrackingTier::Near), 3);
+    TestEqual(TEXT("Far tier is untouched"), LOD.NumInTier(ETrackingTier::Far), 1);
+
+    return true;
+}
@@ -0,0 +1,385 @@
+#include "CoreMinimal.h"
+#include "Misc/AutomationTest.h"
+#include "Async/TaskGraphInterfaces.h"
+#include "HAL/PlatformTime.h"
+#include "TrackingSweep.h"
+#include "GameStateStoryGen.h"
+#include "GameFramework/PlayerState.h"
+#include "Kismet/GameplayStatics.h"
+#include "Engine/World.h"
+#include "Engine/Level.h"
+#include "GameMapsSettings.h"
+#include "Misc/CommandLine.h"
+#include "StoryTestHelpers.h"
+
+/**
+ * Tests for FTrackingSweep: relativity, ordered lock-free merge, the sweep time split into 1 to N chunks,
+ * the chunking of a default tracking slice, the bulk relativity against cached player views
+ * the rate of events the game state publishes for an object that moves every frame
+ * and the share of the actors of a production level that is tracked.
+ */
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FTrackingSweepRelativityTest, "Project.GameStateStoryGen.Tracking.Relativity", EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::ProductFilter)
+bool FTrackingSweepRelativityTest::RunTest(const FString& Parameters)
+{
+    const FTrackingPlayerView Player = MakePlayer();
+    double Distance = 0.0;
+    EStoryDirection Direction = EStoryDirection::Behind;
+
+    TestTrue(TEXT("Near object is related"), FTrackingSweep::GetRelativity(Player, FVector(300.0, 0.0, 0.0), 800.0, Distance, Direction));
+    TestEqual(TEXT("Distance"), Distance, 300.0);
+    TestTrue(TEXT("Object is in front"), Direction == EStoryDirection::Front);
+
+    TestFalse(TEXT("Far object is not related"), FTrackingSweep::GetRelativity(Player, FVector(0.0, 800.0, 0.0), 800.0, Distance, Direction));
+
+    // Chunks are merged in index order, whatever thread ran them
+    TArray<FVector> Current;
+    TArray<FVector> Previous;
+    for (int32 i = 0; i < 1000; i++)
+    {
+        Current.Add(FVector(i % 7 == 0 ? 100.0 : 0.0, 0.0, 0.0));
+        Previous.Add(FVector::ZeroVector);
+    }
+    TArray<FTrackedMovement> Moved = SweepPositions(Current, Previous, Player, 8);
+    TestEqual(TEXT("Every seventh object moved"), Moved.Num(), 143);
+    bool bOrdered = true;
+    for (int32 i = 1; i < Moved.Num(); i++)
+    {
+        bOrdered &= Moved[i - 1].Index < Moved[i].Index;
+    }
+    TestTrue(TEXT("Movements are in index order"), bOrdered);
+    TestEqual(TEXT("Unmoved objects are not reported again"), SweepPositions(Current, Previous, Player, 8).Num(), 0);
+
+    return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FTrackingSweepChunkScalingTest, "Project.GameStateStoryGen.Tracking.ChunkScaling", EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::PerfFilter)
+bool FTrackingSweepChunkScalingTest::RunTest(const FString& Parameters)
+{
+    // 50k tracked objects, a tenth of them moved near the player
+    const int32 NumObjects = 50000;
+    const FTrackingPlayerView Player = MakePlayer();
+    FRandomStream Random(36);
+
+    TArray<FVector> Current;
+    TArray<FVector> Start;
+    for (int32 i = 0; i < NumObjects; i++)
+    {
+        FVector Position(Random.FRandRange(-5000.0, 5000.0), Random.FRandRange(-5000.0, 5000.0), Random.FRandRange(0.0, 500.0));
+        Start.Add(Position);
+        Current.Add(i % 10 == 0 ? Random.VRand() * Random.FRandRange(0.0, 1000.0) : Position);
+    }
+
+    // 1, 2, 4, ... chunks up to one per worker thread plus the game thread. Each chunk is swept by
+    // one thread, so the chunk count caps the threads of a sweep, the task graph may use fewer.
+    const int32 MaxChunks = FTaskGraphInterface::Get().GetNumWorkerThreads() + 1;
+    TArray<int32> ChunkCounts;
+    for (int32 Chunks = 1; Chunks < MaxChunks; Chunks *= 2)
+    {
+        ChunkCounts.Add(Chunks);
+    }
+    ChunkCounts.Add(MaxChunks);
+
+    double SingleChunkMs = 0.0;
+    TArray<FTrackedMovement> Expected;
+
+    for (int32 Chunks : ChunkCounts)
+    {
+        const int32 Runs = 5;
+        double TotalMs = 0.0;
+        TArray<FTrackedMovement> Moved;
+        for (int32 Run = 0; Run < Runs; Run++)
+        {
+            TArray<FVector> Previous = Start;
+            const double StartTime = FPlatformTime::Seconds();
+            Moved = SweepPositions(Current, Previous, Player, Chunks);
+            TotalMs += (FPlatformTime::Seconds() - StartTime) * 1000.0;
+        }
+        const double AverageMs = TotalMs / Runs;
+
+        if (Chunks == 1)
+        {
+            SingleChunkMs = AverageMs;
+            Expected = Moved;
+        }
+        else
+        {
+            TestEqual(FString::Printf(TEXT("Same movements with %d chunks"), Chunks), Moved.Num(), Expected.Num());
+        }
+        AddInfo(FString::Printf(TEXT("%d chunk(s), at most as many threads: %.3f ms per sweep, speedup %.2fx"), Chunks, AverageMs, AverageMs > 0.0 ? SingleChunkMs / AverageMs : 0.0));
+    }
+
+    return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FTrackingSweepChunksTest, "Project.GameStateStoryGen.Tracking.Chunks", EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::ProductFilter)
+bool FTrackingSweepChunksTest::RunTest(const FString& Parameters)
+{
+    // The defaults of AGameStateStoryGen: TrackingSliceSize 256, ParallelTrackingBatchSize 64
+    const int32 SliceSize = 256;
+    const int32 BatchSize = 64;
+
+    TestEqual(TEXT("Less than two batches stay on one chunk"), FTrackingSweep::GetNumChunks(BatchSize + 1, BatchSize), 1);
+    if (FTaskGraphInterface::IsRunning() && FTaskGraphInterface::Get().GetNumWorkerThreads() > 0)
+    {
+        TestTrue(TEXT("A default slice is split over workers"), FTrackingSweep::GetNumChunks(SliceSize, BatchSize) > 1);
+    }
+    TestTrue(TEXT("Chunks hold at least a batch"), FTrackingSweep::GetNumChunks(SliceSize, BatchSize) <= SliceSize / BatchSize);
+
+    return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FTrackingSweepBulkRelativityTest, "Project.GameStateStoryGen.Tracking.BulkRelativity", EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::ProductFilter)
+bool FTrackingSweepBulkRelativityTest::RunTest(const FString& Parameters)
+{
+    FTrackingPlayerView Player = MakePlayer();
+    Player.Position = FVector(100.0, -50.0, 0.0);
+    Player.Forward = FVector(1.0, 1.0, 0.0).GetSafeNormal();
+    Player.Right = FVector(-1.0, 1.0, 0.0).GetSafeNormal();
+    FRandomStream Random(40);
+
+    TArray<FTrackedMovement> Moved;
+    for (int32 i = 0; i < 500; i++)
+    {
+        FTrackedMovement& Movement = Moved.AddDefaulted_GetRef();
+        Movement.Index = i;
+        Movement.Location = Player.Position + Random.VRand() * Random.FRandRange(0.0, 1600.0);
+        Movement.Distance = FVector::Dist(Movement.Location, Player.Position);
+    }
+
+    // The bulk pass gives the same result as one GetRelativity() per movement
+    TArray<FTrackedMovement> Expected;
+    for (const FTrackedMovement& Movement : Moved)
+    {
+        FTrackedMovement Single = Movement;
+        if (FTrackingSweep::GetRelativity(Player, Movement.Location, 800.0, Single.Distance, Single.Direction))
+        {
+            Expected.Add(Single);
+        }
+    }
+    FTrackingSweep::GetRelativities(Player, 800.0, Moved);
+
+    TestEqual(TEXT("Same movements near the player"), Moved.Num(), Expected.Num());
+    bool bSame = Moved.Num() == Expected.Num();
+    for (int32 i = 0; bSame && i < Moved.Num(); i++)
+    {
+        bSame = Moved[i].Index == Expected[i].Index && Moved[i].Direction == Expected[i].Direction;
+    }
+    TestTrue(TEXT("Same order and directions"), bSame);
+
+    return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FTrackingSweepMultiPlayerTest, "Project.GameStateStoryGen.Tracking.MultiPlayer", EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::ProductFilter)
+bool FTrackingSweepMultiPlayerTest::RunTest(const FString& Parameters)
+{
+    // Two players 1000 units apart facing each other, and a third without a pawn
+    TArray<FTrackingPlayerView> Players;
+    Players.Add(MakePlayer());
+    FTrackingPlayerView& Remote = Players.Add_GetRef(MakePlayer());
+    Remote.Position = FVector(1000.0, 0.0, 0.0);
+    Remote.Forward = -FVector::ForwardVector;
+    Remote.Right = -FVector::RightVector;
+    Players.AddDefaulted();
+
+    const FVector Between(500.0, 0.0, 0.0);
+    const FVector NearRemote(1300.0, 0.0, 0.0);
+    TestEqual(TEXT("Distance to the nearest player"), FTrackingSweep::GetNearestDistance(Players, NearRemote), 300.0);
+    TestEqual(TEXT("No valid player is infinitely far"), FTrackingSweep::GetNearestDistance(MakeArrayView(&Players[2], 1), Between), TNumericLimits<double>::Max());
+
+    TArray<FTrackedMovement> Moved;
+    for (const FVector& Location : { Between, NearRemote })
+    {
+        FTrackedMovement& Movement = Moved.AddDefaulted_GetRef();
+        Movement.Index = Moved.Num() - 1;
+        Movement.Location = Location;
+        Movement.Distance = FTrackingSweep::GetNearestDistance(Players, Location);
+    }
+    FTrackingSweep::GetRelativities(Players, 800.0, Moved);
+
+    // The object between the players is near both, the other one only near the remote player
+    TestEqual(TEXT("One entry per player a movement is near"), Moved.Num(), 3);
+    if (Moved.Num() == 3)
+    {
+        TestTrue(TEXT("Between, for the local player"), Moved[0].Index == 0 && Moved[0].Player == 0 && Moved[0].Direction == EStoryDirection::Front);
+        TestTrue(TEXT("Between, for the remote player"), Moved[1].Index == 0 && Moved[1].Player == 1 && Moved[1].Direction == EStoryDirection::Front);
+        TestTrue(TEXT("Behind the remote player"), Moved[2].Index == 1 && Moved[2].Player == 1 && Moved[2].Direction == EStoryDirection::Behind);
+        TestEqual(TEXT("Distance to the remote player"), Moved[2].Distance, 300.0);
+    }
+
+    return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FTrackingSweepManyMoversTest, "Project.GameStateStoryGen.Tracking.ManyMovers", EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::PerfFilter)
+bool FTrackingSweepManyMoversTest::RunTest(const FString& Parameters)
+{
+    // 10k tracked objects that all moved. The player registers first, so it is the first tracked object.
+    struct FObject
+    {
+        FVector Location;
+        FVector Forward;
+        FVector Right;
+        bool IsPlayer = false;
+    };
+    const int32 NumObjects = 10000;
+    FRandomStream Random(40);
+
+    TArray<FObject> Objects;
+    FObject& PlayerObject = Objects.AddDefaulted_GetRef();
+    PlayerObject.Forward = FVector::ForwardVector;
+    PlayerObject.Right = FVector::RightVector;
+    PlayerObject.IsPlayer = true;
+    for (int32 i = 1; i < NumObjects; i++)
+    {
+        FObject& Object = Objects.AddDefaulted_GetRef();
+        Object.Location = Random.VRand() * Random.FRandRange(0.0, 1600.0);
+        Object.Forward = FVector::ForwardVector;
+        Object.Right = FVector::RightVector;
+    }
+
+    // Before: each slice searched the tracked objects for the player, then every moved object
+    // computed its distance and direction with GetRelativity() during detection
+    double StartTime = FPlatformTime::Seconds();
+    TArray<FTrackedMovement> PerMover;
+    {
+        FTrackingPlayerView Player;
+        for (const FObject& Object : Objects)
+        {
+            if (Object.IsPlayer)
+            {
+                Player.Position = Object.Location;
+                Player.Forward = Object.Forward;
+                Player.Right = Object.Right;
+                break;
+            }
+        }
+        FTrackingSweep::Run(1, NumObjects, 1, [&Objects, &Player](int32 Index, FTrackedMovement& OutMovement)
+        {
+            return FTrackingSweep::GetRelativity(Player, Objects[Index].Location, 800.0, OutMovement.Distance, OutMovement.Direction);
+        }, PerMover);
+    }
+    const double PerMoverMs = (FPlatformTime::Seconds() - StartTime) * 1000.0;
+
+    // After: the player view is read once per sweep, detection only records the nearest distance
+    // and the movements are related in bulk
+    StartTime = FPlatformTime::Seconds();
+    const FTrackingPlayerView Player = MakePlayer();
+    TArray<FTrackedMovement> Moved;
+    FTrackingSweep::Run(1, NumObjects, 1, MakeArrayView(&Player, 1), 800.0, [&Objects, &Player](int32 Index, FTrackedMovement& OutMovement)
+    {
+        OutMovement.Location = Objects[Index].Location;
+        OutMovement.Distance = FTrackingSweep::GetNearestDistance(MakeArrayView(&Player, 1), OutMovement.Location);
+        return true;
+    }, Moved);
+    const double BulkMs = (FPlatformTime::Seconds() - StartTime) * 1000.0;
+
+    TestEqual(TEXT("Same movements near the player"), Moved.Num(), PerMover.Num());
+    AddInfo(FString::Printf(TEXT("%d movers on one thread: %.3f ms relating each mover during detection, %.3f ms relating them in bulk (%.2fx)"),
+        NumObjects - 1, PerMoverMs, BulkMs, BulkMs > 0.0 ? PerMoverMs / BulkMs : 0.0));
+
+    return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FTrackingSweepPublishRateTest, "Project.GameStateStoryGen.Tracking.PublishRate", EAutomationTestFlags::EditorContext | EAutomationTestFlags::ProductFilter)
+bool FTrackingSweepPublishRateTest::RunTest(const FString& Parameters)
+{
+    UWorld* World = UGameplayStatics::CreateWorld(EWorldType::Game, false, FName("PublishRateWorld"));
+    if (!World)
+    {
+        AddError(TEXT("Failed to create test world."));
+        return false;
+    }
+    AGameStateStoryGen* GameState = World->SpawnActor<AGameStateStoryGen>();
+    APlayerState* PlayerState = World->SpawnActor<APlayerState>();
+    AActor* Lantern = World->SpawnActor<AActor>();
+    if (!GameState || !PlayerState || !Lantern)
+    {
+        AddError(TEXT("Failed to spawn the game state, the player state or the object."));
+        World->DestroyWorld(false);
+        return false;
+    }
+    GameState->EventPublishInterval = 1.0f;
+    GameState->bSpeculativeNarration = false;
+    GameState->bLatencyTracing = false;
+    GameState->RegisterActor(Lantern);
+    const int32 Slot = GameState->FindTrackedSlot(Lantern);
+    const int32 PlayerIndex = GameState->FindOrAddPlayer(PlayerState);
+    FStoryPlayerStream* Stream = GameState->GetPlayerStream(PlayerIndex);
+    TestNotEqual(TEXT("Object is tracked"), Slot, (int32)INDEX_NONE);
+    TestNotNull(TEXT("Stream of the player"), Stream);
+    if (Slot == INDEX_NONE || !Stream)
+    {
+        World->DestroyWorld(false);
+        return false;
+    }
+
+    // An object carried in front of the player moves every frame at 90 Hz for 5 s. Fewer than ten events
+    // are published, so no batch is sent. Each movement has its own distance to tell the events apart.
+    const double FrameTime = 1.0 / 90.0;
+    const int32 NumFrames = 450;
+    TArray<double> PublishedTimes;
+    for (int32 Frame = 1; Frame <= NumFrames; Frame++)
+    {
+        const double Now = Frame * FrameTime;
+        FTrackedMovement Movement;
+        Movement.Index = Slot;
+        Movement.Player = PlayerIndex;
+        Movement.Location = FVector(100.0, 10.0 * FMath::Sin(Now), 0.0);
+        Movement.Distance = Frame;
+        GameState->PublishMovements({ Movement }, Now);
+
+        if (Stream->Events.Num() > 0 && Stream->Events.Last().Distance == Frame)
+        {
+            PublishedTimes.Add(Now);
+        }
+    }
+
+    const int32 MaxPublished = FMath::CeilToInt(NumFrames * FrameTime / GameState->EventPublishInterval) + 1;
+    TestTrue(TEXT("The first movement is published"), PublishedTimes.Num() > 0 && PublishedTimes[0] == FrameTime);
+    TestTrue(FString::Printf(TEXT("%d events, at most one per interval (%d)"), PublishedTimes.Num(), MaxPublished), PublishedTimes.Num() > 1 && PublishedTimes.Num() <= MaxPublished);
+    for (int32 i = 1; i < PublishedTimes.Num(); i++)
+    {
+        TestTrue(FString::Printf(TEXT("Event %d is an interval after the previous one"), i), PublishedTimes[i] - PublishedTimes[i - 1] >= GameState->EventPublishInterval);
+    }
+
+    // An object that was never published, or not within the interval, is due
+    TestTrue(TEXT("Never published"), FTrackingSweep::IsPublishDue(-1.0, 0.0, 1.0));
+    TestFalse(TEXT("Within the interval"), FTrackingSweep::IsPublishDue(5.0, 5.5, 1.0));
+    TestTrue(TEXT("After the interval"), FTrackingSweep::IsPublishDue(5.0, 6.0, 1.0));
+
+    World->DestroyWorld(false);
+    return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FTrackingSweepLevelReductionTest, "Project.GameStateStoryGen.Tracking.LevelReduction", EAutomationTestFlags::EditorContext | EAutomationTestFlags::PerfFilter)
+bool FTrackingSweepLevelReductionTest::RunTest(const FString& Parameters)
+{
+    // The game's default map, or -LevelReductionMap=/Game/Maps/<Map>. Actors of streamed sublevels are not counted.
+    FString MapPath = UGameMapsSettings::GetGameDefaultMap();
+    FParse::Value(FCommandLine::Get(), TEXT("LevelReductionMap="), MapPath);
+    UWorld* World = LoadObject<UWorld>(nullptr, *MapPath);
+    if (!World || !World->PersistentLevel)
+    {
+        AddError(FString::Printf(TEXT("Could not load the map %s."), *MapPath));
+        return false;
+    }
+
+    // Same classification as AGameStateStoryGen::GetActors()
+    int32 NumCandidates = 0;
+    int32 Classified[(int32)EActorTracking::Count] = {};
+    for (AActor* Actor : World->PersistentLevel->Actors)
+    {
+        if (Actor && AGameStateStoryGen::IsTrackingCandidate(Actor))
+        {
+            NumCandidates++;
+            Classified[(int32)AGameStateStoryGen::ClassifyActor(Actor)]++;
+        }
+    }
+
+    const int32 NumTracked = Classified[(int32)EActorTracking::Tracked];
+    AddInfo(FString::Printf(TEXT("%s: %d of %d candidate actors tracked (%.1f%%), skipped %d static, %d editor-only and %d excluded by tag."),
+        *MapPath, NumTracked, NumCandidates, NumCandidates > 0 ? NumTracked * 100.0 / NumCandidates : 0.0,
+        Classified[(int32)EActorTracking::Static], Classified[(int32)EActorTracking::EditorOnly], Classified[(int32)EActorTracking::Excluded]));
+    TestTrue(TEXT("The level has actors"), NumCandidates > 0);
+
+    return true;
+}
@@ -0,0 +1,117 @@
+#include "CoreMinimal.h"
+#include "Misc/AutomationTest.h"
+#include "WorldSnapshot.h"
+#include "WorldBounds.h"
+#include "GameStateStoryGen.h"
+#include "projectGameMode.h"
+#include "StoryTestHelpers.h"
+
+/**
+ * Tests for JSON built from a FWorldSnapshot, without a world or game thread access.
+ */
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FWorldSnapshotEnvironmentTest, "Project.GameStateStoryGen.Snapshot.Environment", EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::ProductFilter)
+bool FWorldSnapshotEnvironmentTest::RunTest(const FString& Parameters)
+{
+    FWorldSnapshot Snapshot;
+    Snapshot.bHasWorld = true;
+    Snapshot.Actors.Add(MakeActor(TEXT("Lantern"), FVector(100.0, 0.0, 50.0), FVector(10.0), { TEXT("Type:Tool"), TEXT("Description: An old lantern "), TEXT("Interactable:true") }));
+    Snapshot.Actors.Add(MakeActor(TEXT("Stone_Wall"), FVector::ZeroVector, FVector(100.0), { TEXT("Type:Wall") }));
+    Snapshot.Actors.Add(MakeActor(TEXT("Marker"), FVector::ZeroVector, FVector::ZeroVector, { TEXT("Type:Marker") }));
+    Snapshot.Bounds = FBox(FVector(-100.0, -100.0, -100.0), FVector(110.0, 100.0, 100.0));
+
+    const FActorSnapshot& Lantern = Snapshot.Actors[0];
+    TestEqual(TEXT("Tag value is trimmed"), Lantern.FindTag(TEXT("Description:"), TEXT("none")), FString(TEXT("An old lantern")));
+    TestEqual(TEXT("Missing tag gives the default"), Lantern.FindTag(TEXT("Owner:"), TEXT("none")), FString(TEXT("none")));
+
+    TSharedPtr<FJsonObject> Environment = AGameStateStoryGen::BuildEnvironment(Snapshot, TEXT("Woods Adventure"), TEXT("Forest"), TEXT("A dark forest"));
+    TestEqual(TEXT("Game title"), Environment->GetStringField(TEXT("game_title")), FString(TEXT("Woods Adventure")));
+    TestTrue(TEXT("Space is set"), Environment->HasField(TEXT("space")));
+    TSharedPtr<FJsonObject> Space = Environment->GetObjectField(TEXT("space"));
+    TestEqual(TEXT("Width from the bounds"), Space->GetObjectField(TEXT("dimensions"))->GetNumberField(TEXT("width")), 210.0);
+    TestEqual(TEXT("Minimum x from the bounds"), Space->GetObjectField(TEXT("bounds"))->GetNumberField(TEXT("x_min")), -100.0);
+
+    const TArray<TSharedPtr<FJsonValue>>* Objects = nullptr;
+    TestTrue(TEXT("Objects are set"), Environment->TryGetArrayField(TEXT("objects"), Objects));
+    if (Objects)
+    {
+        // Walls and actors without bounds are filtered out
+        TestEqual(TEXT("Only the lantern is an object"), Objects->Num(), 1);
+        if (Objects->Num() == 1)
+        {
+            TSharedPtr<FJsonObject> Object = (*Objects)[0]->AsObject();
+            TestEqual(TEXT("Name"), Object->GetStringField(TEXT("name")), FString(TEXT("Lantern")));
+            TestEqual(TEXT("Type"), Object->GetStringField(TEXT("type")), FString(TEXT("Tool")));
+            TestEqual(TEXT("Interactable"), Object->GetStringField(TEXT("Interactable")), FString(TEXT("true")));
+            TestEqual(TEXT("Full size"), Object->GetObjectField(TEXT("dimensions"))->GetNumberField(TEXT("x")), 20.0);
+        }
+    }
+
+    // Without a world only the general data is set
+    FWorldSnapshot Empty;
+    TSharedPtr<FJsonObject> NoWorld = AGameStateStoryGen::BuildEnvironment(Empty, TEXT("Woods Adventure"), TEXT("Forest"), TEXT("A dark forest"));
+    TestFalse(TEXT("No objects without a world"), NoWorld->HasField(TEXT("objects")));
+
+    return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FWorldBoundsTest, "Project.GameStateStoryGen.Snapshot.Bounds", EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::ProductFilter)
+bool FWorldBoundsTest::RunTest(const FString& Parameters)
+{
+    // Only used as keys, the boxes are passed in
+    const AActor* Lantern = NewObject<AActor>();
+    const AActor* Crate = NewObject<AActor>();
+    const AActor* Gate = NewObject<AActor>();
+    const AActor* Sky = NewObject<AActor>();
+
+    FWorldBounds Bounds;
+    TestFalse(TEXT("No bounds without actors"), Bounds.GetBounds().IsValid != 0);
+
+    Bounds.Update(Crate, FVector(0.0), FVector(50.0));
+    Bounds.Update(Gate, FVector(500.0, 0.0, 0.0), FVector(50.0));
+    Bounds.Update(Lantern, FVector(200.0, 0.0, 0.0), FVector(10.0));
+    Bounds.Update(Sky, FVector(0.0), FVector(100000.0));
+    TestEqual(TEXT("Huge boxes are left out"), Bounds.Num(), 3);
+    TestEqual(TEXT("Bounds grow with new boxes"), Bounds.GetBounds().Max.X, 550.0);
+
+    // Moving inside the bounds needs no recompute
+    Bounds.Update(Lantern, FVector(300.0, 0.0, 0.0), FVector(10.0));
+    TestEqual(TEXT("Box inside the bounds"), Bounds.GetBounds().Min.X, -50.0);
+    TestEqual(TEXT("No recompute"), Bounds.GetRecomputes(), 0);
+
+    // The gate on the edge moves inward, the bounds shrink
+    Bounds.Update(Gate, FVector(400.0, 0.0, 0.0), FVector(50.0));
+    TestEqual(TEXT("Bounds shrink"), Bounds.GetBounds().Max.X, 450.0);
+    TestEqual(TEXT("One recompute"), Bounds.GetRecomputes(), 1);
+
+    Bounds.Remove(Gate);
+    TestEqual(TEXT("Bounds of the remaining boxes"), Bounds.GetBounds().Max.X, 310.0);
+
+    // A destroyed actor without a Remove() is dropped at the next recompute
+    const_cast<AActor*>(Crate)->MarkAsGarbage();
+    Bounds.Update(Lantern, FVector(250.0, 0.0, 0.0), FVector(10.0));
+    TestEqual(TEXT("Stale box is left out"), Bounds.GetBounds().Min.X, 240.0);
+    TestEqual(TEXT("Stale box is dropped"), Bounds.Num(), 1);
+
+    return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FWorldSnapshotWorldDataTest, "Project.GameMode.Snapshot.WorldData", EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::ProductFilter)
+bool FWorldSnapshotWorldDataTest::RunTest(const FString& Parameters)
+{
+    FWorldSnapshot Snapshot;
+    Snapshot.bHasWorld = true;
+    Snapshot.Actors.Add(MakeActor(TEXT("Rock"), FVector(1.0, 2.0, 3.0), FVector::ZeroVector, {}));
+    FActorSnapshot& Sky = Snapshot.Actors.Add_GetRef(MakeActor(TEXT("Sky"), FVector::ZeroVector, FVector::ZeroVector, {}));
+    Sky.ClassName = TEXT("SkyLight");
+
+    // The same snapshot always gives the same JSON, so unchanged worlds compare equal
+    FString Json = AprojectGameMode::BuildWorldDataJson(Snapshot);
+    TestEqual(TEXT("JSON is deterministic"), AprojectGameMode::BuildWorldDataJson(Snapshot), Json);
+    TestTrue(TEXT("Actor is listed"), Json.Contains(TEXT("Rock_C_0")));
+    TestTrue(TEXT("Lighting is listed"), Json.Contains(TEXT("\"Lighting\"")));
+
+    Snapshot.Actors[0].Position.X = 5.0;
+    TestNotEqual(TEXT("Moved actor changes the JSON"), AprojectGameMode::BuildWorldDataJson(Snapshot), Json);
+
+    return true;
+}